@@ -228,6 +228,19 @@ void LLCharacter::updateMotions(e_update_t update_type)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// applyDeferredPose()
+//-----------------------------------------------------------------------------
+void LLCharacter::applyDeferredPose()
+{
+	mMotionController.applyDeferredPose();
+	LLJoint* root = getRootJoint();
+	if (root)
+	{
+		root->updateWorldMatrixChildren();
+	}
+}
+
 
 //-----------------------------------------------------------------------------
 // deactivateAllMotions()
@@ -158,6 +158,10 @@ public:
 	enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
 	void updateMotions(e_update_t update_type);
 
+	// Applies the pose that updateMotions() deferred (see LLMotionController::deferPoseUpdate)
+	// and updates the world matrices of the whole skeleton. Used by LLCharacterUpdatePool.
+	void applyDeferredPose();
+
 	LLAnimPauseRequest requestPause();
 	void requestPause(std::vector<LLAnimPauseRequest>& avatar_pause_handles);
 	void pauseAllSyncedCharacters(std::vector<LLAnimPauseRequest>& avatar_pause_handles);
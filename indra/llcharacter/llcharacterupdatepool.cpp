@@ -0,0 +1,162 @@
+/**
+ * @file llcharacterupdatepool.cpp
+ * @brief Threads that apply the poses of many characters in parallel.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+//-----------------------------------------------------------------------------
+// Header Files
+//-----------------------------------------------------------------------------
+#include "linden_common.h"
+
+#include "llcharacterupdatepool.h"
+#include "llcharacter.h"
+
+//-----------------------------------------------------------------------------
+// LLCharacterUpdatePool()
+//-----------------------------------------------------------------------------
+LLCharacterUpdatePool::LLCharacterUpdatePool(U32 pool_size)
+	: mUnclaimed(0), mUnfinished(0)
+{
+	if (pool_size > MAX_POOL_SIZE)
+	{
+		pool_size = MAX_POOL_SIZE;
+	}
+	else if (pool_size < 1)
+	{
+		pool_size = 1;
+	}
+	mQueues.reserve(pool_size);
+	for (U32 i = 0; i < pool_size; ++i)
+	{
+		mQueues.push_back(new Queue);
+	}
+	mThreads.start(this, "charupdate", pool_size - 1, 1);
+	llinfos << "Applying avatar poses with " << pool_size << " threads." << llendl;
+}
+
+//-----------------------------------------------------------------------------
+// ~LLCharacterUpdatePool()
+//-----------------------------------------------------------------------------
+LLCharacterUpdatePool::~LLCharacterUpdatePool()
+{
+	mThreads.stop();
+	for (std::vector<Queue*>::iterator iter = mQueues.begin(); iter != mQueues.end(); ++iter)
+	{
+		delete *iter;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// applyDeferredPoses()
+//-----------------------------------------------------------------------------
+void LLCharacterUpdatePool::applyDeferredPoses(std::vector<LLCharacter*> const& characters)
+{
+	U32 const count = (U32)characters.size();
+	if (!count)
+	{
+		return;
+	}
+
+	// Set the counters before filling the queues: a worker that is still looking
+	// for work from the previous batch may start on this one right away.
+	mUnfinished = count;
+	mUnclaimed = count;
+
+	U32 const num_queues = (U32)mQueues.size();
+	for (U32 i = 0; i < num_queues; ++i)
+	{
+		Queue& queue = *mQueues[i];
+		LLMutexLock lock(&queue.mMutex);
+		queue.mCharacters.assign(characters.begin() + count * i / num_queues, characters.begin() + count * (i + 1) / num_queues);
+	}
+	mThreads.wake();
+
+	work(0);
+
+	mFinished.lock();
+	while (mUnfinished != 0)
+	{
+		mFinished.wait();
+	}
+	mFinished.unlock();
+}
+
+//-----------------------------------------------------------------------------
+// getWork()
+//-----------------------------------------------------------------------------
+bool LLCharacterUpdatePool::getWork(U32 index, LLCharacter*& character)
+{
+	U32 const num_queues = (U32)mQueues.size();
+	for (U32 i = 0; i < num_queues; ++i)
+	{
+		Queue& queue = *mQueues[(index + i) % num_queues];
+		LLMutexLock lock(&queue.mMutex);
+		if (queue.mCharacters.empty())
+		{
+			continue;
+		}
+		// Steal from the other end, to stay out of the way of the owner of the queue.
+		if (i == 0)
+		{
+			character = queue.mCharacters.front();
+			queue.mCharacters.pop_front();
+		}
+		else
+		{
+			character = queue.mCharacters.back();
+			queue.mCharacters.pop_back();
+		}
+		mUnclaimed -= 1;
+		return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// work()
+//-----------------------------------------------------------------------------
+// virtual
+void LLCharacterUpdatePool::work(U32 index)
+{
+	LLCharacter* character;
+	while (getWork(index, character))
+	{
+		character->applyDeferredPose();
+		if (!--mUnfinished)
+		{
+			mFinished.lock();
+			mFinished.signal();
+			mFinished.unlock();
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// hasWork()
+//-----------------------------------------------------------------------------
+// virtual
+bool LLCharacterUpdatePool::hasWork()
+{
+	return mUnclaimed != 0;
+}
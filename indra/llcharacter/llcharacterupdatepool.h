@@ -0,0 +1,87 @@
+/**
+ * @file llcharacterupdatepool.h
+ * @brief Threads that apply the poses of many characters in parallel.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLCHARACTERUPDATEPOOL_H
+#define LL_LLCHARACTERUPDATEPOOL_H
+
+#include <deque>
+#include <vector>
+
+#include "llatomic.h"
+#include "llthreadpool.h"
+
+class LLCharacter;
+
+//-----------------------------------------------------------------------------
+// LLCharacterUpdatePool
+//
+// Calls LLCharacter::applyDeferredPose() for a batch of characters, spread
+// over a number of threads. Every character only touches its own joints,
+// so they need no locking.
+//
+// Each thread gets an equal share of the batch in a queue of its own; a
+// thread that runs out of work takes characters from the back of the queue
+// of another thread, so that a few expensive characters can't keep the
+// other threads idle.
+//-----------------------------------------------------------------------------
+class LLCharacterUpdatePool : private LLThreadPool::Client
+{
+public:
+	// Maximum number of threads (including the calling thread) that apply poses.
+	static U32 const MAX_POOL_SIZE = 16;
+
+	// pool_size is the total number of threads that apply poses, including the thread calling applyDeferredPoses().
+	LLCharacterUpdatePool(U32 pool_size);
+	~LLCharacterUpdatePool();
+
+	U32 getPoolSize() const { return (U32)mQueues.size(); }
+
+	// Calls applyDeferredPose() on all characters and returns when that is done for every one of them.
+	// The calling thread does its share of the work.
+	void applyDeferredPoses(std::vector<LLCharacter*> const& characters);
+
+private:
+	struct Queue
+	{
+		LLMutex mMutex;
+		std::deque<LLCharacter*> mCharacters;
+	};
+
+	// Takes the next character from the queue of thread index, or else from another queue.
+	bool getWork(U32 index, LLCharacter*& character);
+	// Applies poses until all queues are empty.
+	/*virtual*/ void work(U32 index);
+	/*virtual*/ bool hasWork();
+
+private:
+	std::vector<Queue*> mQueues;		// One per thread; index 0 belongs to the calling thread.
+	LLThreadPool mThreads;				// The threads for the other queues.
+	LLAtomicU32 mUnclaimed;				// The number of characters still in a queue.
+	LLAtomicU32 mUnfinished;			// The number of characters whose pose wasn't applied yet.
+	LLCondition mFinished;				// Signalled when mUnfinished drops to zero.
+};
+
+#endif // LL_LLCHARACTERUPDATEPOOL_H
@@ -99,7 +99,7 @@ public:
 	typedef std::list<LLJoint*> child_list_t;
 	child_list_t mChildren;
 
-	// debug statics
+	// debug statics (not exact while avatar poses are applied in parallel, see LLCharacterUpdatePool)
 	static S32		sNumTouches;
 	static S32		sNumUpdates;
 
@@ -44,6 +44,7 @@
 #include "llbboxlocal.h"
 #include "llhandmotion.h"
 #include "lljointstate.h"
+#include "llkeyframetimeline.h"
 #include "llmotion.h"
 #include "llquaternion.h"
 #include "v3dmath.h"
@@ -434,13 +435,13 @@ public:
 	public:
 		ScaleCurve();
 		~ScaleCurve();
-		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, ScaleKey& before, ScaleKey& after);
+		// hint must be kept per motion instance, see LLKeyframeTimeline.
+		LLVector3 getValue(F32 time, F32 duration, S32& hint) const;
+		LLVector3 getValue(F32 time, F32 duration) const;
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, ScaleKey> key_map_t;
-		key_map_t 			mKeys;
+		LLVector3Timeline	mKeys;
 		ScaleKey			mLoopInKey;
 		ScaleKey			mLoopOutKey;
 	};
@@ -453,13 +454,13 @@ public:
 	public:
 		RotationCurve();
 		~RotationCurve();
-		LLQuaternion getValue(F32 time, F32 duration);
-		LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
+		// hint must be kept per motion instance, see LLKeyframeTimeline.
+		LLQuaternion getValue(F32 time, F32 duration, S32& hint) const;
+		LLQuaternion getValue(F32 time, F32 duration) const;
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, RotationKey> key_map_t;
-		key_map_t		mKeys;
+		LLQuaternionTimeline	mKeys;
 		RotationKey		mLoopInKey;
 		RotationKey		mLoopOutKey;
 	};
@@ -472,13 +473,13 @@ public:
 	public:
 		PositionCurve();
 		~PositionCurve();
-		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
+		// hint must be kept per motion instance, see LLKeyframeTimeline.
+		LLVector3 getValue(F32 time, F32 duration, S32& hint) const;
+		LLVector3 getValue(F32 time, F32 duration) const;
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, PositionKey> key_map_t;
-		key_map_t		mKeys;
+		LLVector3Timeline	mKeys;
 		PositionKey		mLoopInKey;
 		PositionKey		mLoopOutKey;
 	};
@@ -489,6 +490,15 @@ public:
 	class JointMotion
 	{
 	public:
+		// Where the keys were found by the previous update of this joint, per motion instance.
+		struct KeyHints
+		{
+			KeyHints() : mScale(0), mRotation(0), mPosition(0) { }
+			S32 mScale;
+			S32 mRotation;
+			S32 mPosition;
+		};
+
 		PositionCurve	mPositionCurve;
 		RotationCurve	mRotationCurve;
 		ScaleCurve		mScaleCurve;
@@ -496,7 +506,7 @@ public:
 		U32				mUsage;
 		LLJoint::JointPriority	mPriority;
 
-		void update(LLJointState* joint_state, F32 time, F32 duration);
+		void update(LLJointState* joint_state, F32 time, F32 duration, KeyHints& hints);
 	};
 	
 	//-------------------------------------------------------------------------
@@ -542,6 +552,7 @@ protected:
 	//-------------------------------------------------------------------------
 	JointMotionListPtr				mJointMotionList;			// singu: automatically clean up cache entry when destructed.
 	std::vector<LLPointer<LLJointState> > mJointStates;
+	std::vector<JointMotion::KeyHints> mKeyHints;		// One for every joint motion.
 	LLJoint*						mPelvisp;
 	LLCharacter*					mCharacter;
 	typedef std::list<JointConstraint*>	constraint_list_t;
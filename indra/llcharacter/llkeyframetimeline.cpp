@@ -0,0 +1,253 @@
+/**
+ * @file llkeyframetimeline.cpp
+ * @brief Flat, sorted key arrays used by the LLKeyframeMotion curves.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ *
+ * Copyright (c) 2001-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llkeyframetimeline.h"
+
+#include <algorithm>
+
+#include "llmath.h"
+
+namespace
+{
+	struct KeyTimeLess
+	{
+		KeyTimeLess(const std::vector<F32>& times) : mTimes(times) { }
+		bool operator()(S32 a, S32 b) const { return mTimes[a] < mTimes[b]; }
+		const std::vector<F32>& mTimes;
+	};
+}
+
+//-----------------------------------------------------------------------------
+// LLKeyframeTimeline
+//-----------------------------------------------------------------------------
+void LLKeyframeTimeline::sortedOrder(std::vector<S32>& order) const
+{
+	order.clear();
+	S32 const num_keys = (S32)mTimes.size();
+	S32 i = 1;
+	while (i < num_keys && mTimes[i - 1] < mTimes[i])
+	{
+		++i;
+	}
+	if (i >= num_keys)
+	{
+		// Sorted already (the usual case).
+		return;
+	}
+
+	std::vector<S32> sorted(num_keys);
+	for (i = 0; i < num_keys; ++i)
+	{
+		sorted[i] = i;
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), KeyTimeLess(mTimes));
+
+	// Of keys with the same time, keep the one that was added last.
+	order.reserve(num_keys);
+	for (i = 0; i < num_keys; ++i)
+	{
+		if (i + 1 < num_keys && mTimes[sorted[i + 1]] == mTimes[sorted[i]])
+		{
+			continue;
+		}
+		order.push_back(sorted[i]);
+	}
+}
+
+S32 LLKeyframeTimeline::search(F32 time) const
+{
+	return (S32)(std::lower_bound(mTimes.begin(), mTimes.end(), time) - mTimes.begin());
+}
+
+//-----------------------------------------------------------------------------
+// LLVector3Timeline
+//-----------------------------------------------------------------------------
+void LLVector3Timeline::clear()
+{
+	LLKeyframeTimeline::clear();
+	mValues.clear();
+}
+
+void LLVector3Timeline::addKey(F32 time, const LLVector3& value)
+{
+	mTimes.push_back(time);
+	mValues.push_back(LLVector4(value, 0.f));
+}
+
+void LLVector3Timeline::finalize()
+{
+	std::vector<S32> order;
+	sortedOrder(order);
+	if (order.empty())
+	{
+		return;
+	}
+	std::vector<F32> times;
+	std::vector<LLVector4> values;
+	times.reserve(order.size());
+	values.reserve(order.size());
+	for (std::vector<S32>::const_iterator iter = order.begin(); iter != order.end(); ++iter)
+	{
+		times.push_back(mTimes[*iter]);
+		values.push_back(mValues[*iter]);
+	}
+	mTimes.swap(times);
+	mValues.swap(values);
+}
+
+LLVector3 LLVector3Timeline::getValue(F32 time, S32& hint, bool step) const
+{
+	S32 const num_keys = getNumKeys();
+	if (!num_keys)
+	{
+		return LLVector3::zero;
+	}
+
+	S32 const right = findKey(time, hint);
+	if (right == num_keys)
+	{
+		// Past last key
+		return getKeyValue(num_keys - 1);
+	}
+	if (right == 0 || mTimes[right] == time)
+	{
+		// Before first key or exactly on a key
+		return getKeyValue(right);
+	}
+
+	// Between two keys
+	S32 const left = right - 1;
+	if (step)
+	{
+		return getKeyValue(left);
+	}
+	F32 u = (time - mTimes[left]) / (mTimes[right] - mTimes[left]);
+	LLVector4a before, after, value;
+	before.loadua(mValues[left].mV);
+	after.loadua(mValues[right].mV);
+	value.setLerp(before, after, u);
+	return LLVector3(value.getF32ptr());
+}
+
+//-----------------------------------------------------------------------------
+// LLQuaternionTimeline
+//-----------------------------------------------------------------------------
+void LLQuaternionTimeline::clear()
+{
+	LLKeyframeTimeline::clear();
+	mValues.clear();
+}
+
+void LLQuaternionTimeline::addKey(F32 time, const LLQuaternion& value)
+{
+	mTimes.push_back(time);
+	mValues.push_back(value);
+}
+
+void LLQuaternionTimeline::finalize()
+{
+	std::vector<S32> order;
+	sortedOrder(order);
+	if (order.empty())
+	{
+		return;
+	}
+	std::vector<F32> times;
+	std::vector<LLQuaternion> values;
+	times.reserve(order.size());
+	values.reserve(order.size());
+	for (std::vector<S32>::const_iterator iter = order.begin(); iter != order.end(); ++iter)
+	{
+		times.push_back(mTimes[*iter]);
+		values.push_back(mValues[*iter]);
+	}
+	mTimes.swap(times);
+	mValues.swap(values);
+}
+
+LLQuaternion LLQuaternionTimeline::getValue(F32 time, S32& hint, bool step) const
+{
+	S32 const num_keys = getNumKeys();
+	if (!num_keys)
+	{
+		return LLQuaternion::DEFAULT;
+	}
+
+	S32 const right = findKey(time, hint);
+	if (right == num_keys)
+	{
+		// Past last key
+		return mValues[num_keys - 1];
+	}
+	if (right == 0 || mTimes[right] == time)
+	{
+		// Before first key or exactly on a key
+		return mValues[right];
+	}
+
+	// Between two keys
+	S32 const left = right - 1;
+	if (step)
+	{
+		return mValues[left];
+	}
+	F32 u = (time - mTimes[left]) / (mTimes[right] - mTimes[left]);
+	LLVector4a before, after;
+	before.loadua(mValues[left].mQ);
+	after.loadua(mValues[right].mQ);
+	if (before.dot4(after).getF32() < 0.f)
+	{
+		// Opposite hemispheres: nlerp() uses slerp() here.
+		return slerp(u, mValues[left], mValues[right]);
+	}
+
+	// Linear interpolation and normalization, as lerp() and LLQuaternion::normalize() do.
+	LLVector4a value;
+	value.setLerp(before, after, u);
+	F32 mag = sqrtf(value.dot4(value).getF32());
+	if (mag <= FP_MAG_THRESHOLD)
+	{
+		return LLQuaternion::DEFAULT;
+	}
+	if (fabsf(1.f - mag) > ONE_PART_IN_A_MILLION)
+	{
+		value.mul(1.f / mag);
+	}
+	LLQuaternion result;
+	result.mQ[VX] = value[VX];
+	result.mQ[VY] = value[VY];
+	result.mQ[VZ] = value[VZ];
+	result.mQ[VW] = value[VW];
+	return result;
+}
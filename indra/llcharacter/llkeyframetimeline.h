@@ -0,0 +1,144 @@
+/**
+ * @file llkeyframetimeline.h
+ * @brief Flat, sorted key arrays used by the LLKeyframeMotion curves.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ *
+ * Copyright (c) 2001-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLKEYFRAMETIMELINE_H
+#define LL_LLKEYFRAMETIMELINE_H
+
+#include <vector>
+
+#include "v3math.h"
+#include "v4math.h"
+#include "llquaternion.h"
+
+//-----------------------------------------------------------------------------
+// LLKeyframeTimeline
+//
+// The key times of an animation curve, in one sorted array. The key values
+// are kept by the derived classes in a second array with the same order.
+//
+// Keys are added with addKey() in any order while loading; finalize() then
+// sorts them. Of several keys with the same time only the last one added is
+// kept, like assigning to a std::map<F32, Key> would do.
+//
+// Lookups take a hint: the index that the previous lookup on the same curve
+// returned. Animations mostly move forward a little every frame, so the key
+// is then found without searching. The curves are shared by all instances
+// of a motion, so the hint must be stored by the caller.
+//-----------------------------------------------------------------------------
+class LLKeyframeTimeline
+{
+public:
+	S32 getNumKeys() const { return (S32)mTimes.size(); }
+	bool empty() const { return mTimes.empty(); }
+	F32 getKeyTime(S32 index) const { return mTimes[index]; }
+
+	// Returns the index of the first key at or after time, or getNumKeys() if all keys are before time.
+	S32 findKey(F32 time, S32& hint) const
+	{
+		S32 const num_keys = (S32)mTimes.size();
+		S32 index = hint;
+		if (index >= 0 && index <= num_keys && isKeyFor(time, index))
+		{
+			return index;
+		}
+		if (++index >= 0 && index <= num_keys && isKeyFor(time, index))
+		{
+			hint = index;
+			return index;
+		}
+		hint = search(time);
+		return hint;
+	}
+
+protected:
+	void clear() { mTimes.clear(); }
+	// Returns the order in which the keys that were added should be stored after finalize(),
+	// or an empty order if they are stored in the right order already.
+	void sortedOrder(std::vector<S32>& order) const;
+
+private:
+	bool isKeyFor(F32 time, S32 index) const
+	{
+		return (index == (S32)mTimes.size() || mTimes[index] >= time) && (index == 0 || mTimes[index - 1] < time);
+	}
+	S32 search(F32 time) const;
+
+protected:
+	std::vector<F32> mTimes;
+};
+
+//-----------------------------------------------------------------------------
+// LLVector3Timeline
+//
+// Position or scale keys. The values are stored with four floats each so
+// that they can be interpolated with SSE.
+//-----------------------------------------------------------------------------
+class LLVector3Timeline : public LLKeyframeTimeline
+{
+public:
+	void clear();
+	void addKey(F32 time, const LLVector3& value);
+	void finalize();
+
+	LLVector3 getKeyValue(S32 index) const { return LLVector3(mValues[index].mV); }
+	void setKeyValue(S32 index, const LLVector3& value) { mValues[index] = LLVector4(value, 0.f); }
+
+	// The value at time: the nearest key before the first or after the last key,
+	// otherwise a linear interpolation (or, if step is true, the key before time).
+	LLVector3 getValue(F32 time, S32& hint, bool step = false) const;
+
+private:
+	std::vector<LLVector4> mValues;
+};
+
+//-----------------------------------------------------------------------------
+// LLQuaternionTimeline
+//
+// Rotation keys, interpolated like nlerp() does.
+//-----------------------------------------------------------------------------
+class LLQuaternionTimeline : public LLKeyframeTimeline
+{
+public:
+	void clear();
+	void addKey(F32 time, const LLQuaternion& value);
+	void finalize();
+
+	const LLQuaternion& getKeyValue(S32 index) const { return mValues[index]; }
+
+	// See LLVector3Timeline::getValue().
+	LLQuaternion getValue(F32 time, S32& hint, bool step = false) const;
+
+private:
+	std::vector<LLQuaternion> mValues;
+};
+
+#endif // LL_LLKEYFRAMETIMELINE_H
@@ -141,7 +141,10 @@ LLMotionController::LLMotionController()
 	  mPauseTime(0.f),
 	  mTimeStep(0.f),
 	  mTimeStepCount(0),
-	  mLastInterp(0.f)
+	  mLastInterp(0.f),
+	  mDeferPose(false),
+	  mDeferredPose(DEFERRED_NONE),
+	  mDeferredInterp(0.f)
 {
 }
 
@@ -855,6 +858,9 @@ void LLMotionController::updateLoadingMotions()
 //-----------------------------------------------------------------------------
 void LLMotionController::updateMotions(bool force_update)
 {
+	// Don't lose a pose that, for whatever reason, was never applied.
+	applyDeferredPose();
+
 	BOOL use_quantum = (mTimeStep != 0.f);
 
 	// Always update mPrevTimerElapsed
@@ -889,7 +895,15 @@ void LLMotionController::updateMotions(bool force_update)
 				if (!mPaused)
 				{
 					F32 interp = time_interval / mTimeStep;
-					mPoseBlender.interpolate(interp - mLastInterp);
+					if (mDeferPose)
+					{
+						mDeferredPose = DEFERRED_INTERPOLATE;
+						mDeferredInterp = interp - mLastInterp;
+					}
+					else
+					{
+						mPoseBlender.interpolate(interp - mLastInterp);
+					}
 					mLastInterp = interp;
 				}
 
@@ -934,6 +948,10 @@ void LLMotionController::updateMotions(bool force_update)
 		{
 			mPoseBlender.blendAndCache(TRUE);
 		}
+		else if (mDeferPose)
+		{
+			mDeferredPose = DEFERRED_BLEND;
+		}
 		else
 		{
 			mPoseBlender.blendAndApply();
@@ -944,6 +962,25 @@ void LLMotionController::updateMotions(bool force_update)
 //	llinfos << "Motion controller time " << motionTimer.getElapsedTimeF32() << llendl;
 }
 
+//-----------------------------------------------------------------------------
+// applyDeferredPose()
+//-----------------------------------------------------------------------------
+void LLMotionController::applyDeferredPose()
+{
+	switch (mDeferredPose)
+	{
+		case DEFERRED_BLEND:
+			mPoseBlender.blendAndApply();
+			break;
+		case DEFERRED_INTERPOLATE:
+			mPoseBlender.interpolate(mDeferredInterp);
+			break;
+		default:
+			return;
+	}
+	mDeferredPose = DEFERRED_NONE;
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
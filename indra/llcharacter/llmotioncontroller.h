@@ -143,6 +143,13 @@ public:
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
 
+	// While set, updateMotions() leaves the blending of the joint states into the joints
+	// to applyDeferredPose(), so that it can be done for many characters in parallel.
+	void deferPoseUpdate(bool defer) { mDeferPose = defer; }
+	bool hasDeferredPose() const { return mDeferredPose != DEFERRED_NONE; }
+	// Only touches the joints of our character, so it may be called from any thread.
+	void applyDeferredPose();
+
 	void clearBlenders() { mPoseBlender.clearBlenders(); }
 
 	// flush motions
@@ -253,6 +260,11 @@ protected:
 	S32					mTimeStepCount;
 	F32					mLastInterp;
 
+	enum EDeferredPose { DEFERRED_NONE, DEFERRED_BLEND, DEFERRED_INTERPOLATE };
+	bool				mDeferPose;
+	EDeferredPose		mDeferredPose;			// What applyDeferredPose() still has to do.
+	F32					mDeferredInterp;		// The amount to interpolate for DEFERRED_INTERPOLATE.
+
 	U8					mJointSignature[2][LL_CHARACTER_MAX_JOINTS];
 
 	//<singu>
@@ -0,0 +1,259 @@
+/**
+ * @file llkeyframetimeline_bench.cpp
+ * @brief Compares the flat keyframe timelines with the std::map based curves they replaced.
+ *
+ * $LicenseInfo:firstyear=2000&license=viewergpl$
+ *
+ * Copyright (c) 2000-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Usage: llkeyframetimeline_bench [avatars] [motions] [frames]
+//
+// Evaluates every joint of M motions for N avatars per frame, like
+// LLKeyframeMotion::applyKeyframes does, with:
+//   map      - std::map<F32, Key> curves and lower_bound(), as LLKeyframeMotion used to do it,
+//   search   - the flat timelines, searching for every lookup,
+//   hint     - the flat timelines, with a hint per avatar, motion and curve,
+// and reports the largest difference of the results with those of the map variant.
+
+#include "linden_common.h"
+
+#include "../llkeyframetimeline.h"
+#include "llmath.h"
+#include "lltimer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+namespace
+{
+
+const S32 JOINTS_PER_MOTION = 20;		// Rotation curves per motion; the pelvis has a position curve too.
+const S32 KEYS_PER_CURVE = 60;
+const F32 DURATION = 4.f;
+const F32 FRAME_TIME = 1.f / 45.f;
+
+U32 sSeed = 12345;
+
+F32 random(F32 low, F32 high)
+{
+	sSeed = sSeed * 1664525 + 1013904223;
+	return low + (high - low) * (F32)(sSeed >> 8) / (F32)(1 << 24);
+}
+
+// The old curves.
+struct MapCurves
+{
+	typedef std::map<F32, LLQuaternion> rotation_map_t;
+	typedef std::map<F32, LLVector3> position_map_t;
+	std::vector<rotation_map_t> mRotations;
+	position_map_t mPosition;
+
+	static LLQuaternion getValue(const rotation_map_t& keys, F32 time)
+	{
+		rotation_map_t::const_iterator right = keys.lower_bound(time);
+		if (right == keys.end())
+		{
+			--right;
+			return right->second;
+		}
+		if (right == keys.begin() || right->first == time)
+		{
+			return right->second;
+		}
+		rotation_map_t::const_iterator left = right; --left;
+		F32 u = (time - left->first) / (right->first - left->first);
+		return nlerp(u, left->second, right->second);
+	}
+
+	static LLVector3 getValue(const position_map_t& keys, F32 time)
+	{
+		position_map_t::const_iterator right = keys.lower_bound(time);
+		if (right == keys.end())
+		{
+			--right;
+			return right->second;
+		}
+		if (right == keys.begin() || right->first == time)
+		{
+			return right->second;
+		}
+		position_map_t::const_iterator left = right; --left;
+		F32 u = (time - left->first) / (right->first - left->first);
+		return lerp(left->second, right->second, u);
+	}
+};
+
+struct Motion
+{
+	MapCurves mMap;
+	std::vector<LLQuaternionTimeline> mRotations;
+	LLVector3Timeline mPosition;
+};
+
+void makeMotion(Motion& motion)
+{
+	motion.mMap.mRotations.resize(JOINTS_PER_MOTION);
+	motion.mRotations.resize(JOINTS_PER_MOTION);
+	for (S32 joint = 0; joint < JOINTS_PER_MOTION; ++joint)
+	{
+		for (S32 k = 0; k < KEYS_PER_CURVE; ++k)
+		{
+			F32 time = DURATION * k / (KEYS_PER_CURVE - 1);
+			LLQuaternion rotation(random(-1.f, 1.f), random(-1.f, 1.f), random(-1.f, 1.f), random(0.5f, 1.f));
+			motion.mMap.mRotations[joint][time] = rotation;
+			motion.mRotations[joint].addKey(time, rotation);
+		}
+		motion.mRotations[joint].finalize();
+	}
+	for (S32 k = 0; k < KEYS_PER_CURVE; ++k)
+	{
+		F32 time = DURATION * k / (KEYS_PER_CURVE - 1);
+		LLVector3 position(random(-0.5f, 0.5f), random(-0.5f, 0.5f), random(-0.5f, 0.5f));
+		motion.mMap.mPosition[time] = position;
+		motion.mPosition.addKey(time, position);
+	}
+	motion.mPosition.finalize();
+}
+
+enum EVariant { MAP, SEARCH, HINT, NUM_VARIANTS };
+char const* const variant_names[NUM_VARIANTS] = { "map", "search", "hint" };
+
+// Evaluates all curves of one motion for one avatar, accumulating the results in out.
+void evaluate(EVariant variant, const Motion& motion, F32 time, S32* hints, std::vector<F32>& out)
+{
+	for (S32 joint = 0; joint < JOINTS_PER_MOTION; ++joint)
+	{
+		LLQuaternion rotation;
+		S32 hint = 0;
+		switch (variant)
+		{
+			case MAP:
+				rotation = MapCurves::getValue(motion.mMap.mRotations[joint], time);
+				break;
+			case SEARCH:
+				rotation = motion.mRotations[joint].getValue(time, hint);
+				break;
+			default:
+				rotation = motion.mRotations[joint].getValue(time, hints[joint]);
+				break;
+		}
+		out.insert(out.end(), rotation.mQ, rotation.mQ + 4);
+	}
+	LLVector3 position;
+	S32 hint = 0;
+	switch (variant)
+	{
+		case MAP:
+			position = MapCurves::getValue(motion.mMap.mPosition, time);
+			break;
+		case SEARCH:
+			position = motion.mPosition.getValue(time, hint);
+			break;
+		default:
+			position = motion.mPosition.getValue(time, hints[JOINTS_PER_MOTION]);
+			break;
+	}
+	out.insert(out.end(), position.mV, position.mV + 3);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	S32 avatars = argc > 1 ? atoi(argv[1]) : 60;
+	S32 motions = argc > 2 ? atoi(argv[2]) : 8;
+	S32 frames = argc > 3 ? atoi(argv[3]) : 450;
+	avatars = llmax(avatars, 1);
+	motions = llmax(motions, 1);
+	frames = llmax(frames, 1);
+
+	std::vector<Motion> motion_list(motions);
+	for (S32 m = 0; m < motions; ++m)
+	{
+		makeMotion(motion_list[m]);
+	}
+
+	// Every avatar plays every motion, each starting at a different time.
+	std::vector<F32> offsets(avatars * motions);
+	for (size_t i = 0; i < offsets.size(); ++i)
+	{
+		offsets[i] = random(0.f, DURATION);
+	}
+
+	printf("%d avatars x %d motions x %d curves, %d keys per curve, %d frames\n",
+		   avatars, motions, JOINTS_PER_MOTION + 1, KEYS_PER_CURVE, frames);
+
+	std::vector<F32> reference;
+	F64 map_ms = 0.0;
+	for (S32 v = 0; v < NUM_VARIANTS; ++v)
+	{
+		EVariant variant = EVariant(v);
+		std::vector<S32> hints(avatars * motions * (JOINTS_PER_MOTION + 1), 0);
+		std::vector<F32> out;
+		out.reserve(motions * (JOINTS_PER_MOTION * 4 + 3));
+		F32 max_diff = 0.f;
+
+		LLTimer timer;
+		for (S32 frame = 0; frame < frames; ++frame)
+		{
+			for (S32 avatar = 0; avatar < avatars; ++avatar)
+			{
+				out.clear();
+				for (S32 m = 0; m < motions; ++m)
+				{
+					S32 instance = avatar * motions + m;
+					F32 time = fmodf(offsets[instance] + frame * FRAME_TIME, DURATION);
+					evaluate(variant, motion_list[m], time, &hints[instance * (JOINTS_PER_MOTION + 1)], out);
+				}
+				// Compare the last frame of the first avatar with the map variant.
+				if (frame == frames - 1 && avatar == 0)
+				{
+					if (variant == MAP)
+					{
+						reference = out;
+					}
+					else
+					{
+						for (size_t i = 0; i < out.size(); ++i)
+						{
+							max_diff = llmax(max_diff, fabsf(out[i] - reference[i]));
+						}
+					}
+				}
+			}
+		}
+		F64 ms = timer.getElapsedTimeF64() * 1000.0 / frames;
+		if (variant == MAP)
+		{
+			map_ms = ms;
+		}
+		printf("%-8s %9.3f ms per frame  x%5.2f  max diff %g\n", variant_names[v], ms, map_ms / ms, max_diff);
+	}
+	return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief A file that is mapped into memory.
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmappedfile.h"
+#include "llfile.h"
+#include "llstring.h"
+
+#include <new>
+
+#if LL_WINDOWS
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+LLMappedFile::LLMappedFile()
+	: mData(NULL),
+	  mSize(0),
+	  mInitialFileSize(0),
+	  mReadOnly(false)
+#if LL_WINDOWS
+	  , mFileHandle(INVALID_HANDLE_VALUE),
+	  mMappingHandle(NULL)
+#else
+	  , mFileDescriptor(-1)
+#endif
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+	close();
+}
+
+bool LLMappedFile::open(const std::string& filename, size_t size, bool read_only)
+{
+	close();
+
+	if (!size)
+	{
+		return false;
+	}
+
+	mReadOnly = read_only;
+	if (read_only)
+	{
+		mData = new (std::nothrow) U8[size];
+		if (!mData)
+		{
+			return false;
+		}
+		memset(mData, 0, size);
+		mSize = size;
+		LLFILE* fp = LLFile::fopen(filename, "rb");
+		if (fp)
+		{
+			mInitialFileSize = fread(mData, 1, size, fp);
+			fclose(fp);
+		}
+		return true;
+	}
+
+#if LL_WINDOWS
+	llutf16string utf16filename = utf8str_to_utf16str(filename);
+	HANDLE file = CreateFileW(utf16filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+							  NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		llwarns << "Unable to open " << filename << ": error " << GetLastError() << llendl;
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	mInitialFileSize = GetFileSizeEx(file, &file_size) ? (size_t)file_size.QuadPart : 0;
+	// The mapping grows the file to size if needed; the new part reads as zeroes.
+	U64 mapping_size = size;
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READWRITE, (DWORD)(mapping_size >> 32), (DWORD)mapping_size, NULL);
+	void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : NULL;
+	if (!data)
+	{
+		llwarns << "Unable to map " << filename << ": error " << GetLastError() << llendl;
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+	mFileHandle = file;
+	mMappingHandle = mapping;
+#else
+	int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		llwarns << "Unable to open " << filename << ": " << strerror(errno) << llendl;
+		return false;
+	}
+	struct stat file_stat;
+	mInitialFileSize = fstat(fd, &file_stat) == 0 ? (size_t)file_stat.st_size : 0;
+	// Accessing a mapped page beyond the end of the file raises SIGBUS, so make the file large enough first.
+	if (mInitialFileSize < size && ftruncate(fd, (off_t)size) != 0)
+	{
+		llwarns << "Unable to extend " << filename << " to " << size << " bytes: " << strerror(errno) << llendl;
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+	{
+		llwarns << "Unable to map " << filename << ": " << strerror(errno) << llendl;
+		::close(fd);
+		return false;
+	}
+	mFileDescriptor = fd;
+#endif
+
+	mData = (U8*)data;
+	mSize = size;
+	return true;
+}
+
+void LLMappedFile::close()
+{
+	if (!mData)
+	{
+		return;
+	}
+	if (mReadOnly)
+	{
+		delete [] mData;
+	}
+	else
+	{
+#if LL_WINDOWS
+		UnmapViewOfFile(mData);
+		CloseHandle((HANDLE)mMappingHandle);
+		CloseHandle((HANDLE)mFileHandle);
+		mMappingHandle = NULL;
+		mFileHandle = INVALID_HANDLE_VALUE;
+#else
+		munmap(mData, mSize);
+		::close(mFileDescriptor);
+		mFileDescriptor = -1;
+#endif
+	}
+	mData = NULL;
+	mSize = 0;
+	mInitialFileSize = 0;
+}
+
+void LLMappedFile::flush(bool wait)
+{
+	if (!mData || mReadOnly)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	FlushViewOfFile(mData, 0);
+	if (wait)
+	{
+		FlushFileBuffers((HANDLE)mFileHandle);
+	}
+#else
+	msync(mData, mSize, wait ? MS_SYNC : MS_ASYNC);
+#endif
+}
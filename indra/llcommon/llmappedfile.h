@@ -0,0 +1,78 @@
+/**
+ * @file llmappedfile.h
+ * @brief A file that is mapped into memory.
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include <string>
+
+// Maps (the first part of) a file into memory, so that it can be read and updated in place.
+// Changes are written back by the OS whenever it likes, or when flush() is called.
+//
+// A read-only file is copied into memory instead; changes to the copy are never written back.
+// That way the caller can use the same code for both.
+class LL_COMMON_API LLMappedFile
+{
+public:
+	LLMappedFile();
+	~LLMappedFile();
+
+	// Maps the first size bytes of filename. The file is created, or extended with zeroes,
+	// if it is shorter than that (unless read_only is true: then the copy is padded with zeroes).
+	// Returns false if the file could not be mapped.
+	bool open(const std::string& filename, size_t size, bool read_only = false);
+	// Unmaps the file. Changes are not lost, but use flush(true) first to be sure they are on disk.
+	void close();
+
+	bool isOpen() const { return mData != NULL; }
+	bool isReadOnly() const { return mReadOnly; }
+	U8* getData() const { return mData; }
+	size_t getSize() const { return mSize; }
+	// The size that the file had before open() extended it; zero if the file was created.
+	size_t getInitialFileSize() const { return mInitialFileSize; }
+
+	// Writes all changes to disk. If wait is false, the writes are only started.
+	void flush(bool wait = false);
+
+private:
+	// Disallow copying.
+	LLMappedFile(LLMappedFile const&);
+	LLMappedFile& operator=(LLMappedFile const&);
+
+private:
+	U8* mData;
+	size_t mSize;
+	size_t mInitialFileSize;
+	bool mReadOnly;
+#if LL_WINDOWS
+	void* mFileHandle;
+	void* mMappingHandle;
+#else
+	int mFileDescriptor;
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
@@ -197,7 +197,7 @@ void LLQueuedThread::printQueueStats()
 	lockData();
 	if (!mRequestQueue.empty())
 	{
-		QueuedRequest *req = *mRequestQueue.begin();
+		QueuedRequest *req = mRequestQueue.top();
 		llinfos << llformat("Pending Requests:%d Current status:%d", mRequestQueue.size(), req->getStatus()) << llendl;
 	}
 	else
@@ -336,7 +336,7 @@ void LLQueuedThread::setPriority(handle_t handle, U32 priority)
 {
 	lockData();
 	QueuedRequest* req = (QueuedRequest*)mRequestHash.find(handle);
-	if (req)
+	if (req && req->getPriority() != priority)
 	{
 		if(req->getStatus() == STATUS_INPROGRESS)
 		{
@@ -345,10 +345,8 @@ void LLQueuedThread::setPriority(handle_t handle, U32 priority)
 		}
 		else if(req->getStatus() == STATUS_QUEUED)
 		{
-			// remove from list then re-insert
-			llverify(mRequestQueue.erase(req) == 1);
-			req->setPriority(priority);
-			mRequestQueue.insert(req);
+			// move it to its new place in the heap
+			mRequestQueue.reprioritize(req, priority);
 		}
 	}
 	unlockData();
@@ -418,8 +416,8 @@ S32 LLQueuedThread::processNextRequest()
 		{
 			break;
 		}
-		req = *mRequestQueue.begin();
-		mRequestQueue.erase(mRequestQueue.begin());
+		req = mRequestQueue.top();
+		mRequestQueue.erase(req);
 		if ((req->getFlags() & FLAG_ABORT) || (mStatus == QUITTING))
 		{
 			req->setStatus(STATUS_ABORTED);
@@ -588,7 +586,8 @@ LLQueuedThread::QueuedRequest::QueuedRequest(LLQueuedThread::handle_t handle, U3
 	LLSimpleHashEntry<LLQueuedThread::handle_t>(handle),
 	mStatus(STATUS_UNKNOWN),
 	mPriority(priority),
-	mFlags(flags)
+	mFlags(flags),
+	mQueueIndex(-1)
 {
 }
 
@@ -609,3 +608,103 @@ void LLQueuedThread::QueuedRequest::deleteRequest()
 	setStatus(STATUS_DELETE);
 	delete this;
 }
+
+//============================================================================
+// RequestQueue
+//
+// The children of mHeap[i] are mHeap[ARITY * i + 1] .. mHeap[ARITY * i + ARITY].
+// Every element has a higher priority than its children.
+
+void LLQueuedThread::RequestQueue::insert(QueuedRequest* req)
+{
+	llassert(req->mQueueIndex == -1);
+	mHeap.push_back(req);
+	req->mQueueIndex = mHeap.size() - 1;
+	siftUp(req->mQueueIndex);
+}
+
+size_t LLQueuedThread::RequestQueue::erase(QueuedRequest* req)
+{
+	S32 index = req->mQueueIndex;
+	if (index < 0)
+	{
+		return 0;
+	}
+	llassert(mHeap[index] == req);
+	req->mQueueIndex = -1;
+	QueuedRequest* last = mHeap.back();
+	mHeap.pop_back();
+	if (last != req)
+	{
+		// Move the last element into the hole and restore the heap property.
+		place(last, index);
+		restore(index);
+	}
+	return 1;
+}
+
+void LLQueuedThread::RequestQueue::reprioritize(QueuedRequest* req, U32 priority)
+{
+	llassert(req->mQueueIndex >= 0 && mHeap[req->mQueueIndex] == req);
+	req->setPriority(priority);
+	restore(req->mQueueIndex);
+}
+
+// Move the element at index up or down, whichever is needed.
+void LLQueuedThread::RequestQueue::restore(S32 index)
+{
+	if (index > 0 && mHeap[index]->higherPriority(*mHeap[(index - 1) / ARITY]))
+	{
+		siftUp(index);
+	}
+	else
+	{
+		siftDown(index);
+	}
+}
+
+void LLQueuedThread::RequestQueue::siftUp(S32 index)
+{
+	QueuedRequest* req = mHeap[index];
+	while (index > 0)
+	{
+		S32 parent = (index - 1) / ARITY;
+		if (!req->higherPriority(*mHeap[parent]))
+		{
+			break;
+		}
+		place(mHeap[parent], index);
+		index = parent;
+	}
+	place(req, index);
+}
+
+void LLQueuedThread::RequestQueue::siftDown(S32 index)
+{
+	S32 const size = mHeap.size();
+	QueuedRequest* req = mHeap[index];
+	for (;;)
+	{
+		S32 const first_child = ARITY * index + 1;
+		if (first_child >= size)
+		{
+			break;
+		}
+		S32 const end_child = llmin(first_child + ARITY, size);
+		S32 best = first_child;
+		for (S32 child = first_child + 1; child < end_child; ++child)
+		{
+			if (mHeap[child]->higherPriority(*mHeap[best]))
+			{
+				best = child;
+			}
+		}
+		if (!mHeap[best]->higherPriority(*req))
+		{
+			break;
+		}
+		place(mHeap[best], index);
+		index = best;
+	}
+	place(req, index);
+}
@@ -31,6 +31,7 @@
 #include <string>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "llapr.h"
 
@@ -75,9 +76,12 @@ public:
 	//------------------------------------------------------------------------
 public:
 
+	class RequestQueue;
+
 	class LL_COMMON_API QueuedRequest : public LLSimpleHashEntry<handle_t>
 	{
 		friend class LLQueuedThread;
+		friend class RequestQueue;
 		
 	protected:
 		virtual ~QueuedRequest(); // use deleteRequest()
@@ -137,15 +141,36 @@ public:
 		LLAtomic32<status_t> mStatus;
 		U32 mPriority;
 		U32 mFlags;
+		S32 mQueueIndex;	// Index into RequestQueue::mHeap, or -1 when not queued.
 	};
 
-protected:
-	struct queued_request_less
+	// Priority queue of QueuedRequest's, ordered by QueuedRequest::higherPriority.
+	// This is a 4-ary heap in a vector; every request knows its own position in
+	// the heap, so that erasing a request or changing its priority is O(log n)
+	// and doesn't allocate, unlike erasing and reinserting into a std::set.
+	class LL_COMMON_API RequestQueue
 	{
-		bool operator()(const QueuedRequest* lhs, const QueuedRequest* rhs) const
-		{
-			return lhs->higherPriority(*rhs); // higher priority in front of queue (set)
-		}
+	public:
+		bool empty() const { return mHeap.empty(); }
+		size_t size() const { return mHeap.size(); }
+		// Returns the request with the highest priority. The queue may not be empty.
+		QueuedRequest* top() const { return mHeap.front(); }
+		// The requests in heap order, not in priority order, for walking the queue.
+		QueuedRequest* operator[](size_t index) const { return mHeap[index]; }
+		void insert(QueuedRequest* req);
+		// Returns the number of removed requests (0 or 1).
+		size_t erase(QueuedRequest* req);
+		// Change the priority of a request that is in the queue.
+		void reprioritize(QueuedRequest* req, U32 priority);
+
+	private:
+		enum { ARITY = 4 };
+		void place(QueuedRequest* req, S32 index) { mHeap[index] = req; req->mQueueIndex = index; }
+		void siftUp(S32 index);
+		void siftDown(S32 index);
+		void restore(S32 index);
+
+		std::vector<QueuedRequest*> mHeap;
 	};
 
 
@@ -206,8 +231,7 @@ protected:
 	BOOL mStarted;  // required when mThreaded is false to call startThread() from update()
 	LLAtomic32<BOOL> mIdleThread; // request queue is empty (or we are quitting) and the thread is idle
 	
-	typedef std::set<QueuedRequest*, queued_request_less> request_queue_t;
-	request_queue_t mRequestQueue;
+	RequestQueue mRequestQueue;
 
 	enum { REQUEST_HASH_SIZE = 512 }; // must be power of 2
 	typedef LLSimpleHash<handle_t, REQUEST_HASH_SIZE> request_hash_t;
@@ -1210,6 +1210,481 @@ bool LLSDBinaryParser::parseString(
 	return true;
 }
 
+namespace
+{
+	// Shares the storage of map keys while parsing a binary LLSD buffer:
+	// a map key that was seen before is looked up from its bytes, without
+	// constructing a temporary std::string.
+	class LLSDKeyInterner
+	{
+	public:
+		LLSDKeyInterner() : mUsed(0) { mSlots.resize(64); }
+
+		const std::string& intern(const char* key, size_t len)
+		{
+			size_t mask = mSlots.size() - 1;
+			size_t i = hash(key, len) & mask;
+			while (mSlots[i].mValid)
+			{
+				std::string const& slot = mSlots[i].mKey;
+				if (slot.size() == len && !memcmp(slot.data(), key, len))
+				{
+					return slot;
+				}
+				i = (i + 1) & mask;
+			}
+			if (2 * (mUsed + 1) > mSlots.size())
+			{
+				grow();
+				return intern(key, len);
+			}
+			++mUsed;
+			mSlots[i].mValid = true;
+			mSlots[i].mKey.assign(key, len);
+			return mSlots[i].mKey;
+		}
+
+	private:
+		struct Slot
+		{
+			Slot() : mValid(false) { }
+			std::string mKey;
+			bool mValid;
+		};
+
+		static size_t hash(const char* key, size_t len)
+		{
+			// FNV-1a
+			U32 h = 2166136261U;
+			for (size_t i = 0; i < len; ++i)
+			{
+				h = (h ^ (U8)key[i]) * 16777619U;
+			}
+			return h;
+		}
+
+		void grow()
+		{
+			std::vector<Slot> old;
+			old.swap(mSlots);
+			mSlots.resize(old.size() * 2);
+			size_t mask = mSlots.size() - 1;
+			for (std::vector<Slot>::iterator iter = old.begin(); iter != old.end(); ++iter)
+			{
+				if (iter->mValid)
+				{
+					size_t i = hash(iter->mKey.data(), iter->mKey.size()) & mask;
+					while (mSlots[i].mValid)
+					{
+						i = (i + 1) & mask;
+					}
+					mSlots[i].mValid = true;
+					mSlots[i].mKey.swap(iter->mKey);
+				}
+			}
+		}
+
+		std::vector<Slot> mSlots;	// Open addressing, the size is a power of two.
+		size_t mUsed;
+	};
+
+	// The buffer equivalent of LLSDBinaryParser::doParse and friends.
+	class LLSDBinaryBufferReader
+	{
+	public:
+		LLSDBinaryBufferReader(const U8* buf, S32 size) : mStart(buf), mPos(buf), mEnd(buf + size) { }
+
+		S32 parse(LLSD& data);
+		S32 bytesRead() const { return (S32)(mPos - mStart); }
+
+	private:
+		S32 parseMap(LLSD& map);
+		S32 parseArray(LLSD& array);
+		bool readU32(U32& value);
+		bool readBytes(void* out, size_t len);
+		bool readSized(const char*& str, S32& len);
+		bool readDelimited(std::string& value, char delim);
+
+		size_t left() const { return (size_t)(mEnd - mPos); }
+
+		const U8* const mStart;
+		const U8* mPos;
+		const U8* const mEnd;
+		LLSDKeyInterner mKeys;
+	};
+
+	bool LLSDBinaryBufferReader::readBytes(void* out, size_t len)
+	{
+		if (left() < len)
+		{
+			mPos = mEnd;
+			return false;
+		}
+		memcpy(out, mPos, len);		/* Flawfinder: ignore */
+		mPos += len;
+		return true;
+	}
+
+	bool LLSDBinaryBufferReader::readU32(U32& value)
+	{
+		U32 value_nbo;
+		if (!readBytes(&value_nbo, sizeof(U32)))
+		{
+			return false;
+		}
+		value = ntohl(value_nbo);
+		return true;
+	}
+
+	// Reads a 4 byte size followed by that many bytes; str points into the buffer.
+	bool LLSDBinaryBufferReader::readSized(const char*& str, S32& len)
+	{
+		U32 size;
+		if (!readU32(size) || (S32)size < 0 || size > left())
+		{
+			return false;
+		}
+		str = (const char*)mPos;
+		len = (S32)size;
+		mPos += size;
+		return true;
+	}
+
+	// Same as deserialize_string_delim, for a notation-style string inside binary LLSD.
+	bool LLSDBinaryBufferReader::readDelimited(std::string& value, char delim)
+	{
+		value.clear();
+		while (mPos < mEnd)
+		{
+			char c = (char)*mPos++;
+			if (c == delim)
+			{
+				return true;
+			}
+			if (c != '\\')
+			{
+				value += c;
+				continue;
+			}
+			if (mPos == mEnd)
+			{
+				break;
+			}
+			c = (char)*mPos++;
+			switch (c)
+			{
+			case 'a': value += '\a'; break;
+			case 'b': value += '\b'; break;
+			case 'f': value += '\f'; break;
+			case 'n': value += '\n'; break;
+			case 'r': value += '\r'; break;
+			case 't': value += '\t'; break;
+			case 'v': value += '\v'; break;
+			case 'x':
+				if (left() < 2)
+				{
+					mPos = mEnd;
+					return false;
+				}
+				value += (char)((hex_as_nybble(mPos[0]) << 4) | hex_as_nybble(mPos[1]));
+				mPos += 2;
+				break;
+			default: value += c; break;
+			}
+		}
+		return false;
+	}
+
+	S32 LLSDBinaryBufferReader::parse(LLSD& data)
+	{
+		// See LLSDBinaryParser::doParse for the format.
+		if (mPos == mEnd)
+		{
+			return 0;
+		}
+		char c = (char)*mPos++;
+		S32 parse_count = 1;
+		switch(c)
+		{
+		case '{':
+		{
+			S32 child_count = parseMap(data);
+			if((child_count == LLSDParser::PARSE_FAILURE) || data.isUndefined())
+			{
+				llinfos << "BUFFER FAILURE reading binary map." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else
+			{
+				parse_count += child_count;
+			}
+			break;
+		}
+
+		case '[':
+		{
+			S32 child_count = parseArray(data);
+			if((child_count == LLSDParser::PARSE_FAILURE) || data.isUndefined())
+			{
+				llinfos << "BUFFER FAILURE reading binary array." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else
+			{
+				parse_count += child_count;
+			}
+			break;
+		}
+
+		case '!':
+			data.clear();
+			break;
+
+		case '0':
+			data = false;
+			break;
+
+		case '1':
+			data = true;
+			break;
+
+		case 'i':
+		{
+			U32 value;
+			if (readU32(value))
+			{
+				data = (S32)value;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary integer." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'r':
+		{
+			F64 real_nbo = 0.0;
+			if (readBytes(&real_nbo, sizeof(F64)))
+			{
+				data = ll_ntohd(real_nbo);
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary real." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'u':
+		{
+			LLUUID id;
+			if (readBytes(id.mData, UUID_BYTES))
+			{
+				data = id;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary uuid." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case '\'':
+		case '"':
+		{
+			std::string value;
+			if (readDelimited(value, c))
+			{
+				data = value;
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary (notation-style) string." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 's':
+		case 'l':
+		{
+			const char* str;
+			S32 len;
+			if (!readSized(str, len))
+			{
+				llinfos << "BUFFER FAILURE reading binary " << (c == 's' ? "string." : "link.") << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			else if (c == 's')
+			{
+				data = std::string(str, len);
+			}
+			else
+			{
+				data = LLURI(std::string(str, len));
+			}
+			break;
+		}
+
+		case 'd':
+		{
+			F64 real = 0.0;
+			if (readBytes(&real, sizeof(F64)))
+			{
+				data = LLDate(real);
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary date." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		case 'b':
+		{
+			const char* bytes;
+			S32 len;
+			if (readSized(bytes, len))
+			{
+				data = LLSD::Binary((const U8*)bytes, (const U8*)bytes + len);
+			}
+			else
+			{
+				llinfos << "BUFFER FAILURE reading binary." << llendl;
+				parse_count = LLSDParser::PARSE_FAILURE;
+			}
+			break;
+		}
+
+		default:
+			parse_count = LLSDParser::PARSE_FAILURE;
+			llinfos << "Unrecognized character while parsing: int(" << (int)c
+				<< ")" << llendl;
+			break;
+		}
+		if(LLSDParser::PARSE_FAILURE == parse_count)
+		{
+			data.clear();
+		}
+		return parse_count;
+	}
+
+	S32 LLSDBinaryBufferReader::parseMap(LLSD& map)
+	{
+		map = LLSD::emptyMap();
+		U32 size;
+		if (!readU32(size))
+		{
+			return LLSDParser::PARSE_FAILURE;
+		}
+		S32 parse_count = 0;
+		U32 count = 0;
+		char c = mPos < mEnd ? (char)*mPos++ : 0;
+		while (c != '}' && count < size && mPos < mEnd)
+		{
+			static const std::string empty_key;
+			const std::string* name = &empty_key;
+			switch(c)
+			{
+			case 'k':
+			{
+				const char* key;
+				S32 len;
+				if (!readSized(key, len))
+				{
+					return LLSDParser::PARSE_FAILURE;
+				}
+				name = &mKeys.intern(key, len);
+				break;
+			}
+			case '\'':
+			case '"':
+			{
+				std::string key;
+				if (!readDelimited(key, c))
+				{
+					return LLSDParser::PARSE_FAILURE;
+				}
+				name = &mKeys.intern(key.data(), key.size());
+				break;
+			}
+			}
+			LLSD child;
+			S32 child_count = parse(child);
+			if(child_count > 0)
+			{
+				// There must be a value for every key, thus child_count
+				// must be greater than 0.
+				parse_count += child_count;
+				map.insert(*name, child);
+			}
+			else
+			{
+				return LLSDParser::PARSE_FAILURE;
+			}
+			++count;
+			c = mPos < mEnd ? (char)*mPos++ : 0;
+		}
+		if((c != '}') || (count < size))
+		{
+			// Make sure it is correctly terminated and we parsed as many
+			// as were said to be there.
+			return LLSDParser::PARSE_FAILURE;
+		}
+		return parse_count;
+	}
+
+	S32 LLSDBinaryBufferReader::parseArray(LLSD& array)
+	{
+		array = LLSD::emptyArray();
+		U32 size;
+		if (!readU32(size))
+		{
+			return LLSDParser::PARSE_FAILURE;
+		}
+		S32 parse_count = 0;
+		U32 count = 0;
+		while (mPos < mEnd && *mPos != ']' && count < size)
+		{
+			LLSD child;
+			S32 child_count = parse(child);
+			if(LLSDParser::PARSE_FAILURE == child_count)
+			{
+				return LLSDParser::PARSE_FAILURE;
+			}
+			if(child_count)
+			{
+				parse_count += child_count;
+				array.append(child);
+			}
+			++count;
+		}
+		if (mPos == mEnd || *mPos++ != ']' || count < size)
+		{
+			// Make sure it is correctly terminated and we parsed as many
+			// as were said to be there.
+			return LLSDParser::PARSE_FAILURE;
+		}
+		return parse_count;
+	}
+} // namespace
+
+S32 LLSDBinaryParser::parseBuffer(const U8* buf, S32 size, LLSD& data, S32* bytes_read) const
+{
+	LLSDBinaryBufferReader reader(buf, llmax(size, 0));
+	S32 parse_count = reader.parse(data);
+	if (bytes_read)
+	{
+		*bytes_read = reader.bytesRead();
+	}
+	return parse_count;
+}
+
 
 /**
  * LLSDFormatter
@@ -2149,19 +2624,17 @@ bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 
 	//result now points to the decompressed LLSD block
 	{
-		std::string res_str((char*) result, cur_size);
+		U8 const* llsd_data = result;
 
-		std::string deprecated_header("<? LLSD/Binary ?>");
+		static std::string const deprecated_header("<? LLSD/Binary ?>");
 
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
+		if (cur_size > deprecated_header.size() && !memcmp(result, deprecated_header.data(), deprecated_header.size()))
 		{
-			res_str = res_str.substr(deprecated_header.size()+1, cur_size);
+			llsd_data += deprecated_header.size() + 1;
+			cur_size -= deprecated_header.size() + 1;
 		}
-		cur_size = res_str.size();
 
-		std::istringstream istr(res_str);
-		
-		if (!LLSDSerialize::fromBinary(data, istr, cur_size))
+		if (!LLSDSerialize::fromBinary(data, llsd_data, cur_size))
 		{
 			llwarns << "Failed to unzip LLSD block" << llendl;
 			free(result);
@@ -290,6 +290,32 @@ private:
 	bool parseBinary(std::istream& istr, LLSD& data) const;
 };
 
+/** 
+ * @class LLSDXMLVisitor
+ * @brief Receives XML format LLSD piece by piece while it is being parsed.
+ *
+ * Use this instead of parsing into one LLSD when the document is large and
+ * can be handled one part at a time. For every map and array the parser asks
+ * whether to descend into it. If so, its contents are reported one by one
+ * between beginMap() and endMap() (or beginArray() and endArray()). If not,
+ * it is built as an ordinary LLSD and passed to value() when it is complete.
+ * All other values are passed to value().
+ *
+ * The key passed is the key of the value in the enclosing map, or an empty
+ * string for array elements and for the top level value.
+ */
+class LL_COMMON_API LLSDXMLVisitor
+{
+public:
+	virtual ~LLSDXMLVisitor() { }
+
+	virtual bool beginMap(const std::string& key) { return true; }
+	virtual void endMap() { }
+	virtual bool beginArray(const std::string& key) { return true; }
+	virtual void endArray() { }
+	virtual void value(const std::string& key, const LLSD& value) = 0;
+};
+
 /** 
  * @class LLSDXMLParser
  * @brief Parser which handles XML format LLSD.
@@ -308,6 +334,16 @@ public:
 	 */
 	LLSDXMLParser();
 
+	/** 
+	 * @brief Pass the parsed document to visitor instead of building it.
+	 *
+	 * While a visitor is set, parse() and parseLines() leave data
+	 * undefined but still return the number of LLSD objects parsed.
+	 * Pass NULL to build the document as one LLSD again.
+	 * @param visitor The visitor, which must outlive the parse.
+	 */
+	void setVisitor(LLSDXMLVisitor* visitor);
+
 protected:
 	/** 
 	 * @brief Call this method to parse a stream for LLSD.
@@ -356,6 +392,23 @@ public:
 	 */
 	LLSDBinaryParser();
 
+	/** 
+	 * @brief Call this method to parse binary LLSD that is already in memory.
+	 *
+	 * This accepts the same format as parse(), but reads directly from
+	 * the buffer instead of through an istream, and map keys that occur
+	 * more than once share a single string while parsing. This method
+	 * will return after reading one data object; bytes_read tells the
+	 * caller where it ended.
+	 * @param buf The binary LLSD, without the "<? LLSD/Binary ?>" header.
+	 * @param size The number of bytes available at buf.
+	 * @param data[out] The newly parse structured data.
+	 * @param bytes_read[out] If not NULL, set to the number of bytes used.
+	 * @return Returns the number of LLSD objects parsed into
+	 * data. Returns PARSE_FAILURE (-1) on parse failure.
+	 */
+	S32 parseBuffer(const U8* buf, S32 size, LLSD& data, S32* bytes_read = NULL) const;
+
 protected:
 	/** 
 	 * @brief Call this method to parse a stream for LLSD.
@@ -768,6 +821,14 @@ public:
 		return fromXMLEmbedded(sd, str);
 //		return fromXMLDocument(sd, str);
 	}
+	// Pass the document to visitor while it is parsed, instead of building it as one LLSD.
+	static S32 fromXML(LLSDXMLVisitor& visitor, std::istream& str)
+	{
+		LLPointer<LLSDXMLParser> p = new LLSDXMLParser;
+		p->setVisitor(&visitor);
+		LLSD sd;
+		return p->parse(str, sd, LLSDSerialize::SIZE_UNLIMITED);
+	}
 
 	/*
 	 * Binary Methods
@@ -789,6 +850,12 @@ public:
 		(void)p->parse(str, sd, max_bytes);
 		return sd;
 	}
+	// Faster version for data that is already in memory.
+	static S32 fromBinary(LLSD& sd, const U8* buf, S32 size, S32* bytes_read = NULL)
+	{
+		LLPointer<LLSDBinaryParser> p = new LLSDBinaryParser;
+		return p->parseBuffer(buf, size, sd, bytes_read);
+	}
 };
 
 //dirty little zip functions -- yell at davep
@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <deque>
+#include <vector>
 
 #include "apr_base64.h"
 #include <boost/regex.hpp>
@@ -264,6 +265,8 @@ public:
 	
 	void reset();
 
+	void setVisitor(LLSDXMLVisitor* visitor) { mVisitor = visitor; }
+
 private:
 	void startElementHandler(const XML_Char* name, const XML_Char** attributes);
 	void endElementHandler(const XML_Char* name);
@@ -277,6 +280,7 @@ private:
 		void* userData, const XML_Char* data, int length);
 
 	void startSkipping();
+	bool inMap() const;
 	
 	enum Element {
 		ELEMENT_LLSD,
@@ -316,10 +320,15 @@ private:
 	
 	std::string mCurrentKey;		// Current XML <tag>
 	std::string mCurrentContent;	// String data between <tag> and </tag>
+
+	LLSDXMLVisitor* mVisitor;		// If set, values are passed to it instead of being built into mResult
+	typedef std::vector<Element> ElementStack;
+	ElementStack mVisitStack;		// The maps and arrays that the visitor descended into
+	std::string mVisitKey;			// The key of the value that is being built for the visitor
 };
 
 
-LLSDXMLParser::Impl::Impl()
+LLSDXMLParser::Impl::Impl() : mVisitor(NULL)
 {
 	mParser = XML_ParserCreate(NULL);
 	reset();
@@ -505,6 +514,8 @@ void LLSDXMLParser::Impl::reset()
 	mGracefullStop = false;
 
 	mStack.clear();
+	mVisitStack.clear();
+	mVisitKey.clear();
 	
 	mSkipping = false;
 	
@@ -528,6 +539,16 @@ void LLSDXMLParser::Impl::startSkipping()
 	mSkipThrough = mDepth;
 }
 
+// Returns true if the current value is a map, either one being built or one that the visitor descended into.
+bool LLSDXMLParser::Impl::inMap() const
+{
+	if (mStack.empty())
+	{
+		return !mVisitStack.empty() && mVisitStack.back() == ELEMENT_MAP;
+	}
+	return mStack.back()->isMap();
+}
+
 const XML_Char*
 LLSDXMLParser::Impl::findAttribute(const XML_Char* name, const XML_Char** pairs)
 {
@@ -608,7 +629,7 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 			return;
 	
 		case ELEMENT_KEY:
-			if (mStack.empty()  ||  !(mStack.back()->isMap()))
+			if (!inMap())
 			{
 				return startSkipping();
 			}
@@ -629,7 +650,33 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 
 	if (!mInLLSDElement) { return startSkipping(); }
 	
-	if (mStack.empty())
+	if (mStack.empty() && mVisitor)
+	{
+		// The value is the top level value or belongs to a map or array that the visitor descended into.
+		if (!mVisitStack.empty() && mVisitStack.back() == ELEMENT_MAP)
+		{
+			if (mCurrentKey.empty()) { return startSkipping(); }
+			mVisitKey.swap(mCurrentKey);
+			mCurrentKey.clear();
+		}
+		else
+		{
+			mVisitKey.clear();
+		}
+
+		if ((element == ELEMENT_MAP && mVisitor->beginMap(mVisitKey)) ||
+			(element == ELEMENT_ARRAY && mVisitor->beginArray(mVisitKey)))
+		{
+			++mParseCount;
+			mVisitStack.push_back(element);
+			return;
+		}
+
+		// Build this value as usual and pass it to the visitor when it ends.
+		mResult.clear();
+		mStack.push_back(&mResult);
+	}
+	else if (mStack.empty())
 	{
 		mStack.push_back(&mResult);
 	}
@@ -716,6 +763,25 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 	
 	if (!mInLLSDElement) { return; }
 
+	if (mStack.empty())
+	{
+		// The end of a map or array that the visitor descended into.
+		if (mVisitor && !mVisitStack.empty())
+		{
+			Element container = mVisitStack.back();
+			mVisitStack.pop_back();
+			if (container == ELEMENT_MAP)
+			{
+				mVisitor->endMap();
+			}
+			else
+			{
+				mVisitor->endArray();
+			}
+		}
+		return;
+	}
+
 	LLSD& value = *mStack.back();
 	mStack.pop_back();
 	
@@ -805,6 +871,12 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 			break;
 	}
 
+	if (mVisitor && mStack.empty())
+	{
+		mVisitor->value(mVisitKey, mResult);
+		mResult.clear();
+	}
+
 	mCurrentContent.clear();
 }
 
@@ -924,6 +996,11 @@ void LLSDXMLParser::parsePart(const char *buf, int len)
 	impl.parsePart(buf, len);
 }
 
+void LLSDXMLParser::setVisitor(LLSDXMLVisitor* visitor)
+{
+	impl.setVisitor(visitor);
+}
+
 // virtual
 S32 LLSDXMLParser::doParse(std::istream& input, LLSD& data) const
 {
@@ -0,0 +1,103 @@
+/**
+ * @file llthreadpool.cpp
+ * @brief A number of threads that share the work of one client.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llthreadpool.h"
+#include "llformat.h"
+
+//============================================================================
+// LLThreadPool
+
+LLThreadPool::LLThreadPool()
+{
+}
+
+LLThreadPool::~LLThreadPool()
+{
+	stop();
+}
+
+void LLThreadPool::start(Client* client, std::string const& name, U32 num_threads, U32 first_index)
+{
+	llassert(mThreads.empty());
+	mThreads.reserve(num_threads);
+	for (U32 i = 0; i < num_threads; ++i)
+	{
+		Thread* thread = new Thread(llformat("%s %u", name.c_str(), first_index + i), client, first_index + i);
+		mThreads.push_back(thread);
+		thread->start();
+	}
+}
+
+void LLThreadPool::stop()
+{
+	for (std::vector<Thread*>::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+	{
+		delete *iter;		// Calls LLThread::shutdown, which waits for the thread to exit.
+	}
+	mThreads.clear();
+}
+
+void LLThreadPool::wake()
+{
+	for (std::vector<Thread*>::iterator iter = mThreads.begin(); iter != mThreads.end(); ++iter)
+	{
+		(*iter)->wake();
+	}
+}
+
+//============================================================================
+// Thread
+
+LLThreadPool::Thread::Thread(std::string const& name, Client* client, U32 index)
+	: LLThread(name), mClient(client), mIndex(index)
+{
+}
+
+// virtual
+void LLThreadPool::Thread::run(void)
+{
+	while (1)
+	{
+		// Blocks until the client has work, or we are told to quit.
+		checkPause();
+
+		if (isQuitting())
+		{
+			break;
+		}
+
+		mClient->work(mIndex);
+	}
+	llinfos << "LLThreadPool::Thread " << mName << " EXITING." << llendl;
+}
+
+// virtual
+bool LLThreadPool::Thread::runCondition(void)
+{
+	return mClient->hasWork();
+}
@@ -0,0 +1,91 @@
+/**
+ * @file llthreadpool.h
+ * @brief A number of threads that share the work of one client.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTHREADPOOL_H
+#define LL_LLTHREADPOOL_H
+
+#include <string>
+#include <vector>
+
+#include "llthread.h"
+
+//
+// Threads that sleep until their client has work, and then call work() on the
+// client until there is none left. The client keeps the work and its locking to
+// itself; the pool only starts, wakes and stops the threads.
+//
+// The threads call the client until stop() returns, so a client that owns a pool
+// calls stop() before it destroys anything that work() uses.
+//
+class LL_COMMON_API LLThreadPool
+{
+public:
+	class LL_COMMON_API Client
+	{
+	public:
+		virtual ~Client() { }
+
+		// Whether there is work that no thread started on yet. Called by the threads with
+		// their run condition locked, so it must not wait for anything that calls wake().
+		virtual bool hasWork() = 0;
+		// Does some or all of the work; it is called again for as long as hasWork() is true.
+		// index is the index the calling thread was started with.
+		virtual void work(U32 index) = 0;
+	};
+
+	LLThreadPool();
+	// Calls stop().
+	~LLThreadPool();
+
+	// Starts num_threads threads named "name <index>", with indices first_index and up.
+	void start(Client* client, std::string const& name, U32 num_threads, U32 first_index = 0);
+	// Tells the threads to quit and waits for them to exit.
+	void stop();
+
+	U32 getNumThreads() const { return (U32)mThreads.size(); }
+
+	// Wakes up the threads after work was added.
+	void wake();
+
+private:
+	class Thread : public LLThread
+	{
+	public:
+		Thread(std::string const& name, Client* client, U32 index);
+
+	protected:
+		/*virtual*/ void run(void);
+		/*virtual*/ bool runCondition(void);
+
+	private:
+		Client* mClient;
+		U32 mIndex;
+	};
+
+	std::vector<Thread*> mThreads;
+};
+
+#endif // LL_LLTHREADPOOL_H
@@ -0,0 +1,587 @@
+/**
+ * @file llimagescale.cpp
+ * @brief Row kernels used by LLImageRaw to scale and composite images.
+ *
+ * $LicenseInfo:firstyear=2000&license=viewergpl$
+ *
+ * Copyright (c) 2000-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimagescale.h"
+
+#include "llmath.h"
+#include "llprocessor.h"
+
+#include <vector>
+
+#if LL_IMAGESCALE_SSE2
+#include <emmintrin.h>
+#endif
+
+bool LLImageScale::sUseSSE2 = false;
+
+// Calculates (U8)(255*(a/255.f)*(b/255.f) + 0.5f).  Thanks, Jim Blinn!
+// Same as LLImageRaw::fastFractionalMult.
+static inline U8 fastFractionalMult(U8 a, U8 b)
+{
+	U32 i = a * b + 128;
+	return U8((i + (i>>8)) >> 8);
+}
+
+// Blend the scaled RGBA pixel onto the RGB pixel out.
+static inline void compositePixel(U8* out, U8 r, U8 g, U8 b, U8 a)
+{
+	if (a)
+	{
+		if (255 == a)
+		{
+			out[0] = r;
+			out[1] = g;
+			out[2] = b;
+		}
+		else
+		{
+			U8 transparency = 255 - a;
+			out[0] = fastFractionalMult(out[0], transparency) + fastFractionalMult(r, a);
+			out[1] = fastFractionalMult(out[1], transparency) + fastFractionalMult(g, a);
+			out[2] = fastFractionalMult(out[2], transparency) + fastFractionalMult(b, a);
+		}
+	}
+}
+
+//static
+void LLImageScale::initClass()
+{
+#if LL_IMAGESCALE_SSE2
+	setUseSSE2(LLProcessorInfo().hasSSE2());
+#endif
+	llinfos << "Using " << (sUseSSE2 ? "SSE2" : "scalar") << " image scaling kernels." << llendl;
+}
+
+//static
+void LLImageScale::setUseSSE2(bool use_sse2)
+{
+	sUseSSE2 = LL_IMAGESCALE_SSE2 && use_sse2;
+}
+
+//static
+void LLImageScale::scaleRows(U8 const* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows)
+{
+#if LL_IMAGESCALE_SSE2
+	if (sUseSSE2)
+	{
+		scaleRowsSSE2(in, out, row_bytes, in_rows, out_rows);
+		return;
+	}
+#endif
+	scaleRowsScalar(in, out, row_bytes, in_rows, out_rows);
+}
+
+//static
+void LLImageScale::copyLineScaled(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+#if LL_IMAGESCALE_SSE2
+	if (sUseSSE2)
+	{
+		copyLineScaledSSE2(in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step, components);
+		return;
+	}
+#endif
+	copyLineScaledScalar(in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step, components);
+}
+
+//static
+void LLImageScale::compositeRowScaled4onto3(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len)
+{
+#if LL_IMAGESCALE_SSE2
+	if (sUseSSE2)
+	{
+		compositeRowScaled4onto3SSE2(in, out, in_pixel_len, out_pixel_len);
+		return;
+	}
+#endif
+	compositeRowScaled4onto3Scalar(in, out, in_pixel_len, out_pixel_len);
+}
+
+//----------------------------------------------------------------------------
+// Scalar kernels
+
+//static
+void LLImageScale::scaleRowsScalar(U8 const* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows)
+{
+	const F32 ratio = F32(in_rows) / out_rows; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	// Walk the image a whole row at a time instead of a column at a time; that is
+	// the same filter as copyLineScaled with a pixel step of one row, but it reads memory sequentially.
+	std::vector<F32> sum(row_bytes);
+	for (S32 y = 0; y < out_rows; ++y)
+	{
+		// Avoid floating point accumulation error... don't just add ratio each time.  JC
+		const F32 sample0 = y * ratio;
+		const F32 sample1 = (y+1) * ratio;
+		const S32 index0 = llfloor(sample0);			// top integer (floor)
+		const S32 index1 = llfloor(sample1);			// bottom integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on top
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on bottom
+
+		U8* outp = out + y * row_bytes;
+		if (index0 == index1)
+		{
+			// Interval is embedded in one input row
+			memcpy(outp, in + index0 * row_bytes, row_bytes);	/* Flawfinder: ignore */
+			continue;
+		}
+
+		// Top straddle
+		U8 const* inp = in + index0 * row_bytes;
+		for (S32 i = 0; i < row_bytes; ++i)
+		{
+			sum[i] = inp[i] * fract0;
+		}
+		// Central interval
+		for (S32 u = index0 + 1; u < index1; ++u)
+		{
+			inp = in + u * row_bytes;
+			for (S32 i = 0; i < row_bytes; ++i)
+			{
+				sum[i] += inp[i];
+			}
+		}
+		// Bottom straddle
+		// Watch out for reading off of end of input array.
+		if (fract1 && index1 < in_rows)
+		{
+			inp = in + index1 * row_bytes;
+			for (S32 i = 0; i < row_bytes; ++i)
+			{
+				sum[i] += inp[i] * fract1;
+			}
+		}
+		for (S32 i = 0; i < row_bytes; ++i)
+		{
+			outp[i] = U8(llround(sum[i] * norm_factor));
+		}
+	}
+}
+
+//static
+void LLImageScale::copyLineScaledScalar(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+	llassert( components >= 1 && components <= 4 );
+
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	S32 goff = components >= 2 ? 1 : 0;
+	S32 boff = components >= 3 ? 2 : 0;
+	for( S32 x = 0; x < out_pixel_len; x++ )
+	{
+		// Sample input pixels in range from sample0 to sample1.
+		// Avoid floating point accumulation error... don't just add ratio each time.  JC
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = llfloor(sample0);			// left integer (floor)
+		const S32 index1 = llfloor(sample1);			// right integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on left
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on right
+
+		if( index0 == index1 )
+		{
+			// Interval is embedded in one input pixel
+			S32 t0 = x * out_pixel_step * components;
+			S32 t1 = index0 * in_pixel_step * components;
+			U8* outp = out + t0;
+			U8 const* inp = in + t1;
+			for (S32 i = 0; i < components; ++i)
+			{
+				*outp = *inp;
+				++outp;
+				++inp;
+			}
+		}
+		else
+		{
+			// Left straddle
+			S32 t1 = index0 * in_pixel_step * components;
+			F32 r = in[t1 + 0] * fract0;
+			F32 g = in[t1 + goff] * fract0;
+			F32 b = in[t1 + boff] * fract0;
+			F32 a = 0;
+			if( components == 4)
+			{
+				a = in[t1 + 3] * fract0;
+			}
+
+			// Central interval
+			if (components < 4)
+			{
+				for( S32 u = index0 + 1; u < index1; u++ )
+				{
+					S32 t2 = u * in_pixel_step * components;
+					r += in[t2 + 0];
+					g += in[t2 + goff];
+					b += in[t2 + boff];
+				}
+			}
+			else
+			{
+				for( S32 u = index0 + 1; u < index1; u++ )
+				{
+					S32 t2 = u * in_pixel_step * components;
+					r += in[t2 + 0];
+					g += in[t2 + 1];
+					b += in[t2 + 2];
+					a += in[t2 + 3];
+				}
+			}
+
+			// right straddle
+			// Watch out for reading off of end of input array.
+			if( fract1 && index1 < in_pixel_len )
+			{
+				S32 t3 = index1 * in_pixel_step * components;
+				if (components < 4)
+				{
+					U8 in0 = in[t3 + 0];
+					U8 in1 = in[t3 + goff];
+					U8 in2 = in[t3 + boff];
+					r += in0 * fract1;
+					g += in1 * fract1;
+					b += in2 * fract1;
+				}
+				else
+				{
+					U8 in0 = in[t3 + 0];
+					U8 in1 = in[t3 + 1];
+					U8 in2 = in[t3 + 2];
+					U8 in3 = in[t3 + 3];
+					r += in0 * fract1;
+					g += in1 * fract1;
+					b += in2 * fract1;
+					a += in3 * fract1;
+				}
+			}
+
+			r *= norm_factor;
+			g *= norm_factor;
+			b *= norm_factor;
+			a *= norm_factor;  // skip conditional
+
+			S32 t4 = x * out_pixel_step * components;
+			out[t4 + 0] = U8(llround(r));
+			if (components >= 2)
+				out[t4 + 1] = U8(llround(g));
+			if (components >= 3)
+				out[t4 + 2] = U8(llround(b));
+			if( components == 4)
+				out[t4 + 3] = U8(llround(a));
+		}
+	}
+}
+
+//static
+void LLImageScale::compositeRowScaled4onto3Scalar(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len)
+{
+	const S32 IN_COMPONENTS = 4;
+	const S32 OUT_COMPONENTS = 3;
+
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	for( S32 x = 0; x < out_pixel_len; x++ )
+	{
+		// Sample input pixels in range from sample0 to sample1.
+		// Avoid floating point accumulation error... don't just add ratio each time.  JC
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = S32(sample0);			// left integer (floor)
+		const S32 index1 = S32(sample1);			// right integer (floor)
+		const F32 fract0 = 1.f - (sample0 - F32(index0));	// spill over on left
+		const F32 fract1 = sample1 - F32(index1);			// spill-over on right
+
+		U8 in_scaled_r;
+		U8 in_scaled_g;
+		U8 in_scaled_b;
+		U8 in_scaled_a;
+
+		if( index0 == index1 )
+		{
+			// Interval is embedded in one input pixel
+			S32 t1 = index0 * IN_COMPONENTS;
+			in_scaled_r = in[t1 + 0];
+			in_scaled_g = in[t1 + 1];
+			in_scaled_b = in[t1 + 2];
+			in_scaled_a = in[t1 + 3];
+		}
+		else
+		{
+			// Left straddle
+			S32 t1 = index0 * IN_COMPONENTS;
+			F32 r = in[t1 + 0] * fract0;
+			F32 g = in[t1 + 1] * fract0;
+			F32 b = in[t1 + 2] * fract0;
+			F32 a = in[t1 + 3] * fract0;
+
+			// Central interval
+			for( S32 u = index0 + 1; u < index1; u++ )
+			{
+				S32 t2 = u * IN_COMPONENTS;
+				r += in[t2 + 0];
+				g += in[t2 + 1];
+				b += in[t2 + 2];
+				a += in[t2 + 3];
+			}
+
+			// right straddle
+			// Watch out for reading off of end of input array.
+			if( fract1 && index1 < in_pixel_len )
+			{
+				S32 t3 = index1 * IN_COMPONENTS;
+				r += in[t3 + 0] * fract1;
+				g += in[t3 + 1] * fract1;
+				b += in[t3 + 2] * fract1;
+				a += in[t3 + 3] * fract1;
+			}
+
+			r *= norm_factor;
+			g *= norm_factor;
+			b *= norm_factor;
+			a *= norm_factor;
+
+			in_scaled_r = U8(llround(r));
+			in_scaled_g = U8(llround(g));
+			in_scaled_b = U8(llround(b));
+			in_scaled_a = U8(llround(a));
+		}
+
+		compositePixel(out, in_scaled_r, in_scaled_g, in_scaled_b, in_scaled_a);
+		out += OUT_COMPONENTS;
+	}
+}
+
+#if LL_IMAGESCALE_SSE2
+//----------------------------------------------------------------------------
+// SSE2 kernels
+//
+// These do the same floating point operations, in the same order, as the scalar
+// kernels; they just do them for four (RGBA pixels) or sixteen (rows) channels at once.
+
+// Load one RGBA pixel as four floats.
+static LL_FORCE_INLINE __m128 loadPixel(U8 const* p)
+{
+	S32 v;
+	memcpy(&v, p, sizeof(v));
+	__m128i const zero = _mm_setzero_si128();
+	__m128i pixel = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero);
+	return _mm_cvtepi32_ps(_mm_unpacklo_epi16(pixel, zero));
+}
+
+// llround() for non-negative values, followed by a saturating conversion to U8.
+// Returns the four bytes in the low 32 bits.
+static LL_FORCE_INLINE __m128i roundToU8(__m128 v0, __m128 v1, __m128 v2, __m128 v3)
+{
+	__m128 const half = _mm_set1_ps(0.5f);
+	__m128i i0 = _mm_cvttps_epi32(_mm_add_ps(v0, half));
+	__m128i i1 = _mm_cvttps_epi32(_mm_add_ps(v1, half));
+	__m128i i2 = _mm_cvttps_epi32(_mm_add_ps(v2, half));
+	__m128i i3 = _mm_cvttps_epi32(_mm_add_ps(v3, half));
+	return _mm_packus_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3));
+}
+
+// Box filter one pixel of a line of RGBA pixels.
+static LL_FORCE_INLINE __m128 filterPixel(U8 const* in, S32 in_step_bytes, S32 in_pixel_len,
+										  S32 index0, S32 index1, F32 fract0, F32 fract1, F32 norm_factor)
+{
+	// Left straddle
+	__m128 sum = _mm_mul_ps(loadPixel(in + index0 * in_step_bytes), _mm_set1_ps(fract0));
+	// Central interval
+	for (S32 u = index0 + 1; u < index1; ++u)
+	{
+		sum = _mm_add_ps(sum, loadPixel(in + u * in_step_bytes));
+	}
+	// Right straddle
+	// Watch out for reading off of end of input array.
+	if (fract1 && index1 < in_pixel_len)
+	{
+		sum = _mm_add_ps(sum, _mm_mul_ps(loadPixel(in + index1 * in_step_bytes), _mm_set1_ps(fract1)));
+	}
+	return _mm_mul_ps(sum, _mm_set1_ps(norm_factor));
+}
+
+//static
+void LLImageScale::scaleRowsSSE2(U8 const* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows)
+{
+	const F32 ratio = F32(in_rows) / out_rows; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+	const S32 vector_bytes = row_bytes & ~15;
+	__m128i const zero = _mm_setzero_si128();
+
+	for (S32 y = 0; y < out_rows; ++y)
+	{
+		const F32 sample0 = y * ratio;
+		const F32 sample1 = (y+1) * ratio;
+		const S32 index0 = llfloor(sample0);
+		const S32 index1 = llfloor(sample1);
+		const F32 fract0 = 1.f - (sample0 - F32(index0));
+		const F32 fract1 = sample1 - F32(index1);
+
+		U8* outp = out + y * row_bytes;
+		if (index0 == index1)
+		{
+			memcpy(outp, in + index0 * row_bytes, row_bytes);	/* Flawfinder: ignore */
+			continue;
+		}
+
+		bool const bottom = fract1 && index1 < in_rows;
+		__m128 const f0 = _mm_set1_ps(fract0);
+		__m128 const f1 = _mm_set1_ps(fract1);
+		__m128 const norm = _mm_set1_ps(norm_factor);
+
+		// Sixteen channels at a time, keeping the sums in registers while walking down the rows.
+		for (S32 i = 0; i < vector_bytes; i += 16)
+		{
+			__m128 sum[4];
+			U8 const* inp = in + index0 * row_bytes + i;
+			__m128i bytes = _mm_loadu_si128((__m128i const*)inp);
+			__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+			__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+			sum[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), f0);
+			sum[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), f0);
+			sum[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), f0);
+			sum[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), f0);
+			for (S32 u = index0 + 1; u < index1; ++u)
+			{
+				inp += row_bytes;
+				bytes = _mm_loadu_si128((__m128i const*)inp);
+				lo = _mm_unpacklo_epi8(bytes, zero);
+				hi = _mm_unpackhi_epi8(bytes, zero);
+				sum[0] = _mm_add_ps(sum[0], _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+				sum[1] = _mm_add_ps(sum[1], _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+				sum[2] = _mm_add_ps(sum[2], _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+				sum[3] = _mm_add_ps(sum[3], _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+			}
+			if (bottom)
+			{
+				bytes = _mm_loadu_si128((__m128i const*)(in + index1 * row_bytes + i));
+				lo = _mm_unpacklo_epi8(bytes, zero);
+				hi = _mm_unpackhi_epi8(bytes, zero);
+				sum[0] = _mm_add_ps(sum[0], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), f1));
+				sum[1] = _mm_add_ps(sum[1], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), f1));
+				sum[2] = _mm_add_ps(sum[2], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), f1));
+				sum[3] = _mm_add_ps(sum[3], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), f1));
+			}
+			__m128i result = roundToU8(_mm_mul_ps(sum[0], norm), _mm_mul_ps(sum[1], norm), _mm_mul_ps(sum[2], norm), _mm_mul_ps(sum[3], norm));
+			_mm_storeu_si128((__m128i*)(outp + i), result);
+		}
+
+		// The remaining (less than sixteen) channels.
+		for (S32 i = vector_bytes; i < row_bytes; ++i)
+		{
+			F32 sum = in[index0 * row_bytes + i] * fract0;
+			for (S32 u = index0 + 1; u < index1; ++u)
+			{
+				sum += in[u * row_bytes + i];
+			}
+			if (bottom)
+			{
+				sum += in[index1 * row_bytes + i] * fract1;
+			}
+			outp[i] = U8(llround(sum * norm_factor));
+		}
+	}
+}
+
+//static
+void LLImageScale::copyLineScaledSSE2(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+{
+	if (components != 4)
+	{
+		copyLineScaledScalar(in, out, in_pixel_len, out_pixel_len, in_pixel_step, out_pixel_step, components);
+		return;
+	}
+
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+	const S32 in_step_bytes = in_pixel_step * 4;
+	const S32 out_step_bytes = out_pixel_step * 4;
+
+	for (S32 x = 0; x < out_pixel_len; ++x)
+	{
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = llfloor(sample0);
+		const S32 index1 = llfloor(sample1);
+		const F32 fract0 = 1.f - (sample0 - F32(index0));
+		const F32 fract1 = sample1 - F32(index1);
+
+		U8* outp = out + x * out_step_bytes;
+		if (index0 == index1)
+		{
+			// Interval is embedded in one input pixel
+			memcpy(outp, in + index0 * in_step_bytes, 4);	/* Flawfinder: ignore */
+			continue;
+		}
+
+		__m128 pixel = filterPixel(in, in_step_bytes, in_pixel_len, index0, index1, fract0, fract1, norm_factor);
+		S32 result = _mm_cvtsi128_si32(roundToU8(pixel, pixel, pixel, pixel));
+		memcpy(outp, &result, 4);	/* Flawfinder: ignore */
+	}
+}
+
+//static
+void LLImageScale::compositeRowScaled4onto3SSE2(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len)
+{
+	const F32 ratio = F32(in_pixel_len) / out_pixel_len; // ratio of old to new
+	const F32 norm_factor = 1.f / ratio;
+
+	for (S32 x = 0; x < out_pixel_len; ++x)
+	{
+		const F32 sample0 = x * ratio;
+		const F32 sample1 = (x+1) * ratio;
+		const S32 index0 = S32(sample0);
+		const S32 index1 = S32(sample1);
+		const F32 fract0 = 1.f - (sample0 - F32(index0));
+		const F32 fract1 = sample1 - F32(index1);
+
+		U8 rgba[4];
+		if (index0 == index1)
+		{
+			memcpy(rgba, in + index0 * 4, 4);	/* Flawfinder: ignore */
+		}
+		else
+		{
+			__m128 pixel = filterPixel(in, 4, in_pixel_len, index0, index1, fract0, fract1, norm_factor);
+			S32 result = _mm_cvtsi128_si32(roundToU8(pixel, pixel, pixel, pixel));
+			memcpy(rgba, &result, 4);	/* Flawfinder: ignore */
+		}
+		compositePixel(out, rgba[0], rgba[1], rgba[2], rgba[3]);
+		out += 3;
+	}
+}
+#endif // LL_IMAGESCALE_SSE2
@@ -0,0 +1,84 @@
+/**
+ * @file llimagescale.h
+ * @brief Row kernels used by LLImageRaw to scale and composite images.
+ *
+ * $LicenseInfo:firstyear=2000&license=viewergpl$
+ *
+ * Copyright (c) 2000-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGESCALE_H
+#define LL_LLIMAGESCALE_H
+
+#include "stdtypes.h"
+
+// SSE2 kernels are compiled in whenever the compiler targets SSE2; whether they are used is decided at run time.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LL_IMAGESCALE_SSE2 1
+#else
+#define LL_IMAGESCALE_SSE2 0
+#endif
+
+// All kernels apply the same box filter: every output sample is the average of the
+// input samples it covers, with partial weights for the input samples at its edges.
+class LLImageScale
+{
+public:
+	// Select the fastest kernels supported by this CPU.
+	static void initClass();
+
+	// Force the scalar (false) or SSE2 (true) kernels. The latter is ignored when SSE2 was not compiled in.
+	static void setUseSSE2(bool use_sse2);
+	static bool getUseSSE2() { return sUseSSE2; }
+
+	// Scale in_rows rows of row_bytes bytes to out_rows rows. Every byte is filtered
+	// independently, so this works for any number of components per pixel.
+	static void scaleRows(U8 const* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows);
+
+	// Scale a line of in_pixel_len pixels to out_pixel_len pixels.
+	// The steps are the distance between two consecutive pixels, in pixels.
+	static void copyLineScaled(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components);
+
+	// Scale a line of in_pixel_len RGBA pixels to out_pixel_len pixels and blend it onto the RGB line out.
+	static void compositeRowScaled4onto3(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len);
+
+	// The scalar kernels, which are always available.
+	static void scaleRowsScalar(U8 const* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows);
+	static void copyLineScaledScalar(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components);
+	static void compositeRowScaled4onto3Scalar(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len);
+
+#if LL_IMAGESCALE_SSE2
+	static void scaleRowsSSE2(U8 const* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows);
+	// Only handles components == 4; falls back to the scalar kernel otherwise.
+	static void copyLineScaledSSE2(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components);
+	static void compositeRowScaled4onto3SSE2(U8 const* in, U8* out, S32 in_pixel_len, S32 out_pixel_len);
+#endif
+
+private:
+	static bool sUseSSE2;
+};
+
+#endif
@@ -32,14 +32,35 @@
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, U32 pool_size)
 	: LLQueuedThread("imagedecode", threaded)
 {
+	if (threaded && pool_size > 1)
+	{
+		if (pool_size > MAX_POOL_SIZE)
+		{
+			pool_size = MAX_POOL_SIZE;
+		}
+		mHelpers.start(this, "imagedecode", pool_size - 1, 1);
+		llinfos << "Decoding images with " << pool_size << " threads." << llendl;
+	}
 }
 
 //virtual 
 LLImageDecodeThread::~LLImageDecodeThread()
 {
+	// The helper threads must be gone before ~LLQueuedThread deletes the requests.
+	mHelpers.stop();
+}
+
+// MAIN THREAD
+//virtual
+void LLImageDecodeThread::shutdown()
+{
+	// LLQueuedThread::shutdown only waits for our own thread before it deletes
+	// all requests, which the helper threads might still be decoding.
+	mHelpers.stop();
+	LLQueuedThread::shutdown();
 }
 
 // MAIN THREAD
@@ -61,8 +82,14 @@ S32 LLImageDecodeThread::update(F32 max_time_ms)
 			llerrs << "request added after LLLFSThread::cleanupClass()" << llendl;
 		}
 	}
+	bool added = !mCreationList.empty();
 	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
+	if (added)
+	{
+		// addRequest() only woke up our own thread.
+		mHelpers.wake();
+	}
 	return res;
 }
 
@@ -90,6 +117,22 @@ LLImageDecodeThread::Responder::~Responder()
 
 //----------------------------------------------------------------------------
 
+// HELPER THREADS
+// virtual
+void LLImageDecodeThread::work(U32 index)
+{
+	processNextRequest();
+}
+
+// virtual
+bool LLImageDecodeThread::hasWork()
+{
+	// The run condition of the helper is locked here; getPending() takes our own lock, which never waits for it.
+	return getPending() > 0;
+}
+
+//----------------------------------------------------------------------------
+
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
 												LLImageDecodeThread::Responder* responder)
@@ -30,8 +30,9 @@
 #include "llimage.h"
 #include "llpointer.h"
 #include "llworkerthread.h"
+#include "llthreadpool.h"
 
-class LLImageDecodeThread : public LLQueuedThread
+class LLImageDecodeThread : public LLQueuedThread, private LLThreadPool::Client
 {
 public:
 	class Responder : public LLThreadSafeRefCount
@@ -72,8 +73,16 @@ public:
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// Maximum number of threads (including this one) that decode images.
+	static U32 const MAX_POOL_SIZE = 8;
+
+	// pool_size is the total number of decode threads; it is ignored when threaded is false.
+	LLImageDecodeThread(bool threaded = true, U32 pool_size = 1);
 	virtual ~LLImageDecodeThread();
+	/*virtual*/ void shutdown();
+
+	// Returns the number of threads that decode images.
+	U32 getPoolSize() const { return mHelpers.getNumThreads() + 1; }
 
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
@@ -99,6 +108,13 @@ private:
 	typedef std::list<creation_info> creation_list_t;
 	creation_list_t mCreationList;
 	LLMutex mCreationMutex;
+
+	// The helper threads pull requests from the same queue as our own thread,
+	// so that up to pool_size images can be decoded concurrently.
+	/*virtual*/ void work(U32 index);
+	/*virtual*/ bool hasWork();
+
+	LLThreadPool mHelpers;		// Helper threads; none unless threaded and pool_size > 1.
 };
 
 #endif
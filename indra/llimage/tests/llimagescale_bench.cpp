@@ -0,0 +1,219 @@
+/**
+ * @file llimagescale_bench.cpp
+ * @brief Compares the scalar and SSE2 image scaling kernels with the old column-by-column code.
+ *
+ * $LicenseInfo:firstyear=2000&license=viewergpl$
+ *
+ * Copyright (c) 2000-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Usage: llimagescale_bench [iterations]
+//
+// For 512x512, 1024x1024 and 2048x2048 RGBA images, times LLImageRaw::scale (to half
+// and to three quarters of the size) and LLImageRaw::compositeScaled4onto3 with:
+//   legacy - the vertical pass done column by column, as LLImageRaw used to do it,
+//   scalar - the row based scalar kernels,
+//   sse2   - the SSE2 kernels (if compiled in and supported by the CPU),
+// and reports the largest difference of every variant's output with the legacy output.
+
+#include "linden_common.h"
+
+#include "../llimagescale.h"
+#include "llmath.h"
+#include "lltimer.h"
+#include "llprocessor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+enum EVariant { LEGACY, SCALAR, SSE2, NUM_VARIANTS };
+char const* const variant_names[NUM_VARIANTS] = { "legacy", "scalar", "sse2" };
+
+const S32 COMPONENTS = 4;
+
+// Same two pass structure as LLImageRaw::scale: vertical, then horizontal.
+void scaleImage(EVariant variant, U8 const* in, S32 width, S32 height, std::vector<U8>& temp, U8* out, S32 new_width, S32 new_height)
+{
+	S32 const width_bytes = width * COMPONENTS;
+	S32 const new_width_bytes = new_width * COMPONENTS;
+	switch (variant)
+	{
+		case LEGACY:
+			for (S32 col = 0; col < width; ++col)
+			{
+				LLImageScale::copyLineScaledScalar(in + COMPONENTS * col, &temp[0] + COMPONENTS * col, height, new_height, width, width, COMPONENTS);
+			}
+			for (S32 row = 0; row < new_height; ++row)
+			{
+				LLImageScale::copyLineScaledScalar(&temp[0] + width_bytes * row, out + new_width_bytes * row, width, new_width, 1, 1, COMPONENTS);
+			}
+			break;
+		case SCALAR:
+			LLImageScale::scaleRowsScalar(in, &temp[0], width_bytes, height, new_height);
+			for (S32 row = 0; row < new_height; ++row)
+			{
+				LLImageScale::copyLineScaledScalar(&temp[0] + width_bytes * row, out + new_width_bytes * row, width, new_width, 1, 1, COMPONENTS);
+			}
+			break;
+		case SSE2:
+#if LL_IMAGESCALE_SSE2
+			LLImageScale::scaleRowsSSE2(in, &temp[0], width_bytes, height, new_height);
+			for (S32 row = 0; row < new_height; ++row)
+			{
+				LLImageScale::copyLineScaledSSE2(&temp[0] + width_bytes * row, out + new_width_bytes * row, width, new_width, 1, 1, COMPONENTS);
+			}
+#endif
+			break;
+		default:
+			break;
+	}
+}
+
+// Same two pass structure as LLImageRaw::compositeScaled4onto3.
+void compositeImage(EVariant variant, U8 const* in, S32 width, S32 height, std::vector<U8>& temp, U8* out, S32 new_width, S32 new_height)
+{
+	S32 const width_bytes = width * COMPONENTS;
+	switch (variant)
+	{
+		case LEGACY:
+			for (S32 col = 0; col < width; ++col)
+			{
+				LLImageScale::copyLineScaledScalar(in + COMPONENTS * col, &temp[0] + COMPONENTS * col, height, new_height, width, width, COMPONENTS);
+			}
+			for (S32 row = 0; row < new_height; ++row)
+			{
+				LLImageScale::compositeRowScaled4onto3Scalar(&temp[0] + width_bytes * row, out + 3 * new_width * row, width, new_width);
+			}
+			break;
+		case SCALAR:
+			LLImageScale::scaleRowsScalar(in, &temp[0], width_bytes, height, new_height);
+			for (S32 row = 0; row < new_height; ++row)
+			{
+				LLImageScale::compositeRowScaled4onto3Scalar(&temp[0] + width_bytes * row, out + 3 * new_width * row, width, new_width);
+			}
+			break;
+		case SSE2:
+#if LL_IMAGESCALE_SSE2
+			LLImageScale::scaleRowsSSE2(in, &temp[0], width_bytes, height, new_height);
+			for (S32 row = 0; row < new_height; ++row)
+			{
+				LLImageScale::compositeRowScaled4onto3SSE2(&temp[0] + width_bytes * row, out + 3 * new_width * row, width, new_width);
+			}
+#endif
+			break;
+		default:
+			break;
+	}
+}
+
+typedef void (*operation_t)(EVariant, U8 const*, S32, S32, std::vector<U8>&, U8*, S32, S32);
+
+S32 maxDifference(std::vector<U8> const& a, std::vector<U8> const& b)
+{
+	S32 max_diff = 0;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		max_diff = llmax(max_diff, llabs(S32(a[i]) - S32(b[i])));
+	}
+	return max_diff;
+}
+
+void benchmark(char const* name, operation_t operation, S32 out_components, std::vector<U8> const& in, S32 size, S32 new_size, S32 iterations, bool have_sse2)
+{
+	std::vector<U8> temp(size * new_size * COMPONENTS);
+	std::vector<U8> reference;
+	F64 legacy_ms = 0.0;
+	for (S32 v = 0; v < NUM_VARIANTS; ++v)
+	{
+		EVariant variant = EVariant(v);
+		if (variant == SSE2 && !have_sse2)
+		{
+			continue;
+		}
+		// Composite blends onto the destination, so start every run from the same background.
+		std::vector<U8> out(new_size * new_size * out_components, 0x80);
+		operation(variant, &in[0], size, size, temp, &out[0], new_size, new_size);
+		S32 max_diff = 0;
+		if (variant == LEGACY)
+		{
+			reference = out;
+		}
+		else
+		{
+			max_diff = maxDifference(reference, out);
+		}
+		LLTimer timer;
+		for (S32 i = 0; i < iterations; ++i)
+		{
+			std::fill(out.begin(), out.end(), 0x80);
+			operation(variant, &in[0], size, size, temp, &out[0], new_size, new_size);
+		}
+		F64 ms = timer.getElapsedTimeF64() * 1000.0 / iterations;
+		if (variant == LEGACY)
+		{
+			legacy_ms = ms;
+		}
+		printf("%-24s %4dx%-4d -> %4dx%-4d %-6s %9.3f ms  x%5.2f  max diff %d\n",
+			   name, size, size, new_size, new_size, variant_names[v], ms, legacy_ms / ms, max_diff);
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	S32 iterations = argc > 1 ? atoi(argv[1]) : 10;
+	if (iterations < 1)
+	{
+		iterations = 1;
+	}
+
+	bool have_sse2 = LL_IMAGESCALE_SSE2 && LLProcessorInfo().hasSSE2();
+	printf("SSE2 kernels: %s\n", have_sse2 ? "yes" : "no");
+
+	S32 const sizes[] = { 512, 1024, 2048 };
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+	{
+		S32 const size = sizes[s];
+		// Random content; fixed seed so runs are comparable.
+		std::vector<U8> in(size * size * COMPONENTS);
+		U32 seed = 12345;
+		for (size_t i = 0; i < in.size(); ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			in[i] = U8(seed >> 24);
+		}
+		benchmark("scale 1/2", scaleImage, COMPONENTS, in, size, size / 2, iterations, have_sse2);
+		benchmark("scale 3/4", scaleImage, COMPONENTS, in, size, size * 3 / 4, iterations, have_sse2);
+		benchmark("compositeScaled4onto3", compositeImage, 3, in, size, size / 2, iterations, have_sse2);
+	}
+	return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file llimageworker_bench.cpp
+ * @brief Measures how the throughput of LLImageDecodeThread grows with its pool of threads.
+ *
+ * $LicenseInfo:firstyear=2000&license=viewergpl$
+ *
+ * Copyright (c) 2000-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Usage: llimageworker_bench [requests] [busy_ms]
+//
+// Queues the given number of requests (default 256) on an LLImageDecodeThread with
+// 1, 2, 4 and 8 threads, each request keeping the thread that decodes it busy for
+// busy_ms milliseconds (default 5), and reports the time it took to complete them
+// all and the speedup over a single thread.
+
+#include "linden_common.h"
+
+#include "../llimageworker.h"
+#include "llatomic.h"
+#include "lltimer.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+extern void ll_init_apr();
+
+// Stubs for the images; the requests are queued without one, so nothing is decoded.
+LLImageBase::LLImageBase() {}
+LLImageBase::~LLImageBase() {}
+void LLImageBase::dump() { }
+void LLImageBase::sanityCheck() { }
+void LLImageBase::deleteData() { }
+U8* LLImageBase::allocateData(S32 size) { return NULL; }
+U8* LLImageBase::reallocateData(S32 size) { return NULL; }
+
+LLImageRaw::LLImageRaw(U16 width, U16 height, S8 components) { }
+LLImageRaw::~LLImageRaw() { }
+void LLImageRaw::deleteData() { }
+U8* LLImageRaw::allocateData(S32 size) { return NULL; }
+U8* LLImageRaw::reallocateData(S32 size) { return NULL; }
+
+namespace
+{
+
+// completed() is called on the thread that processed the request, so sleeping
+// here keeps that thread busy just like a real decode would.
+class BusyResponder : public LLImageDecodeThread::Responder
+{
+public:
+	BusyResponder(LLAtomicU32* count, U32 busy_ms) : mCount(count), mBusyMs(busy_ms) { }
+	virtual void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
+	{
+		ms_sleep(mBusyMs);
+		(*mCount)++;
+	}
+private:
+	LLAtomicU32* mCount;
+	U32 mBusyMs;
+};
+
+// Returns the time in seconds it took to complete all requests, or a negative
+// value if they were not all completed within a minute.
+F64 decodeAll(U32 pool_size, U32 requests, U32 busy_ms)
+{
+	LLImageDecodeThread* thread = new LLImageDecodeThread(true, pool_size);
+	LLAtomicU32 count(0);
+	LLTimer timer;
+	for (U32 i = 0; i < requests; ++i)
+	{
+		thread->decodeImage(NULL, LLQueuedThread::PRIORITY_NORMAL, 0, FALSE, new BusyResponder(&count, busy_ms));
+	}
+	thread->update(1);
+	while (count < requests && timer.getElapsedTimeF64() < 60.0)
+	{
+		ms_sleep(1);
+	}
+	F64 elapsed = timer.getElapsedTimeF64();
+	bool all_done = (count == requests);
+	delete thread;
+	return all_done ? elapsed : -1.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	ll_init_apr();
+
+	U32 requests = argc > 1 ? atoi(argv[1]) : 256;
+	U32 busy_ms = argc > 2 ? atoi(argv[2]) : 5;
+	if (requests < 1)
+	{
+		requests = 1;
+	}
+
+	F64 single = 0.0;
+	U32 const pool_sizes[] = { 1, 2, 4, 8 };
+	for (size_t p = 0; p < sizeof(pool_sizes) / sizeof(pool_sizes[0]); ++p)
+	{
+		F64 elapsed = decodeAll(pool_sizes[p], requests, busy_ms);
+		if (elapsed < 0.0)
+		{
+			printf("%u thread(s): not all requests completed\n", pool_sizes[p]);
+			return 1;
+		}
+		if (p == 0)
+		{
+			single = elapsed;
+		}
+		printf("%u thread(s): %u requests in %9.3f ms  %9.1f requests/s  x%5.2f\n",
+			   pool_sizes[p], requests, elapsed * 1000.0, requests / elapsed, single / elapsed);
+	}
+	return 0;
+}
@@ -105,6 +105,26 @@ namespace tut
 			bool* done;
 	};
 
+	// Responder that records how often, and with what result, its request completed.
+	// Without an image a request has to complete exactly once, unsuccessfully and
+	// without output.
+	class responder_count_test : public LLImageDecodeThread::Responder
+	{
+		public:
+			responder_count_test(LLAtomicU32* calls, LLAtomicU32* wrong) : mCalls(calls), mWrong(wrong) { }
+			virtual void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
+			{
+				if (success || raw || aux)
+				{
+					(*mWrong)++;
+				}
+				(*mCalls)++;
+			}
+		private:
+			LLAtomicU32* mCalls;
+			LLAtomicU32* mWrong;
+	};
+
 	// Test wrapper declaration : decode thread
 	struct imagedecodethread_test
 	{
@@ -239,6 +259,61 @@ namespace tut
 		ensure("LLImageDecodeThread: threaded work unit not processed", done == true);
 	}
 
+	template<> template<>
+	void imagedecodethread_object_t::test<3>()
+	{
+		// Test the pool size bookkeeping
+		mThread = new LLImageDecodeThread(false, 4);
+		ensure("LLImageDecodeThread: non threaded instance must not create helper threads", mThread->getPoolSize() == 1);
+		delete mThread;
+		mThread = new LLImageDecodeThread(true, 3);
+		ensure("LLImageDecodeThread: threaded instance has wrong pool size", mThread->getPoolSize() == 3);
+		delete mThread;
+		mThread = new LLImageDecodeThread(true, 1000);
+		ensure("LLImageDecodeThread: pool size not clamped", mThread->getPoolSize() == LLImageDecodeThread::MAX_POOL_SIZE);
+	}
+
+	template<> template<>
+	void imagedecodethread_object_t::test<4>()
+	{
+		// Test that a pool completes every request exactly once, whatever thread decodes it
+		// (the throughput of the pool is measured by llimageworker_bench)
+		const U32 NUM_REQUESTS = 64;
+		const U32 NUM_POOL = 4;
+		mThread = new LLImageDecodeThread(true, NUM_POOL);
+		LLAtomicU32 calls[NUM_REQUESTS];
+		LLAtomicU32 wrong(0);
+		for (U32 i = 0; i < NUM_REQUESTS; ++i)
+		{
+			calls[i] = 0;
+			mThread->decodeImage(NULL, LLQueuedThread::PRIORITY_NORMAL, 0, FALSE, new responder_count_test(&calls[i], &wrong));
+		}
+		const U32 INCREMENT_TIME = 500;				// 500 milliseconds
+		const U32 MAX_TIME = 20 * INCREMENT_TIME;	// Update the thread 20 times max, i.e. wait 10 seconds but no more
+		U32 total_time = 0;
+		U32 completed = 0;
+		while (completed < NUM_REQUESTS && total_time < MAX_TIME)
+		{
+			mThread->update(1);
+			ms_sleep(INCREMENT_TIME);
+			total_time += INCREMENT_TIME;
+			completed = 0;
+			for (U32 i = 0; i < NUM_REQUESTS; ++i)
+			{
+				completed += (calls[i] > 0);
+			}
+		}
+		ensure("LLImageDecodeThread: not all requests were processed", completed == NUM_REQUESTS);
+		// Let any request that would wrongly be completed twice show up.
+		mThread->update(1);
+		ms_sleep(INCREMENT_TIME);
+		for (U32 i = 0; i < NUM_REQUESTS; ++i)
+		{
+			ensure_equals("LLImageDecodeThread: request not completed exactly once", (U32)calls[i], 1U);
+		}
+		ensure_equals("LLImageDecodeThread: request completed with wrong output", (U32)wrong, 0U);
+	}
+
 	// ---------------------------------------------------------------------------------------
 	// Test the LLImageDecodeThread::ImageRequest interface
 	// ---------------------------------------------------------------------------------------
@@ -150,6 +150,9 @@ public:
 	LLVector3 mAgentFrustum[AGENT_FRUSTRUM_NUM];  //8 corners of 6-plane frustum
 	F32	mFrustumCornerDist;		//distance to corner of frustum against far clip plane
 	LLPlane& getAgentPlane(U32 idx) { return mAgentPlanes[idx]; }
+	const LLPlane& getAgentPlane(U32 idx) const { return mAgentPlanes[idx]; }
+	U8 getAgentPlaneMask(U32 idx) const { return mPlaneMask[idx]; }	// PLANE_MASK_NONE if the plane is ignored
+	U32 getPlaneCount() const { return mPlaneCount; }
 
 public:
 	LLCamera();
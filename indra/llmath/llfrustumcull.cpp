@@ -0,0 +1,165 @@
+/**
+ * @file llfrustumcull.cpp
+ * @brief Tests bounding boxes against the planes of a camera, four at a time.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llfrustumcull.h"
+
+LLFrustumCuller::LLFrustumCuller()
+:	mNumPlanes(0),
+	mFirstPlane(0),
+	mPlanesMask(0)
+{
+}
+
+void LLFrustumCuller::setup(const LLCamera& camera, bool far_clip)
+{
+	mNumPlanes = 0;
+	mFirstPlane = 0;
+	mPlanesMask = 0;
+
+	U32 max_planes = llmin(camera.getPlaneCount(), (U32) MAX_PLANES);
+	for (U32 i = 0; i < max_planes; ++i)
+	{
+		U8 mask = camera.getAgentPlaneMask(i);
+		if (mask >= LLCamera::PLANE_MASK_NUM || (!far_clip && i == LLCamera::AGENT_PLANE_FAR))
+		{
+			continue;
+		}
+
+		const LLPlane& plane = camera.getAgentPlane(i);
+		Plane& p = mPlanes[mNumPlanes++];
+		for (S32 k = 0; k < 3; ++k)
+		{
+			p.mNormal[k].splat(plane[k]);
+			p.mSign[k].splat((mask & (1 << k)) ? 1.f : -1.f);
+		}
+		p.mNegDist.splat(-plane[3]);
+		p.mBit = 1 << i;
+		mPlanesMask |= p.mBit;
+	}
+}
+
+void LLFrustumCuller::cullBatch(const LLVector4a& cx, const LLVector4a& cy, const LLVector4a& cz,
+								const LLVector4a& rx, const LLVector4a& ry, const LLVector4a& rz,
+								U32 count, S32* results, U8* planes_inside)
+{
+	llassert(count > 0 && count <= BATCH_SIZE);
+
+	// The planes all boxes are known to be inside of need no testing.
+	U8 skip = planes_inside[0];
+	for (U32 j = 1; j < count; ++j)
+	{
+		skip &= planes_inside[j];
+	}
+
+	const S32 lanes = (1 << count) - 1;
+	LLQuad outside = _mm_setzero_ps();
+	LLQuad partial = _mm_setzero_ps();
+	__m128i inside = _mm_setzero_si128();
+
+	for (U32 n = 0; n < mNumPlanes; ++n)
+	{
+		U32 idx = mFirstPlane + n;
+		if (idx >= mNumPlanes)
+		{
+			idx -= mNumPlanes;
+		}
+		const Plane& p = mPlanes[idx];
+		if (skip & p.mBit)
+		{
+			continue;
+		}
+
+		// The same arithmetic as LLCamera::AABBInFrustum, so that the results are bit for bit the same:
+		// the corners nearest to and furthest from the inside of the plane are center -/+ radius * sign.
+		const LLQuad sx = _mm_mul_ps(rx, p.mSign[0]);
+		const LLQuad sy = _mm_mul_ps(ry, p.mSign[1]);
+		const LLQuad sz = _mm_mul_ps(rz, p.mSign[2]);
+
+		const LLQuad dmin = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.mNormal[0], _mm_sub_ps(cx, sx)),
+												  _mm_mul_ps(p.mNormal[1], _mm_sub_ps(cy, sy))),
+									   _mm_mul_ps(p.mNormal[2], _mm_sub_ps(cz, sz)));
+		const LLQuad dmax = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p.mNormal[0], _mm_add_ps(cx, sx)),
+												  _mm_mul_ps(p.mNormal[1], _mm_add_ps(cy, sy))),
+									   _mm_mul_ps(p.mNormal[2], _mm_add_ps(cz, sz)));
+
+		const LLQuad crossing = _mm_cmpgt_ps(dmax, p.mNegDist);
+		outside = _mm_or_ps(outside, _mm_cmpgt_ps(dmin, p.mNegDist));
+		partial = _mm_or_ps(partial, crossing);
+		inside = _mm_or_si128(inside, _mm_andnot_si128(_mm_castps_si128(crossing), _mm_set1_epi32(p.mBit)));
+
+		if ((_mm_movemask_ps(outside) & lanes) == lanes)
+		{	// All boxes are out, start with this plane next time.
+			mFirstPlane = idx;
+			break;
+		}
+	}
+
+	const S32 out_bits = _mm_movemask_ps(outside);
+	const S32 partial_bits = _mm_movemask_ps(partial);
+	LL_ALIGN_16(S32 inside_bits[4]);
+	_mm_store_si128((__m128i*)inside_bits, inside);
+
+	for (U32 j = 0; j < count; ++j)
+	{
+		results[j] = (out_bits & (1 << j)) ? 0 : (partial_bits & (1 << j)) ? 1 : 2;
+		planes_inside[j] |= (U8) inside_bits[j];
+	}
+}
+
+void LLFrustumCuller::cull(const LLVector4a* const* centers, const LLVector4a* const* radii, U32 count, S32* results, U8* planes_inside)
+{
+	for (U32 i = 0; i < count; i += BATCH_SIZE)
+	{
+		U32 n = llmin(count - i, (U32) BATCH_SIZE);
+
+		// Lanes past the last box repeat it.
+		LLQuad c[4];
+		LLQuad r[4];
+		for (U32 j = 0; j < BATCH_SIZE; ++j)
+		{
+			U32 k = i + llmin(j, n - 1);
+			c[j] = *centers[k];
+			r[j] = *radii[k];
+		}
+		_MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+		cullBatch(LLVector4a(c[0]), LLVector4a(c[1]), LLVector4a(c[2]),
+				  LLVector4a(r[0]), LLVector4a(r[1]), LLVector4a(r[2]),
+				  n, results + i, planes_inside + i);
+	}
+}
+
+void LLFrustumCuller::cullSoA(const LLVector4a* const soa[6], U32 count, S32* results, U8* planes_inside)
+{
+	for (U32 i = 0, b = 0; i < count; i += BATCH_SIZE, ++b)
+	{
+		cullBatch(soa[0][b], soa[1][b], soa[2][b], soa[3][b], soa[4][b], soa[5][b],
+				  llmin(count - i, (U32) BATCH_SIZE), results + i, planes_inside + i);
+	}
+}
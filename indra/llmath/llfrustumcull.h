@@ -0,0 +1,93 @@
+/**
+ * @file llfrustumcull.h
+ * @brief Tests bounding boxes against the planes of a camera, four at a time.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFRUSTUMCULL_H
+#define LL_LLFRUSTUMCULL_H
+
+#include "llmath.h"
+#include "llvector4a.h"
+#include "llcamera.h"
+
+//
+// Tests axis aligned boxes (center and half size, like the bounds of an
+// LLSpatialGroup) against the agent planes of an LLCamera, four boxes per
+// SSE iteration. The boxes are transposed so that every lane holds one box,
+// and the results are exactly those of LLCamera::AABBInFrustum (or
+// AABBInFrustumNoFarClip): 0 if the box is outside, 1 if it is partly in and
+// 2 if it is fully in.
+//
+// Every box comes with a mask of the planes (bit i for agent plane i) it is
+// known to be on the inside of, typically because its parent is; those are
+// skipped when all boxes of a batch have them. The mask is updated with the
+// planes the box turns out to be inside of, for passing on to its children.
+// The plane that rejected the last fully rejected batch is tested first,
+// since neighbouring boxes tend to be outside of the same plane.
+//
+class LLFrustumCuller
+{
+public:
+	enum
+	{
+		MAX_PLANES = LLCamera::AGENT_PLANE_USER_CLIP_NUM,
+		BATCH_SIZE = 4
+	};
+
+	LLFrustumCuller();
+
+	// Copies the planes of camera. Without far_clip the far plane is left out, like AABBInFrustumNoFarClip does.
+	void setup(const LLCamera& camera, bool far_clip);
+
+	// Tests the boxes centers[i], radii[i] for i < count.
+	void cull(const LLVector4a* const* centers, const LLVector4a* const* radii, U32 count, S32* results, U8* planes_inside);
+
+	// Tests boxes that are already transposed: component k of box i is at soa[k][i / 4][i % 4], for the
+	// center x, y, z followed by the half size x, y, z. Lanes past count are ignored.
+	void cullSoA(const LLVector4a* const soa[6], U32 count, S32* results, U8* planes_inside);
+
+	// The mask of all planes that are tested, for a box that is fully in.
+	U8 getPlanesMask() const					{ return mPlanesMask; }
+
+private:
+	// Tests one batch, in lanes [0, count) of the transposed boxes.
+	void cullBatch(const LLVector4a& cx, const LLVector4a& cy, const LLVector4a& cz,
+				   const LLVector4a& rx, const LLVector4a& ry, const LLVector4a& rz,
+				   U32 count, S32* results, U8* planes_inside);
+
+	struct Plane
+	{
+		LLVector4a mNormal[3];					// The components of the normal, splatted.
+		LLVector4a mSign[3];					// 1 where the normal component is not negative, -1 where it is.
+		LLVector4a mNegDist;					// Minus the distance term, splatted.
+		U8 mBit;								// 1 << the index of the agent plane.
+	};
+
+	Plane mPlanes[MAX_PLANES];
+	U32 mNumPlanes;
+	U32 mFirstPlane;							// The plane to test first.
+	U8 mPlanesMask;
+};
+
+#endif // LL_LLFRUSTUMCULL_H
@@ -31,6 +31,7 @@
 #include "v3math.h"
 #include "llvector4a.h"
 #include <vector>
+#include <algorithm>
 #ifdef TIME_UTC
 //Singu note: TIME_UTC is defined as '1' in time.h, and boost thread (1.49) tries to use it as an enum member.
 #undef TIME_UTC
@@ -239,6 +240,7 @@ public:
 	typedef LLTreeNode<T>		BaseType;
 	typedef LLOctreeNode<T>		oct_node;
 	typedef LLOctreeListener<T>	oct_listener;
+	typedef std::vector<std::pair<oct_node*, LLPointer<T> > >	move_list_t;
 
 #ifdef LL_OCTREE_POOLS
 	struct octree_pool_alloc
@@ -408,6 +410,15 @@ public:
 				(radius <= p_size && radius > size);
 	}
 
+	//does data, an element of this node, still belong here (see insert)?
+	bool fits(T* data)
+	{
+		oct_node* parent = getOctParent();
+		return isInside(data->getPositionGroup()) &&
+			(contains(data->getBinRadius()) ||
+			 (data->getBinRadius() > getSize()[0] && parent && parent->getElementCount() >= gOctreeMaxCapacity));
+	}
+
 	static void pushCenter(LLVector4a &center, const LLVector4a &size, const T* data)
 	{
 		const LLVector4a& pos = data->getPositionGroup();
@@ -649,7 +660,7 @@ public:
 		return false;
 	}
 
-	void _remove(T* data, S32 i)
+	void _remove(T* data, S32 i, bool check_alive = true)
 	{ //precondition -- mElementCount > 0, idx is in range [0, mElementCount)
 		OctreeGuard::checkGuarded(this);
 		//mElementCount--;
@@ -712,7 +723,10 @@ public:
 		}
 
 		this->notifyRemoval(data);
-		checkAlive();
+		if (check_alive)
+		{
+			checkAlive();
+		}
 	}
 
 	bool remove(T* data)
@@ -783,6 +797,86 @@ public:
 		}
 	}
 
+	// Applies a batch of moves, normally those of a frame. Every entry is an
+	// element that moved and the node it is in. Elements that still fit in
+	// their node stay where they are. The others are taken out of their node
+	// and inserted again from the nearest ancestor that encloses them, rather
+	// than from the root. Nodes left empty are deleted once all the elements
+	// are back in the tree, so that a node that is left and entered by
+	// elements in the same batch is kept (along with its listeners).
+	// Empties moves.
+	void applyMoves(move_list_t& moves)
+	{
+		OctreeGuard::checkGuarded(this);
+
+		std::vector<oct_node*> vacated;
+		typename move_list_t::iterator out = moves.begin();
+		for (typename move_list_t::iterator iter = moves.begin(); iter != moves.end(); ++iter)
+		{
+			oct_node* node = iter->first;
+			T* data = iter->second;
+			S32 i = data->getBinIndex();
+
+			if (i < 0 || i >= (S32)node->mData.size() || node->mData[i] != data)
+			{ //removed or moved since it was queued
+				continue;
+			}
+
+			if (node->fits(data))
+			{
+				continue;
+			}
+
+			node->_remove(data, i, false);
+			vacated.push_back(node);
+			if (out != iter)
+			{
+				*out = *iter;
+			}
+			++out;
+		}
+		moves.erase(out, moves.end());
+
+		for (typename move_list_t::iterator iter = moves.begin(); iter != moves.end(); ++iter)
+		{
+			oct_node* node = iter->first;
+			T* data = iter->second;
+
+			while (node->getOctParent() && !node->isInside(data->getPositionGroup(), data->getBinRadius()))
+			{
+				node = node->getOctParent();
+			}
+
+			if (node->getOctParent())
+			{
+				node->getNodeAt(data)->insert(data);
+			}
+			else
+			{ //the root may have to grow
+				node->insert(data);
+			}
+		}
+		moves.clear();
+
+		//delete the vacated nodes that are still empty leaves, which also deletes the ancestors
+		//that leaves empty. None of those ancestors is in the list, as they were not leaves.
+		typename std::vector<oct_node*>::iterator last = vacated.begin();
+		for (typename std::vector<oct_node*>::iterator iter = vacated.begin(); iter != vacated.end(); ++iter)
+		{
+			if ((*iter)->getElementCount() == 0 && (*iter)->getChildCount() == 0)
+			{
+				*last++ = *iter;
+			}
+		}
+		vacated.erase(last, vacated.end());
+		std::sort(vacated.begin(), vacated.end());
+		vacated.erase(std::unique(vacated.begin(), vacated.end()), vacated.end());
+		for (U32 i = 0; i < vacated.size(); ++i)
+		{
+			vacated[i]->checkAlive();
+		}
+	}
+
 	void clearChildren()
 	{
 		OctreeGuard::checkGuarded(this);
@@ -0,0 +1,228 @@
+/**
+ * @file llskinningpool.cpp
+ * @brief Software skinning of rigged meshes, spread over a number of threads.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llskinningpool.h"
+
+//============================================================================
+// Kernels
+
+namespace
+{
+
+// The blend of four rows of the palette.
+inline LLQuad blend_row(const LLMatrix4a* const m[4], S32 row, const LLVector4a w[4])
+{
+	LLQuad sum = _mm_mul_ps(w[0], m[0]->mMatrix[row]);
+	sum = _mm_add_ps(sum, _mm_mul_ps(w[1], m[1]->mMatrix[row]));
+	sum = _mm_add_ps(sum, _mm_mul_ps(w[2], m[2]->mMatrix[row]));
+	return _mm_add_ps(sum, _mm_mul_ps(w[3], m[3]->mMatrix[row]));
+}
+
+} // namespace
+
+//static
+void LLSkinningPool::skinVertices(const Job& job, S32 begin, S32 end)
+{
+	llassert(job.mPaletteSize > 0);
+	const S32 last_joint = (S32)job.mPaletteSize - 1;
+
+	LL_ALIGN_16(S32 idx[4]);
+	LL_ALIGN_16(F32 frac[4]);
+
+	for (S32 i = begin; i < end; ++i)
+	{
+		// Joint indices in the integer parts, weights in the fractions (weights are never negative).
+		const LLQuad weight = job.mWeights[i];
+		const __m128i joints = _mm_cvttps_epi32(weight);
+		const LLQuad fractions = _mm_sub_ps(weight, _mm_cvtepi32_ps(joints));
+		_mm_store_si128((__m128i*)idx, joints);
+		_mm_store_ps(frac, fractions);
+
+		LLVector4a w;
+		F32 scale = frac[0] + frac[1] + frac[2] + frac[3];
+		if (scale > 0.f)
+		{
+			w = fractions;
+			w.mul(1.f / scale);
+		}
+		else
+		{
+			w.splat(F32_MAX);
+		}
+
+		LLVector4a wk[4];
+		wk[0].splat<0>(w);
+		wk[1].splat<1>(w);
+		wk[2].splat<2>(w);
+		wk[3].splat<3>(w);
+
+		const LLMatrix4a* m[4];
+		for (S32 k = 0; k < 4; ++k)
+		{
+			m[k] = job.mPalette + llclamp(idx[k], 0, last_joint);
+		}
+
+		LLMatrix4a final_mat;
+		final_mat.mMatrix[0] = blend_row(m, 0, wk);
+		final_mat.mMatrix[1] = blend_row(m, 1, wk);
+		final_mat.mMatrix[2] = blend_row(m, 2, wk);
+		final_mat.mMatrix[3] = blend_row(m, 3, wk);
+
+		final_mat.affineTransform(job.mPositions[i], job.mPositionsOut[i]);
+
+		if (job.mNormalsOut)
+		{
+			LLVector4a& dst = job.mNormalsOut[i];
+			final_mat.rotate(job.mNormals[i], dst);
+			dst.normalize3fast();
+		}
+	}
+}
+
+//static
+void LLSkinningPool::applyBindShape(LLMatrix4a* palette, U32 count, const LLMatrix4a& bind_shape)
+{
+	// bind_shape is affine: its rows are rotated by M, except the translation, which is transformed.
+	for (U32 j = 0; j < count; ++j)
+	{
+		const LLMatrix4a mat = palette[j];
+		mat.rotate(bind_shape.mMatrix[0], palette[j].mMatrix[0]);
+		mat.rotate(bind_shape.mMatrix[1], palette[j].mMatrix[1]);
+		mat.rotate(bind_shape.mMatrix[2], palette[j].mMatrix[2]);
+		mat.affineTransform(bind_shape.mMatrix[3], palette[j].mMatrix[3]);
+	}
+}
+
+//static
+U32 LLSkinningPool::hashPalette(const LLMatrix4a* palette, U32 count, U32 hash)
+{
+	// FNV-1a, a word at a time.
+	const U32* words = (const U32*)palette;
+	const U32* end = words + count * 16;
+	while (words < end)
+	{
+		hash = (hash ^ *words++) * 16777619u;
+	}
+	return hash;
+}
+
+//============================================================================
+// LLSkinningPool
+
+LLSkinningPool::LLSkinningPool(U32 pool_size)
+:	mNextBatch(0),
+	mNumBatches(0),
+	mUnclaimed(0),
+	mUnfinished(0)
+{
+	if (pool_size > MAX_POOL_SIZE)
+	{
+		pool_size = MAX_POOL_SIZE;
+	}
+	else if (pool_size < 1)
+	{
+		pool_size = 1;
+	}
+	mThreads.start(this, "skinning", pool_size - 1, 1);
+	llinfos << "Skinning rigged meshes with " << pool_size << " threads." << llendl;
+}
+
+LLSkinningPool::~LLSkinningPool()
+{
+	mThreads.stop();
+}
+
+void LLSkinningPool::skin(const Job& job)
+{
+	S32 const num_batches = (job.mNumVertices + BATCH_SIZE - 1) / BATCH_SIZE;
+	if (num_batches <= 1 || !mThreads.getNumThreads())
+	{
+		skinVertices(job, 0, job.mNumVertices);
+		return;
+	}
+
+	// Set the counters before publishing the batches: a worker that is still looking
+	// for work from the previous job may start on this one right away.
+	mUnfinished = num_batches;
+	mUnclaimed = num_batches;
+	{
+		LLMutexLock lock(&mMutex);
+		mJob = job;
+		mNextBatch = 0;
+		mNumBatches = num_batches;
+	}
+	mThreads.wake();
+
+	work(0);
+
+	mFinished.lock();
+	while (mUnfinished != 0)
+	{
+		mFinished.wait();
+	}
+	mFinished.unlock();
+}
+
+bool LLSkinningPool::getWork(Job& job, S32& begin, S32& end)
+{
+	LLMutexLock lock(&mMutex);
+	if (mNextBatch >= mNumBatches)
+	{
+		return false;
+	}
+	job = mJob;
+	begin = mNextBatch * BATCH_SIZE;
+	end = llmin(begin + BATCH_SIZE, mJob.mNumVertices);
+	mNextBatch += 1;
+	mUnclaimed -= 1;
+	return true;
+}
+
+// virtual
+void LLSkinningPool::work(U32 index)
+{
+	Job job;
+	S32 begin;
+	S32 end;
+	while (getWork(job, begin, end))
+	{
+		skinVertices(job, begin, end);
+		if (!--mUnfinished)
+		{
+			mFinished.lock();
+			mFinished.signal();
+			mFinished.unlock();
+		}
+	}
+}
+
+// virtual
+bool LLSkinningPool::hasWork()
+{
+	return mUnclaimed != 0;
+}
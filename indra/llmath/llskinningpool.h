@@ -0,0 +1,103 @@
+/**
+ * @file llskinningpool.h
+ * @brief Software skinning of rigged meshes, spread over a number of threads.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSKINNINGPOOL_H
+#define LL_LLSKINNINGPOOL_H
+
+#include <vector>
+
+#include "llatomic.h"
+#include "llthreadpool.h"
+#include "llmath.h"
+#include "llvector4a.h"
+#include "llmatrix4a.h"
+
+//
+// Skins the vertices of a rigged mesh on the CPU, for when there is no
+// vertex shader to do it. Every vertex is transformed by the blend of up to
+// four matrices of a palette: the integer part of each component of the
+// weight of the vertex is the index of a matrix, the fraction its weight.
+//
+// Meshes of more than BATCH_SIZE vertices are split into batches that the
+// threads of the pool (including the calling thread) take in turns; skin()
+// returns when all of them are done. Smaller meshes are skinned by the
+// calling thread alone.
+//
+class LLSkinningPool : private LLThreadPool::Client
+{
+public:
+	// Maximum number of threads (including the calling thread) that skin vertices.
+	static U32 const MAX_POOL_SIZE = 16;
+	// Number of vertices in a batch.
+	static S32 const BATCH_SIZE = 2048;
+
+	struct Job
+	{
+		const LLMatrix4a* mPalette;		// With the bind shape matrix applied, see applyBindShape().
+		U32 mPaletteSize;
+		const LLVector4a* mWeights;
+		const LLVector4a* mPositions;
+		const LLVector4a* mNormals;		// May be NULL.
+		LLVector4a* mPositionsOut;
+		LLVector4a* mNormalsOut;		// May be NULL.
+		S32 mNumVertices;
+	};
+
+	// pool_size is the total number of threads that skin vertices, including the thread calling skin().
+	LLSkinningPool(U32 pool_size);
+	~LLSkinningPool();
+
+	U32 getPoolSize() const { return mThreads.getNumThreads() + 1; }
+
+	// Skins all vertices of job and returns when that is done. The calling thread does its share of the work.
+	void skin(const Job& job);
+
+	// Skins vertices begin up to end of job on the calling thread.
+	static void skinVertices(const Job& job, S32 begin, S32 end);
+	// Replaces every matrix M of palette with bind_shape * M, so that the vertices need one transform instead of two.
+	static void applyBindShape(LLMatrix4a* palette, U32 count, const LLMatrix4a& bind_shape);
+	// Hash of the bits of the palette, to find out whether vertices skinned with it before need skinning again.
+	static U32 hashPalette(const LLMatrix4a* palette, U32 count, U32 hash = 2166136261u);
+
+private:
+	// Claims the next batch of the current job.
+	bool getWork(Job& job, S32& begin, S32& end);
+	// Skins batches until none are left.
+	/*virtual*/ void work(U32 index);
+	/*virtual*/ bool hasWork();
+
+private:
+	LLThreadPool mThreads;
+	LLMutex mMutex;						// Protects mJob and mNextBatch.
+	Job mJob;
+	S32 mNextBatch;
+	S32 mNumBatches;
+	LLAtomicU32 mUnclaimed;				// The number of batches that no thread started on.
+	LLAtomicU32 mUnfinished;			// The number of batches that aren't done yet.
+	LLCondition mFinished;				// Signalled when mUnfinished drops to zero.
+};
+
+#endif // LL_LLSKINNINGPOOL_H
@@ -0,0 +1,426 @@
+/**
+ * @file llvertexfill.cpp
+ * @brief Fills vertex buffer arrays from the faces of a volume.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvertexfill.h"
+
+namespace
+{
+
+// Number of vertices that the structure of arrays code does at a time.
+const S32 BLOCK = 4;
+
+inline LLQuad select(const LLQuad& mask, const LLQuad& a, const LLQuad& b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Loads four texture coordinates as <s0, s1, s2, s3> and <t0, t1, t2, t3>.
+inline void load_tex_coords(const LLVector2* src, LLQuad& s, LLQuad& t)
+{
+	const LLQuad st01 = _mm_loadu_ps(src[0].mV);
+	const LLQuad st23 = _mm_loadu_ps(src[2].mV);
+	s = _mm_shuffle_ps(st01, st23, _MM_SHUFFLE(2, 0, 2, 0));
+	t = _mm_shuffle_ps(st01, st23, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+inline void store_tex_coords(LLVector2* dst, const LLQuad& s, const LLQuad& t)
+{
+	_mm_storeu_ps(dst[0].mV, _mm_unpacklo_ps(s, t));
+	_mm_storeu_ps(dst[2].mV, _mm_unpackhi_ps(s, t));
+}
+
+// Loads four vectors as <x0, x1, x2, x3>, <y0, ...>, <z0, ...> and <w0, ...>.
+inline void load_transposed(const LLVector4a* src, LLQuad& x, LLQuad& y, LLQuad& z, LLQuad& w)
+{
+	x = src[0];
+	y = src[1];
+	z = src[2];
+	w = src[3];
+	_MM_TRANSPOSE4_PS(x, y, z, w);
+}
+
+// Runs block(dst, src...) for the last count % BLOCK vertices, padded with zeroes.
+struct TailTexCoords
+{
+	LLVector2 mTexCoords[BLOCK];
+	LLVector2 mOut[BLOCK];
+	LLVector4a mA[BLOCK];
+	LLVector4a mB[BLOCK];
+
+	TailTexCoords(S32 count, const LLVector2* tex_coords, const LLVector4a* a, const LLVector4a* b)
+	{
+		for (S32 i = 0; i < BLOCK; ++i)
+		{
+			mTexCoords[i] = i < count && tex_coords ? tex_coords[i] : LLVector2(0.f, 0.f);
+			mA[i] = i < count && a ? a[i] : LLVector4a(0.f, 0.f, 0.f, 0.f);
+			mB[i] = i < count && b ? b[i] : LLVector4a(0.f, 0.f, 0.f, 0.f);
+		}
+	}
+
+	void copyOut(LLVector2* dst, S32 count) const
+	{
+		for (S32 i = 0; i < count; ++i)
+		{
+			dst[i] = mOut[i];
+		}
+	}
+};
+
+void planar_block(LLVector2* dst, const LLVector4a* positions, const LLVector4a* normals, const LLVector4a& scale)
+{
+	LLQuad nx, ny, nz, nw;
+	load_transposed(normals, nx, ny, nz, nw);
+
+	LLVector4a scaled[BLOCK];
+	for (S32 i = 0; i < BLOCK; ++i)
+	{
+		scaled[i].setMul(positions[i], scale);
+	}
+	LLQuad px, py, pz, pw;
+	load_transposed(scaled, px, py, pz, pw);
+
+	const LLQuad zero = _mm_setzero_ps();
+	const LLQuad one = _mm_set1_ps(1.f);
+	const LLQuad minus_one = _mm_set1_ps(-1.f);
+	const LLQuad half = _mm_set1_ps(0.5f);
+	const LLQuad two = _mm_set1_ps(2.f);
+
+	// The binormal is <0, +-1, 0> for normals that point mostly along x, and <-+1, 0, 0> otherwise.
+	const LLQuad along_x = _mm_or_ps(_mm_cmpge_ps(nx, half), _mm_cmple_ps(nx, _mm_set1_ps(-0.5f)));
+	const LLQuad by = select(along_x, select(_mm_cmplt_ps(nx, zero), minus_one, one), zero);
+	const LLQuad bx = select(along_x, zero, select(_mm_cmpgt_ps(ny, zero), minus_one, one));
+
+	// tangent = binormal x normal; the terms with the zero z of the binormal are left out.
+	const LLQuad tx = _mm_mul_ps(by, nz);
+	const LLQuad ty = _mm_sub_ps(zero, _mm_mul_ps(bx, nz));
+	const LLQuad tz = _mm_sub_ps(_mm_mul_ps(bx, ny), _mm_mul_ps(by, nx));
+
+	const LLQuad b_dot = _mm_add_ps(_mm_mul_ps(bx, px), _mm_mul_ps(by, py));
+	const LLQuad t_dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz));
+
+	const LLQuad s = _mm_add_ps(one, _mm_sub_ps(_mm_mul_ps(b_dot, two), half));
+	const LLQuad t = _mm_sub_ps(half, _mm_mul_ps(t_dot, two));
+	store_tex_coords(dst, s, t);
+}
+
+struct TexTransformQuads
+{
+	TexTransformQuads(const LLVertexFill::TexTransform& xform)
+	:	mHalf(_mm_set1_ps(0.5f)),
+		mCos(_mm_set1_ps(xform.mCos)),
+		mSin(_mm_set1_ps(xform.mSin)),
+		mScaleS(_mm_set1_ps(xform.mScaleS)),
+		mScaleT(_mm_set1_ps(xform.mScaleT)),
+		mOffsetS(_mm_set1_ps(xform.mOffsetS + 0.5f)),
+		mOffsetT(_mm_set1_ps(xform.mOffsetT + 0.5f))
+	{
+	}
+
+	LLQuad mHalf, mCos, mSin, mScaleS, mScaleT, mOffsetS, mOffsetT;
+};
+
+void transform_block(LLVector2* dst, const LLVector2* src, const TexTransformQuads& xf)
+{
+	LLQuad s, t;
+	load_tex_coords(src, s, t);
+
+	// About the center of the face: rotate, scale, offset.
+	s = _mm_sub_ps(s, xf.mHalf);
+	t = _mm_sub_ps(t, xf.mHalf);
+	LLQuad rot_s = _mm_add_ps(_mm_mul_ps(s, xf.mCos), _mm_mul_ps(t, xf.mSin));
+	LLQuad rot_t = _mm_sub_ps(_mm_mul_ps(t, xf.mCos), _mm_mul_ps(s, xf.mSin));
+	rot_s = _mm_add_ps(_mm_mul_ps(rot_s, xf.mScaleS), xf.mOffsetS);
+	rot_t = _mm_add_ps(_mm_mul_ps(rot_t, xf.mScaleT), xf.mOffsetT);
+
+	store_tex_coords(dst, rot_s, rot_t);
+}
+
+struct MatrixQuads
+{
+	LLQuad m[4][4];
+
+	void set(const F32 mat[4][4], S32 rows)
+	{
+		for (S32 i = 0; i < rows; ++i)
+		{
+			for (S32 j = 0; j < 4; ++j)
+			{
+				m[i][j] = _mm_set1_ps(mat[i][j]);
+			}
+		}
+	}
+};
+
+void matrix_block(LLVector2* dst, const LLVector2* src, const MatrixQuads& mat)
+{
+	LLQuad s, t;
+	load_tex_coords(src, s, t);
+
+	// z is 0, so row 2 doesn't contribute.
+	const LLQuad res_s = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, mat.m[0][0]), _mm_mul_ps(t, mat.m[1][0])), mat.m[3][0]);
+	const LLQuad res_t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, mat.m[0][1]), _mm_mul_ps(t, mat.m[1][1])), mat.m[3][1]);
+
+	store_tex_coords(dst, res_s, res_t);
+}
+
+struct BumpQuads
+{
+	MatrixQuads mNormalMat;
+	LLQuad mCos, mMinusSin;
+	LLQuad mSRay[3], mTRay[3];
+};
+
+void bump_block(LLVector2* dst, const LLVector2* tex_coords, const LLVector4a* normals, const LLVector4a* tangents, const BumpQuads& bq)
+{
+	LLQuad nx, ny, nz, nw;
+	load_transposed(normals, nx, ny, nz, nw);
+	LLQuad tx, ty, tz, tw;
+	load_transposed(tangents, tx, ty, tz, tw);
+
+	// binormal of the face = (normal x tangent) * the sign in the w of the tangent
+	const LLQuad bx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty)), tw);
+	const LLQuad by = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz)), tw);
+	const LLQuad bz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx)), tw);
+
+	// Binormal of the texture, <-sin, cos, 0> in tangent space, in object space.
+	const LLQuad ox = _mm_add_ps(_mm_mul_ps(bq.mMinusSin, tx), _mm_mul_ps(bq.mCos, bx));
+	const LLQuad oy = _mm_add_ps(_mm_mul_ps(bq.mMinusSin, ty), _mm_mul_ps(bq.mCos, by));
+	const LLQuad oz = _mm_add_ps(_mm_mul_ps(bq.mMinusSin, tz), _mm_mul_ps(bq.mCos, bz));
+
+	// ... and rotated into render space.
+	const MatrixQuads& m = bq.mNormalMat;
+	LLQuad rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, m.m[0][0]), _mm_mul_ps(oy, m.m[1][0])), _mm_mul_ps(oz, m.m[2][0]));
+	LLQuad ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, m.m[0][1]), _mm_mul_ps(oy, m.m[1][1])), _mm_mul_ps(oz, m.m[2][1]));
+	LLQuad rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, m.m[0][2]), _mm_mul_ps(oy, m.m[1][2])), _mm_mul_ps(oz, m.m[2][2]));
+
+	// Same precision as LLVector4a::normalize3fast().
+	const LLQuad length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz));
+	const LLQuad rsqrt = _mm_rsqrt_ps(length_squared);
+	rx = _mm_mul_ps(rx, rsqrt);
+	ry = _mm_mul_ps(ry, rsqrt);
+	rz = _mm_mul_ps(rz, rsqrt);
+
+	const LLQuad s_offset = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bq.mSRay[0], tx), _mm_mul_ps(bq.mSRay[1], ty)), _mm_mul_ps(bq.mSRay[2], tz));
+	const LLQuad t_offset = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bq.mTRay[0], rx), _mm_mul_ps(bq.mTRay[1], ry)), _mm_mul_ps(bq.mTRay[2], rz));
+
+	LLQuad s, t;
+	load_tex_coords(tex_coords, s, t);
+	store_tex_coords(dst, _mm_add_ps(s, s_offset), _mm_add_ps(t, t_offset));
+}
+
+} // namespace
+
+LLVertexFill::TexTransform::TexTransform()
+:	mCos(1.f),
+	mSin(0.f),
+	mOffsetS(0.f),
+	mOffsetT(0.f),
+	mScaleS(1.f),
+	mScaleT(1.f)
+{
+}
+
+LLVertexFill::TexTransform::TexTransform(F32 cos_ang, F32 sin_ang, F32 offset_s, F32 offset_t, F32 scale_s, F32 scale_t)
+:	mCos(cos_ang),
+	mSin(sin_ang),
+	mOffsetS(offset_s),
+	mOffsetT(offset_t),
+	mScaleS(scale_s),
+	mScaleT(scale_t)
+{
+}
+
+//static
+void LLVertexFill::positions(F32* dst, const LLVector4a* src, S32 count, S32 dst_count, const LLMatrix4a& mat, S32 texture_index)
+{
+	const LLVector4a* end = src + count;
+	F32* end_f32 = dst + dst_count * 4;
+
+	// The texture index goes in w as is, not converted to F32.
+	F32 val = 0.f;
+	S32* vp = (S32*) &val;
+	*vp = texture_index;
+
+	LLVector4a tex_idx;
+	tex_idx.set(0, 0, 0, val);
+
+	LLVector4Logical mask;
+	mask.clear();
+	mask.setElement<3>();
+
+	LLVector4a res;
+	LLVector4a tmp;
+	while (src < end)
+	{
+		mat.affineTransform(*src++, res);
+		tmp.setSelectWithMask(mask, tex_idx, res);
+		tmp.store4a(dst);
+		dst += 4;
+	}
+
+	while (dst < end_f32)
+	{
+		res.store4a(dst);
+		dst += 4;
+	}
+}
+
+//static
+void LLVertexFill::normals(F32* dst, const LLVector4a* src, S32 count, const LLMatrix4a& mat)
+{
+	const LLVector4a* end = src + count;
+	while (src < end)
+	{
+		LLVector4a normal;
+		mat.rotate(*src++, normal);
+		normal.store4a(dst);
+		dst += 4;
+	}
+}
+
+//static
+void LLVertexFill::tangents(F32* dst, const LLVector4a* src, S32 count, const LLMatrix4a& mat)
+{
+	LLVector4Logical mask;
+	mask.clear();
+	mask.setElement<3>();
+
+	const LLVector4a* end = src + count;
+	while (src < end)
+	{
+		LLVector4a tangent_out;
+		mat.rotate(*src, tangent_out);
+		tangent_out.normalize3fast();
+		tangent_out.setSelectWithMask(mask, *src, tangent_out);
+		tangent_out.store4a(dst);
+		++src;
+		dst += 4;
+	}
+}
+
+//static
+void LLVertexFill::planarTexCoords(LLVector2* dst, const LLVector4a* positions, const LLVector4a* normals, S32 count, const LLVector4a& scale)
+{
+	S32 i = 0;
+	for ( ; i + BLOCK <= count; i += BLOCK)
+	{
+		planar_block(dst + i, positions + i, normals + i, scale);
+	}
+	if (i < count)
+	{
+		TailTexCoords tail(count - i, NULL, positions + i, normals + i);
+		planar_block(tail.mOut, tail.mA, tail.mB, scale);
+		tail.copyOut(dst + i, count - i);
+	}
+}
+
+//static
+void LLVertexFill::transformTexCoords(LLVector2* dst, const LLVector2* src, S32 count, const TexTransform& xform)
+{
+	const TexTransformQuads xf(xform);
+	S32 i = 0;
+	for ( ; i + BLOCK <= count; i += BLOCK)
+	{
+		transform_block(dst + i, src + i, xf);
+	}
+	if (i < count)
+	{
+		TailTexCoords tail(count - i, src + i, NULL, NULL);
+		transform_block(tail.mOut, tail.mTexCoords, xf);
+		tail.copyOut(dst + i, count - i);
+	}
+}
+
+//static
+void LLVertexFill::transformTexCoords(LLVector2* dst, const LLVector2* src, S32 count, const LLMatrix4& mat)
+{
+	MatrixQuads mq;
+	mq.set(mat.mMatrix, 4);
+	S32 i = 0;
+	for ( ; i + BLOCK <= count; i += BLOCK)
+	{
+		matrix_block(dst + i, src + i, mq);
+	}
+	if (i < count)
+	{
+		TailTexCoords tail(count - i, src + i, NULL, NULL);
+		matrix_block(tail.mOut, tail.mTexCoords, mq);
+		tail.copyOut(dst + i, count - i);
+	}
+}
+
+//static
+void LLVertexFill::bumpTexCoords(LLVector2* dst, const LLVector2* tex_coords, const LLVector4a* normals, const LLVector4a* tangents,
+								 S32 count, const LLMatrix4a& normal_mat, F32 cos_ang, F32 sin_ang,
+								 const LLVector4a& s_light_ray, const LLVector4a& t_light_ray)
+{
+	BumpQuads bq;
+	F32 rows[4][4];
+	for (S32 i = 0; i < 3; ++i)
+	{
+		normal_mat.mMatrix[i].store4a(rows[i]);
+		bq.mSRay[i] = _mm_set1_ps(s_light_ray[i]);
+		bq.mTRay[i] = _mm_set1_ps(t_light_ray[i]);
+	}
+	bq.mNormalMat.set(rows, 3);
+	bq.mCos = _mm_set1_ps(cos_ang);
+	bq.mMinusSin = _mm_set1_ps(-sin_ang);
+
+	S32 i = 0;
+	for ( ; i + BLOCK <= count; i += BLOCK)
+	{
+		bump_block(dst + i, tex_coords + i, normals + i, tangents + i, bq);
+	}
+	if (i < count)
+	{
+		TailTexCoords tail(count - i, tex_coords + i, normals + i, tangents + i);
+		// A zero tangent would make the normalization divide by zero; it's thrown away anyway.
+		for (S32 j = count - i; j < BLOCK; ++j)
+		{
+			tail.mB[j].set(1.f, 0.f, 0.f, 1.f);
+			tail.mA[j].set(0.f, 0.f, 1.f, 0.f);
+		}
+		bump_block(tail.mOut, tail.mTexCoords, tail.mA, tail.mB, bq);
+		tail.copyOut(dst + i, count - i);
+	}
+}
+
+//static
+void LLVertexFill::fill(U32* dst, U32 value, S32 count)
+{
+	const __m128i quad = _mm_set1_epi32((S32)value);
+	S32 i = 0;
+	for ( ; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_si128((__m128i*)(dst + i), quad);
+	}
+	for ( ; i < count; ++i)
+	{
+		dst[i] = value;
+	}
+}
@@ -0,0 +1,91 @@
+/**
+ * @file llvertexfill.h
+ * @brief Fills vertex buffer arrays from the faces of a volume.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVERTEXFILL_H
+#define LL_LLVERTEXFILL_H
+
+#include "llmath.h"
+#include "llvector4a.h"
+#include "llmatrix4a.h"
+#include "v2math.h"
+#include "m4math.h"
+
+//
+// The per vertex loops of LLFace::getGeometryVolume().
+//
+// Positions, normals and tangents are transformed one LLVector4a at a time.
+// Texture coordinates are done four vertices at a time, with the vertices
+// transposed into one register per component (structure of arrays), so that
+// the planar projection, the texture transform and the bump offsets need no
+// shuffling or horizontal adds. They compute the same values as the scalar
+// code they replace, except that the rotation of bump offsets by the render
+// matrix of an active drawable is folded into the normal matrix.
+//
+// Source arrays of LLVector4a must be 16 byte aligned (as in LLVolumeFace).
+// The destination arrays and arrays of LLVector2 need not be.
+//
+class LLVertexFill
+{
+public:
+	// The texture transform of a texture entry: rotation about the center of the face, then scale, then offset.
+	struct TexTransform
+	{
+		TexTransform();
+		TexTransform(F32 cos_ang, F32 sin_ang, F32 offset_s, F32 offset_t, F32 scale_s, F32 scale_t);
+
+		F32 mCos;
+		F32 mSin;
+		F32 mOffsetS;
+		F32 mOffsetT;
+		F32 mScaleS;
+		F32 mScaleT;
+	};
+
+	// Writes the count positions transformed by mat, with texture_index (as bits) in w,
+	// then repeats the last one up to dst_count.
+	static void positions(F32* dst, const LLVector4a* src, S32 count, S32 dst_count, const LLMatrix4a& mat, S32 texture_index);
+	// Writes the count normals rotated by mat.
+	static void normals(F32* dst, const LLVector4a* src, S32 count, const LLMatrix4a& mat);
+	// Writes the count tangents rotated by mat and normalized, keeping their w (the sign of the binormal).
+	static void tangents(F32* dst, const LLVector4a* src, S32 count, const LLMatrix4a& mat);
+
+	// Planar texture coordinates of the positions scaled by scale; see planarProjection() in llface.cpp.
+	static void planarTexCoords(LLVector2* dst, const LLVector4a* positions, const LLVector4a* normals, S32 count, const LLVector4a& scale);
+	// dst[i] = src[i] transformed by xform. dst may be src.
+	static void transformTexCoords(LLVector2* dst, const LLVector2* src, S32 count, const TexTransform& xform);
+	// dst[i] = <src[i], 0> * mat, as LLVector3 * LLMatrix4 would do it (used for texture animations). dst may be src.
+	static void transformTexCoords(LLVector2* dst, const LLVector2* src, S32 count, const LLMatrix4& mat);
+	// Emboss bump mapping: offsets tex_coords by the dot products of the light rays with the tangent and
+	// with the binormal of the texture (rotated by the texture rotation and then by normal_mat).
+	static void bumpTexCoords(LLVector2* dst, const LLVector2* tex_coords, const LLVector4a* normals, const LLVector4a* tangents,
+							  S32 count, const LLMatrix4a& normal_mat, F32 cos_ang, F32 sin_ang,
+							  const LLVector4a& s_light_ray, const LLVector4a& t_light_ray);
+
+	// Sets count U32s (colors) to value.
+	static void fill(U32* dst, U32 value, S32 count);
+};
+
+#endif // LL_LLVERTEXFILL_H
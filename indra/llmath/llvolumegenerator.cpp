@@ -0,0 +1,162 @@
+/**
+ * @file llvolumegenerator.cpp
+ * @brief Generates volumes on a pool of threads.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvolumegenerator.h"
+
+#include <algorithm>
+
+//============================================================================
+// LLVolumeRequest
+
+LLVolumeRequest::LLVolumeRequest(LLVolumeGenerator* generator, const LLVolumeParams& params, const F32 detail)
+:	mGenerator(generator),
+	mParams(params),
+	mDetail(detail),
+	mState(QUEUED)
+{
+}
+
+LLVolume* LLVolumeRequest::getVolume()
+{
+	// Once done, the generator may be gone.
+	if (mState == DONE)
+	{
+		return mVolume;
+	}
+
+	LLCondition& condition = mGenerator->mCondition;
+	condition.lock();
+	if (mState == QUEUED)
+	{
+		// No worker got to it yet; generating it here is faster than waiting for the requests in front of it.
+		std::deque<LLPointer<LLVolumeRequest> >& queued = mGenerator->mQueued;
+		queued.erase(std::find(queued.begin(), queued.end(), LLPointer<LLVolumeRequest>(this)));
+		mGenerator->mNumQueued -= 1;
+		mState = GENERATING;
+		condition.unlock();
+		generate();
+		condition.lock();
+		mState = DONE;
+	}
+	while (mState != DONE)
+	{
+		condition.wait();
+	}
+	condition.unlock();
+	return mVolume;
+}
+
+void LLVolumeRequest::generate()
+{
+	mVolume = new LLVolume(mParams, mDetail);
+}
+
+//============================================================================
+// LLVolumeGenerator
+
+LLVolumeGenerator::LLVolumeGenerator(U32 num_threads)
+:	mNumQueued(0)
+{
+	if (num_threads > MAX_THREADS)
+	{
+		num_threads = MAX_THREADS;
+	}
+	mThreads.start(this, "volumegen", num_threads);
+	llinfos << "Generating volumes with " << num_threads << " threads." << llendl;
+}
+
+LLVolumeGenerator::~LLVolumeGenerator()
+{
+	mCondition.lock();
+	for (std::deque<LLPointer<LLVolumeRequest> >::iterator iter = mQueued.begin(); iter != mQueued.end(); ++iter)
+	{
+		// Cancelled: done without a volume.
+		(*iter)->mState = LLVolumeRequest::DONE;
+	}
+	mQueued.clear();
+	mNumQueued = 0;
+	mCondition.unlock();
+
+	mThreads.stop();
+}
+
+void LLVolumeGenerator::queue(LLVolumeRequest* request)
+{
+	{
+		LLMutexLock lock(&mCondition);
+		mQueued.push_back(request);
+		mNumQueued += 1;
+	}
+	mThreads.wake();
+}
+
+void LLVolumeGenerator::releaseFinished()
+{
+	std::vector<LLPointer<LLVolumeRequest> > finished;
+	{
+		LLMutexLock lock(&mCondition);
+		finished.swap(mFinished);
+	}
+	// Any request (and volume) that nobody else references is deleted here.
+}
+
+// virtual
+void LLVolumeGenerator::work(U32 index)
+{
+	mCondition.lock();
+	while (!mQueued.empty())
+	{
+		LLVolumeRequest* request = mQueued.front();
+		// Keep the request alive without this thread ever holding the last reference: mFinished takes over below.
+		request->ref();
+		mQueued.pop_front();
+		mNumQueued -= 1;
+
+		// If nobody else references it, whoever wanted the volume doesn't anymore.
+		if (request->getNumRefs() > 1)
+		{
+			request->mState = LLVolumeRequest::GENERATING;
+			mCondition.unlock();
+
+			request->generate();
+
+			mCondition.lock();
+		}
+		request->mState = LLVolumeRequest::DONE;
+		mFinished.push_back(request);
+		request->unref();
+		mCondition.signal();
+	}
+	mCondition.unlock();
+}
+
+// virtual
+bool LLVolumeGenerator::hasWork()
+{
+	return mNumQueued != 0;
+}
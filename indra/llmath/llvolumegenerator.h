@@ -0,0 +1,119 @@
+/**
+ * @file llvolumegenerator.h
+ * @brief Generates volumes on a pool of threads.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUMEGENERATOR_H
+#define LL_LLVOLUMEGENERATOR_H
+
+#include <deque>
+#include <vector>
+
+#include "llatomic.h"
+#include "llpointer.h"
+#include "llthreadpool.h"
+#include "llvolume.h"
+
+class LLVolumeGenerator;
+
+//
+// A volume that is being generated in the background; think of it as a future.
+// Poll isDone() to find out when getVolume() won't block.
+//
+class LLVolumeRequest : public LLThreadSafeRefCount
+{
+public:
+	LLVolumeRequest(LLVolumeGenerator* generator, const LLVolumeParams& params, const F32 detail);
+
+	const LLVolumeParams& getParams() const	{ return mParams; }
+	F32 getDetail() const					{ return mDetail; }
+	bool isDone() const						{ return mState == DONE; }
+
+	// Returns the volume, waiting for the worker that generates it. If no worker
+	// started on it yet, it is generated on the calling thread instead.
+	// Returns NULL if the request was cancelled. Main thread only.
+	LLVolume* getVolume();
+
+private:
+	friend class LLVolumeGenerator;
+
+	enum EState
+	{
+		QUEUED,
+		GENERATING,
+		DONE
+	};
+
+	// Only for the thread that set mState to GENERATING.
+	void generate();
+
+private:
+	LLVolumeGenerator* mGenerator;
+	LLVolumeParams mParams;
+	F32 mDetail;
+	LLPointer<LLVolume> mVolume;		// Set before mState becomes DONE.
+	LLAtomicU32 mState;					// Changes while holding the lock of the generator.
+};
+
+//
+// Runs the LLVolumeRequests that LLVolumeLODGroup::requestLOD() creates.
+//
+// The workers never release the last reference to a request, so that all
+// reference counting of the generated LLVolume (which isn't thread safe)
+// happens on the main thread once the request is done: finished requests are
+// parked until the main thread calls releaseFinished().
+//
+class LLVolumeGenerator : private LLThreadPool::Client
+{
+public:
+	// Maximum number of worker threads.
+	static U32 const MAX_THREADS = 8;
+
+	LLVolumeGenerator(U32 num_threads);
+	// Cancels the requests that no worker started on.
+	~LLVolumeGenerator();
+
+	U32 getNumThreads() const { return mThreads.getNumThreads(); }
+
+	void queue(LLVolumeRequest* request);
+	// Drops the references of the generator to the requests that are done.
+	void releaseFinished();
+
+private:
+	friend class LLVolumeRequest;
+
+	// Generates queued requests until none are left.
+	/*virtual*/ void work(U32 index);
+	/*virtual*/ bool hasWork();
+
+private:
+	LLThreadPool mThreads;
+	LLAtomicU32 mNumQueued;
+
+	LLCondition mCondition;								// Protects the queues; signalled when a request is done.
+	std::deque<LLPointer<LLVolumeRequest> > mQueued;
+	std::vector<LLPointer<LLVolumeRequest> > mFinished;
+};
+
+#endif // LL_LLVOLUMEGENERATOR_H
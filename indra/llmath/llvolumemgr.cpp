@@ -27,6 +27,7 @@
 
 #include "llvolumemgr.h"
 #include "llvolume.h"
+#include "llvolumegenerator.h"
 
 
 const F32 BASE_THRESHOLD = 0.03f;
@@ -44,7 +45,8 @@ F32 LLVolumeLODGroup::mDetailScales[NUM_LODS] = {1.f, 1.5f, 2.5f, 4.f};
 //============================================================================
 
 LLVolumeMgr::LLVolumeMgr()
-:	mDataMutex(NULL)
+:	mDataMutex(NULL),
+	mGenerator(NULL)
 {
 	// the LLMutex magic interferes with easy unit testing,
 	// so you now must manually call useMutex() to use it
@@ -53,6 +55,9 @@ LLVolumeMgr::LLVolumeMgr()
 
 LLVolumeMgr::~LLVolumeMgr()
 {
+	delete mGenerator;
+	mGenerator = NULL;
+
 	cleanup();
 
 	delete mDataMutex;
@@ -172,6 +177,39 @@ void LLVolumeMgr::unrefVolume(LLVolume *volumep)
 
 }
 
+void LLVolumeMgr::setGenerateThreads(U32 num_threads)
+{
+	num_threads = llmin(num_threads, (U32)LLVolumeGenerator::MAX_THREADS);
+	if (mGenerator && mGenerator->getNumThreads() != num_threads)
+	{
+		// Requests that no thread started on yet are cancelled; refVolume() generates them if still needed.
+		delete mGenerator;
+		mGenerator = NULL;
+	}
+	if (!mGenerator && num_threads)
+	{
+		mGenerator = new LLVolumeGenerator(num_threads);
+	}
+	if (mGenerator)
+	{
+		mGenerator->releaseFinished();
+	}
+}
+
+LLVolumeRequest* LLVolumeMgr::requestVolume(const LLVolumeParams& volume_params, const S32 detail)
+{
+	if (!mGenerator)
+	{
+		return NULL;
+	}
+	LLVolumeLODGroup* volgroupp = getGroup(volume_params);
+	if (!volgroupp || !volgroupp->getNumRefs())
+	{
+		return NULL;
+	}
+	return volgroupp->requestLOD(detail, mGenerator);
+}
+
 // protected
 void LLVolumeMgr::insertGroup(LLVolumeLODGroup* volgroup)
 {
@@ -293,6 +331,12 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	mAccessCount[detail]++;
 	
 	mRefs++;
+	if (mVolumeLODs[detail].isNull() && mRequests[detail].notNull())
+	{
+		// Being generated in the background; this waits for it if needed.
+		mVolumeLODs[detail] = mRequests[detail]->getVolume();
+		mRequests[detail] = NULL;
+	}
 	if (mVolumeLODs[detail].isNull())
 	{
 		mVolumeLODs[detail] = new LLVolume(mVolumeParams, mDetailScales[detail]);
@@ -301,6 +345,22 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	return mVolumeLODs[detail];
 }
 
+LLVolumeRequest* LLVolumeLODGroup::requestLOD(const S32 detail, LLVolumeGenerator* generator)
+{
+	llassert(detail >=0 && detail < NUM_LODS);
+	if (mVolumeLODs[detail].notNull())
+	{
+		return NULL;
+	}
+	// Also replace a request that was cancelled.
+	if (mRequests[detail].isNull() || (mRequests[detail]->isDone() && !mRequests[detail]->getVolume()))
+	{
+		mRequests[detail] = new LLVolumeRequest(generator, mVolumeParams, mDetailScales[detail]);
+		generator->queue(mRequests[detail]);
+	}
+	return mRequests[detail];
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
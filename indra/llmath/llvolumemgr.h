@@ -41,6 +41,8 @@
 
 class LLVolumeParams;
 class LLVolumeLODGroup;
+class LLVolumeGenerator;
+class LLVolumeRequest;
 
 class LLVolumeLODGroup
 {
@@ -63,6 +65,9 @@ public:
 
 	LLVolume* refLOD(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
+	// Starts generating the volume for detail with generator, unless it exists or is being generated already.
+	// Returns the request to poll, or NULL if the volume exists.
+	LLVolumeRequest* requestLOD(const S32 detail, LLVolumeGenerator* generator);
 	S32 getNumRefs() const { return mRefs; }
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
@@ -76,6 +81,7 @@ protected:
 	S32 mRefs;
 	S32 mLODRefs[NUM_LODS];
 	LLPointer<LLVolume> mVolumeLODs[NUM_LODS];
+	LLPointer<LLVolumeRequest> mRequests[NUM_LODS];	// Volumes that are being generated in the background.
 	static F32 mDetailThresholds[NUM_LODS];
 	static F32 mDetailScales[NUM_LODS];
 	S32		mAccessCount[NUM_LODS];
@@ -96,6 +102,15 @@ public:
 	virtual LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail);
 	virtual void unrefVolume(LLVolume *volumep);
 
+	// Generates volumes for requestVolume() on num_threads threads; none if num_threads is 0.
+	// Main thread only. Call it regularly: it also releases the requests that are done.
+	void setGenerateThreads(U32 num_threads);
+	// Starts generating a volume in the background, so that refVolume() won't have to generate it.
+	// Returns the request to poll, or NULL if the volume exists already, if nothing references other
+	// volumes with these params (so that there is nothing to keep the result around) or if there are
+	// no generate threads.
+	LLVolumeRequest* requestVolume(const LLVolumeParams& volume_params, const S32 detail);
+
 	void dump();
 
 	// manually call this for mutex magic
@@ -113,6 +128,8 @@ protected:
 	volume_lod_group_map_t mVolumeLODGroups;
 
 	LLMutex* mDataMutex;
+
+	LLVolumeGenerator* mGenerator;
 };
 
 #endif // LL_LLVOLUMEMGR_H
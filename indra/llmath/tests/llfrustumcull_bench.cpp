@@ -0,0 +1,336 @@
+/**
+ * @file llfrustumcull_bench.cpp
+ * @brief Compares culling octree bounds one box at a time with LLFrustumCuller.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: llfrustumcull_bench [objects] [frames] [far clip]
+//
+// Builds an octree over objects scattered over a region, every node with the tight
+// bounds of its objects and children like the LLSpatialGroups of the viewer, and
+// culls it against a camera that turns around and flies over the region, with:
+//   scalar  - what LLOctreeCull does: test each node that isn't known to be fully in
+//             with LLCamera::AABBInFrustumNoFarClip (or AABBInFrustum),
+//   batched - test the root like that, then all children of every partly visible node
+//             at once with LLFrustumCuller, passing down the planes a node is inside of.
+// Both variants are checked to give every node the same result. The bounds of all nodes
+// are also tested without the tree, one at a time and from SoA arrays, to time just the
+// plane tests.
+
+#include "linden_common.h"
+
+#include "../llfrustumcull.h"
+#include "lltimer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+struct Node
+{
+	LLVector4a mBounds[2];						// Center and half size.
+	Node* mChild[8];
+	U32 mChildCount;
+	U32 mIndex;
+};
+
+struct Object
+{
+	LLVector4a mMin;
+	LLVector4a mMax;
+};
+
+// A fixed generator, so that both variants see the same scene.
+U32 gSeed;
+
+F32 frand(F32 lo, F32 hi)
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * (F32)(gSeed >> 8) / (F32)(1 << 24);
+}
+
+const F32 REGION_SIZE = 256.f;
+const U32 MAX_OBJECTS_PER_LEAF = 8;
+
+std::vector<Node*> gNodes;
+
+// Splits objects over the octants of the cube around center, until there are few enough for a leaf.
+Node* build(std::vector<Object>& objects, const LLVector4a& center, F32 size, S32 depth)
+{
+	Node* node = new Node;
+	node->mChildCount = 0;
+	node->mIndex = gNodes.size();
+	gNodes.push_back(node);
+
+	LLVector4a min = objects[0].mMin;
+	LLVector4a max = objects[0].mMax;
+	for (U32 i = 1; i < objects.size(); ++i)
+	{
+		min.setMin(min, objects[i].mMin);
+		max.setMax(max, objects[i].mMax);
+	}
+
+	if (objects.size() > MAX_OBJECTS_PER_LEAF && depth < 10)
+	{
+		std::vector<Object> octant[8];
+		for (U32 i = 0; i < objects.size(); ++i)
+		{
+			LLVector4a pos;
+			pos.setAdd(objects[i].mMin, objects[i].mMax);
+			pos.mul(0.5f);
+			U32 idx = (pos[0] > center[0] ? 1 : 0) | (pos[1] > center[1] ? 2 : 0) | (pos[2] > center[2] ? 4 : 0);
+			octant[idx].push_back(objects[i]);
+		}
+		F32 half = size * 0.5f;
+		for (U32 idx = 0; idx < 8; ++idx)
+		{
+			if (octant[idx].empty())
+			{
+				continue;
+			}
+			LLVector4a child_center(idx & 1 ? half : -half, idx & 2 ? half : -half, idx & 4 ? half : -half);
+			child_center.add(center);
+			node->mChild[node->mChildCount++] = build(octant[idx], child_center, half, depth + 1);
+		}
+	}
+
+	node->mBounds[0].setAdd(min, max);
+	node->mBounds[0].mul(0.5f);
+	node->mBounds[1].setSub(max, min);
+	node->mBounds[1].mul(0.5f);
+	return node;
+}
+
+void make_scene(S32 num_objects)
+{
+	gSeed = 12345;
+	std::vector<Object> objects(num_objects);
+	for (S32 i = 0; i < num_objects; ++i)
+	{
+		LLVector4a pos(frand(0.f, REGION_SIZE), frand(0.f, REGION_SIZE), frand(20.f, 60.f));
+		F32 r = frand(0.f, 1.f);
+		r = 0.25f + r * r * r * 16.f;
+		LLVector4a size(r * frand(0.2f, 1.f), r * frand(0.2f, 1.f), r * frand(0.2f, 1.f));
+		objects[i].mMin.setSub(pos, size);
+		objects[i].mMax.setAdd(pos, size);
+	}
+	LLVector4a center(REGION_SIZE * 0.5f, REGION_SIZE * 0.5f, REGION_SIZE * 0.5f);
+	build(objects, center, REGION_SIZE * 0.5f, 0);
+}
+
+// Places the camera for a frame, and computes its planes like LLViewerCamera does from the corners of the frustum.
+void place_camera(LLCamera& camera, S32 frame, S32 frames)
+{
+	F32 t = (F32)frame / (F32)frames;
+	F32 angle = t * F_TWO_PI * 3.f;
+	LLVector3 origin(REGION_SIZE * (0.5f + 0.45f * cosf(t * F_TWO_PI)), REGION_SIZE * (0.5f + 0.45f * sinf(t * F_TWO_PI)), 40.f + 30.f * sinf(t * 7.f));
+	LLVector3 target = origin + LLVector3(cosf(angle), sinf(angle), -0.3f * sinf(t * 11.f));
+	camera.lookAt(origin, target);
+
+	F32 tan_half = tanf(camera.getView() * 0.5f);
+	LLVector3 frust[8];
+	for (S32 i = 0; i < 4; ++i)
+	{
+		// Bottom left, bottom right, top right, top left.
+		F32 x = (i == 1 || i == 2) ? -1.f : 1.f;
+		F32 y = i >= 2 ? 1.f : -1.f;
+		LLVector3 dir = camera.getAtAxis() + camera.getLeftAxis() * (x * tan_half * camera.getAspect()) + camera.getUpAxis() * (y * tan_half);
+		frust[i] = origin + dir * camera.getNear();
+		frust[i + 4] = origin + dir * camera.getFar();
+	}
+	camera.calcAgentFrustumPlanes(frust);
+}
+
+std::vector<S32> gResults;
+U32 gTests;
+
+void cull_scalar(LLCamera& camera, bool far_clip, const Node* node, S32 res)
+{
+	if (res != 2)
+	{
+		res = far_clip ? camera.AABBInFrustum(node->mBounds[0], node->mBounds[1])
+					   : camera.AABBInFrustumNoFarClip(node->mBounds[0], node->mBounds[1]);
+		++gTests;
+	}
+	gResults[node->mIndex] = res;
+	if (res)
+	{
+		for (U32 i = 0; i < node->mChildCount; ++i)
+		{
+			cull_scalar(camera, far_clip, node->mChild[i], res);
+		}
+	}
+}
+
+void cull_batched(LLFrustumCuller& culler, const Node* node, S32 res, U8 planes_inside)
+{
+	gResults[node->mIndex] = res;
+	if (!res || !node->mChildCount)
+	{
+		return;
+	}
+
+	S32 results[8];
+	U8 planes[8];
+	if (res == 2)
+	{
+		for (U32 i = 0; i < node->mChildCount; ++i)
+		{
+			results[i] = 2;
+		}
+	}
+	else
+	{
+		const LLVector4a* centers[8];
+		const LLVector4a* radii[8];
+		for (U32 i = 0; i < node->mChildCount; ++i)
+		{
+			centers[i] = &node->mChild[i]->mBounds[0];
+			radii[i] = &node->mChild[i]->mBounds[1];
+			planes[i] = planes_inside;
+		}
+		culler.cull(centers, radii, node->mChildCount, results, planes);
+		gTests += node->mChildCount;
+	}
+
+	for (U32 i = 0; i < node->mChildCount; ++i)
+	{
+		cull_batched(culler, node->mChild[i], results[i], planes[i]);
+	}
+}
+
+void run(S32 frames, bool far_clip)
+{
+	LLCamera camera(1.0f, 16.f / 9.f, 1080, 0.5f, 96.f);
+	Node* root = gNodes[0];
+
+	std::vector<S32> scalar_results(gNodes.size());
+	F64 scalar_time = 0.0;
+	F64 batched_time = 0.0;
+	U32 scalar_tests = 0;
+	U32 batched_tests = 0;
+	U32 visible = 0;
+	U32 mismatches = 0;
+
+	// The bounds of all nodes, transposed.
+	const U32 count = gNodes.size();
+	std::vector<LLVector4a> soa[6];
+	const LLVector4a* soa_ptrs[6];
+	for (S32 k = 0; k < 6; ++k)
+	{
+		soa[k].resize((count + 3) / 4);
+		for (U32 i = 0; i < count; ++i)
+		{
+			soa[k][i / 4].getF32ptr()[i % 4] = gNodes[i]->mBounds[k / 3][k % 3];
+		}
+		soa_ptrs[k] = &soa[k][0];
+	}
+	std::vector<S32> flat_results(count);
+	std::vector<S32> soa_results(count);
+	std::vector<U8> soa_planes(count);
+	F64 flat_time = 0.0;
+	F64 soa_time = 0.0;
+
+	for (S32 frame = 0; frame < frames; ++frame)
+	{
+		place_camera(camera, frame, frames);
+
+		gResults.assign(gNodes.size(), -1);
+		gTests = 0;
+		LLTimer timer;
+		cull_scalar(camera, far_clip, root, 0);
+		scalar_time += timer.getElapsedTimeF64();
+		scalar_tests += gTests;
+		scalar_results.swap(gResults);
+
+		gResults.assign(gNodes.size(), -1);
+		gTests = 0;
+		timer.reset();
+		LLFrustumCuller culler;
+		culler.setup(camera, far_clip);
+		const LLVector4a* center = &root->mBounds[0];
+		const LLVector4a* radius = &root->mBounds[1];
+		S32 res;
+		U8 planes = 0;
+		culler.cull(&center, &radius, 1, &res, &planes);
+		cull_batched(culler, root, res, planes);
+		batched_time += timer.getElapsedTimeF64();
+		batched_tests += gTests + 1;
+
+		timer.reset();
+		for (U32 i = 0; i < count; ++i)
+		{
+			flat_results[i] = far_clip ? camera.AABBInFrustum(gNodes[i]->mBounds[0], gNodes[i]->mBounds[1])
+									   : camera.AABBInFrustumNoFarClip(gNodes[i]->mBounds[0], gNodes[i]->mBounds[1]);
+		}
+		flat_time += timer.getElapsedTimeF64();
+
+		timer.reset();
+		soa_planes.assign(count, 0);
+		culler.cullSoA(soa_ptrs, count, &soa_results[0], &soa_planes[0]);
+		soa_time += timer.getElapsedTimeF64();
+
+		for (U32 i = 0; i < count; ++i)
+		{
+			if (gResults[i] != scalar_results[i] || soa_results[i] != flat_results[i])
+			{
+				++mismatches;
+			}
+			if (gResults[i] > 0)
+			{
+				++visible;
+			}
+		}
+	}
+
+	printf("%s: %u nodes, %.1f%% visible, %u mismatches\n", far_clip ? "far clip" : "no far clip",
+		   (U32)gNodes.size(), 100.f * visible / ((F32)gNodes.size() * frames), mismatches);
+	printf("  %-8s %9.1f us/frame  %8.1f boxes tested/frame\n", "scalar", scalar_time * 1.0e6 / frames, (F32)scalar_tests / frames);
+	printf("  %-8s %9.1f us/frame  %8.1f boxes tested/frame\n", "batched", batched_time * 1.0e6 / frames, (F32)batched_tests / frames);
+	printf("  %-8s %9.1f us/frame  %8u boxes tested/frame\n", "flat", flat_time * 1.0e6 / frames, count);
+	printf("  %-8s %9.1f us/frame  %8u boxes tested/frame\n", "soa", soa_time * 1.0e6 / frames, count);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	S32 num_objects = argc > 1 ? atoi(argv[1]) : 20000;
+	S32 frames = argc > 2 ? atoi(argv[2]) : 1000;
+	bool far_clip = argc > 3 ? atoi(argv[3]) != 0 : false;
+
+	printf("%d objects, %d frames\n", num_objects, frames);
+
+	make_scene(num_objects);
+	run(frames, far_clip);
+	run(frames, !far_clip);
+
+	for (U32 i = 0; i < gNodes.size(); ++i)
+	{
+		delete gNodes[i];
+	}
+	return 0;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file lloctree_bench.cpp
+ * @brief Compares moving octree elements one at a time with batched moves.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: lloctree_bench [static entries] [moving entries] [frames]
+//
+// Fills an octree with entries scattered over a region, sizes ranging from pebbles
+// to buildings, then moves some of them every frame (like avatars and vehicles,
+// bouncing off the edges of the region) and times updating the octree, with:
+//   immediate - what LLSpatialPartition::move did: leave the entry if it still fits
+//               in its node, otherwise remove it and insert it again from the root,
+//   batched   - LLOctreeNode::applyMoves once per frame,
+// followed by balancing the root, as LLPipeline::updateMove does. Every node has a
+// listener, like the LLSpatialGroups of the viewer, that counts the callbacks and
+// the nodes created and destroyed. Both variants are checked to leave every entry
+// in the node its listener was last told about, and no empty leaf nodes.
+
+#include "linden_common.h"
+
+#include "../lloctree.h"
+#include "lltimer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// lloctree.h uses these; the viewer defines them in newview.
+U32 gOctreeMaxCapacity = 128;
+U32 gOctreeReserveCapacity = 4;
+
+namespace
+{
+
+class Entry;
+typedef LLOctreeNode<Entry> Node;
+
+class Entry : public LLRefCount
+{
+public:
+	Entry() : mBinIndex(-1), mNode(NULL) { }
+
+	const LLVector4a& getPositionGroup() const	{ return mPosition; }
+	F32 getBinRadius() const					{ return mRadius; }
+	S32 getBinIndex() const						{ return mBinIndex; }
+	void setBinIndex(S32 index) const			{ mBinIndex = index; }
+
+	LLVector4a mPosition;
+	LLVector4a mVelocity;
+	F32 mRadius;
+	mutable S32 mBinIndex;
+	Node* mNode;								// Set by Listener.
+};
+
+struct Counters
+{
+	U32 mInsertions;
+	U32 mRemovals;
+	U32 mNodesCreated;
+	U32 mNodesDestroyed;
+};
+
+Counters gCounters;
+
+// Keeps track of the node of every entry, and hooks itself up to new nodes.
+class Listener : public LLOctreeListener<Entry>
+{
+public:
+	Listener(Node* node) { node->addListener(this); }
+
+	/*virtual*/ void handleInsertion(const LLTreeNode<Entry>* node, Entry* data)
+	{
+		data->mNode = (Node*) node;
+		++gCounters.mInsertions;
+	}
+	/*virtual*/ void handleRemoval(const LLTreeNode<Entry>* node, Entry* data)
+	{
+		data->mNode = NULL;
+		++gCounters.mRemovals;
+	}
+	/*virtual*/ void handleDestruction(const LLTreeNode<Entry>* node)
+	{
+		++gCounters.mNodesDestroyed;
+	}
+	/*virtual*/ void handleStateChange(const LLTreeNode<Entry>* node) { }
+	/*virtual*/ void handleChildAddition(const Node* parent, Node* child)
+	{
+		new Listener(child);
+		++gCounters.mNodesCreated;
+	}
+	/*virtual*/ void handleChildRemoval(const Node* parent, const Node* child) { }
+};
+
+// A fixed generator, so that both variants see the same scene and the same motion.
+U32 gSeed;
+
+F32 frand(F32 lo, F32 hi)
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return lo + (hi - lo) * (F32)(gSeed >> 8) / (F32)(1 << 24);
+}
+
+const F32 REGION_SIZE = 256.f;
+
+void make_scene(std::vector<LLPointer<Entry> >& entries, S32 num_static, S32 num_moving)
+{
+	gSeed = 12345;
+	entries.clear();
+	for (S32 i = 0; i < num_static + num_moving; ++i)
+	{
+		Entry* entry = new Entry;
+		entry->mPosition.set(frand(0.f, REGION_SIZE), frand(0.f, REGION_SIZE), frand(20.f, 60.f));
+		// Bin radii, which the viewer scales up from the object size: mostly small things, a few large ones.
+		F32 r = frand(0.f, 1.f);
+		entry->mRadius = 0.5f + r * r * r * 64.f;
+		if (i >= num_static)
+		{
+			// Avatars and vehicles, walking to driving speed, per frame at 30 fps.
+			entry->mVelocity.set(frand(-0.5f, 0.5f), frand(-0.5f, 0.5f), frand(-0.05f, 0.05f));
+			entry->mRadius = frand(2.f, 16.f);
+		}
+		else
+		{
+			entry->mVelocity.clear();
+		}
+		entries.push_back(entry);
+	}
+}
+
+void step(Entry* entry)
+{
+	entry->mPosition.add(entry->mVelocity);
+	for (S32 k = 0; k < 2; ++k)
+	{
+		if (entry->mPosition[k] < 0.f || entry->mPosition[k] > REGION_SIZE)
+		{
+			entry->mVelocity.getF32ptr()[k] = -entry->mVelocity[k];
+		}
+	}
+}
+
+// Returns the number of nodes, other than the root, without elements or children.
+S32 count_empty_leaves(Node* node)
+{
+	S32 count = node->getOctParent() && node->isEmpty() && node->isLeaf() ? 1 : 0;
+	for (U32 i = 0; i < node->getChildCount(); ++i)
+	{
+		count += count_empty_leaves(node->getChild(i));
+	}
+	return count;
+}
+
+// Returns the number of entries that are not where their listener says they are.
+S32 validate(const std::vector<LLPointer<Entry> >& entries)
+{
+	S32 bad = 0;
+	for (U32 i = 0; i < entries.size(); ++i)
+	{
+		Entry* entry = entries[i];
+		Node* node = entry->mNode;
+		S32 index = entry->getBinIndex();
+		if (!node || index < 0 || index >= (S32)node->getElementCount() || *(node->getDataBegin() + index) != entry)
+		{
+			++bad;
+		}
+	}
+	return bad;
+}
+
+void run(bool batched, S32 num_static, S32 num_moving, S32 frames)
+{
+	std::vector<LLPointer<Entry> > entries;
+	make_scene(entries, num_static, num_moving);
+
+	LLVector4a center, size;
+	center.splat(0.f);
+	size.splat(1.f);
+	LLOctreeRoot<Entry>* root = new LLOctreeRoot<Entry>(center, size, NULL);
+	new Listener(root);
+
+	for (U32 i = 0; i < entries.size(); ++i)
+	{
+		root->insert(entries[i]);
+	}
+
+	memset(&gCounters, 0, sizeof(gCounters));
+	Node::move_list_t moves;
+	U32 relocated = 0;
+
+	LLTimer timer;
+	for (S32 frame = 0; frame < frames; ++frame)
+	{
+		for (S32 i = num_static; i < num_static + num_moving; ++i)
+		{
+			Entry* entry = entries[i];
+			step(entry);
+
+			Node* node = entry->mNode;
+			if (node->fits(entry))
+			{
+				continue;
+			}
+			++relocated;
+
+			if (batched)
+			{
+				moves.push_back(std::make_pair(node, LLPointer<Entry>(entry)));
+			}
+			else
+			{
+				node->remove(entry);
+				root->insert(entry);
+			}
+		}
+
+		if (batched)
+		{
+			root->applyMoves(moves);
+		}
+
+		root->balance();
+	}
+	F64 elapsed = timer.getElapsedTimeF64();
+
+	printf("%-10s %9.1f us/frame  %7u relocations  %8u insertions  %8u removals  %6u nodes created  %6u nodes destroyed  %d misplaced  %d empty leaves\n",
+		   batched ? "batched" : "immediate", elapsed * 1.0e6 / frames, relocated,
+		   gCounters.mInsertions, gCounters.mRemovals, gCounters.mNodesCreated, gCounters.mNodesDestroyed,
+		   validate(entries), count_empty_leaves(root));
+
+	delete root;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	S32 num_static = argc > 1 ? atoi(argv[1]) : 20000;
+	S32 num_moving = argc > 2 ? atoi(argv[2]) : 4000;
+	S32 frames = argc > 3 ? atoi(argv[3]) : 300;
+
+	printf("%d static entries, %d moving entries, %d frames\n", num_static, num_moving, frames);
+
+	run(false, num_static, num_moving, frames);
+	run(true, num_static, num_moving, frames);
+
+	return 0;
+}
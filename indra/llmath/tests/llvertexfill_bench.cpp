@@ -0,0 +1,510 @@
+/**
+ * @file llvertexfill_bench.cpp
+ * @brief Compares the LLVertexFill kernels with the per vertex loops of LLFace::getGeometryVolume.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: llvertexfill_bench [prims] [iterations]
+//
+// Builds a scene of prims (all profile and path types, with cuts, hollows, twists and
+// all four levels of detail) and times rebuilding the vertex arrays of all their faces
+// (positions, normals, tangents, texture coordinates and colors), with:
+//   legacy     - the per vertex loops that LLFace::getGeometryVolume used before,
+//   vertexfill - the LLVertexFill kernels it uses now,
+// for each kind of texture coordinates: texture transform plus bump offsets (half
+// of the prims active, so that the bump offsets are rotated by the render matrix),
+// planar projection, and texture animation. Also reports the largest difference of
+// the texture coordinates of every variant with the legacy ones.
+
+#include "linden_common.h"
+
+#include "../llvertexfill.h"
+#include "../llvolume.h"
+#include "llquaternion.h"
+#include "m3math.h"
+#include "lltimer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// llvolume.cpp uses these; the viewer defines them in llrender and newview.
+BOOL gDebugGL = FALSE;
+U32 gOctreeMaxCapacity = 128;
+U32 gOctreeReserveCapacity = 4;
+
+namespace
+{
+
+enum EVariant { LEGACY, VERTEXFILL, NUM_VARIANTS };
+char const* const variant_names[NUM_VARIANTS] = { "legacy", "vertexfill" };
+
+enum ETexCoords { TC_BUMP, TC_PLANAR, TC_ANIM, NUM_TEX_COORDS };
+char const* const tex_coords_names[NUM_TEX_COORDS] = { "transform+bump", "planar", "animated" };
+
+// What getGeometryVolume gets from the face, its texture entry and its drawable.
+struct FaceState
+{
+	LLMatrix4 mVert;
+	LLMatrix3 mNormal;
+	LLQuaternion mBumpQuat;
+	bool mActive;
+	LLMatrix4 mTexMatrix;
+	F32 mCos, mSin, mOffsetS, mOffsetT, mScaleS, mScaleT;
+	LLVector3 mScale;
+	LLVector3 mSRay, mTRay;
+	U32 mColor;
+	S32 mTextureIndex;
+};
+
+// The vertex buffer arrays of one face, padded to a multiple of 4 vertices like LLVertexBuffer.
+struct FaceBuffers
+{
+	FaceBuffers(S32 num_vertices)
+	:	mNumVertices(num_vertices),
+		mTexCoords0((num_vertices + 3) & ~3),
+		mTexCoords1((num_vertices + 3) & ~3)
+	{
+		S32 padded = (num_vertices + 3) & ~3;
+		mPositions = (F32*) ll_aligned_malloc_16(padded * 4 * sizeof(F32));
+		mNormals = (F32*) ll_aligned_malloc_16(padded * 4 * sizeof(F32));
+		mTangents = (F32*) ll_aligned_malloc_16(padded * 4 * sizeof(F32));
+		mColors = (U32*) ll_aligned_malloc_16(padded * sizeof(U32));
+	}
+
+	~FaceBuffers()
+	{
+		ll_aligned_free_16(mPositions);
+		ll_aligned_free_16(mNormals);
+		ll_aligned_free_16(mTangents);
+		ll_aligned_free_16(mColors);
+	}
+
+	S32 mNumVertices;
+	F32* mPositions;
+	F32* mNormals;
+	F32* mTangents;
+	std::vector<LLVector2> mTexCoords0;
+	std::vector<LLVector2> mTexCoords1;
+	U32* mColors;
+
+private:
+	FaceBuffers(FaceBuffers const&);
+	FaceBuffers& operator=(FaceBuffers const&);
+};
+
+//----------------------------------------------------------------------------
+// The loops as they were in LLFace::getGeometryVolume.
+
+void planarProjection(LLVector2 &tc, const LLVector4a& normal, const LLVector4a& vec)
+{
+	LLVector4a binormal;
+	F32 d = normal[0];
+
+	if (d >= 0.5f || d <= -0.5f)
+	{
+		if (d < 0)
+		{
+			binormal.set(0,-1,0);
+		}
+		else
+		{
+			binormal.set(0, 1, 0);
+		}
+	}
+	else
+	{
+		if (normal[1] > 0)
+		{
+			binormal.set(-1,0,0);
+		}
+		else
+		{
+			binormal.set(1,0,0);
+		}
+	}
+	LLVector4a tangent;
+	tangent.setCross3(binormal,normal);
+
+	tc.mV[1] = -((tangent.dot3(vec).getF32())*2 - 0.5f);
+	tc.mV[0] = 1.0f+((binormal.dot3(vec).getF32())*2 - 0.5f);
+}
+
+void xform(LLVector2 &tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 offT, F32 magS, F32 magT)
+{
+	F32 s = tex_coord.mV[0];
+	F32 t = tex_coord.mV[1];
+
+	s -= 0.5;
+	t -= 0.5;
+
+	F32 temp = s;
+	s  = s     * cosAng + t * sinAng;
+	t  = -temp * sinAng + t * cosAng;
+
+	s *= magS;
+	t *= magT;
+
+	s += offS + 0.5f;
+	t += offT + 0.5f;
+
+	tex_coord.mV[0] = s;
+	tex_coord.mV[1] = t;
+}
+
+void rebuildLegacy(const LLVolumeFace& vf, const FaceState& fs, ETexCoords tex_coords, FaceBuffers& out)
+{
+	S32 num_vertices = vf.mNumVertices;
+
+	LLVector4a scalea;
+	scalea.load3(fs.mScale.mV);
+	LLMatrix4a mat_normal;
+	mat_normal.loadu(fs.mNormal);
+
+	std::vector<LLVector2> bump_tc;
+	for (S32 i = 0; i < num_vertices; i++)
+	{
+		LLVector2 tc(vf.mTexCoords[i]);
+		if (tex_coords == TC_PLANAR)
+		{
+			LLVector4a vec = vf.mPositions[i];
+			vec.mul(scalea);
+			planarProjection(tc, vf.mNormals[i], vec);
+		}
+		if (tex_coords == TC_ANIM)
+		{
+			LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
+			tmp = tmp * fs.mTexMatrix;
+			tc.mV[0] = tmp.mV[0];
+			tc.mV[1] = tmp.mV[1];
+		}
+		else
+		{
+			xform(tc, fs.mCos, fs.mSin, fs.mOffsetS, fs.mOffsetT, fs.mScaleS, fs.mScaleT);
+		}
+		out.mTexCoords0[i] = tc;
+		if (tex_coords == TC_BUMP)
+		{
+			bump_tc.push_back(tc);
+		}
+	}
+
+	if (tex_coords == TC_BUMP)
+	{
+		LLVector4a binormal_dir(-fs.mSin, fs.mCos, 0.f);
+		LLVector4a bump_s_primary_light_ray;
+		bump_s_primary_light_ray.load3(fs.mSRay.mV);
+		LLVector4a bump_t_primary_light_ray;
+		bump_t_primary_light_ray.load3(fs.mTRay.mV);
+
+		for (S32 i = 0; i < num_vertices; i++)
+		{
+			LLVector4a tangent = vf.mTangents[i];
+
+			LLVector4a binorm;
+			binorm.setCross3(vf.mNormals[i], tangent);
+			binorm.mul(tangent.getF32ptr()[3]);
+
+			LLMatrix4a tangent_to_object;
+			tangent_to_object.setRows(tangent, binorm, vf.mNormals[i]);
+			LLVector4a t;
+			tangent_to_object.rotate(binormal_dir, t);
+			LLVector4a binormal;
+			mat_normal.rotate(t, binormal);
+
+			if (fs.mActive)
+			{
+				LLVector3 t;
+				t.set(binormal.getF32ptr());
+				t *= fs.mBumpQuat;
+				binormal.load3(t.mV);
+			}
+
+			binormal.normalize3fast();
+
+			LLVector2 tc = bump_tc[i];
+			tc += LLVector2( bump_s_primary_light_ray.dot3(tangent).getF32(), bump_t_primary_light_ray.dot3(binormal).getF32() );
+
+			out.mTexCoords1[i] = tc;
+		}
+	}
+
+	// Positions, normals and tangents were already done with LLVector4a; these are the same loops.
+	LLMatrix4a mat_vert;
+	mat_vert.loadu(fs.mVert);
+	LLVertexFill::positions(out.mPositions, vf.mPositions, num_vertices, num_vertices, mat_vert, fs.mTextureIndex);
+	LLVertexFill::normals(out.mNormals, vf.mNormals, num_vertices, mat_normal);
+	LLVertexFill::tangents(out.mTangents, vf.mTangents, num_vertices, mat_normal);
+
+	LLVector4a src;
+	U32 vec[4];
+	vec[0] = vec[1] = vec[2] = vec[3] = fs.mColor;
+	src.loadua((F32*) vec);
+	F32* dst = (F32*) out.mColors;
+	S32 num_vecs = num_vertices/4;
+	if (num_vertices%4 > 0)
+	{
+		++num_vecs;
+	}
+	for (S32 i = 0; i < num_vecs; i++)
+	{
+		src.store4a(dst);
+		dst += 4;
+	}
+}
+
+//----------------------------------------------------------------------------
+// The same with the kernels, as LLFace::getGeometryVolume does it now.
+
+void rebuildVertexFill(const LLVolumeFace& vf, const FaceState& fs, ETexCoords tex_coords, FaceBuffers& out)
+{
+	S32 num_vertices = vf.mNumVertices;
+
+	LLVector4a scalea;
+	scalea.load3(fs.mScale.mV);
+	LLMatrix4a mat_normal;
+	mat_normal.loadu(fs.mNormal);
+
+	LLVertexFill::TexTransform xf(fs.mCos, fs.mSin, fs.mOffsetS, fs.mOffsetT, fs.mScaleS, fs.mScaleT);
+	switch (tex_coords)
+	{
+		case TC_BUMP:
+		{
+			std::vector<LLVector2> bump_tc(num_vertices);
+			LLVertexFill::transformTexCoords(&bump_tc[0], vf.mTexCoords, num_vertices, xf);
+			memcpy(&out.mTexCoords0[0], &bump_tc[0], num_vertices * sizeof(LLVector2));
+
+			LLMatrix4a bump_mat = mat_normal;
+			if (fs.mActive)
+			{
+				bump_mat.loadu(fs.mNormal * fs.mBumpQuat.getMatrix3());
+			}
+			LLVector4a s_ray;
+			s_ray.load3(fs.mSRay.mV);
+			LLVector4a t_ray;
+			t_ray.load3(fs.mTRay.mV);
+			LLVertexFill::bumpTexCoords(&out.mTexCoords1[0], &bump_tc[0], vf.mNormals, vf.mTangents, num_vertices,
+										bump_mat, fs.mCos, fs.mSin, s_ray, t_ray);
+			break;
+		}
+		case TC_PLANAR:
+		{
+			std::vector<LLVector2> planar(num_vertices);
+			LLVertexFill::planarTexCoords(&planar[0], vf.mPositions, vf.mNormals, num_vertices, scalea);
+			LLVertexFill::transformTexCoords(&out.mTexCoords0[0], &planar[0], num_vertices, xf);
+			break;
+		}
+		default:
+			LLVertexFill::transformTexCoords(&out.mTexCoords0[0], vf.mTexCoords, num_vertices, fs.mTexMatrix);
+			break;
+	}
+
+	LLMatrix4a mat_vert;
+	mat_vert.loadu(fs.mVert);
+	LLVertexFill::positions(out.mPositions, vf.mPositions, num_vertices, num_vertices, mat_vert, fs.mTextureIndex);
+	LLVertexFill::normals(out.mNormals, vf.mNormals, num_vertices, mat_normal);
+	LLVertexFill::tangents(out.mTangents, vf.mTangents, num_vertices, mat_normal);
+	LLVertexFill::fill(out.mColors, fs.mColor, num_vertices);
+}
+
+//----------------------------------------------------------------------------
+
+struct Prim
+{
+	LLPointer<LLVolume> mVolume;
+	FaceState mState;
+	std::vector<FaceBuffers*> mBuffers;
+};
+
+LLVolumeParams primParams(S32 i)
+{
+	static U8 const profiles[] = { LL_PCODE_PROFILE_SQUARE, LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PROFILE_ISOTRI, LL_PCODE_PROFILE_CIRCLE_HALF };
+	static U8 const paths[] = { LL_PCODE_PATH_LINE, LL_PCODE_PATH_CIRCLE };
+
+	LLVolumeParams params;
+	params.setType(profiles[i % 4], paths[(i / 4) % 2]);
+	params.setBeginAndEndS(0.f, 1.f);
+	params.setBeginAndEndT(0.f, 1.f);
+	params.setHollow(0.3f * ((i / 8) % 3));
+	if ((i / 8) % 2)
+	{
+		params.setBeginAndEndS(0.125f, 0.875f);
+	}
+	if ((i / 4) % 2)
+	{
+		// Tube, torus, ring and sphere.
+		params.setRatio(1.f, 0.5f);
+		params.setShear(0.f, 0.f);
+	}
+	else
+	{
+		params.setRatio(1.f, 1.f);
+		params.setShear(0.f, 0.f);
+		params.setTwistEnd(0.25f * ((i / 3) % 3));
+	}
+	return params;
+}
+
+FaceState primState(S32 i)
+{
+	FaceState fs;
+	LLQuaternion rot(0.37f * i, LLVector3(0.3f, 0.5f, 1.f));
+	fs.mVert.initAll(LLVector3(1.f + (i % 5), 1.f + (i % 3), 0.5f), rot, LLVector3(10.f * i, 20.f, 30.f));
+	fs.mNormal = rot.getMatrix3();
+	fs.mBumpQuat = LLQuaternion(0.11f * i, LLVector3(0.f, 0.f, 1.f));
+	fs.mActive = (i % 2) != 0;
+	fs.mTexMatrix.initAll(LLVector3(2.f, 3.f, 1.f), LLQuaternion(0.25f * i, LLVector3(0.f, 0.f, 1.f)), LLVector3(0.1f * i, 0.5f, 0.f));
+	F32 r = 0.2f * i;
+	fs.mCos = cosf(r);
+	fs.mSin = sinf(r);
+	fs.mOffsetS = 0.1f;
+	fs.mOffsetT = -0.25f;
+	fs.mScaleS = 1.f + (i % 4);
+	fs.mScaleT = 2.f;
+	fs.mScale.setVec(1.f + (i % 5), 1.f + (i % 3), 0.5f);
+	fs.mSRay.setVec(0.002f, 0.003f, 0.004f);
+	fs.mTRay.setVec(0.004f, -0.001f, 0.003f);
+	fs.mColor = 0xff8040c0;
+	fs.mTextureIndex = i % 8;
+	return fs;
+}
+
+typedef void (*rebuild_t)(const LLVolumeFace&, const FaceState&, ETexCoords, FaceBuffers&);
+
+void rebuildScene(rebuild_t rebuild, std::vector<Prim>& scene, ETexCoords tex_coords)
+{
+	for (size_t p = 0; p < scene.size(); ++p)
+	{
+		Prim& prim = scene[p];
+		for (S32 f = 0; f < prim.mVolume->getNumVolumeFaces(); ++f)
+		{
+			rebuild(prim.mVolume->getVolumeFace(f), prim.mState, tex_coords, *prim.mBuffers[f]);
+		}
+	}
+}
+
+void snapshotTexCoords(std::vector<Prim> const& scene, std::vector<LLVector2>& tex_coords)
+{
+	tex_coords.clear();
+	for (size_t p = 0; p < scene.size(); ++p)
+	{
+		for (size_t f = 0; f < scene[p].mBuffers.size(); ++f)
+		{
+			FaceBuffers const& buffers = *scene[p].mBuffers[f];
+			tex_coords.insert(tex_coords.end(), buffers.mTexCoords0.begin(), buffers.mTexCoords0.begin() + buffers.mNumVertices);
+			tex_coords.insert(tex_coords.end(), buffers.mTexCoords1.begin(), buffers.mTexCoords1.begin() + buffers.mNumVertices);
+		}
+	}
+}
+
+F32 maxDifference(std::vector<LLVector2> const& a, std::vector<LLVector2> const& b)
+{
+	F32 max_diff = 0.f;
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		max_diff = llmax(max_diff, fabsf(a[i].mV[VX] - b[i].mV[VX]));
+		max_diff = llmax(max_diff, fabsf(a[i].mV[VY] - b[i].mV[VY]));
+	}
+	return max_diff;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	S32 num_prims = argc > 1 ? atoi(argv[1]) : 1000;
+	S32 iterations = argc > 2 ? atoi(argv[2]) : 10;
+	if (num_prims < 1)
+	{
+		num_prims = 1;
+	}
+	if (iterations < 1)
+	{
+		iterations = 1;
+	}
+
+	static F32 const details[] = { 1.f, 1.5f, 2.5f, 4.f };
+	std::vector<Prim> scene(num_prims);
+	S32 num_faces = 0;
+	S32 num_vertices = 0;
+	for (S32 i = 0; i < num_prims; ++i)
+	{
+		Prim& prim = scene[i];
+		prim.mVolume = new LLVolume(primParams(i), details[i % 4]);
+		prim.mState = primState(i);
+		for (S32 f = 0; f < prim.mVolume->getNumVolumeFaces(); ++f)
+		{
+			prim.mVolume->genTangents(f);
+			S32 count = prim.mVolume->getVolumeFace(f).mNumVertices;
+			prim.mBuffers.push_back(new FaceBuffers(count));
+			num_vertices += count;
+		}
+		num_faces += prim.mVolume->getNumVolumeFaces();
+	}
+	printf("%d prims, %d faces, %d vertices\n", num_prims, num_faces, num_vertices);
+
+	rebuild_t const rebuilds[NUM_VARIANTS] = { rebuildLegacy, rebuildVertexFill };
+	for (S32 t = 0; t < NUM_TEX_COORDS; ++t)
+	{
+		ETexCoords tex_coords = ETexCoords(t);
+		std::vector<LLVector2> reference;
+		F64 legacy_ms = 0.0;
+		for (S32 v = 0; v < NUM_VARIANTS; ++v)
+		{
+			rebuildScene(rebuilds[v], scene, tex_coords);
+			std::vector<LLVector2> result;
+			snapshotTexCoords(scene, result);
+			F32 max_diff = 0.f;
+			if (v == LEGACY)
+			{
+				reference.swap(result);
+			}
+			else
+			{
+				max_diff = maxDifference(reference, result);
+			}
+
+			LLTimer timer;
+			for (S32 i = 0; i < iterations; ++i)
+			{
+				rebuildScene(rebuilds[v], scene, tex_coords);
+			}
+			F64 ms = timer.getElapsedTimeF64() * 1000.0 / iterations;
+			if (v == LEGACY)
+			{
+				legacy_ms = ms;
+			}
+			printf("%-16s %-10s %9.3f ms per rebuild  x%5.2f  max diff %g\n",
+				   tex_coords_names[t], variant_names[v], ms, legacy_ms / ms, max_diff);
+		}
+	}
+
+	for (S32 i = 0; i < num_prims; ++i)
+	{
+		for (size_t f = 0; f < scene[i].mBuffers.size(); ++f)
+		{
+			delete scene[i].mBuffers[f];
+		}
+	}
+	return 0;
+}
@@ -200,6 +200,13 @@ U32 getNumHTTPAdded(void);
 // Return the maximum number of total allowed added curl requests.
 U32 getMaxHTTPAdded(void);
 
+// Returns true if the curl thread waits for socket activity with epoll(7) instead of select(2).
+bool usingEPoll(void);
+
+// Returns the number of times the curl thread woke up from select() / epoll_wait() and
+// the total number of ready filedescriptors that it handled. Both counters wrap around.
+void getCurlThreadLoopStats(U32& wakeups, U32& ready_fds);
+
 // This used to be LLAppViewer::getTextureFetch()->getNumHTTPRequests().
 // Returns the number of active curl easy handles (that are actually attempting to download something).
 U32 getNumHTTPRunning(void);
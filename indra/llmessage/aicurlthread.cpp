@@ -45,6 +45,9 @@
 #include <unistd.h>
 #include <fcntl.h>
 #endif
+#if LL_LINUX
+#include <sys/epoll.h>
+#endif
 #include <deque>
 #include <cctype>
 
@@ -203,6 +206,9 @@ int ioctlsocket(int fd, int, unsigned long* nonblocking_enable)
 
 #define WINDOWS_CODE (LL_WINDOWS || DEBUG_WINDOWS_CODE_ON_LINUX)
 
+// epoll(7) is only available on linux. It is used instead of select(2) when CurlUseEPoll is set.
+#define HAVE_EPOLL (LL_LINUX && !WINDOWS_CODE)
+
 #undef AICurlPrivate
 
 namespace AICurlPrivate {
@@ -727,6 +733,140 @@ bool MergeIterator::next(curl_socket_t& fd_out, int& ev_bitmask_out)
   return true;
 }
 
+#if HAVE_EPOLL
+//-----------------------------------------------------------------------------
+// EPollSet
+//
+// Replaces the pair of PollSet's (and the MergeIterator) when CurlUseEPoll is set.
+// Filedescriptors are registered with the kernel once and only modified when
+// libcurl changes what it wants to wait for, so that there is no need to rebuild
+// an fd_set every loop, the cost of waiting doesn't depend on the largest
+// filedescriptor, and there is no FD_SETSIZE limit.
+
+class EPollSet
+{
+  public:
+	EPollSet(void);
+	~EPollSet();
+
+	// Register, change or unregister filedescriptor fd. Action is a CURL_POLL_* value.
+	void add(curl_socket_t fd, int action);
+	void modify(curl_socket_t fd, int action);
+	void remove(curl_socket_t fd);
+
+	// Wait at most timeout_ms milliseconds for registered filedescriptors to become ready.
+	// Returns the number of ready filedescriptors, 0 on timeout or -1 on error (errno is set).
+	int wait(int timeout_ms);
+
+	// Run over all filedescriptors returned by the last call to wait() that weren't removed since.
+	// Returns false when there are no more.
+	bool next(curl_socket_t& fd_out, int& ev_bitmask_out);
+
+  private:
+	static U32 events(int action);
+	void ctl(int op, curl_socket_t fd, int action);
+
+	static int const sMaxEvents = 256;	// Maximum number of ready filedescriptors returned by one call to wait().
+
+	int mEPollFd;						// The epoll instance.
+	struct epoll_event mEvents[sMaxEvents];	// Output of epoll_wait.
+	int mReady;							// Number of valid elements in mEvents.
+	int mIter;							// Index into mEvents of the next event returned by next().
+};
+
+EPollSet::EPollSet(void) : mReady(0), mIter(0)
+{
+  mEPollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (mEPollFd == -1)
+  {
+	llerrs << "epoll_create1() failed: " << strerror(errno) << llendl;
+  }
+}
+
+EPollSet::~EPollSet()
+{
+  close(mEPollFd);
+}
+
+//static
+U32 EPollSet::events(int action)
+{
+  U32 events = 0;
+  if ((action & CURL_POLL_IN))
+	events |= EPOLLIN;
+  if ((action & CURL_POLL_OUT))
+	events |= EPOLLOUT;
+  return events;
+}
+
+void EPollSet::ctl(int op, curl_socket_t fd, int action)
+{
+  struct epoll_event ev;
+  ev.events = events(action);
+  ev.data.u64 = 0;
+  ev.data.fd = fd;
+  if (epoll_ctl(mEPollFd, op, fd, &ev) == -1)
+  {
+	// A filedescriptor that was already closed was removed from the epoll set by the kernel.
+	if (op == EPOLL_CTL_DEL && (errno == EBADF || errno == ENOENT))
+	  return;
+	llwarns << "epoll_ctl(" << op << ", " << fd << ") failed: " << strerror(errno) << llendl;
+  }
+}
+
+void EPollSet::add(curl_socket_t fd, int action)
+{
+  ctl(EPOLL_CTL_ADD, fd, action);
+}
+
+void EPollSet::modify(curl_socket_t fd, int action)
+{
+  ctl(EPOLL_CTL_MOD, fd, action);
+}
+
+void EPollSet::remove(curl_socket_t fd)
+{
+  ctl(EPOLL_CTL_DEL, fd, CURL_POLL_NONE);
+  // Make sure that fd isn't returned by next() anymore, or we might confuse libcurl by
+  // calling curl_multi_socket_action for a socket that it told us to remove (and that
+  // possibly was already closed and reused).
+  for (int i = mIter; i < mReady; ++i)
+  {
+	if (mEvents[i].data.fd == fd)
+	  mEvents[i].events = 0;
+  }
+}
+
+int EPollSet::wait(int timeout_ms)
+{
+  mIter = 0;
+  int ready = epoll_wait(mEPollFd, mEvents, sMaxEvents, timeout_ms);
+  mReady = llmax(ready, 0);
+  return ready;
+}
+
+bool EPollSet::next(curl_socket_t& fd_out, int& ev_bitmask_out)
+{
+  while (mIter < mReady)
+  {
+	struct epoll_event const& ev(mEvents[mIter++]);
+	if (!ev.events)
+	  continue;		// Removed.
+	fd_out = ev.data.fd;
+	ev_bitmask_out = 0;
+	// A hangup is reported as readable by select(2), so that libcurl will read EOF.
+	if ((ev.events & (EPOLLIN | EPOLLHUP)))
+	  ev_bitmask_out |= CURL_CSELECT_IN;
+	if ((ev.events & EPOLLOUT))
+	  ev_bitmask_out |= CURL_CSELECT_OUT;
+	if ((ev.events & EPOLLERR))
+	  ev_bitmask_out |= CURL_CSELECT_ERR;
+	return true;
+  }
+  return false;
+}
+#endif // HAVE_EPOLL
+
 //-----------------------------------------------------------------------------
 // CurlSocketInfo
 
@@ -778,8 +918,8 @@ CurlSocketInfo::CurlSocketInfo(MultiHandle& multi_handle, ASSERT_ONLY(CURL* easy
 {
   llassert(*AICurlEasyRequest_wat(*mEasyRequest) == easy);
   mMultiHandle.assign(s, this);
-  llassert(!mMultiHandle.mReadPollSet->contains(s));
-  llassert(!mMultiHandle.mWritePollSet->contains(s));
+  llassert(!mMultiHandle.mReadPollSet || !mMultiHandle.mReadPollSet->contains(s));
+  llassert(!mMultiHandle.mWritePollSet || !mMultiHandle.mWritePollSet->contains(s));
   set_action(action);
   // Create a new HTTPTimeout object and keep a pointer to it in the corresponding CurlEasyRequest object.
   // The reason for this seemingly redundant storage (we could just store it directly in the CurlEasyRequest
@@ -804,8 +944,19 @@ void CurlSocketInfo::set_action(int action)
 
   Dout(dc::curl, "CurlSocketInfo::set_action(" << action_str(mAction) << " --> " << action_str(action) << ") [" << (void*)mEasyRequest.get_ptr().get() << "]");
   int toggle_action = mAction ^ action; 
+#if HAVE_EPOLL
+  if (mMultiHandle.mEPollSet && toggle_action)
+  {
+	if (mAction == CURL_POLL_NONE)
+	  mMultiHandle.mEPollSet->add(mSocketFd, action);
+	else if (action == CURL_POLL_NONE)
+	  mMultiHandle.mEPollSet->remove(mSocketFd);
+	else
+	  mMultiHandle.mEPollSet->modify(mSocketFd, action);
+  }
+#endif
   mAction = action;
-  if ((toggle_action & CURL_POLL_IN))
+  if ((toggle_action & CURL_POLL_IN) && mMultiHandle.mReadPollSet)
   {
 	if ((action & CURL_POLL_IN))
 	  mMultiHandle.mReadPollSet->add(this);
@@ -816,7 +967,8 @@ void CurlSocketInfo::set_action(int action)
   {
 	if ((action & CURL_POLL_OUT))
 	{
-	  mMultiHandle.mWritePollSet->add(this);
+	  if (mMultiHandle.mWritePollSet)
+		mMultiHandle.mWritePollSet->add(this);
 	  if (mTimeout)
 	  {
 		  // Note that this detection normally doesn't work because mTimeout will be zero.
@@ -826,7 +978,8 @@ void CurlSocketInfo::set_action(int action)
 	}
 	else
 	{
-	  mMultiHandle.mWritePollSet->remove(this);
+	  if (mMultiHandle.mWritePollSet)
+		mMultiHandle.mWritePollSet->remove(this);
 
 	  // The following is a bit of a hack, needed because of the lack of proper timeout callbacks in libcurl.
 	  // The removal of CURL_POLL_OUT could be part of the SSL handshake, therefore check if we're already connected:
@@ -853,6 +1006,9 @@ class AICurlThread : public LLThread
 	LLMutex mWakeUpFlagMutex;	// Set when the curl thread is sleeping (in or about to enter select()).
 	bool mWakeUpFlag;			// Protected by mWakeUpFlagMutex.
 
+	static LLAtomicU32 sWakeUps;	// The number of times select() or epoll_wait() returned.
+	static LLAtomicU32 sReadyFds;	// The total number of ready filedescriptors returned by select() or epoll_wait().
+
   public:
 	// MAIN-THREAD
 	AICurlThread(void);
@@ -866,6 +1022,13 @@ class AICurlThread : public LLThread
 
   protected:
 	virtual void run(void);
+#if HAVE_EPOLL
+	void run_epoll(AICurlMultiHandle_wat const& multi_handle_w);
+#endif
+	// Returns the time in ms to wait for socket activity; sets libcurl_timeout iff that is the timeout of libcurl.
+	long calculate_timeout(AICurlMultiHandle_wat const& multi_handle_w, bool& libcurl_timeout);
+	// Called when select() or epoll_wait() timed out after timeout_ms milliseconds.
+	void handle_timeout(AICurlMultiHandle_wat const& multi_handle_w, long timeout_ms, bool libcurl_timeout);
 	void wakeup(AICurlMultiHandle_wat const& multi_handle_w);
 	void process_commands(AICurlMultiHandle_wat const& multi_handle_w);
 
@@ -885,6 +1048,9 @@ class AICurlThread : public LLThread
 // Only the main thread is accessing this.
 AICurlThread* AICurlThread::sInstance = NULL;
 
+LLAtomicU32 AICurlThread::sWakeUps;
+LLAtomicU32 AICurlThread::sReadyFds;
+
 // MAIN-THREAD
 AICurlThread::AICurlThread(void) : LLThread("AICurlThread"),
     mWakeUpFd_in(CURL_SOCKET_BAD),
@@ -1381,6 +1547,70 @@ static bool is_bad(curl_socket_t fd, bool for_writing)
   return ret == -1;
 }
 
+// Returns the time in ms that we may sleep waiting for socket activity.
+// Sets libcurl_timeout iff the shortest timeout is that of libcurl.
+long AICurlThread::calculate_timeout(AICurlMultiHandle_wat const& multi_handle_w, bool& libcurl_timeout)
+{
+  // Update AICurlTimer::sTime_1ms.
+  AICurlTimer::sTime_1ms = get_clock_count() * AICurlTimer::sClockWidth_1ms;
+  Dout(dc::curl, "AICurlTimer::sTime_1ms = " << AICurlTimer::sTime_1ms);
+  // Get the time in ms that libcurl wants us to wait for socket actions - at most - before proceeding.
+  long timeout_ms = multi_handle_w->getTimeout();
+  // Set libcurl_timeout iff the shortest timeout is that of libcurl.
+  libcurl_timeout = timeout_ms == 0 || (timeout_ms > 0 && !AICurlTimer::expiresBefore(timeout_ms));
+  // If no curl timeout is set, sleep at most 4 seconds.
+  if (LL_UNLIKELY(timeout_ms < 0))
+	timeout_ms = 4000;
+  // Check if some AICurlTimer expires first.
+  if (AICurlTimer::expiresBefore(timeout_ms))
+  {
+	timeout_ms = AICurlTimer::nextExpiration();
+  }
+  // If we have to continue immediately, then just set a zero timeout, but only for 100 calls on a row;
+  // after that start sleeping 1ms and later even 10ms (this should never happen).
+  if (LL_UNLIKELY(timeout_ms <= 0))
+  {
+	if (mZeroTimeout >= 1000)
+	{
+	  if (mZeroTimeout % 10000 == 0)
+		llwarns << "Detected " << mZeroTimeout << " zero-timeout calls of select() by curl thread (more than 101 seconds)!" << llendl;
+	  timeout_ms = 10;
+	}
+	else if (mZeroTimeout >= 100)
+	  timeout_ms = 1;
+	else
+	  timeout_ms = 0;
+  }
+  else
+  {
+	if (LL_UNLIKELY(mZeroTimeout >= 10000))
+	  llinfos << "Timeout of select() call by curl thread reset (to " << timeout_ms << " ms)." << llendl;
+	mZeroTimeout = 0;
+  }
+  return timeout_ms;
+}
+
+void AICurlThread::handle_timeout(AICurlMultiHandle_wat const& multi_handle_w, long timeout_ms, bool libcurl_timeout)
+{
+  if (libcurl_timeout)
+  {
+	multi_handle_w->socket_action(CURL_SOCKET_TIMEOUT, 0);
+  }
+  else
+  {
+	// Update MultiHandle::mTimeout because next loop we need to sleep timeout_ms shorter.
+	multi_handle_w->update_timeout(timeout_ms);
+	Dout(dc::curl, "MultiHandle::mTimeout set to " << multi_handle_w->getTimeout() << " ms.");
+  }
+  // Handle timers.
+  if (AICurlTimer::expiresBefore(1))
+  {
+	AICurlTimer::handleExpiration();
+  }
+  // Handle stalling transactions.
+  multi_handle_w->handle_stalls();
+}
+
 // The main loop of the curl thread.
 void AICurlThread::run(void)
 {
@@ -1388,6 +1618,13 @@ void AICurlThread::run(void)
 
   {
 	AICurlMultiHandle_wat multi_handle_w(AICurlMultiHandle::getInstance());
+#if HAVE_EPOLL
+	if (multi_handle_w->mEPollSet)
+	{
+	  run_epoll(multi_handle_w);
+	}
+	else
+#endif
 	while(mRunning)
 	{
 	  // If mRunning is true then we can only get here if mWakeUpFd != CURL_SOCKET_BAD.
@@ -1437,42 +1674,8 @@ void AICurlThread::run(void)
 #endif
 	  int ready = 0;
 	  struct timeval timeout;
-	  // Update AICurlTimer::sTime_1ms.
-	  AICurlTimer::sTime_1ms = get_clock_count() * AICurlTimer::sClockWidth_1ms;
-	  Dout(dc::curl, "AICurlTimer::sTime_1ms = " << AICurlTimer::sTime_1ms);
-	  // Get the time in ms that libcurl wants us to wait for socket actions - at most - before proceeding.
-	  long timeout_ms = multi_handle_w->getTimeout();
-	  // Set libcurl_timeout iff the shortest timeout is that of libcurl.
-	  bool libcurl_timeout = timeout_ms == 0 || (timeout_ms > 0 && !AICurlTimer::expiresBefore(timeout_ms));
-	  // If no curl timeout is set, sleep at most 4 seconds.
-	  if (LL_UNLIKELY(timeout_ms < 0))
-		timeout_ms = 4000;
-	  // Check if some AICurlTimer expires first.
-	  if (AICurlTimer::expiresBefore(timeout_ms))
-	  {
-		timeout_ms = AICurlTimer::nextExpiration();
-	  }
-	  // If we have to continue immediately, then just set a zero timeout, but only for 100 calls on a row;
-	  // after that start sleeping 1ms and later even 10ms (this should never happen).
-	  if (LL_UNLIKELY(timeout_ms <= 0))
-	  {
-		if (mZeroTimeout >= 1000)
-		{
-		  if (mZeroTimeout % 10000 == 0)
-			llwarns << "Detected " << mZeroTimeout << " zero-timeout calls of select() by curl thread (more than 101 seconds)!" << llendl;
-		  timeout_ms = 10;
-		}
-		else if (mZeroTimeout >= 100)
-		  timeout_ms = 1;
-		else
-		  timeout_ms = 0;
-	  }
-	  else
-	  {
-		if (LL_UNLIKELY(mZeroTimeout >= 10000))
-		  llinfos << "Timeout of select() call by curl thread reset (to " << timeout_ms << " ms)." << llendl;
-		mZeroTimeout = 0;
-	  }
+	  bool libcurl_timeout;
+	  long timeout_ms = calculate_timeout(multi_handle_w, libcurl_timeout);
 	  timeout.tv_sec = timeout_ms / 1000;
 	  timeout.tv_usec = (timeout_ms % 1000) * 1000;
 #ifdef CWDEBUG
@@ -1572,29 +1775,15 @@ void AICurlThread::run(void)
 		}
 		continue;
 	  }
+	  sWakeUps++;
+	  sReadyFds += ready;
 	  // Update the clocks.
 	  AICurlTimer::sTime_1ms = get_clock_count() * AICurlTimer::sClockWidth_1ms;
 	  Dout(dc::curl, "AICurlTimer::sTime_1ms = " << AICurlTimer::sTime_1ms);
 	  HTTPTimeout::sTime_10ms = AICurlTimer::sTime_1ms / 10;
 	  if (ready == 0)
 	  {
-		if (libcurl_timeout)
-		{
-		  multi_handle_w->socket_action(CURL_SOCKET_TIMEOUT, 0);
-		}
-		else
-		{
-		  // Update MultiHandle::mTimeout because next loop we need to sleep timeout_ms shorter.
-		  multi_handle_w->update_timeout(timeout_ms);
-		  Dout(dc::curl, "MultiHandle::mTimeout set to " << multi_handle_w->getTimeout() << " ms.");
-		}
-		// Handle timers.
-		if (AICurlTimer::expiresBefore(1))
-		{
-		  AICurlTimer::handleExpiration();
-		}
-		// Handle stalling transactions.
-		multi_handle_w->handle_stalls();
+		handle_timeout(multi_handle_w, timeout_ms, libcurl_timeout);
 	  }
 	  else
 	  {
@@ -1627,15 +1816,103 @@ void AICurlThread::run(void)
   AICurlMultiHandle::destroyInstance();
 }
 
+#if HAVE_EPOLL
+// The main loop of the curl thread when using epoll(7).
+void AICurlThread::run_epoll(AICurlMultiHandle_wat const& multi_handle_w)
+{
+  DoutEntering(dc::curl, "AICurlThread::run_epoll()");
+
+  EPollSet* epoll_set = multi_handle_w->mEPollSet;
+  // The wake up fd stays registered for as long as the thread runs.
+  epoll_set->add(mWakeUpFd, CURL_POLL_IN);
+  while(mRunning)
+  {
+	// Process every command in command_queue before entering epoll_wait().
+	for(;;)
+	{
+	  mWakeUpFlagMutex.lock();
+	  if (mWakeUpFlag)
+	  {
+		mWakeUpFlagMutex.unlock();
+		process_commands(multi_handle_w);
+		continue;
+	  }
+	  break;
+	}
+	// wakeup_thread() is also called after setting mRunning to false.
+	if (!mRunning)
+	{
+	  mWakeUpFlagMutex.unlock();
+	  break;
+	}
+
+	// If we get here then mWakeUpFlag has been false since we grabbed the lock.
+	// We're now entering epoll_wait(), during which the main thread will write to the pipe
+	// to wake us up, because it can't get the lock.
+	bool libcurl_timeout;
+	long timeout_ms = calculate_timeout(multi_handle_w, libcurl_timeout);
+	int ready = epoll_set->wait(timeout_ms);
+	mWakeUpFlagMutex.unlock();
+	Dout(dc::curl|cond_error_cf(ready == -1), "epoll_wait(..., timeout = " << timeout_ms << " ms) = " << ready);
+	if (ready == -1)
+	{
+	  // Unlike select(), epoll_wait() doesn't fail when one of our filedescriptors was closed
+	  // behind our back: the kernel simply drops it from the epoll set. The only expected error is EINTR.
+	  if (errno != EINTR)
+		llwarns << "epoll_wait() failed: " << errno << ", " << strerror(errno) << llendl;
+	  continue;
+	}
+	sWakeUps++;
+	sReadyFds += ready;
+	// Update the clocks.
+	AICurlTimer::sTime_1ms = get_clock_count() * AICurlTimer::sClockWidth_1ms;
+	Dout(dc::curl, "AICurlTimer::sTime_1ms = " << AICurlTimer::sTime_1ms);
+	HTTPTimeout::sTime_10ms = AICurlTimer::sTime_1ms / 10;
+	if (ready == 0)
+	{
+	  handle_timeout(multi_handle_w, timeout_ms, libcurl_timeout);
+	}
+	else
+	{
+	  // Handle all ready filedescriptors.
+	  curl_socket_t fd;
+	  int ev_bitmask;
+	  while (epoll_set->next(fd, ev_bitmask))
+	  {
+		if (fd == mWakeUpFd)
+		{
+		  // Process commands from main-thread. This can add or remove filedescriptors from the epoll set.
+		  wakeup(multi_handle_w);
+		  continue;
+		}
+		// This can cause libcurl to do callbacks and remove filedescriptors, which are then also removed from the remaining ready events.
+		multi_handle_w->socket_action(fd, ev_bitmask);
+	  }
+	}
+	multi_handle_w->check_msg_queue();
+  }
+  epoll_set->remove(mWakeUpFd);
+}
+#endif // HAVE_EPOLL
+
 //-----------------------------------------------------------------------------
 // MultiHandle
 
 LLAtomicU32 MultiHandle::sTotalAdded;
 
-MultiHandle::MultiHandle(void) : mTimeout(-1), mReadPollSet(NULL), mWritePollSet(NULL)
+MultiHandle::MultiHandle(void) : mTimeout(-1), mReadPollSet(NULL), mWritePollSet(NULL), mEPollSet(NULL)
 {
-  mReadPollSet = new PollSet;
-  mWritePollSet = new PollSet;
+#if HAVE_EPOLL
+  if (curl_use_epoll)
+  {
+	mEPollSet = new EPollSet;
+  }
+  else
+#endif
+  {
+	mReadPollSet = new PollSet;
+	mWritePollSet = new PollSet;
+  }
   check_multi_code(curl_multi_setopt(mMultiHandle, CURLMOPT_SOCKETFUNCTION, &MultiHandle::socket_callback));
   check_multi_code(curl_multi_setopt(mMultiHandle, CURLMOPT_SOCKETDATA, this));
   check_multi_code(curl_multi_setopt(mMultiHandle, CURLMOPT_TIMERFUNCTION, &MultiHandle::timer_callback));
@@ -1655,6 +1932,10 @@ MultiHandle::~MultiHandle()
   }
   delete mWritePollSet;
   delete mReadPollSet;
+#if HAVE_EPOLL
+  delete mEPollSet;
+  mEPollSet = NULL;
+#endif
 }
 
 void MultiHandle::handle_stalls(void)
@@ -1745,6 +2026,7 @@ CURLMsg const* MultiHandle::info_read(int* msgs_in_queue) const
 }
 
 U32 curl_max_total_concurrent_connections = 32;						// Initialized on start up by startCurlThread().
+bool curl_use_epoll = false;											// Initialized on start up by startCurlThread().
 
 bool MultiHandle::add_easy_request(AICurlEasyRequest const& easy_request, bool from_queue)
 {
@@ -2683,6 +2965,9 @@ void startCurlThread(LLControlGroup* control_group)
   curl_max_total_concurrent_connections = sConfigGroup->getU32("CurlMaxTotalConcurrentConnections");
   CurlConcurrentConnectionsPerService = (U16)sConfigGroup->getU32("CurlConcurrentConnectionsPerService");
   gNoVerifySSLCert = sConfigGroup->getBOOL("NoVerifySSLCert");
+#if HAVE_EPOLL
+  curl_use_epoll = sConfigGroup->getBOOL("CurlUseEPoll");
+#endif
   AIPerService::setMaxPipelinedRequests(curl_max_total_concurrent_connections);
   AIPerService::setHTTPThrottleBandwidth(sConfigGroup->getF32("HTTPThrottleBandwidth"));
 
@@ -2751,6 +3036,19 @@ U32 getMaxHTTPAdded(void)
   return AICurlPrivate::curlthread::curl_max_total_concurrent_connections;
 }
 
+bool usingEPoll(void)
+{
+  return AICurlPrivate::curlthread::curl_use_epoll;
+}
+
+void getCurlThreadLoopStats(U32& wakeups, U32& ready_fds)
+{
+  using namespace AICurlPrivate::curlthread;
+
+  wakeups = AICurlThread::sWakeUps;
+  ready_fds = AICurlThread::sReadyFds;
+}
+
 size_t getHTTPBandwidth(void)
 {
   using namespace AICurlPrivate;
@@ -368,6 +368,20 @@ void LLHTTPClient::ResponderBase::decode_llsd_body(U32 status, std::string const
 #endif
 }
 
+bool LLHTTPClient::ResponderBase::decode_llsd_body(U32 status, std::string const& reason, LLChannelDescriptors const& channels, buffer_ptr_t const& buffer, LLSDXMLVisitor& visitor)
+{
+	AICurlInterface::Stats::llsd_body_count++;
+	llassert(200 <= status && status < 300);
+	LLBufferStream istr(channels, buffer.get());
+	if (LLSDSerialize::fromXML(visitor, istr) == LLSDParser::PARSE_FAILURE)
+	{
+		llwarns << "Failed to deserialize LLSD. " << mURL << " [" << status << "]: " << reason << llendl;
+		AICurlInterface::Stats::llsd_body_parse_error++;
+		return false;
+	}
+	return true;
+}
+
 void LLHTTPClient::ResponderBase::decode_raw_body(U32 status, std::string const& reason, LLChannelDescriptors const& channels, buffer_ptr_t const& buffer, std::string& content)
 {
 	AICurlInterface::Stats::raw_body_count++;
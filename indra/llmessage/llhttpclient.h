@@ -43,6 +43,7 @@
 class LLUUID;
 class LLPumpIO;
 class LLSD;
+class LLSDXMLVisitor;
 class AIHTTPTimeoutPolicy;
 class LLBufferArray;
 class LLChannelDescriptors;
@@ -148,6 +149,10 @@ public:
 		// Read body from buffer and put it into content. If status indicates success, interpret it as LLSD, otherwise copy it as-is.
 		void decode_llsd_body(U32 status, std::string const& reason, LLChannelDescriptors const& channels, buffer_ptr_t const& buffer, LLSD& content);
 
+		// Read body from buffer and pass it to visitor while it is parsed as LLSD, without building the whole body as one LLSD.
+		// Only use this when status indicates success. Returns false if the body could not be parsed.
+		bool decode_llsd_body(U32 status, std::string const& reason, LLChannelDescriptors const& channels, buffer_ptr_t const& buffer, LLSDXMLVisitor& visitor);
+
 		// Read body from buffer and put it into content. Always copy it as-is.
 		void decode_raw_body(U32 status, std::string const& reason, LLChannelDescriptors const& channels, buffer_ptr_t const& buffer, std::string& content);
 
@@ -67,6 +67,63 @@ void LLMsgData::addDataFast(char *blockname, char *varname, const void *data, S3
 	}
 }
 
+// LLMessageLayout functions
+
+void LLMessageLayout::build(const LLMessageTemplate& message_template)
+{
+	clear();
+
+	for (LLMessageTemplate::message_block_map_t::const_iterator iter = message_template.mMemberBlocks.begin();
+		 iter != message_template.mMemberBlocks.end(); ++iter)
+	{
+		const LLMessageBlock* blockp = *iter;
+
+		Block block;
+		block.mName = blockp->mName;
+		block.mType = blockp->mType;
+		block.mNumber = blockp->mNumber;
+		block.mFirstVariable = mVariables.size();
+		block.mNumVariables = blockp->mMemberVariables.size();
+
+		S32 offset = 0;
+		for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = blockp->mMemberVariables.begin();
+			 var_iter != blockp->mMemberVariables.end(); ++var_iter)
+		{
+			const LLMessageVariable* varp = *var_iter;
+
+			Variable var;
+			var.mName = varp->getName();
+			var.mType = varp->getType();
+			var.mSize = varp->getSize();
+			var.mOffset = offset;
+			mVariables.push_back(var);
+
+			if (var.mType == MVT_VARIABLE)
+			{
+				if (var.mSize != 1 && var.mSize != 2 && var.mSize != 4)
+				{
+					llerrs << "Variable " << var.mName << " of message " << message_template.mName
+						   << " has a size field of unknown size " << var.mSize << llendl;
+				}
+				offset = -1;
+			}
+			else
+			{
+				mMaxFixedSize = llmax(mMaxFixedSize, var.mSize);
+				if (offset >= 0)
+				{
+					offset += var.mSize;
+				}
+			}
+		}
+		block.mFixedSize = offset;
+
+		mBlocks.push_back(block);
+	}
+
+	mBuilt = true;
+}
+
 // LLMessageVariable functions and friends
 
 std::ostream& operator<<(std::ostream& s, LLMessageVariable &msg)
@@ -235,6 +235,77 @@ public:
 };
 
 
+class LLMessageTemplate;
+
+// The blocks and variables of a message template in the order they appear in a
+// packet, for decoding received messages without looking anything up by name.
+class LLMessageLayout
+{
+public:
+	struct Variable
+	{
+		char*				mName;
+		EMsgVariableType	mType;
+		S32					mSize;			// The size of a fixed size variable, or of the length of a variable size one.
+		S32					mOffset;		// From the start of the block, or -1 if a variable size variable comes before it.
+	};
+
+	struct Block
+	{
+		char*				mName;
+		EMsgBlockType		mType;
+		S32					mNumber;
+		S32					mFirstVariable;	// Index in mVariables.
+		S32					mNumVariables;
+		S32					mFixedSize;		// The size of the block, or -1 if it has variable size variables.
+	};
+
+	LLMessageLayout() : mMaxFixedSize(0), mBuilt(false) { }
+
+	void build(const LLMessageTemplate& message_template);
+	void clear()							{ mBlocks.clear(); mVariables.clear(); mMaxFixedSize = 0; mBuilt = false; }
+	bool isBuilt() const					{ return mBuilt; }
+
+	// Returns the index of the block in mBlocks, or -1.
+	S32 findBlock(const char* name) const
+	{
+		for (U32 i = 0; i < mBlocks.size(); ++i)
+		{
+			if (mBlocks[i].mName == name)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// Returns the index of a variable of block in mVariables, or -1. Variables tend to be
+	// read in order, so pass the one after the last one found as hint.
+	S32 findVariable(const Block& block, const char* name, S32 hint) const
+	{
+		const S32 end = block.mFirstVariable + block.mNumVariables;
+		if (hint >= block.mFirstVariable && hint < end && mVariables[hint].mName == name)
+		{
+			return hint;
+		}
+		for (S32 i = block.mFirstVariable; i < end; ++i)
+		{
+			if (mVariables[i].mName == name)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	std::vector<Block>		mBlocks;
+	std::vector<Variable>	mVariables;
+	S32						mMaxFixedSize;	// Of all fixed size variables.
+
+private:
+	bool					mBuilt;
+};
+
 enum EMsgFrequency
 {
 	MFT_NULL	= 0,  // value is size of message number in bytes
@@ -305,6 +376,7 @@ public:
 				<< "has already been used as a block name!" << llendl;
 		}
 		*member_blockp = blockp;
+		mLayout.clear();
 		if (  (mTotalSize != -1)
 			&&(blockp->mTotalSize != -1)
 			&&(  (blockp->mType == MBT_SINGLE)
@@ -382,6 +454,22 @@ public:
 		return trustedSource ? mBanFromTrusted : mBanFromUntrusted;
 	}
 
+	// Builds the layout of the message; done when the template is added to the message system.
+	void buildLayout()
+	{
+		mLayout.build(*this);
+	}
+
+	// The layout of the message, built on first use if need be.
+	const LLMessageLayout& getLayout()
+	{
+		if (!mLayout.isBuilt())
+		{
+			mLayout.build(*this);
+		}
+		return mLayout;
+	}
+
 	friend std::ostream&	 operator<<(std::ostream& s, LLMessageTemplate &msg);
 
 	const LLMessageBlock* getBlock(char* name) const
@@ -412,6 +500,8 @@ public:
 	bool									mBanFromUntrusted;
 
 private:
+	LLMessageLayout							mLayout;
+
 	// message handler function (this is set by each application)
 	void									(*mHandlerFunc)(LLMessageSystem *msgsystem, void **user_data);
 	void									**mUserData;
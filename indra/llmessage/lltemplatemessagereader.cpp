@@ -38,12 +38,17 @@
 #include "v3math.h"
 #include "v4math.h"
 
+//static
+bool LLTemplateMessageReader::sDecodeWithLayouts = true;
+
 LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 												 number_template_map) :
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(NULL),
 	mCurrentRMessageData(NULL),
-	mMessageNumbers(number_template_map)
+	mMessageNumbers(number_template_map),
+	mDecodedWithLayout(false),
+	mVariableHint(0)
 {
 }
 
@@ -61,6 +66,28 @@ void LLTemplateMessageReader::clearMessage()
 	mCurrentRMessageTemplate = NULL;
 	delete mCurrentRMessageData;
 	mCurrentRMessageData = NULL;
+	mDecodedWithLayout = false;
+}
+
+S32 LLTemplateMessageReader::findVariable(const char* blockname, S32 blocknum, const char* varname, S32& var_index)
+{
+	const LLMessageLayout& layout = mCurrentRMessageTemplate->getLayout();
+
+	S32 block_index = layout.findBlock(blockname);
+	if (block_index < 0 || blocknum < 0 || blocknum >= mBlockRefs[block_index].mCount)
+	{
+		return LL_BLOCK_NOT_IN_MESSAGE;
+	}
+
+	const LLMessageLayout::Block& block = layout.mBlocks[block_index];
+	var_index = layout.findVariable(block, varname, mVariableHint);
+	if (var_index < 0)
+	{
+		return LL_VARIABLE_NOT_IN_BLOCK;
+	}
+	mVariableHint = var_index + 1;
+
+	return mBlockRefs[block_index].mFirstRef + blocknum * block.mNumVariables + var_index - block.mFirstVariable;
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -72,6 +99,52 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
 		return;
 	}
 
+	if (mDecodedWithLayout)
+	{
+		S32 var_index;
+		S32 ref = findVariable(blockname, blocknum, varname, var_index);
+		if (ref == LL_BLOCK_NOT_IN_MESSAGE)
+		{
+			llerrs << "Block " << blockname << " #" << blocknum
+				<< " not in message " << mCurrentRMessageTemplate->mName << llendl;
+			return;
+		}
+		if (ref == LL_VARIABLE_NOT_IN_BLOCK)
+		{
+			llerrs << "Variable "<< varname << " not in message "
+				<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+			return;
+		}
+
+		const VarRef& var_ref = mVarRefs[ref];
+		if (size && size != var_ref.mSize)
+		{
+			llerrs << "Msg " << mCurrentRMessageTemplate->mName 
+				<< " variable " << varname
+				<< " is size " << var_ref.mSize
+				<< " but copying into buffer of size " << size
+				<< llendl;
+			return;
+		}
+
+		const U8* data = &mLayoutBuffer[0] + var_ref.mOffset;
+		if (max_size >= var_ref.mSize)
+		{
+			htonmemcpy(datap, data, mCurrentRMessageTemplate->getLayout().mVariables[var_index].mType, var_ref.mSize);
+		}
+		else
+		{
+			llwarns << "Msg " << mCurrentRMessageTemplate->mName 
+				<< " variable " << varname
+				<< " is size " << var_ref.mSize
+				<< " but truncated to max size of " << max_size
+				<< llendl;
+
+			memcpy(datap, data, max_size);
+		}
+		return;
+	}
+
 	if (!mCurrentRMessageData)
 	{
 		llerrs << "Invalid mCurrentMessageData in getData!" << llendl;
@@ -155,6 +228,12 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
 		return -1;
 	}
 
+	if (mDecodedWithLayout)
+	{
+		S32 block_index = mCurrentRMessageTemplate->getLayout().findBlock(blockname);
+		return block_index < 0 ? 0 : mBlockRefs[block_index].mCount;
+	}
+
 	if (!mCurrentRMessageData)
 	{
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -182,6 +261,32 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
 		return LL_MESSAGE_ERROR;
 	}
 
+	if (mDecodedWithLayout)
+	{
+		S32 var_index;
+		S32 ref = findVariable(blockname, 0, varname, var_index);
+		if (ref == LL_BLOCK_NOT_IN_MESSAGE)
+		{	// don't crash
+			llinfos << "Block " << blockname << " not in message "
+				<< mCurrentRMessageTemplate->mName << llendl;
+			return LL_BLOCK_NOT_IN_MESSAGE;
+		}
+		if (ref == LL_VARIABLE_NOT_IN_BLOCK)
+		{	// don't crash
+			llinfos << "Variable " << varname << " not in message "
+				<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+			return LL_VARIABLE_NOT_IN_BLOCK;
+		}
+		const LLMessageLayout& layout = mCurrentRMessageTemplate->getLayout();
+		if (layout.mBlocks[layout.findBlock(blockname)].mType != MBT_SINGLE)
+		{	// This is a serious error - crash
+			llerrs << "Block " << blockname << " isn't type MBT_SINGLE,"
+				" use getSize with blocknum argument!" << llendl;
+			return LL_MESSAGE_ERROR;
+		}
+		return mVarRefs[ref].mSize;
+	}
+
 	if (!mCurrentRMessageData)
 	{	// This is a serious error - crash
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -230,6 +335,25 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 		return LL_MESSAGE_ERROR;
 	}
 
+	if (mDecodedWithLayout)
+	{
+		S32 var_index;
+		S32 ref = findVariable(blockname, blocknum, varname, var_index);
+		if (ref == LL_BLOCK_NOT_IN_MESSAGE)
+		{	// don't crash
+			llinfos << "Block " << blockname << " #" << blocknum << " not in message " 
+				<< mCurrentRMessageTemplate->mName << llendl;
+			return LL_BLOCK_NOT_IN_MESSAGE;
+		}
+		if (ref == LL_VARIABLE_NOT_IN_BLOCK)
+		{	// don't crash
+			llinfos << "Variable " << varname << " not in message "
+				<<  mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+			return LL_VARIABLE_NOT_IN_BLOCK;
+		}
+		return mVarRefs[ref].mSize;
+	}
+
 	if (!mCurrentRMessageData)
 	{	// This is a serious error - crash
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
@@ -530,14 +654,9 @@ void LLTemplateMessageReader::logRanOffEndOfPacket( const LLHost& host, const S3
 
 static LLFastTimer::DeclareTimer FTM_PROCESS_MESSAGES("Process Messages");
 
-// decode a given message
-BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender, bool custom)
+// decode a given message into an LLMsgData
+BOOL LLTemplateMessageReader::decodeIntoMessageData(const U8* buffer, const LLHost& sender, bool custom)
 {
-	llassert( mReceiveSize >= 0 );
-	llassert( mCurrentRMessageTemplate);
-	llassert( !mCurrentRMessageData );
-	delete mCurrentRMessageData; // just to make sure
-
 	// The offset tells us how may bytes to skip after the end of the
 	// message name.
 	U8 offset = buffer[PHL_OFFSET];
@@ -702,6 +821,191 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 		return FALSE;
 	}
 
+	return TRUE;
+}
+
+// decode a given message using the layout of its template
+BOOL LLTemplateMessageReader::decodeWithLayout(const U8* buffer, const LLHost& sender, bool custom)
+{
+	const LLMessageLayout& layout = mCurrentRMessageTemplate->getLayout();
+
+	// Keep a copy of the packet: handlers aren't the only ones to read the message,
+	// and the buffer doesn't necessarily outlive the call. Variables that run off
+	// the end of the packet read from the zeros after it.
+	const S32 zeros_pos = mReceiveSize;
+	mLayoutBuffer.resize(mReceiveSize + layout.mMaxFixedSize);
+	memcpy(&mLayoutBuffer[0], buffer, mReceiveSize);
+	if (layout.mMaxFixedSize)
+	{
+		memset(&mLayoutBuffer[zeros_pos], 0, layout.mMaxFixedSize);
+	}
+
+	// The offset tells us how may bytes to skip after the end of the
+	// message name.
+	U8 offset = buffer[PHL_OFFSET];
+	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
+
+	mBlockRefs.resize(layout.mBlocks.size());
+	mVarRefs.clear();
+	mVariableHint = 0;
+	S32 total_blocks = 0;
+
+	for (U32 block_index = 0; block_index < layout.mBlocks.size(); ++block_index)
+	{
+		const LLMessageLayout::Block& block = layout.mBlocks[block_index];
+		U8 repeat_number;
+
+		// how many of this block?
+		if (block.mType == MBT_SINGLE)
+		{
+			repeat_number = 1;
+		}
+		else if (block.mType == MBT_MULTIPLE)
+		{
+			repeat_number = block.mNumber;
+		}
+		else if (block.mType == MBT_VARIABLE)
+		{
+			// missing variable blocks at the end of a message are legal
+			if (decode_pos >= mReceiveSize)
+			{
+				repeat_number = 0;
+			}
+			else
+			{
+				repeat_number = buffer[decode_pos];
+				decode_pos++;
+			}
+		}
+		else
+		{
+			if(!custom)
+				llerrs << "Unknown block type" << llendl;
+			return FALSE;
+		}
+
+		mBlockRefs[block_index].mFirstRef = mVarRefs.size();
+		mBlockRefs[block_index].mCount = repeat_number;
+		total_blocks += repeat_number;
+
+		if (!block.mNumVariables)
+		{
+			continue;
+		}
+		mVarRefs.resize(mVarRefs.size() + repeat_number * block.mNumVariables);
+		const LLMessageLayout::Variable* vars = &layout.mVariables[block.mFirstVariable];
+		VarRef* refs = &mVarRefs[mBlockRefs[block_index].mFirstRef];
+
+		for (S32 i = 0; i < repeat_number; i++, refs += block.mNumVariables)
+		{
+			if (block.mFixedSize >= 0 && decode_pos + block.mFixedSize <= mReceiveSize)
+			{
+				// All of the block is in the packet, its variables are where the layout says.
+				for (S32 j = 0; j < block.mNumVariables; j++)
+				{
+					refs[j].mOffset = decode_pos + vars[j].mOffset;
+					refs[j].mSize = vars[j].mSize;
+				}
+				decode_pos += block.mFixedSize;
+				continue;
+			}
+
+			for (S32 j = 0; j < block.mNumVariables; j++)
+			{
+				const LLMessageLayout::Variable& var = vars[j];
+				if (var.mType == MVT_VARIABLE)
+				{
+					// the size of the data comes first
+					S32 data_size = var.mSize;
+					U8 tsizeb = 0;
+					U16 tsizeh = 0;
+					U32 tsize = 0;
+
+					if ((decode_pos + data_size) > mReceiveSize)
+					{
+						if (!custom)
+							logRanOffEndOfPacket(sender, decode_pos, data_size);
+
+						// default to 0 length variable blocks
+						tsize = 0;
+					}
+					else
+					{
+						switch(data_size)
+						{
+						case 1:
+							htonmemcpy(&tsizeb, &buffer[decode_pos], MVT_U8, 1);
+							tsize = tsizeb;
+							break;
+						case 2:
+							htonmemcpy(&tsizeh, &buffer[decode_pos], MVT_U16, 2);
+							tsize = tsizeh;
+							break;
+						default:
+							htonmemcpy(&tsize, &buffer[decode_pos], MVT_U32, 4);
+							break;
+						}
+					}
+					decode_pos += data_size;
+
+					refs[j].mOffset = decode_pos;
+					refs[j].mSize = tsize;
+					if (tsize > (U32)(mReceiveSize - decode_pos))
+					{
+						// The size is bogus, don't read past the end of the packet.
+						if (!custom)
+							logRanOffEndOfPacket(sender, decode_pos, tsize);
+						refs[j].mOffset = zeros_pos;
+						refs[j].mSize = 0;
+					}
+					decode_pos += tsize;
+				}
+				else
+				{
+					if ((decode_pos + var.mSize) > mReceiveSize)
+					{
+						if(!custom)
+							logRanOffEndOfPacket(sender, decode_pos, var.mSize);
+
+						// default to 0s.
+						refs[j].mOffset = zeros_pos;
+					}
+					else
+					{
+						refs[j].mOffset = decode_pos;
+					}
+					refs[j].mSize = var.mSize;
+					decode_pos += var.mSize;
+				}
+			}
+		}
+	}
+
+	if (!total_blocks && !layout.mBlocks.empty())
+	{
+		lldebugs << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << llendl;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+// decode a given message
+BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender, bool custom)
+{
+	llassert( mReceiveSize >= 0 );
+	llassert( mCurrentRMessageTemplate);
+	llassert( !mCurrentRMessageData );
+	delete mCurrentRMessageData; // just to make sure
+	mCurrentRMessageData = NULL;
+
+	mDecodedWithLayout = sDecodeWithLayouts;
+	if (!(mDecodedWithLayout ? decodeWithLayout(buffer, sender, custom)
+							 : decodeIntoMessageData(buffer, sender, custom)))
+	{
+		return FALSE;
+	}
+
 	if(!custom)
 	{
 		static LLTimer decode_timer;
@@ -831,5 +1135,34 @@ void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
     {
         return;
     }
-	builder.copyFromMessageData(*mCurrentRMessageData);
+
+	if (!mDecodedWithLayout)
+	{
+		builder.copyFromMessageData(*mCurrentRMessageData);
+		return;
+	}
+
+	// Build the LLMsgData that decodeIntoMessageData would have.
+	LLMsgData data(mCurrentRMessageTemplate->mName);
+	const LLMessageLayout& layout = mCurrentRMessageTemplate->getLayout();
+	for (U32 block_index = 0; block_index < layout.mBlocks.size(); ++block_index)
+	{
+		const LLMessageLayout::Block& block = layout.mBlocks[block_index];
+		const BlockRefs& block_refs = mBlockRefs[block_index];
+		for (S32 i = 0; i < block_refs.mCount; i++)
+		{
+			LLMsgBlkData* block_data = new LLMsgBlkData(block.mName, block_refs.mCount);
+			block_data->mName = block.mName + i;
+			data.addBlock(block_data);
+
+			const VarRef* refs = &mVarRefs[block_refs.mFirstRef + i * block.mNumVariables];
+			for (S32 j = 0; j < block.mNumVariables; j++)
+			{
+				const LLMessageLayout::Variable& var = layout.mVariables[block.mFirstVariable + j];
+				block_data->addVariable(var.mName, var.mType);
+				block_data->addData(var.mName, &mLayoutBuffer[0] + refs[j].mOffset, refs[j].mSize, var.mType);
+			}
+		}
+	}
+	builder.copyFromMessageData(data);
 }
@@ -30,10 +30,17 @@
 #include "llmessagereader.h"
 
 #include <map>
+#include <vector>
 
 class LLMessageTemplate;
 class LLMsgData;
 
+// Received messages are decoded with the layout of their template (see
+// LLMessageLayout): the reader keeps a copy of the packet and the offset and
+// size of every variable in it, and the getters copy straight out of that.
+// setDecodeWithLayouts(false) switches back to copying every variable into
+// an LLMsgData, which allocates for every block and variable.
+
 class LLTemplateMessageReader : public LLMessageReader
 {
 public:
@@ -105,6 +112,9 @@ public:
 	bool isTrusted() const;
 	bool isBanned(bool trusted_source) const;
 	bool isUdpBanned() const;
+
+	static void setDecodeWithLayouts(bool b)	{ sDecodeWithLayouts = b; }
+	static bool getDecodeWithLayouts()			{ return sDecodeWithLayouts; }
 	
 private:
 
@@ -118,11 +128,37 @@ private:
 	void logRanOffEndOfPacket( const LLHost& host, const S32 where, const S32 wanted );
 
 	BOOL decodeData(const U8* buffer, const LLHost& sender, bool custom);
+	BOOL decodeIntoMessageData(const U8* buffer, const LLHost& sender, bool custom);
+	BOOL decodeWithLayout(const U8* buffer, const LLHost& sender, bool custom);
+
+	// Returns the index in mVarRefs of variable varname of block blockname number blocknum, and sets
+	// var_index to its index in the layout; or returns LL_BLOCK_NOT_IN_MESSAGE or LL_VARIABLE_NOT_IN_BLOCK.
+	S32 findVariable(const char* blockname, S32 blocknum, const char* varname, S32& var_index);
 
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
 	LLMsgData* mCurrentRMessageData;
 	message_template_number_map_t& mMessageNumbers;
+
+	// The message as decoded with the layout of its template.
+	struct VarRef
+	{
+		S32 mOffset;							// In mLayoutBuffer.
+		S32 mSize;
+	};
+	struct BlockRefs
+	{
+		S32 mFirstRef;							// Index in mVarRefs of the first variable of the first block.
+		S32 mCount;								// Number of blocks.
+	};
+	bool mDecodedWithLayout;
+	std::vector<U8> mLayoutBuffer;				// The packet, followed by zeros for variables that run off its end.
+	std::vector<BlockRefs> mBlockRefs;			// For every block of the layout.
+	std::vector<VarRef> mVarRefs;				// For every variable of every block in the message.
+	S32 mVariableHint;							// The variable after the last one looked up.
+
+	static bool sDecodeWithLayouts;
+
 	friend class LLFloaterMessageLogItem;
 };
 
@@ -2980,6 +2980,7 @@ void LLMessageSystem::addTemplate(LLMessageTemplate *templatep)
 	}
 	mMessageTemplates[templatep->mName] = templatep;
 	mMessageNumbers[templatep->mMessageNumber] = templatep;
+	templatep->buildLayout();
 }
 
 
@@ -0,0 +1,449 @@
+/**
+ * @file lltemplatemessagereader_bench.cpp
+ * @brief Compares decoding template messages into an LLMsgData with decoding them with their layouts.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: lltemplatemessagereader_bench [passes] [message_template.msg recorded stream]
+//
+// Replays a stream of packets through LLTemplateMessageReader, the way
+// LLMessageSystem::checkMessages does (validateMessage, readMessage, then the
+// handler of the message), with every handler reading all of the variables of
+// its message. It is timed with:
+//   legacy - every variable copied into an LLMsgData by decodeData,
+//   layout - the offsets of the variables found with the layout of the template.
+// The bytes read by the handlers are checksummed, and must be the same for both.
+//
+// A recorded stream is a file of the packets as received, each preceded by its
+// size as a 32 bit little endian integer; zero coded packets are expanded when
+// loading. Without one, packets are made up for a few templates that are like
+// the busiest messages of a region: ImprovedTerseObjectUpdate, ObjectUpdate,
+// CoarseLocationUpdate and AvatarAnimation.
+
+#include "linden_common.h"
+
+#include "llhost.h"
+#include "llmessagetemplate.h"
+#include "llmessagetemplateparser.h"
+#include "lltemplatemessagebuilder.h"
+#include "lltemplatemessagereader.h"
+#include "lltimer.h"
+#include "message.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+extern void ll_init_apr();
+
+namespace
+{
+
+typedef std::vector<U8> packet_t;
+
+LLTemplateMessageReader* gReader = NULL;
+U32 gChecksum;
+U32 gBytesRead;
+
+// The handler of every message: reads all of its variables, like the handlers of
+// the viewer do (they mostly go through the variables in template order).
+void read_all(LLMessageSystem*, void** user_data)
+{
+	const LLMessageTemplate* templatep = (const LLMessageTemplate*) user_data;
+	U8 data[MAX_BUFFER_SIZE];
+
+	for (LLMessageTemplate::message_block_map_t::const_iterator iter = templatep->mMemberBlocks.begin();
+		 iter != templatep->mMemberBlocks.end(); ++iter)
+	{
+		const LLMessageBlock* blockp = *iter;
+		S32 count = gReader->getNumberOfBlocks(blockp->mName);
+		for (S32 i = 0; i < count; ++i)
+		{
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = blockp->mMemberVariables.begin();
+				 var_iter != blockp->mMemberVariables.end(); ++var_iter)
+			{
+				const LLMessageVariable* varp = *var_iter;
+				S32 size = varp->getSize();
+				if (varp->getType() == MVT_VARIABLE)
+				{
+					size = gReader->getSize(blockp->mName, i, varp->getName());
+				}
+				gReader->getBinaryData(blockp->mName, varp->getName(), data, size, i, sizeof(data));
+
+				// FNV-1a
+				for (S32 k = 0; k < size; ++k)
+				{
+					gChecksum = (gChecksum ^ data[k]) * 16777619u;
+				}
+				gBytesRead += size;
+			}
+		}
+	}
+}
+
+void register_template(LLTemplateMessageReader::message_template_number_map_t& numbers, LLMessageTemplate* templatep)
+{
+	templatep->setHandlerFunc(read_all, (void**) templatep);
+	numbers[templatep->mMessageNumber] = templatep;
+}
+
+char* name(const char* str)
+{
+	return LLMessageStringTable::getInstance()->getString(str);
+}
+
+// A fixed generator, so that the made up stream is the same every run.
+U32 gSeed = 12345;
+
+U32 rand_u32()
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return gSeed >> 8;
+}
+
+S32 rand_range(S32 lo, S32 hi)
+{
+	return lo + (S32)(rand_u32() % (U32)(hi - lo + 1));
+}
+
+// The largest size made up for the variable size variables, by name.
+S32 max_variable_size(const char* var_name)
+{
+	const std::string str(var_name);
+	if (str == "TextureEntry")
+	{
+		return 400;
+	}
+	if (str == "ObjectData" || str == "Data")
+	{
+		return 60;
+	}
+	if (str == "NameValue" || str == "Text")
+	{
+		return 40;
+	}
+	return 8;
+}
+
+LLMessageTemplate* make_template(const char* message_name, U32 number)
+{
+	return new LLMessageTemplate(message_name, number, MFT_HIGH);
+}
+
+void add_variables(LLMessageBlock* blockp, const char* const* names, const EMsgVariableType* types, const S32* sizes, S32 count)
+{
+	for (S32 i = 0; i < count; ++i)
+	{
+		blockp->addVariable(name(names[i]), types[i], sizes[i]);
+	}
+}
+
+LLMessageBlock* region_data_block()
+{
+	LLMessageBlock* blockp = new LLMessageBlock("RegionData", MBT_SINGLE);
+	blockp->addVariable(name("RegionHandle"), MVT_U64, 8);
+	blockp->addVariable(name("TimeDilation"), MVT_U16, 2);
+	return blockp;
+}
+
+void make_templates(std::vector<LLMessageTemplate*>& templates)
+{
+	LLMessageTemplate* templatep = make_template("ImprovedTerseObjectUpdate", 1);
+	templatep->addBlock(region_data_block());
+	LLMessageBlock* blockp = new LLMessageBlock("ObjectData", MBT_VARIABLE);
+	blockp->addVariable(name("Data"), MVT_VARIABLE, 1);
+	blockp->addVariable(name("TextureEntry"), MVT_VARIABLE, 2);
+	templatep->addBlock(blockp);
+	templates.push_back(templatep);
+
+	templatep = make_template("ObjectUpdate", 12);
+	templatep->addBlock(region_data_block());
+	blockp = new LLMessageBlock("ObjectData", MBT_VARIABLE);
+	{
+		static const char* const names[] = {
+			"ID", "State", "FullID", "CRC", "PCode", "Material", "ClickAction", "Scale", "ObjectData",
+			"ParentID", "UpdateFlags", "PathCurve", "ProfileCurve", "PathBegin", "PathEnd", "PathScaleX",
+			"PathScaleY", "PathShearX", "PathShearY", "PathTwist", "PathTwistBegin", "PathRadiusOffset",
+			"PathTaperX", "PathTaperY", "PathRevolutions", "PathSkew", "ProfileBegin", "ProfileEnd",
+			"ProfileHollow", "TextureEntry", "TextureAnim", "NameValue", "Data", "Text", "TextColor",
+			"MediaURL", "PSBlock", "ExtraParams", "Sound", "OwnerID", "Gain", "Flags", "Radius",
+			"JointType", "JointPivot", "JointAxisOrAnchor" };
+		static const EMsgVariableType types[] = {
+			MVT_U32, MVT_U8, MVT_LLUUID, MVT_U32, MVT_U8, MVT_U8, MVT_U8, MVT_LLVector3, MVT_VARIABLE,
+			MVT_U32, MVT_U32, MVT_U8, MVT_U8, MVT_U16, MVT_U16, MVT_U8,
+			MVT_U8, MVT_U8, MVT_U8, MVT_S8, MVT_S8, MVT_S8,
+			MVT_S8, MVT_S8, MVT_U8, MVT_S8, MVT_U16, MVT_U16,
+			MVT_U16, MVT_VARIABLE, MVT_VARIABLE, MVT_VARIABLE, MVT_VARIABLE, MVT_VARIABLE, MVT_FIXED,
+			MVT_VARIABLE, MVT_VARIABLE, MVT_VARIABLE, MVT_LLUUID, MVT_LLUUID, MVT_F32, MVT_U8, MVT_F32,
+			MVT_U8, MVT_LLVector3, MVT_LLVector3 };
+		static const S32 sizes[] = {
+			4, 1, 16, 4, 1, 1, 1, 12, 1,
+			4, 4, 1, 1, 2, 2, 1,
+			1, 1, 1, 1, 1, 1,
+			1, 1, 1, 1, 2, 2,
+			2, 2, 1, 2, 2, 1, 4,
+			1, 1, 1, 16, 16, 4, 1, 4,
+			1, 12, 12 };
+		add_variables(blockp, names, types, sizes, LL_ARRAY_SIZE(names));
+	}
+	templatep->addBlock(blockp);
+	templates.push_back(templatep);
+
+	templatep = make_template("CoarseLocationUpdate", 6);
+	blockp = new LLMessageBlock("Location", MBT_VARIABLE);
+	blockp->addVariable(name("X"), MVT_U8, 1);
+	blockp->addVariable(name("Y"), MVT_U8, 1);
+	blockp->addVariable(name("Z"), MVT_U8, 1);
+	templatep->addBlock(blockp);
+	blockp = new LLMessageBlock("Index", MBT_SINGLE);
+	blockp->addVariable(name("You"), MVT_S16, 2);
+	blockp->addVariable(name("Prey"), MVT_S16, 2);
+	templatep->addBlock(blockp);
+	blockp = new LLMessageBlock("AgentData", MBT_VARIABLE);
+	blockp->addVariable(name("AgentID"), MVT_LLUUID, 16);
+	templatep->addBlock(blockp);
+	templates.push_back(templatep);
+
+	templatep = make_template("AvatarAnimation", 20);
+	blockp = new LLMessageBlock("Sender", MBT_SINGLE);
+	blockp->addVariable(name("ID"), MVT_LLUUID, 16);
+	templatep->addBlock(blockp);
+	blockp = new LLMessageBlock("AnimationList", MBT_VARIABLE);
+	blockp->addVariable(name("AnimID"), MVT_LLUUID, 16);
+	blockp->addVariable(name("AnimSequenceID"), MVT_S32, 4);
+	templatep->addBlock(blockp);
+	blockp = new LLMessageBlock("AnimationSourceList", MBT_VARIABLE);
+	blockp->addVariable(name("ObjectID"), MVT_LLUUID, 16);
+	templatep->addBlock(blockp);
+	blockp = new LLMessageBlock("PhysicalAvatarEventList", MBT_VARIABLE);
+	blockp->addVariable(name("TypeData"), MVT_VARIABLE, 1);
+	templatep->addBlock(blockp);
+	templates.push_back(templatep);
+}
+
+// The number of blocks of a variable block, by message.
+S32 max_blocks(const LLMessageTemplate* templatep)
+{
+	const std::string str(templatep->mName);
+	if (str == "ObjectUpdate")
+	{
+		return 3;
+	}
+	if (str == "ImprovedTerseObjectUpdate")
+	{
+		return 12;
+	}
+	if (str == "CoarseLocationUpdate")
+	{
+		return 40;
+	}
+	return 4;
+}
+
+void make_packet(LLTemplateMessageBuilder& builder, const LLMessageTemplate* templatep, packet_t& packet)
+{
+	U8 data[MAX_BUFFER_SIZE];
+	for (S32 k = 0; k < (S32)sizeof(data); ++k)
+	{
+		data[k] = (U8) rand_u32();
+	}
+
+	builder.newMessage(templatep->mName);
+	for (LLMessageTemplate::message_block_map_t::const_iterator iter = templatep->mMemberBlocks.begin();
+		 iter != templatep->mMemberBlocks.end(); ++iter)
+	{
+		const LLMessageBlock* blockp = *iter;
+		S32 count = blockp->mType == MBT_SINGLE ? 1 :
+					blockp->mType == MBT_MULTIPLE ? blockp->mNumber : rand_range(1, max_blocks(templatep));
+		for (S32 i = 0; i < count; ++i)
+		{
+			builder.nextBlock(blockp->mName);
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = blockp->mMemberVariables.begin();
+				 var_iter != blockp->mMemberVariables.end(); ++var_iter)
+			{
+				const LLMessageVariable* varp = *var_iter;
+				S32 size = varp->getSize();
+				if (varp->getType() == MVT_VARIABLE)
+				{
+					size = rand_range(0, max_variable_size(varp->getName()));
+				}
+				builder.addBinaryData(varp->getName(), data + rand_range(0, 64), size);
+			}
+		}
+	}
+
+	U8 buffer[MAX_BUFFER_SIZE];
+	memset(buffer, 0, LL_PACKET_ID_SIZE);
+	U32 size = builder.buildMessage(buffer, sizeof(buffer), 0);
+	packet.assign(buffer, buffer + size);
+	builder.clearMessage();
+}
+
+void make_stream(std::vector<packet_t>& packets, LLTemplateMessageReader::message_template_number_map_t& numbers)
+{
+	std::vector<LLMessageTemplate*> templates;
+	make_templates(templates);
+
+	LLTemplateMessageBuilder::message_template_name_map_t names;
+	for (U32 i = 0; i < templates.size(); ++i)
+	{
+		register_template(numbers, templates[i]);
+		names[templates[i]->mName] = templates[i];
+	}
+
+	// Mostly terse updates, as in a busy region.
+	static const S32 weights[] = { 60, 15, 10, 15 };
+	LLTemplateMessageBuilder builder(names);
+	packets.resize(5000);
+	for (U32 i = 0; i < packets.size(); ++i)
+	{
+		S32 pick = rand_range(0, 99);
+		U32 t = 0;
+		while (pick >= weights[t])
+		{
+			pick -= weights[t++];
+		}
+		make_packet(builder, templates[t], packets[i]);
+	}
+}
+
+bool load_stream(const char* template_file, const char* stream_file,
+				 std::vector<packet_t>& packets, LLTemplateMessageReader::message_template_number_map_t& numbers)
+{
+	std::ifstream template_in(template_file);
+	if (!template_in)
+	{
+		printf("Failed to open %s\n", template_file);
+		return false;
+	}
+	std::string template_body((std::istreambuf_iterator<char>(template_in)), std::istreambuf_iterator<char>());
+	LLTemplateTokenizer tokens(template_body);
+	LLTemplateParser parsed(tokens);
+	for (LLTemplateParser::message_iterator iter = parsed.getMessagesBegin(); iter != parsed.getMessagesEnd(); ++iter)
+	{
+		register_template(numbers, *iter);
+	}
+
+	std::ifstream stream_in(stream_file, std::ios::binary);
+	if (!stream_in)
+	{
+		printf("Failed to open %s\n", stream_file);
+		return false;
+	}
+	U8 buffer[MAX_BUFFER_SIZE];
+	U8 size_bytes[4];
+	while (stream_in.read((char*) size_bytes, 4))
+	{
+		S32 size = size_bytes[0] | (size_bytes[1] << 8) | (size_bytes[2] << 16) | (size_bytes[3] << 24);
+		if (size < LL_MINIMUM_VALID_PACKET_SIZE || size > MAX_BUFFER_SIZE || !stream_in.read((char*) buffer, size))
+		{
+			printf("Bad packet in %s after %u packets\n", stream_file, (U32) packets.size());
+			break;
+		}
+
+		// What LLMessageSystem::checkMessages does before handing the packet to the reader.
+		if (buffer[0] & LL_ACK_FLAG)
+		{
+			S32 acks = buffer[--size];
+			size -= acks * sizeof(TPACKETID);
+			if (size < LL_MINIMUM_VALID_PACKET_SIZE)
+			{
+				continue;
+			}
+		}
+		U8* data = buffer;
+		gMessageSystem->zeroCodeExpand(&data, &size);
+		packets.push_back(packet_t(data, data + size));
+	}
+	return !packets.empty();
+}
+
+void run(bool with_layouts, const std::vector<packet_t>& packets, S32 passes)
+{
+	LLTemplateMessageReader::setDecodeWithLayouts(with_layouts);
+	const LLHost host;
+	gChecksum = 2166136261u;
+	gBytesRead = 0;
+	U32 decoded = 0;
+
+	LLTimer timer;
+	for (S32 pass = 0; pass < passes; ++pass)
+	{
+		for (U32 i = 0; i < packets.size(); ++i)
+		{
+			const packet_t& packet = packets[i];
+			if (gReader->validateMessage(&packet[0], packet.size(), host, true)
+				&& gReader->readMessage(&packet[0], host))
+			{
+				++decoded;
+			}
+			gReader->clearMessage();
+		}
+	}
+	F64 elapsed = timer.getElapsedTimeF64();
+
+	printf("%-7s %8.3f us/packet  %8u packets decoded  %10u bytes read  checksum %08x\n",
+		   with_layouts ? "layout" : "legacy", elapsed * 1.0e6 / (packets.size() * passes),
+		   decoded, gBytesRead, gChecksum);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	ll_init_apr();
+
+	S32 passes = argc > 1 ? atoi(argv[1]) : 20;
+
+	// The reader calls on the message system for the handlers and the timing callback.
+	start_messaging_system("notafile", 0, 1, 0, 0, false, "notasharedsecret", NULL, false, 5.f, 100.f);
+
+	LLTemplateMessageReader::message_template_number_map_t numbers;
+	std::vector<packet_t> packets;
+	if (argc > 3)
+	{
+		if (!load_stream(argv[2], argv[3], packets, numbers))
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		make_stream(packets, numbers);
+	}
+
+	gReader = new LLTemplateMessageReader(numbers);
+
+	printf("%u packets, %d passes\n", (U32) packets.size(), passes);
+
+	run(false, packets, passes);
+	U32 legacy_checksum = gChecksum;
+	run(true, packets, passes);
+	printf("%s\n", gChecksum == legacy_checksum ? "Same data read." : "DIFFERENT DATA READ!");
+
+	delete gReader;
+	end_messaging_system();
+
+	return gChecksum == legacy_checksum ? 0 : 1;
+}
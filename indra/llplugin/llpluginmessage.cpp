@@ -371,8 +371,24 @@ std::string LLPluginMessage::generate(void) const
 	return result.str();
 }
 
+/**
+ *	Flatten the message into binary LLSD. This is much faster to generate and parse than XML,
+ *	but may only be sent to a peer that announced it understands it.
+ *
+ * @return Message as a string of binary LLSD.
+ */
+std::string LLPluginMessage::generateBinary(void) const
+{
+	std::ostringstream result;
+	
+	LLSDSerialize::toBinary(mMessage, result);
+	
+	return result.str();
+}
+
 /**
  *	Parse an incoming message into component parts. Clears all existing state before starting the parse.
+ *	The message may be XML (see generate()) or binary LLSD (see generateBinary()).
  *
  * @return Returns -1 on failure, otherwise returns the number of key/value pairs in the incoming message.
  */
@@ -381,13 +397,34 @@ int LLPluginMessage::parse(const std::string &message)
 	// clear any previous state
 	clear();
 
-	std::istringstream input(message);
-	
-	S32 parse_result = LLSDSerialize::fromXML(mMessage, input);
+	S32 parse_result;
+	if (isBinary(message))
+	{
+		parse_result = LLSDSerialize::fromBinary(mMessage, (const U8*)message.data(), (S32)message.size());
+	}
+	else
+	{
+		std::istringstream input(message);
+		parse_result = LLSDSerialize::fromXML(mMessage, input);
+	}
 	
 	return (int)parse_result;
 }
 
+/**
+ *	Tells whether message was generated by generateBinary().
+ *
+ * @param[in] message Message as received
+ *
+ * @return True if message is binary LLSD; the XML of generate() always starts with '<' or white space.
+ */
+//static
+bool LLPluginMessage::isBinary(const std::string &message)
+{
+	// Messages are maps, and a binary LLSD map starts with '{'.
+	return !message.empty() && message[0] == '{';
+}
+
 
 /**
  * Destructor
@@ -88,11 +88,18 @@ public:
 	// Flatten the message into a string
 	std::string generate(void) const;
 
+	// Flatten the message into binary LLSD, for a peer that supports it
+	std::string generateBinary(void) const;
+
 	// Parse an incoming message into component parts
 	// (this clears out all existing state before starting the parse)
+	// Accepts the output of both generate() and generateBinary().
 	// Returns -1 on failure, otherwise returns the number of key/value pairs in the message.
 	int parse(const std::string &message);
 
+	// Returns true if message was made by generateBinary()
+	static bool isBinary(const std::string &message);
+
 	enum LLPLUGIN_LOG_LEVEL {
 		LOG_LEVEL_DEBUG,
 		LOG_LEVEL_INFO,
@@ -29,11 +29,16 @@
 #include "linden_common.h"
 
 #include "llpluginmessagepipe.h"
+#include "llpluginmessage.h"
 #include "llbufferstream.h"
 
 #include "llapr.h"
 
 static const char MESSAGE_DELIMITER = '\0';
+// Binary messages (see LLPluginMessage::generateBinary) may contain MESSAGE_DELIMITER,
+// so they are sent as this byte, followed by the size as four bytes (most significant first), followed by the message.
+static const char BINARY_MESSAGE_START = '\1';
+static const size_t BINARY_MESSAGE_HEADER_SIZE = 5;
 
 LLPluginMessagePipeOwner::LLPluginMessagePipeOwner() :
 	mMessagePipe(NULL),
@@ -121,12 +126,61 @@ bool LLPluginMessagePipe::addMessage(const std::string &message)
 {
 	// queue the message for later output
 	LLMutexLock lock(&mOutputMutex);
-	mOutput += message;
-	mOutput += MESSAGE_DELIMITER;	// message separator
+	appendMessage(mOutput, message);
 	
 	return true;
 }
 
+//static
+void LLPluginMessagePipe::appendMessage(std::string &output, const std::string &message)
+{
+	if (LLPluginMessage::isBinary(message))
+	{
+		U32 size = (U32)message.size();
+		char header[BINARY_MESSAGE_HEADER_SIZE] = { BINARY_MESSAGE_START, (char)(size >> 24), (char)(size >> 16), (char)(size >> 8), (char)size };
+		output.append(header, BINARY_MESSAGE_HEADER_SIZE);
+		output += message;
+	}
+	else
+	{
+		output += message;
+		output += MESSAGE_DELIMITER;	// message separator
+	}
+}
+
+//static
+bool LLPluginMessagePipe::extractMessage(std::string &input, std::string &message)
+{
+	if (input.empty())
+	{
+		return false;
+	}
+	if (input[0] == BINARY_MESSAGE_START)
+	{
+		if (input.size() < BINARY_MESSAGE_HEADER_SIZE)
+		{
+			return false;
+		}
+		U8 const* header = (U8 const*)input.data();
+		size_t size = ((size_t)header[1] << 24) | ((size_t)header[2] << 16) | ((size_t)header[3] << 8) | (size_t)header[4];
+		if (input.size() < BINARY_MESSAGE_HEADER_SIZE + size)
+		{
+			return false;
+		}
+		message.assign(input, BINARY_MESSAGE_HEADER_SIZE, size);
+		input.erase(0, BINARY_MESSAGE_HEADER_SIZE + size);
+		return true;
+	}
+	size_t delim = input.find(MESSAGE_DELIMITER);
+	if (delim == std::string::npos)
+	{
+		return false;
+	}
+	message.assign(input, 0, delim);
+	input.erase(0, delim + 1);
+	return true;
+}
+
 void LLPluginMessagePipe::clearOwner(void)
 {
 	// The owner is done with this pipe.  The next call to process_impl should send any remaining data and exit.
@@ -384,27 +438,22 @@ bool LLPluginMessagePipe::pumpInput(F64 timeout)
 
 void LLPluginMessagePipe::processInput(void)
 {
-	// Look for input delimiter(s) in the input buffer.
-	int delim;
+	// Look for complete messages in the input buffer.
+	std::string message;
 	mInputMutex.lock();
-	while((delim = mInput.find(MESSAGE_DELIMITER)) != std::string::npos)
+	while(mOwner && extractMessage(mInput, message))
 	{	
 		// Let the owner process this message
-		if (mOwner)
-		{
-			// Pull the message out of the input buffer before calling receiveMessageRaw.
-			// It's now possible for this function to get called recursively (in the case where the plugin makes a blocking request)
-			// and this guarantees that the messages will get dequeued correctly.
-			std::string message(mInput, 0, delim);
-			mInput.erase(0, delim + 1);
-			mInputMutex.unlock();
-			mOwner->receiveMessageRaw(message);
-			mInputMutex.lock();
-		}
-		else
-		{
-			LL_WARNS("Plugin") << "!mOwner" << LL_ENDL;
-		}
+		// The message is pulled out of the input buffer before calling receiveMessageRaw.
+		// It's now possible for this function to get called recursively (in the case where the plugin makes a blocking request)
+		// and this guarantees that the messages will get dequeued correctly.
+		mInputMutex.unlock();
+		mOwner->receiveMessageRaw(message);
+		mInputMutex.lock();
+	}
+	if (!mOwner && !mInput.empty())
+	{
+		LL_WARNS("Plugin") << "!mOwner" << LL_ENDL;
 	}
 	mInputMutex.unlock();
 }
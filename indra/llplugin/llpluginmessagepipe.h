@@ -79,6 +79,12 @@ public:
 	bool pumpInput(F64 timeout = 0.0f);
 
 	bool flushMessages(void) { return pumpOutput(true); }
+
+	// Adds message to output in the format used on the wire: XML messages end with a null byte,
+	// binary messages are preceded by their size.
+	static void appendMessage(std::string &output, const std::string &message);
+	// Moves the first complete message from input to message. Returns false if there is none yet.
+	static bool extractMessage(std::string &input, std::string &message);
 		
 protected:	
 	void processInput(void);
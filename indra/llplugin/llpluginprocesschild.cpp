@@ -45,6 +45,7 @@ LLPluginProcessChild::LLPluginProcessChild()
 	mCPUElapsed = 0.0f;
 	mBlockingRequest = false;
 	mBlockingResponseReceived = false;
+	mBinaryMessages = false;
 }
 
 LLPluginProcessChild::~LLPluginProcessChild()
@@ -131,7 +132,12 @@ void LLPluginProcessChild::idle(void)
 			break;
 			
 			case STATE_CONNECTED:
-				sendMessageToParent(LLPluginMessage(LLPLUGIN_MESSAGE_CLASS_INTERNAL, "hello"));
+				{
+					LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_INTERNAL, "hello");
+					// Let the parent know that we can handle binary messages.
+					message.setValueBoolean("binary_messages", true);
+					sendMessageToParent(message);
+				}
 				setState(STATE_PLUGIN_LOADING);
 			break;
 						
@@ -310,9 +316,9 @@ void LLPluginProcessChild::sendMessageToPlugin(const LLPluginMessage &message)
 // This function is called by SLPlugin to send 'message' to the viewer (the parent process).
 void LLPluginProcessChild::sendMessageToParent(const LLPluginMessage &message)
 {
-	std::string buffer = message.generate();
+	std::string buffer = mBinaryMessages ? message.generateBinary() : message.generate();
 
-	LL_DEBUGS("Plugin") << "Sending to parent: " << buffer << LL_ENDL;
+	LL_DEBUGS("Plugin") << "Sending to parent: " << message << LL_ENDL;
 
 	// Write the serialized message to the pipe.
 	writeMessageRaw(buffer);
@@ -328,12 +334,12 @@ void LLPluginProcessChild::receiveMessageRaw(const std::string &message)
 {
 	// Incoming message from the TCP Socket
 
-	LL_DEBUGS("Plugin") << "Received from parent: " << message << LL_ENDL;
-
 	// Decode this message
 	LLPluginMessage parsed;
 	parsed.parse(message);
 
+	LL_DEBUGS("Plugin") << "Received from parent: " << parsed << LL_ENDL;
+
 	if(mBlockingRequest)
 	{
 		// We're blocking the plugin waiting for a response.
@@ -366,6 +372,7 @@ void LLPluginProcessChild::receiveMessageRaw(const std::string &message)
 			{
 				mPluginFile = parsed.getValue("file");
 				mPluginDir = parsed.getValue("dir");
+				mBinaryMessages = parsed.hasValue("binary_messages") && parsed.getValueBoolean("binary_messages");
 			}
 			else if(message_name == "shm_add")
 			{
@@ -454,7 +461,8 @@ void LLPluginProcessChild::receiveMessageRaw(const std::string &message)
 	{
 		LLTimer elapsed;
 
-		mInstance->sendMessage(message);
+		// The plugin itself only understands XML.
+		mInstance->sendMessage(LLPluginMessage::isBinary(message) ? parsed.generate() : message);
 
 		mCPUElapsed += elapsed.getElapsedTimeF64();
 	}
@@ -486,12 +494,12 @@ void LLPluginProcessChild::receivePluginMessage(const std::string &message)
 
 	// FIXME: how should we handle queueing here?
 	
+	// Decode this message
+	LLPluginMessage parsed;
+	parsed.parse(message);
+
 	// Intercept certain base messages (responses to ones sent by this class)
 	{
-		// Decode this message
-		LLPluginMessage parsed;
-		parsed.parse(message);
-		
 		if(parsed.hasValue("blocking_request"))
 		{
 			mBlockingRequest = true;
@@ -573,7 +581,8 @@ void LLPluginProcessChild::receivePluginMessage(const std::string &message)
 	if(passMessage)
 	{
 		LL_DEBUGS("Plugin") << "Passing through to parent: " << message << LL_ENDL;
-		writeMessageRaw(message);
+		// The plugin itself always sends XML.
+		writeMessageRaw(mBinaryMessages ? parsed.generateBinary() : message);
 	}
 	
 	while(mBlockingRequest)
@@ -45,6 +45,7 @@ LLPluginProcessParentOwner::~LLPluginProcessParentOwner()
 }
 
 bool LLPluginProcessParent::sUseReadThread = false;
+bool LLPluginProcessParent::sUseBinaryMessages = true;
 apr_pollset_t *LLPluginProcessParent::sPollSet = NULL;
 LLAPRPool LLPluginProcessParent::sPollSetPool;
 bool LLPluginProcessParent::sPollsetNeedsRebuild = false;
@@ -99,6 +100,7 @@ LLPluginProcessParent::LLPluginProcessParent(LLPluginProcessParentOwner *owner)
 	mBlocked = false;
 	mPolledInput = false;
 	mReceivedShutdown = false;
+	mBinaryMessages = false;
 	mPollFD.client_data = NULL;
 	mPollFDPool.create();
 
@@ -495,6 +497,11 @@ void LLPluginProcessParent::idle(void)
 					LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_INTERNAL, "load_plugin");
 					message.setValue("file", mPluginFile);
 					message.setValue("dir", mPluginDir);
+					if(mBinaryMessages)
+					{
+						// Tell the plugin process to answer in binary too.
+						message.setValueBoolean("binary_messages", true);
+					}
 					sendMessage(message);
 				}
 
@@ -629,15 +636,15 @@ void LLPluginProcessParent::sendMessage(const LLPluginMessage &message)
 		mBlocked = true;
 	}
 	
-	std::string buffer = message.generate();
+	std::string buffer = mBinaryMessages ? message.generateBinary() : message.generate();
 #if LL_DEBUG
 	if (message.getName() == "mouse_event")
 	{
-		LL_DEBUGS("PluginMouseEvent") << "Sending: " << buffer << LL_ENDL;
+		LL_DEBUGS("PluginMouseEvent") << "Sending: " << message << LL_ENDL;
 	}
 	else
 	{
-		LL_DEBUGS("Plugin") << "Sending: " << buffer << LL_ENDL;
+		LL_DEBUGS("Plugin") << "Sending: " << message << LL_ENDL;
 	}
 #endif
 	writeMessageRaw(buffer);
@@ -917,11 +924,11 @@ void LLPluginProcessParent::servicePoll()
 // It parses the message and passes it on to LLPluginProcessParent::receiveMessage.
 void LLPluginProcessParent::receiveMessageRaw(const std::string &message)
 {
-	LL_DEBUGS("PluginRaw") << "Received: " << message << LL_ENDL;
-	
 	LLPluginMessage parsed;
 	if(parsed.parse(message) != -1)
 	{
+		LL_DEBUGS("PluginRaw") << "Received: " << parsed << LL_ENDL;
+
 		if(parsed.hasValue("blocking_request"))
 		{
 			mBlocked = true;
@@ -993,6 +1000,9 @@ void LLPluginProcessParent::receiveMessage(const LLPluginMessage &message)
 			if(mState == STATE_CONNECTED)
 			{
 				// Plugin host has launched.  Tell it which plugin to load.
+				// Older plugin hosts only understand XML messages.
+				mBinaryMessages = sUseBinaryMessages && message.hasValue("binary_messages") && message.getValueBoolean("binary_messages");
+				LL_DEBUGS("Plugin") << "binary messages: " << mBinaryMessages << LL_ENDL;
 				setState(STATE_HELLO);
 			}
 			else
@@ -125,6 +125,8 @@ public:
 	static bool canPollThreadRun() { return (sPollSet || sPollsetNeedsRebuild || sUseReadThread); };
 	static void setUseReadThread(bool use_read_thread);
 	static bool getUseReadThread() { return sUseReadThread; };
+	// Use binary LLSD instead of XML for messages to and from plugin processes that support it.
+	static void setUseBinaryMessages(bool use_binary_messages) { sUseBinaryMessages = use_binary_messages; };
 private:
 
 	enum EState
@@ -179,6 +181,7 @@ private:
 	bool mBlocked;
 	bool mPolledInput;
 	bool mReceivedShutdown;
+	bool mBinaryMessages;			// The plugin process accepts binary messages.
 
 	LLProcessLauncher mDebugger;
 	
@@ -186,6 +189,7 @@ private:
 	F32 mPluginLockupTimeout;		// If we don't receive a heartbeat in this many seconds, we declare the plugin locked up.
 
 	static bool sUseReadThread;
+	static bool sUseBinaryMessages;
 	apr_pollfd_t mPollFD;
 	LLAPRPool mPollFDPool;
 	static apr_pollset_t *sPollSet;
@@ -53,6 +53,7 @@ LLFontManager *gFontManagerp = NULL;
 FT_Library gFTLibrary = NULL;
 
 bool LLFontFreetype::sOpenGLcrashOnRestart = false;
+U32 LLFontFreetype::sLastGlyphGeneration = 0;
 
 //static
 void LLFontManager::initClass()
@@ -114,6 +115,7 @@ LLFontFreetype::LLFontFreetype()
 	mAddGlyphCount(0),
 	mPointSize(0)
 {
+	newGlyphGeneration();
 }
 
 
@@ -462,6 +464,7 @@ void LLFontFreetype::insertGlyphInfo(llwchar wch, LLFontGlyphInfo* gi) const
 	{
 		delete iter->second;
 		iter->second = gi;
+		newGlyphGeneration();
 	}
 	else
 	{
@@ -469,6 +472,11 @@ void LLFontFreetype::insertGlyphInfo(llwchar wch, LLFontGlyphInfo* gi) const
 	}
 }
 
+void LLFontFreetype::newGlyphGeneration() const
+{
+	mGlyphGeneration = ++sLastGlyphGeneration;
+}
+
 void LLFontFreetype::renderGlyph(const U32 glyph_index) const
 {
 	if (mFTFace == NULL)
@@ -509,6 +517,7 @@ void LLFontFreetype::resetBitmapCache()
 {
 	for_each(mCharGlyphInfoMap.begin(), mCharGlyphInfoMap.end(), DeletePairedPointer());
 	mCharGlyphInfoMap.clear();
+	newGlyphGeneration();
 	
 	mFontBitmapCachep->reset();
 
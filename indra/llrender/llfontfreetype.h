@@ -133,6 +133,10 @@ public:
 	F32 getXKerning(const LLFontGlyphInfo* left_glyph_info, const LLFontGlyphInfo* right_glyph_info) const; // Get the kerning between the two characters
 	LLFontGlyphInfo* getGlyphInfo(const llwchar wch) const;
 
+	// Changes whenever glyph infos of this font are deleted, so that the
+	// glyph runs cached for it are not used any more.
+	U32 getGlyphGeneration() const { return mGlyphGeneration; }
+
 	void reset(F32 vert_dpi, F32 horz_dpi);
 
 	void destroyGL();
@@ -151,6 +155,7 @@ private:
 	LLFontGlyphInfo* addGlyphFromFont(const LLFontFreetype *fontp, llwchar wch, U32 glyph_index) const;	// Add a glyph from this font to the other (returns the glyph_index, 0 if not found)
 	void renderGlyph(U32 glyph_index) const;
 	void insertGlyphInfo(llwchar wch, LLFontGlyphInfo* gi) const;
+	void newGlyphGeneration() const;
 
 	std::string mName;
 
@@ -173,6 +178,11 @@ private:
 
 	mutable S32 mRenderGlyphCount;
 	mutable S32 mAddGlyphCount;
+
+	// Unique over all fonts, so that a font allocated where a deleted one
+	// was doesn't find its runs.
+	mutable U32 mGlyphGeneration;
+	static U32 sLastGlyphGeneration;
 };
 
 #endif // LL_FONTFREETYPE_H
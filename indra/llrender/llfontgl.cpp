@@ -33,6 +33,7 @@
 // Linden library includes
 #include "llfontfreetype.h"
 #include "llfontbitmapcache.h"
+#include "llfontglyphruncache.h"
 #include "llfontregistry.h"
 #include "llgl.h"
 #include "llrender.h"
@@ -268,6 +269,13 @@ S32 LLFontGL::render(const LLWString &wstr, S32 begin_offset, F32 x, F32 y, cons
 
 	const LLFontGlyphInfo* next_glyph = NULL;
 
+	// Embedded characters are looked up as they are drawn.
+	const LLFontGlyphRun* run = NULL;
+	if (!use_embedded || mEmbeddedChars.empty())
+	{
+		run = LLFontGlyphRunCache::getRun(mFontFreetype, wstr.c_str() + begin_offset, length);
+	}
+
 	const S32 GLYPH_BATCH_SIZE = 30;
 	static LL_ALIGN_16(LLVector4a vertices[GLYPH_BATCH_SIZE * 4]);
 	static LLVector2 uvs[GLYPH_BATCH_SIZE * 4];
@@ -355,7 +363,11 @@ S32 LLFontGL::render(const LLWString &wstr, S32 begin_offset, F32 x, F32 y, cons
 		{
 			const LLFontGlyphInfo* fgi = next_glyph;
 			next_glyph = NULL;
-			if(!fgi)
+			if (run)
+			{
+				fgi = run->mGlyphs[i - begin_offset];
+			}
+			else if(!fgi)
 			{
 				fgi = mFontFreetype->getGlyphInfo(wch);
 			}
@@ -421,7 +433,11 @@ S32 LLFontGL::render(const LLWString &wstr, S32 begin_offset, F32 x, F32 y, cons
 			cur_y += fgi->mYAdvance;
 
 			llwchar next_char = wstr[i+1];
-			if (next_char && (next_char < LAST_CHARACTER))
+			if (run && i + 1 < begin_offset + length)
+			{
+				cur_x += run->mKerning[i - begin_offset];
+			}
+			else if (next_char && (next_char < LAST_CHARACTER))
 			{
 				// Kern this puppy.
 				next_glyph = mFontFreetype->getGlyphInfo(next_char);
@@ -568,6 +584,21 @@ F32 LLFontGL::getWidthF32(const std::string& utf8text, const S32 begin_offset, c
 
 F32 LLFontGL::getWidthF32(const llwchar* wchars, const S32 begin_offset, const S32 max_chars, BOOL use_embedded) const
 {
+	if (!use_embedded || mEmbeddedChars.empty())
+	{
+		// Most strings are measured again every frame, so their widths are cached.
+		S32 count = 0;
+		while (count < max_chars && count <= LLFontGlyphRunCache::MAX_RUN_LENGTH && wchars[begin_offset + count])
+		{
+			count++;
+		}
+		const LLFontGlyphRun* run = LLFontGlyphRunCache::getRun(mFontFreetype, wchars + begin_offset, count);
+		if (run)
+		{
+			return run->mWidth / sScaleX;
+		}
+	}
+
 	const S32 LAST_CHARACTER = LLFontFreetype::LAST_CHAR_FULL;
 
 	F32 cur_x = 0;
@@ -1038,6 +1069,9 @@ bool LLFontGL::loadDefaultFonts()
 // static
 void LLFontGL::destroyDefaultFonts()
 {
+	LLFontGlyphRunCache::logStats();
+	LLFontGlyphRunCache::clear();
+
 	// Remove the actual fonts.
 	delete sFontRegistry;
 	sFontRegistry = NULL;
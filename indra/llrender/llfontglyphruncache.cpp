@@ -0,0 +1,178 @@
+/** 
+ * @file llfontglyphruncache.cpp
+ * @brief Cache of the glyphs, advances and kerning of recently drawn strings.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llfontglyphruncache.h"
+
+#include "llfontfreetype.h"
+
+#include <boost/functional/hash.hpp>
+
+// static
+LLFontGlyphRunCache::run_list_t LLFontGlyphRunCache::sRuns;
+LLFontGlyphRunCache::run_map_t LLFontGlyphRunCache::sRunMap;
+U32 LLFontGlyphRunCache::sHits = 0;
+U32 LLFontGlyphRunCache::sMisses = 0;
+U32 LLFontGlyphRunCache::sEvictions = 0;
+
+// static
+const LLFontGlyphRun* LLFontGlyphRunCache::getRun(const LLFontFreetype* font, const llwchar* text, S32 count)
+{
+	if (count <= 0 || count > MAX_RUN_LENGTH)
+	{
+		return NULL;
+	}
+
+	U32 generation = font->getGlyphGeneration();
+	size_t hash = boost::hash_range(text, text + count);
+	boost::hash_combine(hash, font);
+	boost::hash_combine(hash, generation);
+
+	run_map_t::iterator found = sRunMap.find(hash);
+	if (found != sRunMap.end())
+	{
+		run_list_t::iterator iter = found->second;
+		if (iter->mFont == font
+			&& iter->mGlyphGeneration == generation
+			&& iter->mText.size() == (size_t)count
+			&& !memcmp(iter->mText.data(), text, count * sizeof(llwchar)))
+		{
+			++sHits;
+			sRuns.splice(sRuns.begin(), sRuns, iter);
+			return &*iter;
+		}
+
+		// Another string with the same hash; this one takes its place.
+		sRuns.erase(iter);
+		sRunMap.erase(found);
+	}
+
+	++sMisses;
+
+	sRuns.push_front(LLFontGlyphRun());
+	LLFontGlyphRun& run = sRuns.front();
+	if (!buildRun(run, font, text, count))
+	{
+		sRuns.pop_front();
+		return NULL;
+	}
+	run.mHash = hash;
+	sRunMap[hash] = sRuns.begin();
+
+	if (sRunMap.size() > MAX_RUNS)
+	{
+		++sEvictions;
+		sRunMap.erase(sRuns.back().mHash);
+		sRuns.pop_back();
+	}
+
+	return &sRuns.front();
+}
+
+// static
+bool LLFontGlyphRunCache::buildRun(LLFontGlyphRun& run, const LLFontFreetype* font, const llwchar* text, S32 count)
+{
+	const llwchar LAST_CHARACTER = LLFontFreetype::LAST_CHAR_FULL;
+
+	run.mFont = font;
+	run.mGlyphGeneration = font->getGlyphGeneration();
+	run.mText.assign(text, count);
+	run.mGlyphs.resize(count);
+	run.mAdvances.resize(count);
+	run.mKerning.assign(count, 0.f);
+
+	for (S32 i = 0; i < count; ++i)
+	{
+		if (!text[i])
+		{
+			return false;
+		}
+		const LLFontGlyphInfo* fgi = font->getGlyphInfo(text[i]);
+		if (!fgi)
+		{
+			return false;
+		}
+		run.mGlyphs[i] = fgi;
+		run.mAdvances[i] = font->getXAdvance(fgi);
+	}
+
+	if (font->getGlyphGeneration() != run.mGlyphGeneration)
+	{
+		// Adding the glyphs replaced some glyph infos.
+		return false;
+	}
+
+	// Same sums as LLFontGL::getWidthF32(), so that the width is the same.
+	F32 cur_x = 0.f;
+	F32 width_padding = 0.f;
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLFontGlyphInfo* fgi = run.mGlyphs[i];
+		F32 advance = run.mAdvances[i];
+		width_padding = llmax(0.f, width_padding - advance, (F32)(fgi->mWidth + fgi->mXBearing) - advance);
+
+		cur_x += advance;
+		if (i + 1 < count && text[i + 1] < LAST_CHARACTER)
+		{
+			run.mKerning[i] = font->getXKerning(fgi, run.mGlyphs[i + 1]);
+			cur_x += run.mKerning[i];
+		}
+		cur_x = (F32)llround(cur_x);
+	}
+	run.mWidth = cur_x + width_padding;
+
+	return true;
+}
+
+// static
+void LLFontGlyphRunCache::clear()
+{
+	sRunMap.clear();
+	sRuns.clear();
+}
+
+// static
+void LLFontGlyphRunCache::resetStats()
+{
+	sHits = 0;
+	sMisses = 0;
+	sEvictions = 0;
+}
+
+// static
+void LLFontGlyphRunCache::logStats()
+{
+	U32 lookups = sHits + sMisses;
+	llinfos << "Glyph runs: " << sRunMap.size() << " cached, " << sHits << " hits, " << sMisses << " misses ("
+			<< (lookups ? sHits * 100.f / lookups : 0.f) << "% hits), " << sEvictions << " evictions" << llendl;
+}
@@ -0,0 +1,98 @@
+/** 
+ * @file llfontglyphruncache.h
+ * @brief Cache of the glyphs, advances and kerning of recently drawn strings.
+ *
+ * $LicenseInfo:firstyear=2009&license=viewergpl$
+ * 
+ * Copyright (c) 2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFONTGLYPHRUNCACHE_H
+#define LL_LLFONTGLYPHRUNCACHE_H
+
+#include <list>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#include "llstring.h"
+
+class LLFontFreetype;
+struct LLFontGlyphInfo;
+
+// The glyphs of a string in one font, with what LLFontGL needs to lay them
+// out, so that the same labels, name tags and chat lines drawn every frame
+// don't look up every glyph and ask FreeType for the kerning of every pair.
+struct LLFontGlyphRun
+{
+	const LLFontFreetype* mFont;
+	U32 mGlyphGeneration;
+	size_t mHash;
+	LLWString mText;
+
+	std::vector<const LLFontGlyphInfo*> mGlyphs;
+	std::vector<F32> mAdvances;
+	// Kerning between each glyph and the next one of the run, 0 after the last.
+	std::vector<F32> mKerning;
+	// Unscaled width, as LLFontGL::getWidthF32() measures it.
+	F32 mWidth;
+};
+
+// Least recently used runs of glyphs, shared by all fonts.
+class LLFontGlyphRunCache
+{
+public:
+	// Longer strings, such as whole notecards, are not cached.
+	static const S32 MAX_RUN_LENGTH = 256;
+	static const U32 MAX_RUNS = 2048;
+
+	// Returns the run of glyphs for count characters of text, or NULL if the
+	// text can't be cached (too long, or a NUL or missing glyph in it).
+	// The run is only valid until the next call.
+	static const LLFontGlyphRun* getRun(const LLFontFreetype* font, const llwchar* text, S32 count);
+
+	static void clear();
+
+	static U32 getHits() { return sHits; }
+	static U32 getMisses() { return sMisses; }
+	static U32 getEvictions() { return sEvictions; }
+	static void resetStats();
+	static void logStats();
+
+private:
+	static bool buildRun(LLFontGlyphRun& run, const LLFontFreetype* font, const llwchar* text, S32 count);
+
+	// Most recently used first
+	typedef std::list<LLFontGlyphRun> run_list_t;
+	static run_list_t sRuns;
+	typedef boost::unordered_map<size_t, run_list_t::iterator> run_map_t;
+	static run_map_t sRunMap;
+
+	static U32 sHits;
+	static U32 sMisses;
+	static U32 sEvictions;
+};
+
+#endif // LL_LLFONTGLYPHRUNCACHE_H
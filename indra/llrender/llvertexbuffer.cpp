@@ -79,6 +79,12 @@ U32 vbo_block_index(U32 size)
 
 const U32 LL_VBO_POOL_SEED_COUNT = vbo_block_index(LL_VBO_POOL_MAX_SEED_SIZE);
 
+//client side blocks of up to LL_VBO_SLAB_MAX_CLASS blocks are carved out of slabs of LL_VBO_SLAB_SIZE bytes
+const U32 LL_VBO_SLAB_SIZE = 128*1024;
+const U32 LL_VBO_SLAB_MAX_CLASS = 8;
+//free client side blocks of the larger classes kept for reuse
+const U32 LL_VBO_CLIENT_MAX_FREE_BYTES = 16*1024*1024;
+
 
 //============================================================================
 
@@ -91,6 +97,11 @@ LLVBOPool LLVertexBuffer::sDynamicIBOPool(GL_DYNAMIC_DRAW_ARB, GL_ELEMENT_ARRAY_
 U32 LLVBOPool::sBytesPooled = 0;
 U32 LLVBOPool::sIndexBytesPooled = 0;
 
+U32 LLVBOClientPool::sBytesFree = 0;
+U32 LLVBOClientPool::sSlabBytes = 0;
+LLMutex LLVBOClientPool::sMutex;
+std::vector<LLVBOClientPool::SizeClass> LLVBOClientPool::sClasses(LL_VBO_POOL_SEED_COUNT);
+
 std::list<U32> LLVertexBuffer::sAvailableVAOName;
 U32 LLVertexBuffer::sCurVAOName = 1;
 
@@ -119,6 +130,122 @@ bool LLVertexBuffer::sUseVAO = false;
 bool LLVertexBuffer::sPreferStreamDraw = false;
 
 
+//static
+volatile U8* LLVBOClientPool::allocate(U32 size)
+{
+	llassert(vbo_block_size(size) == size);
+
+	U32 i = vbo_block_index(size);
+
+	if (i == 0 || i >= LL_VBO_POOL_SEED_COUNT)
+	{
+		return (U8*) ll_aligned_malloc(size, 64);
+	}
+
+	LLMutexLock lock(&sMutex);
+
+	SizeClass& c = sClasses[i];
+
+	if (c.mFree.empty())
+	{
+		if (i > LL_VBO_SLAB_MAX_CLASS)
+		{
+			c.mInUse++;
+			return (U8*) ll_aligned_malloc(size, 64);
+		}
+
+		//carve a new slab into blocks, in reverse so that they are handed out in address order
+		U8* slab = (U8*) ll_aligned_malloc(LL_VBO_SLAB_SIZE, 64);
+		c.mSlabs.push_back(slab);
+		sSlabBytes += LL_VBO_SLAB_SIZE;
+
+		U32 count = LL_VBO_SLAB_SIZE / size;
+		for (U32 j = count; j > 0; --j)
+		{
+			c.mFree.push_back(slab + (j-1)*size);
+		}
+		sBytesFree += count*size;
+	}
+
+	U8* ret = c.mFree.back();
+	c.mFree.pop_back();
+	c.mInUse++;
+	sBytesFree -= size;
+
+	return ret;
+}
+
+//static
+void LLVBOClientPool::release(volatile U8* buffer, U32 size)
+{
+	if (!buffer)
+	{
+		return;
+	}
+
+	llassert(vbo_block_size(size) == size);
+
+	U32 i = vbo_block_index(size);
+
+	if (i == 0 || i >= LL_VBO_POOL_SEED_COUNT)
+	{
+		ll_aligned_free((U8*) buffer);
+		return;
+	}
+
+	LLMutexLock lock(&sMutex);
+
+	SizeClass& c = sClasses[i];
+	llassert(c.mInUse > 0);
+	c.mInUse--;
+
+	if (i <= LL_VBO_SLAB_MAX_CLASS || sBytesFree + size <= LL_VBO_CLIENT_MAX_FREE_BYTES)
+	{
+		c.mFree.push_back((U8*) buffer);
+		sBytesFree += size;
+	}
+	else
+	{
+		ll_aligned_free((U8*) buffer);
+	}
+}
+
+//static
+void LLVBOClientPool::cleanup()
+{
+	LLMutexLock lock(&sMutex);
+
+	U32 size = 0;
+
+	for (U32 i = 0; i < sClasses.size(); ++i)
+	{
+		SizeClass& c = sClasses[i];
+
+		if (i > LL_VBO_SLAB_MAX_CLASS)
+		{
+			for (U32 j = 0; j < c.mFree.size(); ++j)
+			{
+				ll_aligned_free(c.mFree[j]);
+			}
+			sBytesFree -= c.mFree.size()*size;
+			c.mFree.clear();
+		}
+		else if (c.mInUse == 0)
+		{ //blocks in use would point into the slabs
+			for (U32 j = 0; j < c.mSlabs.size(); ++j)
+			{
+				ll_aligned_free(c.mSlabs[j]);
+			}
+			sSlabBytes -= c.mSlabs.size()*LL_VBO_SLAB_SIZE;
+			sBytesFree -= c.mFree.size()*size;
+			c.mSlabs.clear();
+			c.mFree.clear();
+		}
+
+		size += LL_VBO_BLOCK_SIZE;
+	}
+}
+
 U32 LLVBOPool::genBuffer()
 {
 	U32 ret = 0;
@@ -144,7 +271,7 @@ void LLVBOPool::deleteBuffer(U32 name)
 
 
 LLVBOPool::LLVBOPool(U32 vboUsage, U32 vboType)
-: mUsage(vboUsage), mType(vboType)
+: mUsage(vboUsage), mType(vboType), mReleasedBytes(0)
 {
 	mMissCount.resize(LL_VBO_POOL_SEED_COUNT);
 	std::fill(mMissCount.begin(), mMissCount.end(), 0);
@@ -187,7 +314,7 @@ volatile U8* LLVBOPool::allocate(U32& name, U32 size, bool for_seed)
 		if (LLVertexBuffer::sDisableVBOMapping || mUsage != GL_DYNAMIC_DRAW_ARB)
 		{
 			glBufferDataARB(mType, size, 0, mUsage);
-			ret = (U8*) ll_aligned_malloc(size, 64);
+			ret = LLVBOClientPool::allocate(size);
 		}
 		else
 		{ //always use a true hint of static draw when allocating non-client-backed buffers
@@ -239,16 +366,49 @@ void LLVBOPool::release(U32 name, volatile U8* buffer, U32 size)
 {
 	llassert(vbo_block_size(size) == size);
 
-	deleteBuffer(name);
-	ll_aligned_free((U8*) buffer);
+	LLVBOClientPool::release(buffer, size);
+
+	LLMutexLock lock(&mReleasedMutex);
+	mReleasedNames.push_back(name);
+	mReleasedBytes += size;
+}
+
+void LLVBOPool::deleteReleasedBuffers()
+{
+	U32 bytes;
+	{
+		LLMutexLock lock(&mReleasedMutex);
+		if (mReleasedNames.empty())
+		{
+			return;
+		}
+		mDeletedNames.swap(mReleasedNames);
+		bytes = mReleasedBytes;
+		mReleasedBytes = 0;
+	}
+
+	if (gGLManager.mInited)
+	{
+		LLVertexBuffer::unbind();
+
+		for (U32 i = 0; i < mDeletedNames.size(); ++i)
+		{
+			glBindBufferARB(mType, mDeletedNames[i]);
+			glBufferDataARB(mType, 0, NULL, mUsage);
+		}
+		glBindBufferARB(mType, 0);
+
+		glDeleteBuffersARB(mDeletedNames.size(), &mDeletedNames[0]);
+	}
+	mDeletedNames.clear();
 
 	if (mType == GL_ARRAY_BUFFER_ARB)
 	{
-		LLVertexBuffer::sAllocatedBytes -= size;
+		LLVertexBuffer::sAllocatedBytes -= bytes;
 	}
 	else
 	{
-		LLVertexBuffer::sAllocatedIndexBytes -= size;
+		LLVertexBuffer::sAllocatedIndexBytes -= bytes;
 	}
 }
 
@@ -256,6 +416,8 @@ void LLVBOPool::seedPool()
 {
 	U32 dummy_name = 0;
 
+	deleteReleasedBuffers();
+
 	if (mFreeList.size() < LL_VBO_POOL_SEED_COUNT)
 	{
 		mFreeList.resize(LL_VBO_POOL_SEED_COUNT);
@@ -280,10 +442,12 @@ void LLVBOPool::seedPool()
 
 void LLVBOPool::cleanup()
 {
-	U32 size = LL_VBO_BLOCK_SIZE;
+	deleteReleasedBuffers();
 
 	for (U32 i = 0; i < mFreeList.size(); ++i)
 	{
+		//mFreeList[i] holds buffers of i blocks
+		U32 size = i*LL_VBO_BLOCK_SIZE;
 		record_list_t& l = mFreeList[i];
 
 		while (!l.empty())
@@ -292,10 +456,7 @@ void LLVBOPool::cleanup()
 
 			deleteBuffer(r.mGLName);
 			
-			if (r.mClientData)
-			{
-				ll_aligned_free((void*) r.mClientData);
-			}
+			LLVBOClientPool::release(r.mClientData, size);
 
 			l.pop_front();
 
@@ -310,8 +471,6 @@ void LLVBOPool::cleanup()
 				LLVertexBuffer::sAllocatedIndexBytes -= size;
 			}
 		}
-
-		size += LL_VBO_BLOCK_SIZE;
 	}
 
 	//reset miss counts
@@ -882,6 +1041,7 @@ void LLVertexBuffer::cleanupClass()
 	sDynamicIBOPool.cleanup();
 	sStreamVBOPool.cleanup();
 	sDynamicVBOPool.cleanup();
+	LLVBOClientPool::cleanup();
 
 	if(sPrivatePoolp)
 	{
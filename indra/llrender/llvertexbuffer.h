@@ -34,6 +34,7 @@
 #include "v4coloru.h"
 #include "llstrider.h"
 #include "llrender.h"
+#include "llthread.h"
 #include <set>
 #include <vector>
 #include <list>
@@ -49,6 +50,42 @@
 //  called from the main (i.e OpenGL) thread)
 
 
+//============================================================================
+// Size class allocator for the client side copies of buffers. Sizes are a
+// multiple of the VBO block size, the multiple being the size class. Blocks
+// of the small classes are carved out of slabs that are kept for reuse, the
+// larger ones are kept on a free list of their class up to a limit and are
+// returned to the system beyond that. Blocks larger than the largest seeded
+// VBO are not pooled. Thread safe.
+class LLVBOClientPool
+{
+public:
+	//size MUST be a multiple of the VBO block size
+	static volatile U8* allocate(U32 size);
+
+	//size MUST be the size provided to allocate that returned buffer, buffer may be NULL
+	static void release(volatile U8* buffer, U32 size);
+
+	//free the blocks on the free lists, and the slabs of classes that have no block in use
+	static void cleanup();
+
+	static U32 sBytesFree;		//bytes in free blocks, including those in slabs
+	static U32 sSlabBytes;		//bytes in slabs
+
+private:
+	struct SizeClass
+	{
+		SizeClass() : mInUse(0) { }
+
+		std::vector<U8*> mFree;
+		std::vector<U8*> mSlabs;
+		U32 mInUse;
+	};
+
+	static LLMutex sMutex;		//protects all of the below and the statistics
+	static std::vector<SizeClass> sClasses;
+};
+
 //============================================================================
 // gl name pools for dynamic and streaming buffers
 class LLVBOPool
@@ -66,6 +103,7 @@ public:
 	volatile U8* allocate(U32& name, U32 size, bool for_seed = false);
 	
 	//size MUST be the size provided to allocate that returned the given name
+	//may be called from any thread, the name is deleted by the next call to deleteReleasedBuffers()
 	void release(U32 name, volatile U8* buffer, U32 size);
 	
 	//batch allocate buffers to be provided to the application on demand
@@ -77,6 +115,9 @@ public:
 	U32 genBuffer();
 	void deleteBuffer(U32 name);
 
+	//delete the names released since the last call with one call to GL
+	void deleteReleasedBuffers();
+
 	class Record
 	{
 	public:
@@ -88,6 +129,11 @@ public:
 	std::vector<record_list_t> mFreeList;
 	std::vector<U32> mMissCount;
 
+private:
+	LLMutex mReleasedMutex;				//protects mReleasedNames and mReleasedBytes
+	std::vector<U32> mReleasedNames;
+	U32 mReleasedBytes;
+	std::vector<U32> mDeletedNames;		//main thread only, swapped with mReleasedNames
 };
 
 
@@ -293,6 +293,7 @@ LLTextEditor::LLTextEditor(
 	mLastContextMenuX(-1),
 	mLastContextMenuY(-1),
 	mReflowNeeded(FALSE),
+	mReflowStartPos(0),
 	mScrollNeeded(FALSE),
 	mSpellCheckable(FALSE)
 {
@@ -509,6 +510,20 @@ void LLTextEditor::updateLineStartList(S32 startpos)
 	S32 seg_idx = 0;
 	S32 seg_offset = 0;
 
+	if (mKeywords.isLoaded() || mAllowEmbeddedItems)
+	{
+		// updateSegments() built the segments again, so the segment
+		// indices of the lines before startpos may have changed too.
+		startpos = 0;
+	}
+	else if (startpos > 0)
+	{
+		// Wrapping starts over after every newline, so the lines before the
+		// paragraph containing startpos stay the same.
+		size_t newline = mWText.rfind('\n', llmin(startpos, getLength()) - 1);
+		startpos = (newline == LLWString::npos) ? 0 : (S32)newline + 1;
+	}
+
 	if (!mLineStartList.empty())
 	{
 		getSegmentAndOffset(startpos, &seg_idx, &seg_offset);
@@ -600,6 +615,16 @@ void LLTextEditor::updateLineStartList(S32 startpos)
 	}
 }
 
+void LLTextEditor::reflow()
+{
+	if (mReflowNeeded)
+	{
+		updateLineStartList(mReflowStartPos);
+		mReflowNeeded = FALSE;
+		mReflowStartPos = 0;
+	}
+}
+
 ////////////////////////////////////////////////////////////
 // LLTextEditor
 // Public methods
@@ -2683,12 +2708,17 @@ BOOL LLTextEditor::handleUnicodeCharHere(llwchar uni_char)
 
 	if ( gFocusMgr.getKeyboardFocus() == this )
 	{
+		// The text before the selection or cursor doesn't change, except
+		// for the spaces taken out before a close brace.
+		S32 edit_pos = hasSelection() ? llmin(mSelectionStart, mSelectionEnd) : mCursorPos;
+
 		// Handle most keys only if the text editor is writeable.
 		if( !mReadOnly )
 		{
 			if( '}' == uni_char )
 			{
 				unindentLineBeforeCloseBrace();
+				edit_pos = llmax(0, edit_pos - SPACES_PER_TAB);
 			}
 
 			// TODO: KLW Add auto show of tool tip on (
@@ -2707,7 +2737,7 @@ BOOL LLTextEditor::handleUnicodeCharHere(llwchar uni_char)
 			// Most keystrokes will make the selection box go away, but not all will.
 			deselect();
 
-			needsReflow();
+			needsReflow(edit_pos);
 			onKeyStroke();
 		}
 	}
@@ -2766,7 +2796,8 @@ void LLTextEditor::doDelete()
 		}
 	}
 
-	needsReflow();
+	// Nothing before the cursor was deleted.
+	needsReflow(mCursorPos);
 	onKeyStroke();
 }
 
@@ -3630,11 +3661,7 @@ void LLTextEditor::drawClippedSegment(const LLWString &text, S32 seg_start, S32
 void LLTextEditor::draw()
 {
 	// do on-demand reflow 
-	if (mReflowNeeded)
-	{
-		updateLineStartList();
-		mReflowNeeded = FALSE;
-	}
+	reflow();
 
 	// then update scroll position, as cursor may have moved
 	if (mScrollNeeded)
@@ -4203,7 +4230,9 @@ void LLTextEditor::appendText(const std::string &new_text, bool allow_undo, bool
 		mSegments.push_back(segment);
 	}
 	
-	needsReflow();
+	// Only the lines from the end of the old text need to be wrapped,
+	// rather than the whole history on every new chat line.
+	needsReflow(old_length);
 	
 	// Set the cursor and scroll position
 	// Maintain the scroll position unless the scroll was at the end of the doc (in which 
@@ -4258,9 +4287,9 @@ void LLTextEditor::removeTextFromEnd(S32 num_chars)
 
 	pruneSegments();
 	
-	// pruneSegments will invalidate mLineStartList.
-	updateLineStartList();
-	needsScroll();
+	// pruneSegments only invalidates the lines from the new end of the text.
+	needsReflow(len);
+	reflow();
 }
 
 ///////////////////////////////////////////////////////////////////
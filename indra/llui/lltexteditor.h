@@ -306,6 +306,8 @@ protected:
 	void			drawPreeditMarker();
 public:
 	void			updateLineStartList(S32 startpos = 0);
+	// Does any pending reflow now rather than at the next draw.
+	void			reflow();
 protected:
 	void			updateScrollFromCursor();
 	void			updateTextRect();
@@ -493,8 +495,10 @@ private:
 	void			drawText();
 	void			drawClippedSegment(const LLWString &wtext, S32 seg_start, S32 seg_end, F32 x, F32 y, S32 selection_left, S32 selection_right, const LLStyleSP& color, F32* right_x);
 
-	void			needsReflow() 
+	// Only the paragraphs from the one containing startpos on need to be wrapped again.
+	void			needsReflow(S32 startpos = 0)
 	{ 
+		mReflowStartPos = mReflowNeeded ? llmin(mReflowStartPos, startpos) : startpos;
 		mReflowNeeded = TRUE; 
 		// cursor might have moved, need to scroll
 		mScrollNeeded = TRUE;
@@ -567,6 +571,7 @@ private:
 
 	line_list_t mLineStartList;
 	BOOL			mReflowNeeded;
+	S32				mReflowStartPos;
 	BOOL			mScrollNeeded;
 
 	LLFrameTimer	mKeystrokeTimer;
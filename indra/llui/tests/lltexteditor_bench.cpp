@@ -0,0 +1,195 @@
+/**
+ * @file lltexteditor_bench.cpp
+ * @brief Times appending styled lines to a word wrapped text editor.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ *
+ * Copyright (c) 2001-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Usage: lltexteditor_bench <indra/newview directory> [lines]
+//
+// Appends lines of chat (a styled name and a styled message, some long enough
+// to wrap) to a word wrapped editor, without a window or GL, reflowing after
+// every line as the next frame would. The fonts come from the newview
+// directory. Prints the time of each append with the reflow, and the time
+// every append took before, when each reflow wrapped the whole history again.
+// The lines wrapped after the appends must be the same as after wrapping the
+// whole history.
+
+#include "linden_common.h"
+
+#include "llaprpool.h"
+#include "llcontrol.h"
+#include "lldir.h"
+#include "llerrorcontrol.h"
+#include "llfontgl.h"
+#include "llgl.h"
+#include "llstyle.h"
+#include "lltexteditor.h"
+#include "lltimer.h"
+#include "llui.h"
+#include "../newview/lgghunspell_wrapper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// llui calls on the spell checker of the viewer, which is never turned on here.
+lggHunSpell_Wrapper* glggHunSpell = NULL;
+void lggHunSpell_Wrapper::addWordToCustomDictionary(std::string) {}
+BOOL lggHunSpell_Wrapper::getSpellCheckHighlight() { return FALSE; }
+std::vector<std::string> lggHunSpell_Wrapper::getSuggestionList(std::string) { return std::vector<std::string>(); }
+BOOL lggHunSpell_Wrapper::isSpelledRight(std::string) { return TRUE; }
+void lggHunSpell_Wrapper::setSpellCheckHighlight(BOOL) {}
+
+namespace
+{
+
+U32 gSeed = 1;
+
+U32 next_random()
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return gSeed >> 8;
+}
+
+const char* WORDS[] =
+{
+	"hello", "there", "anyone", "know", "where", "the", "sandbox", "is", "?",
+	"lol", "brb", "teleporting", "to", "a", "new", "region", "now",
+	"texture", "prim", "script", "avatar", "inventory", "thanks", "!"
+};
+
+std::string make_message()
+{
+	// Mostly short lines, with now and then one that wraps several times.
+	U32 words = 2 + next_random() % ((next_random() % 8) ? 12 : 80);
+	std::string message;
+	for (U32 i = 0; i < words; ++i)
+	{
+		if (i)
+		{
+			message += ' ';
+		}
+		message += WORDS[next_random() % LL_ARRAY_SIZE(WORDS)];
+	}
+	return message;
+}
+
+class BenchTextEditor : public LLTextEditor
+{
+public:
+	BenchTextEditor()
+	:	LLTextEditor("bench", LLRect(0, 400, 300, 0), S32_MAX, LLStringUtil::null)
+	{
+		setWordWrap(TRUE);
+		setParseHighlights(FALSE);
+	}
+
+	void getLineStarts(std::vector<S32>& starts) const
+	{
+		starts.clear();
+		for (S32 i = 0; i < getLineCount(); ++i)
+		{
+			starts.push_back(getLineStart(i));
+		}
+	}
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <indra/newview directory> [lines]\n", argv[0]);
+		return 1;
+	}
+	std::string app_dir(argv[1]);
+	S32 lines = argc > 2 ? atoi(argv[2]) : 10000;
+
+	ll_init_apr();
+	LLError::setDefaultLevel(LLError::LEVEL_WARN);
+
+	gGLManager.mIsDisabled = TRUE;
+	gDirUtilp->initAppDirs("SecondLife", app_dir);
+	gDirUtilp->setSkinFolder("default");
+
+	LLControlGroup config("Global");
+	LLControlGroup account("Account");
+	LLControlGroup ignores("Ignores");
+	LLControlGroup colors("Colors");
+	config.declareBOOL("ShowXUINames", FALSE, "", FALSE);
+	LLUI::initClass(&config, &account, &ignores, &colors, NULL);
+
+	std::vector<std::string> xui_paths;
+	xui_paths.push_back("xui" + gDirUtilp->getDirDelimiter() + "en-us");
+	LLFontManager::initClass();
+	LLFontGL::initClass(96.f, 1.f, 1.f, app_dir, xui_paths, false);
+	if (!LLFontGL::loadDefaultFonts())
+	{
+		printf("can't load the fonts from %s\n", app_dir.c_str());
+		return 1;
+	}
+
+	LLStyleSP name_style(new LLStyle(TRUE, LLColor4::yellow, LLStringUtil::null));
+	LLStyleSP text_style(new LLStyle(TRUE, LLColor4::white, LLStringUtil::null));
+
+	BenchTextEditor* editor = new BenchTextEditor;
+	LLTimer timer;
+	for (S32 i = 0; i < lines; ++i)
+	{
+		editor->appendStyledText(llformat("Resident %d: ", i % 37), false, true, name_style);
+		editor->appendStyledText(make_message(), false, false, text_style);
+		editor->reflow();
+	}
+	F64 append = timer.getElapsedTimeF64() / lines;
+
+	std::vector<S32> appended_starts;
+	editor->getLineStarts(appended_starts);
+
+	// Wrapping the whole history is what every append cost before.
+	timer.reset();
+	editor->updateLineStartList();
+	F64 full = timer.getElapsedTimeF64();
+
+	std::vector<S32> full_starts;
+	editor->getLineStarts(full_starts);
+
+	printf("%d chat lines, %d wrapped lines, %d characters\n",
+		   lines, (S32) full_starts.size(), (S32) editor->getWText().length());
+	printf("append and reflow      %9.1f us/line\n", append * 1.0e6);
+	printf("wrap the whole history %9.1f us\n", full * 1.0e6);
+	printf("%s\n", appended_starts == full_starts ? "Same lines." : "DIFFERENT LINES!");
+
+	bool same = (appended_starts == full_starts);
+	delete editor;
+	LLFontGL::destroyDefaultFonts();
+	LLUI::cleanupClass();
+
+	return same ? 0 : 1;
+}
@@ -40,6 +40,10 @@
 #else
 #include <sys/file.h>
 #endif
+#if !LL_WINDOWS
+#include <unistd.h>		// pread
+#include <errno.h>
+#endif
     
 #include "llstl.h"
 #include "lltimer.h"
@@ -314,6 +318,9 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 		size_t nread = fread(&buffer[0], 1, fbuf.st_size, mIndexFP);
  
 		std::vector<LLVFSFileBlock*> files_by_loc;
+		size_t const max_entries = nread / LLVFSFileBlock::SERIAL_SIZE;
+		files_by_loc.reserve(max_entries);
+		mFileBlocks.rehash((size_t)(max_entries / mFileBlocks.max_load_factor()) + 1);
 		
 		while (buf_offset < nread)
 		{
@@ -749,7 +756,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		return FALSE;
 	}
 
-	lockData();
+	lockDataForWrite();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	LLVFSFileBlock *block = NULL;
@@ -777,7 +784,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
     
 		if (max_size == block->mLength)
 		{
-			unlockData();
+			unlockDataForWrite();
 			return TRUE;
 		}
 		else if (max_size < block->mLength)
@@ -799,7 +806,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 			sync(block);
 			//mergeFreeBlocks();
 
-			unlockData();
+			unlockDataForWrite();
 			return TRUE;
 		}
 		else if (max_size > block->mLength)
@@ -826,7 +833,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 					block->mLength += size_increase;
 					sync(block);
 
-					unlockData();
+					unlockDataForWrite();
 					return TRUE;
 				}
 			}
@@ -862,6 +869,9 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 							{
 								llwarns << "Short write" << llendl;
 							}
+#if !LL_WINDOWS
+							fflush(mDataFP);
+#endif
 						} else {
 							llwarns << "Short read" << llendl;
 						}
@@ -875,14 +885,14 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 
 				sync(block);
 
-				unlockData();
+				unlockDataForWrite();
 				return TRUE;
 			}
 			else
 			{
 				llwarns << "VFS: No space (" << max_size << ") to resize existing vfile " << file_id << llendl;
 				//dumpMap();
-				unlockData();
+				unlockDataForWrite();
 				dumpStatistics();
 				return FALSE;
 			}
@@ -918,12 +928,12 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		{
 			llwarns << "VFS: No space (" << max_size << ") for new virtual file " << file_id << llendl;
 			//dumpMap();
-			unlockData();
+			unlockDataForWrite();
 			dumpStatistics();
 			return FALSE;
 		}
 	}
-	unlockData();
+	unlockDataForWrite();
 	return TRUE;
 }
 
@@ -942,7 +952,7 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempt to write to read-only VFS" << llendl;
 	}
 
-	lockData();
+	lockDataForWrite();
 	
 	LLVFSFileSpecifier new_spec(new_id, new_type);
 	LLVFSFileSpecifier old_spec(file_id, file_type);
@@ -993,7 +1003,7 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 	{
 		llwarns << "VFS: Attempt to rename nonexistent vfile " << file_id << ":" << file_type << llendl;
 	}
-	unlockData();
+	unlockDataForWrite();
 }
 
 // mDataMutex must be LOCKED before calling this
@@ -1030,7 +1040,7 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempt to write to read-only VFS" << llendl;
 	}
 
-    lockData();
+    lockDataForWrite();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -1044,7 +1054,7 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		llwarns << "VFS: attempting to remove nonexistent file " << file_id << " type " << file_type << llendl;
 	}
 
-	unlockData();
+	unlockDataForWrite();
 }
     
     
@@ -1088,8 +1098,24 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 
 	if (do_read)
 	{
+#if LL_WINDOWS
 		fseek(mDataFP, location, SEEK_SET);
 		bytesread = (S32)fread(buffer, 1, length, mDataFP);
+#else
+		// Do the actual read without holding mDataMutex, so that reads of different
+		// files don't block each other. mDataRWLock makes sure that the block isn't
+		// freed, moved or written to until we're done.
+		mDataRWLock.rdlock();
+		unlockData();
+		ssize_t res;
+		do
+		{
+			res = pread(fileno(mDataFP), buffer, length, location);
+		}
+		while (res == -1 && errno == EINTR);
+		mDataRWLock.rdunlock();
+		return (res < 0) ? 0 : (S32)res;
+#endif
 	}
 	
 	unlockData();
@@ -1110,7 +1136,7 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
     
 	llassert(length > 0);
 
-    lockData();
+    lockDataForWrite();
     
 	LLVFSFileSpecifier spec(file_id, file_type);
 	fileblock_map::iterator it = mFileBlocks.find(spec);
@@ -1135,7 +1161,7 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 					<< " location: " << in_loc
 					<< " bytes: " << length
 					<< llendl;
-			unlockData();
+			unlockDataForWrite();
 			return length;
 		}
 		else if (location > block->mLength)
@@ -1146,7 +1172,7 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 					<< " of size " << block->mSize
 					<< " block length " << block->mLength
 					<< llendl;
-			unlockData();
+			unlockDataForWrite();
 			return length;
 		}
 		else
@@ -1164,21 +1190,24 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 			{
 				llwarns << llformat("VFS Write Error: %d != %d",write_len,length) << llendl;
 			}
-			// fflush(mDataFP);
+#if !LL_WINDOWS
+			// getData reads straight from the file descriptor.
+			fflush(mDataFP);
+#endif
 			
 			if (location + length > block->mSize)
 			{
 				block->mSize = location + write_len;
 				sync(block);
 			}
-			unlockData();
+			unlockDataForWrite();
 			
 			return write_len;
 		}
 	}
 	else
 	{
-		unlockData();
+		unlockDataForWrite();
 		return 0;
 	}
 }
@@ -2060,7 +2089,7 @@ std::map<LLVFSFileSpecifier, LLVFSFileBlock*> LLVFS::getFileList()
 {
 	//have to do this so as not to mess with the gods of threading
 	lockData();
-	fileblock_map mFileList = mFileBlocks;
+	std::map<LLVFSFileSpecifier, LLVFSFileBlock*> mFileList(mFileBlocks.begin(), mFileBlocks.end());
 	unlockData();
 
 	return mFileList;
@@ -29,6 +29,7 @@
 
 #include <deque>
 #include "lluuid.h"
+#include "sguuidhash.h"
 #include "linked_lists.h"
 #include "llassettype.h"
 #include "llthread.h"
@@ -84,6 +85,18 @@ public:
 	LLAssetType::EType mFileType;
 };
 
+namespace boost {
+	template<> class hash<LLVFSFileSpecifier> {
+	public:
+		size_t operator()(const LLVFSFileSpecifier& spec) const
+		{
+			size_t seed = hash<LLUUID>()(spec.mFileID);
+			hash_combine(seed, (S32)spec.mFileType);
+			return seed;
+		}
+	};
+}
+
 class LLVFSFileBlock : public LLVFSBlock, public LLVFSFileSpecifier
 {
 public:
@@ -191,13 +204,22 @@ protected:
 	// lock/unlock data mutex (mDataMutex)
 	void lockData() { mDataMutex->lock(); }
 	void unlockData() { mDataMutex->unlock(); }	
+
+	// Same as lockData, but also wait until all reads from the data file that getData
+	// does after releasing mDataMutex are finished. Use this when writing to the data
+	// file, or when freeing or moving blocks.
+	void lockDataForWrite() { mDataMutex->lock(); mDataRWLock.wrlock(); }
+	void unlockDataForWrite() { mDataRWLock.wrunlock(); mDataMutex->unlock(); }
 	
 protected:
 	LLMutex* mDataMutex;
+	// Read locked by getData while reading the data file without holding mDataMutex.
+	// Only write locked while mDataMutex is locked (see lockDataForWrite).
+	AIRWLock mDataRWLock;
 
 //<edit>
 public:
-	typedef std::map<LLVFSFileSpecifier, LLVFSFileBlock*> fileblock_map;
+	typedef boost::unordered_map<LLVFSFileSpecifier, LLVFSFileBlock*> fileblock_map;
 	std::map<LLVFSFileSpecifier, LLVFSFileBlock*> getFileList();
 //</edit>
 protected:
@@ -32,6 +32,8 @@
 
 #include "llcontrol.h"
 
+#include "aithreadid.h"
+#include "llfasttimer.h"
 #include "llstl.h"
 
 #include "llstring.h"
@@ -356,19 +358,27 @@ void LLControlGroup::updateLookupMap(ctrl_name_table_t::const_iterator iter) con
 }
 #endif //PROF_CTRL_CALLS
 
+// The calls per frame of this timer are the controls still looked up by name,
+// which an LLControlHandle or LLCachedControl would find without the lookup.
+// Fast timers are only used by the main thread.
+static LLFastTimer::DeclareTimer FTM_CONTROL_LOOKUP("Settings Lookups By Name");
+
 LLControlVariable* LLControlGroup::getControl(std::string const& name)
 {
-	ctrl_name_table_t::iterator iter = mNameTable.find(name);
-#ifdef PROF_CTRL_CALLS
-	updateLookupMap(iter);
-#endif //PROF_CTRL_CALLS
-	if(iter != mNameTable.end())
-		return iter->second->getCOAActive();
-	else
-		return NULL;
+	return const_cast<LLControlVariable*>(static_cast<LLControlGroup const*>(this)->getControl(name));
 }
 
 LLControlVariable const* LLControlGroup::getControl(std::string const& name) const
+{
+	if (AIThreadID::in_main_thread())
+	{
+		LLFastTimer t(FTM_CONTROL_LOOKUP);
+		return findControl(name);
+	}
+	return findControl(name);
+}
+
+LLControlVariable const* LLControlGroup::findControl(std::string const& name) const
 {
 	ctrl_name_table_t::const_iterator iter = mNameTable.find(name);
 #ifdef PROF_CTRL_CALLS
@@ -380,10 +390,23 @@ LLControlVariable const* LLControlGroup::getControl(std::string const& name) con
 		return NULL;
 }
 
+S32 LLControlGroup::getControlID(std::string const& name) const
+{
+	ctrl_id_table_t::const_iterator iter = mIDTable.find(name);
+	return iter != mIDTable.end() ? iter->second : -1;
+}
+
+void LLControlHandle::resolve()
+{
+	mGeneration = mGroup.getGeneration();
+	mID = mGroup.getControlID(mName);
+}
+
 ////////////////////////////////////////////////////////////////////////////
 
 LLControlGroup::LLControlGroup(const std::string& name)
-:	LLInstanceTracker<LLControlGroup, std::string>(name)
+:	LLInstanceTracker<LLControlGroup, std::string>(name),
+	mGeneration(1)
 {
 	mTypeString[TYPE_U32] = "U32";
 	mTypeString[TYPE_S32] = "S32";
@@ -406,6 +429,10 @@ LLControlGroup::~LLControlGroup()
 void LLControlGroup::cleanup()
 {
 	mNameTable.clear();
+	mIDTable.clear();
+	mControlsByID.clear();
+	// Handles resolved before this have to look their control up again.
+	++mGeneration;
 }
 
 eControlType LLControlGroup::typeStringToEnum(const std::string& typestr)
@@ -448,6 +475,8 @@ BOOL LLControlGroup::declareControl(const std::string& name, eControlType type,
 	// if not, create the control and add it to the name table
 	LLControlVariable* control = new LLControlVariable(name, type, initial_val, comment, persist, hidefromsettingseditor, IsCOA);
 	mNameTable[name] = control;	
+	mIDTable[name] = (S32)mControlsByID.size();
+	mControlsByID.push_back(control);
 	return TRUE;
 }
 
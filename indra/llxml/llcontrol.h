@@ -52,6 +52,7 @@
 #endif
 
 #include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
 
 #if LL_WINDOWS
 	#pragma warning (push)
@@ -222,9 +223,17 @@ class LLControlGroup : public LLInstanceTracker<LLControlGroup, std::string>
 protected:
 	typedef std::map<std::string, LLControlVariablePtr > ctrl_name_table_t;
 	ctrl_name_table_t mNameTable;
+	// Every control gets the next ID when it is declared, so that LLControlHandle
+	// finds it by index instead of by name. The IDs stay valid until cleanup(),
+	// which starts a new generation.
+	typedef boost::unordered_map<std::string, S32> ctrl_id_table_t;
+	ctrl_id_table_t mIDTable;
+	std::vector<LLControlVariablePtr> mControlsByID;
+	U32 mGeneration;
 	std::set<std::string> mWarnings;
 	std::string mTypeString[TYPE_COUNT];
 
+	LLControlVariable const* findControl(std::string const& name) const;
 	eControlType typeStringToEnum(const std::string& typestr);
 	std::string typeEnumToString(eControlType typeenum);
 	std::set<std::string> mIncludedFiles; //To prevent perpetual recursion.
@@ -237,6 +246,11 @@ public:
 	LLControlVariable* getControl(std::string const& name);
 	LLControlVariable const* getControl(std::string const& name) const;
 
+	// Returns the ID of the control, or -1 if there is no such control.
+	S32 getControlID(std::string const& name) const;
+	LLControlVariable* getControlByID(S32 id) { return mControlsByID[id]->getCOAActive(); }
+	U32 getGeneration() const { return mGeneration; }
+
 	struct ApplyFunctor
 	{
 		virtual ~ApplyFunctor() {};
@@ -557,6 +571,85 @@ template<> LLColor3 convert_from_llsd<LLColor3>(const LLSD& sd, eControlType typ
 template<> LLColor4 convert_from_llsd<LLColor4>(const LLSD& sd, eControlType type, const std::string& control_name);
 template<> LLSD convert_from_llsd<LLSD>(const LLSD& sd, eControlType type, const std::string& control_name);
 
+//! A control of a group that is looked up by name only the first time it is used.
+
+//! Use a static LLControlHandle where a control is read often, like every frame:
+//!   static LLControlHandle sRenderGlow(gSavedSettings, "RenderGlow");
+//!   if (sRenderGlow.getBOOL()) ...
+//! Unlike LLCachedControl it doesn't connect to the control, and it reads the
+//! value of the control when it's asked, from the ID the name was resolved to.
+class LLControlHandle
+{
+	LOG_CLASS(LLControlHandle);
+
+public:
+	LLControlHandle(LLControlGroup& group, const std::string& name)
+	:	mGroup(group), mName(name), mID(-1), mGeneration(0)
+	{
+	}
+
+	const std::string& getName() const { return mName; }
+
+	// Returns NULL if the control doesn't exist (yet).
+	LLControlVariable* getControl()
+	{
+		if (mID < 0 || mGeneration != mGroup.getGeneration())
+		{
+			resolve();
+			if (mID < 0)
+			{
+				return NULL;
+			}
+		}
+		return mGroup.getControlByID(mID);
+	}
+
+	template<typename T> T get()
+	{
+		LLControlVariable* control = getControl();
+		if (!control)
+		{
+			llwarns << "Control " << mName << " not found." << llendl;
+			return T();
+		}
+		return convert_from_llsd<T>(control->get(), control->type(), mName);
+	}
+
+	template<typename T> void set(const T& val)
+	{
+		LLControlVariable* control = getControl();
+		if (control && control->isType(get_control_type<T>()))
+		{
+			control->set(convert_to_llsd(val));
+		}
+		else
+		{
+			llwarns << "Invalid control " << mName << llendl;
+		}
+	}
+
+	BOOL		getBOOL()		{ return (BOOL)get<bool>(); }
+	S32			getS32()		{ return get<S32>(); }
+	F32			getF32()		{ return get<F32>(); }
+	U32			getU32()		{ return get<U32>(); }
+	std::string	getString()		{ return get<std::string>(); }
+	LLColor4	getColor4()		{ return get<LLColor4>(); }
+
+	void	setBOOL(BOOL val)					{ set<bool>(val); }
+	void	setS32(S32 val)						{ set(val); }
+	void	setF32(F32 val)						{ set(val); }
+	void	setU32(U32 val)						{ set(val); }
+	void	setString(const std::string& val)	{ set(val); }
+
+private:
+	void resolve();
+
+	LLControlGroup&	mGroup;
+	std::string		mName;
+	S32				mID;
+	U32				mGeneration;
+};
+
 //#define TEST_CACHED_CONTROL 1
 #ifdef TEST_CACHED_CONTROL
 void test_cached_control();
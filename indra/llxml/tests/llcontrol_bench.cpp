@@ -0,0 +1,192 @@
+/**
+ * @file llcontrol_bench.cpp
+ * @brief Compares reading controls by name with reading them through LLControlHandle.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ *
+ * Copyright (c) 2001-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+
+// Usage: llcontrol_bench [frames] [controls]
+//
+// Declares as many controls as the viewer has settings (about 1,800), and
+// reads 200 of them every frame, picked at random like the per-frame code of
+// the pipeline, drawpools and avatars does, timed with:
+//   name   - gSavedSettings.getBOOL("...") and friends, which make a string
+//            and look the control up in the name table every time,
+//   handle - a static LLControlHandle per call site, resolved the first time.
+// Both must read the same values.
+
+#include "linden_common.h"
+
+#include "llaprpool.h"
+#include "llcontrol.h"
+#include "llerrorcontrol.h"
+#include "lltimer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+U32 gSeed = 1;
+
+U32 next_random()
+{
+	gSeed = gSeed * 1664525u + 1013904223u;
+	return gSeed >> 8;
+}
+
+const S32 CALL_SITES = 200;
+
+const char* PREFIXES[] =
+{
+	"Render", "Avatar", "Camera", "Chat", "Debug", "Inventory", "Audio", "UI"
+};
+
+enum EType { BOOLEAN, INTEGER, REAL, TYPES };
+
+struct CallSite
+{
+	// The name of the control as it is written at the call site.
+	const char* mName;
+	EType mType;
+	LLControlHandle* mHandle;
+};
+
+F64 read_by_name(LLControlGroup& group, const std::vector<CallSite>& sites)
+{
+	F64 sum = 0.0;
+	for (std::vector<CallSite>::const_iterator iter = sites.begin(); iter != sites.end(); ++iter)
+	{
+		switch (iter->mType)
+		{
+		case BOOLEAN:	sum += group.getBOOL(iter->mName);	break;
+		case INTEGER:	sum += group.getS32(iter->mName);	break;
+		default:		sum += group.getF32(iter->mName);	break;
+		}
+	}
+	return sum;
+}
+
+F64 read_by_handle(const std::vector<CallSite>& sites)
+{
+	F64 sum = 0.0;
+	for (std::vector<CallSite>::const_iterator iter = sites.begin(); iter != sites.end(); ++iter)
+	{
+		switch (iter->mType)
+		{
+		case BOOLEAN:	sum += iter->mHandle->getBOOL();	break;
+		case INTEGER:	sum += iter->mHandle->getS32();		break;
+		default:		sum += iter->mHandle->getF32();		break;
+		}
+	}
+	return sum;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	S32 frames = argc > 1 ? atoi(argv[1]) : 10000;
+	S32 controls = argc > 2 ? atoi(argv[2]) : 1800;
+	if (frames < 1 || controls < 1)
+	{
+		printf("Usage: %s [frames] [controls]\n", argv[0]);
+		return 1;
+	}
+
+	ll_init_apr();
+	LLError::setDefaultLevel(LLError::LEVEL_WARN);
+
+	LLControlGroup group("Bench");
+	std::vector<std::string> names(controls);
+	for (S32 i = 0; i < controls; ++i)
+	{
+		names[i] = llformat("%sSetting%d", PREFIXES[next_random() % LL_ARRAY_SIZE(PREFIXES)], i);
+		switch (i % TYPES)
+		{
+		case BOOLEAN:	group.declareBOOL(names[i], next_random() & 1, "", FALSE);			break;
+		case INTEGER:	group.declareS32(names[i], next_random() % 100, "", FALSE);			break;
+		default:		group.declareF32(names[i], (next_random() % 100) * 0.5f, "", FALSE);	break;
+		}
+	}
+
+	std::vector<CallSite> sites(CALL_SITES);
+	for (S32 i = 0; i < CALL_SITES; ++i)
+	{
+		S32 control = next_random() % controls;
+		sites[i].mName = names[control].c_str();
+		sites[i].mType = (EType)(control % TYPES);
+		sites[i].mHandle = new LLControlHandle(group, names[control]);
+	}
+
+	// Once untimed, which resolves the handles.
+	F64 name_sum = read_by_name(group, sites);
+	F64 handle_sum = read_by_handle(sites);
+	bool same = (name_sum == handle_sum);
+
+	LLTimer timer;
+	for (S32 i = 0; i < frames; ++i)
+	{
+		same = same && read_by_name(group, sites) == name_sum;
+	}
+	F64 by_name = timer.getElapsedTimeF64() / frames;
+
+	timer.reset();
+	for (S32 i = 0; i < frames; ++i)
+	{
+		same = same && read_by_handle(sites) == name_sum;
+	}
+	F64 by_handle = timer.getElapsedTimeF64() / frames;
+
+	// Declaring the controls again after a cleanup gives them other IDs.
+	group.cleanup();
+	for (S32 i = controls - 1; i >= 0; --i)
+	{
+		switch (i % TYPES)
+		{
+		case BOOLEAN:	group.declareBOOL(names[i], FALSE, "", FALSE);	break;
+		case INTEGER:	group.declareS32(names[i], i, "", FALSE);		break;
+		default:		group.declareF32(names[i], 0.25f * i, "", FALSE);	break;
+		}
+	}
+	same = same && read_by_handle(sites) == read_by_name(group, sites);
+
+	printf("%d controls, %d reads per frame\n", controls, CALL_SITES);
+	printf("by name   %9.3f us/frame\n", by_name * 1.0e6);
+	printf("by handle %9.3f us/frame\n", by_handle * 1.0e6);
+	printf("speedup %.1fx, values %s\n", by_name / by_handle, same ? "identical" : "DIFFER");
+
+	for (S32 i = 0; i < CALL_SITES; ++i)
+	{
+		delete sites[i].mHandle;
+	}
+	return same ? 0 : 1;
+}
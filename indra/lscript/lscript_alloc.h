@@ -225,74 +225,12 @@ S32 lsa_postadd_lists(U8 *buffer, S32 offset1, LLScriptLibData *data, S32 heapsi
 // would cause l1 to be copied, 12 to replace the 0th entry, and the address of the new list to be saved in l1
 //
 
-inline LLScriptLibData *lsa_bubble_sort(LLScriptLibData *src, S32 stride, S32 ascending)
-{
-	S32 number = src->getListLength();
-
-	if (number <= 0)
-	{
-		return NULL;
-	}
-
-	if (stride <= 0)
-	{
-		stride = 1;
-	}
-
-	S32 i = 0;
-
-	if (number % stride)
-	{
-		LLScriptLibData *retval = src->mListp;
-		src->mListp = NULL;
-		return retval;
-	}
-
-	LLScriptLibData **sortarray = new LLScriptLibData*[number];
-
-	LLScriptLibData *temp = src->mListp;
-	while (temp)
-	{
-		sortarray[i] = temp;
-		i++;
-		temp = temp->mListp;
-	}
-
-	S32 j, s;
-
-	for (i = 0; i < number; i += stride)
-	{
-		for (j = i; j < number; j += stride)
-		{
-			if (  ((*sortarray[i]) <= (*sortarray[j]))
-				!= (ascending == TRUE))
-			{
-				for (s = 0; s < stride; s++)
-				{
-					temp = sortarray[i + s];
-					sortarray[i + s] = sortarray[j + s];
-					sortarray[j + s] = temp;
-				}
-			}
-		}
-	}
-
-	i = 1;
-	temp = sortarray[0];
-	while (i < number)
-	{
-		temp->mListp = sortarray[i++];
-		temp = temp->mListp;
-	}
-	temp->mListp = NULL;
-
-	src->mListp = NULL;
-
-	temp = sortarray[0];
-	delete[] sortarray;
-	return temp;
-}
-
+// Sorts the list of src in strides of stride entries by the first entry of each stride, ascending if
+// ascending is TRUE and descending otherwise, and returns the sorted entries, which src gives up.
+// A list whose length isn't a multiple of stride comes back as it is. Keys that operator<= orders
+// (all integers, floats, strings, keys or vectors) are merge sorted, keeping strides with equal keys
+// in the order they were in; anything else goes through the exchange sort this always was.
+LLScriptLibData *lsa_bubble_sort(LLScriptLibData *src, S32 stride, S32 ascending);
 
 LLScriptLibData* lsa_randomize(LLScriptLibData* src, S32 stride);
 
@@ -10697,6 +10697,13 @@ void LLScriptScript::recurse(LLFILE *fp, S32 tabs, S32 tabsize, LSCRIPTCompilePa
 						sentry = mGlobalScope->addEntry(i->mName, LIT_LIBRARY_FUNCTION, char2type(*i->mReturnType));
 					else
 						sentry = mGlobalScope->addEntry(i->mName, LIT_LIBRARY_FUNCTION, LST_NULL);
+					// LSL has no overloading: of the OpenSim functions listed more than once
+					// with different arguments, only the first can be called.
+					if (!sentry)
+					{
+						function_index++;
+						continue;
+					}
 					sentry->mLibraryNumber = function_index;
 					arg = i->mArgs;
 					if (arg)
@@ -37,6 +37,8 @@
 #include "linked_lists.h"
 #include "lscript_library.h"
 
+#include <vector>
+
 class LLTimer;
 
 // Return values for run() methods
@@ -442,8 +444,8 @@ public:
 						  F32 quanta,
 						  U32& events_processed, LLTimer& timer);
 
-	// Run smallest possible amount of code: an instruction for LSL2, a segment
-	// between save tests for Mono
+	// Run smallest possible amount of code: an instruction for LSL2 (a few with
+	// decoded execution), a segment between save tests for Mono
 	void runInstructions(BOOL b_print, const LLUUID &id,
 						 const char **errorstr, 
 						 U32& events_processed,
@@ -472,6 +474,21 @@ private:
 	static	S32		sTimerCheckSkip;		// Number of times to skip the timer check for performance reasons
 };
 
+// An instruction of the bytecode, decoded once by LLScriptExecuteLSL2 with its
+// argument read and the types of its operands resolved. Instructions that are
+// not worth decoding run their run_xxx function from the bytecode as before.
+struct LLScriptDecodedOp
+{
+	void (*mExecute)(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id);
+	BOOL (*mLegacy)(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id);
+	void (*mOperation)(U8 *buffer, LSCRIPTOpCodesEnum opcode);	// From binary_operations or unary_operations.
+	LSCRIPTOpCodesEnum mOpcode;
+	S32 mArg;
+	F32 mArgF;
+	S32 mNext;		// Offset of the next instruction.
+	BOOL mYield;	// May sleep or change state, so nothing may run after it before the yield checks.
+};
+
 class LLScriptExecuteLSL2 : public LLScriptExecute
 {
 public:
@@ -544,11 +561,30 @@ public:
 	U8*						mBytecode; // Initial state and bytecode.
 	U32						mBytecodeSize;
 
+	// Run the code from pre-decoded instructions, several per resumeEventHandler() call,
+	// instead of decoding every instruction as it is run. Not used when printing.
+	static void		setDecodedExecution( BOOL value )		{ sDecodedExecution = value;	}
+	static BOOL		getDecodedExecution()					{ return sDecodedExecution;	}
+
 private:
 	S32 getMajorVersion() const;
 	void		recordBoundaryError( const LLUUID &id );
 	void		setStateEventOpcoodeStartSafely( S32 state, LSCRIPTStateEventType event, const LLUUID &id );
 
+	void		runDecoded( const LLUUID &id );
+	const LLScriptDecodedOp* getDecodedOp( S32 offset );
+	void		decodeOp( S32 offset, LLScriptDecodedOp &op );
+	void		clearDecoded();
+
+	// For every byte of code from GFR to HR, 1 + the index in mDecodedOps of the
+	// instruction starting there, or 0 if it has not been decoded yet.
+	std::vector<U16>				mDecodedIndex;
+	std::vector<LLScriptDecodedOp>	mDecodedOps;
+	S32								mDecodedGFR;
+	S32								mDecodedHR;
+
+	static	BOOL	sDecodedExecution;
+
 	// Called when the script is scheduled to be run from newsim/LLScriptData
 	virtual void startRunning();
 
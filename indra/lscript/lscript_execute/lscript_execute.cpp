@@ -47,6 +47,10 @@
 // Static
 const	S32	DEFAULT_SCRIPT_TIMER_CHECK_SKIP = 4;
 S32		LLScriptExecute::sTimerCheckSkip = DEFAULT_SCRIPT_TIMER_CHECK_SKIP;
+BOOL	LLScriptExecuteLSL2::sDecodedExecution = TRUE;
+
+// Most decoded instructions run per resumeEventHandler() call.
+const	S32	DECODED_BATCH_SIZE = 32;
 
 void (*binary_operations[LST_EOF][LST_EOF])(U8 *buffer, LSCRIPTOpCodesEnum opcode);
 void (*unary_operations[LST_EOF])(U8 *buffer, LSCRIPTOpCodesEnum opcode);
@@ -124,6 +128,8 @@ void LLScriptExecuteLSL2::init()
 	S32 i, j;
 
 	mInstructionCount = 0;
+	mDecodedGFR = 0;
+	mDecodedHR = 0;
 
 	for (i = 0; i < 256; i++)
 	{
@@ -321,6 +327,12 @@ S32 lscript_push_variable(LLScriptLibData *data, U8 *buffer);
 
 void LLScriptExecuteLSL2::resumeEventHandler(BOOL b_print, const LLUUID &id, F32 time_slice)
 {
+	if (sDecodedExecution && !b_print)
+	{
+		runDecoded(id);
+		return;
+	}
+
 	//	call opcode run function pointer with buffer and IP
 	mInstructionCount++;
 	S32 value = get_register(mBuffer, LREG_IP);
@@ -1782,10 +1794,9 @@ void unknown_operation(U8 *buffer, LSCRIPTOpCodesEnum opcode)
 	printf("Unknown arithmetic operation!\n");
 }
 
-void integer_integer_operation(U8 *buffer, LSCRIPTOpCodesEnum opcode)
+// The result of an integer, integer operation, shared with the decoded instructions.
+inline S32 integer_integer_result(U8 *buffer, LSCRIPTOpCodesEnum opcode, S32 lside, S32 rside)
 {
-	S32 lside = lscript_pop_int(buffer);
-	S32 rside = lscript_pop_int(buffer);
 	S32 result = 0;
 
 	switch(opcode)
@@ -1870,7 +1881,14 @@ void integer_integer_operation(U8 *buffer, LSCRIPTOpCodesEnum opcode)
 	default:
 		break;
 	}
-	lscript_push(buffer, result);
+	return result;
+}
+
+void integer_integer_operation(U8 *buffer, LSCRIPTOpCodesEnum opcode)
+{
+	S32 lside = lscript_pop_int(buffer);
+	S32 rside = lscript_pop_int(buffer);
+	lscript_push(buffer, integer_integer_result(buffer, opcode, lside, rside));
 }
 
 void integer_float_operation(U8 *buffer, LSCRIPTOpCodesEnum opcode)
@@ -3336,15 +3354,9 @@ BOOL run_state(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id)
 	return FALSE;
 }
 
-BOOL run_call(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id)
+// Stores the return address and jumps to global function func, offset is the return address.
+static void call_function(U8 *buffer, S32 &offset, S32 func)
 {
-	if (b_print)
-		printf("[0x%X]\tCALL ", offset);
-	offset++;
-	S32 func = safe_instruction_bytestream2integer(buffer, offset);
-	if (b_print)
-		printf("%d\n", func);
-
 	lscript_local_store(buffer, -8, offset);
 
 	S32 minimum = get_register(buffer, LREG_GFR);
@@ -3371,15 +3383,24 @@ BOOL run_call(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id)
 	{
 		set_fault(buffer, LSRF_BOUND_CHECK_ERROR);
 	}
-	return FALSE;
 }
 
-BOOL run_return(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id)
+BOOL run_call(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id)
 {
 	if (b_print)
-		printf("[0x%X]\tRETURN\n", offset);
+		printf("[0x%X]\tCALL ", offset);
 	offset++;
-	
+	S32 func = safe_instruction_bytestream2integer(buffer, offset);
+	if (b_print)
+		printf("%d\n", func);
+
+	call_function(buffer, offset, func);
+	return FALSE;
+}
+
+// Pops the caller's BP and sets offset to the return address.
+static void return_function(U8 *buffer, S32 &offset)
+{
 	// SEC-53: babbage: broken instructions may allow inbalanced pushes and
 	// pops which can cause caller BP and return IP to be corrupted, so restore
 	// SP from BP before popping caller BP and IP.
@@ -3389,6 +3410,14 @@ BOOL run_return(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id)
 	bp = lscript_pop_int(buffer);
 	set_bp(buffer, bp);
 	offset = lscript_pop_int(buffer);
+}
+
+BOOL run_return(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &id)
+{
+	if (b_print)
+		printf("[0x%X]\tRETURN\n", offset);
+	offset++;
+	return_function(buffer, offset);
 	return FALSE;
 }
 
@@ -4328,3 +4357,440 @@ BOOL run_calllib_two_byte(U8 *buffer, S32 &offset, BOOL b_print, const LLUUID &i
 	}
 	return run_calllib_common(buffer, offset, id, arg);
 }
+
+//
+// Decoded execution
+//
+// Every instruction is decoded the first time it runs, into an LLScriptDecodedOp
+// with its argument read and, for the arithmetic, the operation for the types of
+// its operands looked up. The instructions that scripts spend most of their time
+// in get their own function, the others run their run_xxx function. IP remains
+// the offset into the bytecode, so the state written and read is the same.
+//
+
+static void decoded_legacy(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	op.mLegacy(buffer, offset, FALSE, id);
+}
+
+static void decoded_noop(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+}
+
+static void decoded_pop(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	lscript_poparg(buffer, LSCRIPTDataSize[LST_INTEGER]);
+}
+
+static void decoded_poparg(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	lscript_poparg(buffer, op.mArg);
+}
+
+static void decoded_popbp(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 bp = lscript_pop_int(buffer);
+	set_bp(buffer, bp);
+}
+
+static void decoded_store(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 sp = get_register(buffer, LREG_SP);
+	S32 value = bytestream2integer(buffer, sp);
+	lscript_local_store(buffer, op.mArg, value);
+}
+
+static void decoded_storeg(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 sp = get_register(buffer, LREG_SP);
+	S32 value = bytestream2integer(buffer, sp);
+	lscript_global_store(buffer, op.mArg, value);
+}
+
+static void decoded_loadp(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 value = lscript_pop_int(buffer);
+	lscript_local_store(buffer, op.mArg, value);
+}
+
+static void decoded_loadgp(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 value = lscript_pop_int(buffer);
+	lscript_global_store(buffer, op.mArg, value);
+}
+
+static void decoded_push(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 value = lscript_local_get(buffer, op.mArg);
+	lscript_push(buffer, value);
+}
+
+static void decoded_pushg(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 value = lscript_global_get(buffer, op.mArg);
+	lscript_push(buffer, value);
+}
+
+static void decoded_pushbp(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	lscript_push(buffer, get_register(buffer, LREG_BP));
+}
+
+static void decoded_pushargb(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	lscript_push(buffer, (U8)op.mArg);
+}
+
+static void decoded_pushargi(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	lscript_push(buffer, op.mArg);
+}
+
+static void decoded_pushargf(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	lscript_push(buffer, op.mArgF);
+}
+
+static void decoded_pusharge(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	lscript_pusharge(buffer, op.mArg);
+}
+
+static void decoded_operation(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	op.mOperation(buffer, op.mOpcode);
+}
+
+template <LSCRIPTOpCodesEnum OPCODE>
+static void decoded_integer_integer(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 lside = lscript_pop_int(buffer);
+	S32 rside = lscript_pop_int(buffer);
+	lscript_push(buffer, integer_integer_result(buffer, OPCODE, lside, rside));
+}
+
+static void decoded_jump(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext + op.mArg;
+}
+
+static void decoded_jumpif_integer(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 test = lscript_pop_int(buffer);
+	if (test)
+	{
+		offset += op.mArg;
+	}
+}
+
+static void decoded_jumpnif_integer(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	S32 test = lscript_pop_int(buffer);
+	if (!test)
+	{
+		offset += op.mArg;
+	}
+}
+
+static void decoded_call(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	call_function(buffer, offset, op.mArg);
+}
+
+static void decoded_return(U8 *buffer, S32 &offset, const LLScriptDecodedOp &op, const LLUUID &id)
+{
+	offset = op.mNext;
+	return_function(buffer, offset);
+}
+
+// The function for an operation on two integers, NULL for the opcodes that are not one.
+static void (*decoded_integer_integer_func(LSCRIPTOpCodesEnum opcode))(U8 *, S32 &, const LLScriptDecodedOp &, const LLUUID &)
+{
+	switch (opcode)
+	{
+	case LOPC_ADD:		return decoded_integer_integer<LOPC_ADD>;
+	case LOPC_SUB:		return decoded_integer_integer<LOPC_SUB>;
+	case LOPC_MUL:		return decoded_integer_integer<LOPC_MUL>;
+	case LOPC_DIV:		return decoded_integer_integer<LOPC_DIV>;
+	case LOPC_MOD:		return decoded_integer_integer<LOPC_MOD>;
+	case LOPC_EQ:		return decoded_integer_integer<LOPC_EQ>;
+	case LOPC_NEQ:		return decoded_integer_integer<LOPC_NEQ>;
+	case LOPC_LEQ:		return decoded_integer_integer<LOPC_LEQ>;
+	case LOPC_GEQ:		return decoded_integer_integer<LOPC_GEQ>;
+	case LOPC_LESS:		return decoded_integer_integer<LOPC_LESS>;
+	case LOPC_GREATER:	return decoded_integer_integer<LOPC_GREATER>;
+	case LOPC_BITAND:	return decoded_integer_integer<LOPC_BITAND>;
+	case LOPC_BITOR:	return decoded_integer_integer<LOPC_BITOR>;
+	case LOPC_BITXOR:	return decoded_integer_integer<LOPC_BITXOR>;
+	case LOPC_BOOLAND:	return decoded_integer_integer<LOPC_BOOLAND>;
+	case LOPC_BOOLOR:	return decoded_integer_integer<LOPC_BOOLOR>;
+	case LOPC_SHL:		return decoded_integer_integer<LOPC_SHL>;
+	case LOPC_SHR:		return decoded_integer_integer<LOPC_SHR>;
+	default:			return NULL;
+	}
+}
+
+void LLScriptExecuteLSL2::decodeOp(S32 offset, LLScriptDecodedOp &op)
+{
+	U8 byte = mBuffer[offset];
+	op.mExecute = decoded_legacy;
+	op.mLegacy = mExecuteFuncs[byte];
+	op.mOperation = NULL;
+	op.mOpcode = LOPC_INVALID;
+	op.mArg = 0;
+	op.mArgF = 0.f;
+	op.mNext = offset + 1;
+	op.mYield = FALSE;
+
+	S32 i;
+	for (i = LOPC_NOOP; i < LOPC_EOF; i++)
+	{
+		if (LSCRIPTOpCodes[i] == byte)
+		{
+			op.mOpcode = (LSCRIPTOpCodesEnum)i;
+			break;
+		}
+	}
+
+	// The bytes of the arguments, which are only decoded when all of them are
+	// code: otherwise the run_xxx function faults the way it always did.
+	S32 arg_offset = offset + 1;
+	S32 code_left = mDecodedHR - arg_offset;
+
+	switch (op.mOpcode)
+	{
+	case LOPC_NOOP:
+		op.mExecute = decoded_noop;
+		break;
+	case LOPC_POP:
+		op.mExecute = decoded_pop;
+		break;
+	case LOPC_POPBP:
+		op.mExecute = decoded_popbp;
+		break;
+	case LOPC_PUSHBP:
+		op.mExecute = decoded_pushbp;
+		break;
+	case LOPC_PUSHE:
+		op.mExecute = decoded_pusharge;
+		op.mArg = LSCRIPTDataSize[LST_INTEGER];
+		break;
+	case LOPC_RETURN:
+		op.mExecute = decoded_return;
+		break;
+	case LOPC_BITAND:
+	case LOPC_BITOR:
+	case LOPC_BITXOR:
+	case LOPC_BOOLAND:
+	case LOPC_BOOLOR:
+	case LOPC_SHL:
+	case LOPC_SHR:
+		op.mExecute = decoded_integer_integer_func(op.mOpcode);
+		break;
+	case LOPC_BITNOT:
+	case LOPC_BOOLNOT:
+		op.mExecute = decoded_operation;
+		op.mOperation = unary_operations[LST_INTEGER];
+		break;
+	case LOPC_PUSHARGB:
+		if (code_left >= 1)
+		{
+			op.mExecute = decoded_pushargb;
+			op.mArg = mBuffer[arg_offset];
+			op.mNext = arg_offset + 1;
+		}
+		break;
+	case LOPC_PUSHARGF:
+		if (code_left >= LSCRIPTDataSize[LST_FLOATINGPOINT])
+		{
+			op.mArgF = bytestream2float(mBuffer, arg_offset);
+			if (llfinite(op.mArgF))
+			{
+				op.mExecute = decoded_pushargf;
+				op.mNext = arg_offset;
+			}
+		}
+		break;
+	case LOPC_POPARG:
+	case LOPC_STORE:
+	case LOPC_STOREG:
+	case LOPC_LOADP:
+	case LOPC_LOADGP:
+	case LOPC_PUSH:
+	case LOPC_PUSHG:
+	case LOPC_PUSHARGI:
+	case LOPC_PUSHARGE:
+	case LOPC_JUMP:
+	case LOPC_CALL:
+		if (code_left >= LSCRIPTDataSize[LST_INTEGER])
+		{
+			op.mArg = bytestream2integer(mBuffer, arg_offset);
+			op.mNext = arg_offset;
+			switch (op.mOpcode)
+			{
+			case LOPC_POPARG:	op.mExecute = decoded_poparg;	break;
+			case LOPC_STORE:	op.mExecute = decoded_store;	break;
+			case LOPC_STOREG:	op.mExecute = decoded_storeg;	break;
+			case LOPC_LOADP:	op.mExecute = decoded_loadp;	break;
+			case LOPC_LOADGP:	op.mExecute = decoded_loadgp;	break;
+			case LOPC_PUSH:		op.mExecute = decoded_push;		break;
+			case LOPC_PUSHG:	op.mExecute = decoded_pushg;	break;
+			case LOPC_PUSHARGI:	op.mExecute = decoded_pushargi;	break;
+			case LOPC_PUSHARGE:	op.mExecute = decoded_pusharge;	break;
+			case LOPC_JUMP:		op.mExecute = decoded_jump;		break;
+			default:			op.mExecute = decoded_call;		break;
+			}
+		}
+		break;
+	case LOPC_ADD:
+	case LOPC_SUB:
+	case LOPC_MUL:
+	case LOPC_DIV:
+	case LOPC_MOD:
+	case LOPC_EQ:
+	case LOPC_NEQ:
+	case LOPC_LEQ:
+	case LOPC_GEQ:
+	case LOPC_LESS:
+	case LOPC_GREATER:
+		if (code_left >= 1)
+		{
+			U8 arg = mBuffer[arg_offset];
+			U8 arg1 = safe_op_index(arg >> 4);
+			U8 arg2 = safe_op_index(arg & 0xf);
+			op.mNext = arg_offset + 1;
+			if (arg1 == LST_INTEGER && arg2 == LST_INTEGER)
+			{
+				op.mExecute = decoded_integer_integer_func(op.mOpcode);
+			}
+			else
+			{
+				op.mExecute = decoded_operation;
+				op.mOperation = binary_operations[arg1][arg2];
+			}
+		}
+		break;
+	case LOPC_NEG:
+		if (code_left >= 1)
+		{
+			op.mExecute = decoded_operation;
+			op.mOperation = unary_operations[safe_op_index(mBuffer[arg_offset])];
+			op.mNext = arg_offset + 1;
+		}
+		break;
+	case LOPC_JUMPIF:
+	case LOPC_JUMPNIF:
+		// Other types are left to run_jumpif and run_jumpnif.
+		if (code_left >= 1 + LSCRIPTDataSize[LST_INTEGER]
+			&& mBuffer[arg_offset] == LST_INTEGER)
+		{
+			arg_offset++;
+			op.mArg = bytestream2integer(mBuffer, arg_offset);
+			op.mNext = arg_offset;
+			op.mExecute = op.mOpcode == LOPC_JUMPIF ? decoded_jumpif_integer : decoded_jumpnif_integer;
+		}
+		break;
+	case LOPC_POPSLR:
+	case LOPC_STATE:
+	case LOPC_CALLLIB:
+	case LOPC_CALLLIB_TWO_BYTE:
+		op.mYield = TRUE;
+		break;
+	default:
+		break;
+	}
+}
+
+const LLScriptDecodedOp* LLScriptExecuteLSL2::getDecodedOp(S32 offset)
+{
+	if (offset < mDecodedGFR || offset >= mDecodedHR)
+	{
+		return NULL;
+	}
+	U16 &index = mDecodedIndex[offset - mDecodedGFR];
+	if (!index)
+	{
+		if (mDecodedOps.size() >= 0xFFFF)
+		{
+			return NULL;
+		}
+		mDecodedOps.resize(mDecodedOps.size() + 1);
+		decodeOp(offset, mDecodedOps.back());
+		index = (U16)mDecodedOps.size();
+	}
+	return &mDecodedOps[index - 1];
+}
+
+void LLScriptExecuteLSL2::clearDecoded()
+{
+	mDecodedIndex.clear();
+	mDecodedOps.clear();
+	mDecodedGFR = 0;
+	mDecodedHR = 0;
+}
+
+// Runs instructions like resumeEventHandler() does one at a time, until a fault,
+// the end of the handler, or an instruction that may need runQuanta() to yield.
+void LLScriptExecuteLSL2::runDecoded(const LLUUID &id)
+{
+	S32 gfr = get_register(mBuffer, LREG_GFR);
+	S32 hr = get_register(mBuffer, LREG_HR);
+	if (gfr != mDecodedGFR || hr != mDecodedHR)
+	{
+		clearDecoded();
+		if (gfr > 0 && gfr < hr && hr <= TOP_OF_MEMORY)
+		{
+			mDecodedGFR = gfr;
+			mDecodedHR = hr;
+			mDecodedIndex.resize(hr - gfr, 0);
+		}
+	}
+
+	for (S32 i = 0; i < DECODED_BATCH_SIZE; i++)
+	{
+		mInstructionCount++;
+		S32 value = get_register(mBuffer, LREG_IP);
+		const LLScriptDecodedOp *op = getDecodedOp(value);
+		BOOL yield = TRUE;
+		if (op)
+		{
+			op->mExecute(mBuffer, value, *op, id);
+			yield = op->mYield;
+		}
+		else
+		{
+			S32 tvalue = value;
+			S32	opcode = safe_instruction_bytestream2byte(mBuffer, tvalue);
+			mExecuteFuncs[opcode](mBuffer, value, FALSE, id);
+		}
+		set_ip(mBuffer, value);
+		add_register_fp(mBuffer, LREG_ESR, -0.1f);
+
+		if (yield
+			|| get_register(mBuffer, LREG_FR)
+			|| !get_register(mBuffer, LREG_IP))
+		{
+			break;
+		}
+	}
+}
@@ -0,0 +1,304 @@
+/**
+ * @file lscript_execute_bench.cpp
+ * @brief Compares running LSL2 bytecode one instruction at a time with running it pre-decoded.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewergpl$
+ *
+ * Copyright (c) 2002-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Usage: lscript_execute_bench [runs] [script.lsl ...]
+//
+// Compiles a few scripts that are like what keeps sims busy (integer and float
+// loops, function calls, vectors, and strings and lists, which run mostly in
+// the heap code), or the scripts given, and runs the state_entry handler of
+// each to the end with runQuanta, the way lscript_run does, timed with:
+//   legacy  - every instruction decoded as it is run by resumeEventHandler,
+//   decoded - setDecodedExecution, several pre-decoded instructions per call.
+// The script is reset before every run. After the last run the registers,
+// globals, heap and stack of both must be the same.
+
+#include "linden_common.h"
+
+#include "lscript_execute.h"
+#include "lscript_rt_interface.h"
+#include "lltimer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+struct Script
+{
+	const char* mName;
+	const char* mSource;
+};
+
+const Script SCRIPTS[] =
+{
+	{ "integer",
+	  "integer gTotal;\n"
+	  "default\n"
+	  "{\n"
+	  "	state_entry()\n"
+	  "	{\n"
+	  "		integer i;\n"
+	  "		integer sum = 0;\n"
+	  "		for (i = 0; i < 20000; ++i)\n"
+	  "		{\n"
+	  "			sum += (i * 7) % 13;\n"
+	  "			if ((i & 3) == 0)\n"
+	  "				sum = sum ^ (i << 2);\n"
+	  "		}\n"
+	  "		gTotal = sum;\n"
+	  "	}\n"
+	  "}\n" },
+
+	{ "float",
+	  "float gX;\n"
+	  "default\n"
+	  "{\n"
+	  "	state_entry()\n"
+	  "	{\n"
+	  "		float x = 1.0;\n"
+	  "		float v = 0.0;\n"
+	  "		float dt = 0.01;\n"
+	  "		integer i;\n"
+	  "		for (i = 0; i < 20000; ++i)\n"
+	  "		{\n"
+	  "			float a = -4.0 * x - 0.1 * v;\n"
+	  "			v += a * dt;\n"
+	  "			x += v * dt;\n"
+	  "		}\n"
+	  "		gX = x;\n"
+	  "	}\n"
+	  "}\n" },
+
+	{ "calls",
+	  "integer gFib;\n"
+	  "integer fib(integer n)\n"
+	  "{\n"
+	  "	if (n < 2)\n"
+	  "		return n;\n"
+	  "	return fib(n - 1) + fib(n - 2);\n"
+	  "}\n"
+	  "default\n"
+	  "{\n"
+	  "	state_entry()\n"
+	  "	{\n"
+	  "		gFib = fib(18);\n"
+	  "	}\n"
+	  "}\n" },
+
+	{ "vector",
+	  "vector gPos;\n"
+	  "default\n"
+	  "{\n"
+	  "	state_entry()\n"
+	  "	{\n"
+	  "		vector pos = <128.0, 128.0, 20.0>;\n"
+	  "		vector vel = <0.5, -0.25, 0.1>;\n"
+	  "		integer i;\n"
+	  "		for (i = 0; i < 5000; ++i)\n"
+	  "		{\n"
+	  "			pos += vel * 0.1;\n"
+	  "			if (pos.x > 256.0 || pos.x < 0.0)\n"
+	  "				vel.x = -vel.x;\n"
+	  "			vel = vel * 0.999 + <0.0, 0.0, -0.001>;\n"
+	  "		}\n"
+	  "		gPos = pos;\n"
+	  "	}\n"
+	  "}\n" },
+
+	{ "strings",
+	  "string gText;\n"
+	  "list gItems;\n"
+	  "default\n"
+	  "{\n"
+	  "	state_entry()\n"
+	  "	{\n"
+	  "		integer i;\n"
+	  "		for (i = 0; i < 1000; ++i)\n"
+	  "		{\n"
+	  "			if (i % 20 == 0)\n"
+	  "			{\n"
+	  "				gItems = [];\n"
+	  "				gText = \"\";\n"
+	  "			}\n"
+	  "			gItems += [i, (float)i * 0.5];\n"
+	  "			gText += (string)(i % 10);\n"
+	  "		}\n"
+	  "	}\n"
+	  "}\n" }
+};
+
+bool read_file(const std::string& filename, std::vector<U8>& data)
+{
+	LLFILE* fp = LLFile::fopen(filename, "rb");
+	if (!fp)
+	{
+		return false;
+	}
+	data.clear();
+	U8 buffer[4096];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+	{
+		data.insert(data.end(), buffer, buffer + count);
+	}
+	fclose(fp);
+	return !data.empty();
+}
+
+bool compile(const std::string& name, const std::string& src_filename, std::vector<U8>& bytecode)
+{
+	std::string dst_filename = "lscript_execute_bench_" + name + ".lso";
+	std::string err_filename = "lscript_execute_bench_" + name + ".out";
+	BOOL ok = lscript_compile(src_filename.c_str(), dst_filename.c_str(), err_filename.c_str(), FALSE, name.c_str());
+	ok = ok && read_file(dst_filename, bytecode);
+	LLFile::remove(dst_filename);
+	if (!ok)
+	{
+		printf("%s: failed to compile, see %s\n", name.c_str(), err_filename.c_str());
+		return false;
+	}
+	LLFile::remove(err_filename);
+	return true;
+}
+
+// Runs the state_entry handler to the end, returning the number of instructions.
+U32 run_once(LLScriptExecuteLSL2& execute)
+{
+	execute.reset();
+	execute.mInstructionCount = 0;
+
+	// runQuanta only returns after a fault when the time is up.
+	const char* error = NULL;
+	U32 events_processed = 0;
+	do
+	{
+		LLTimer timer;
+		execute.runQuanta(FALSE, LLUUID::null, &error, 0.1f, events_processed, timer);
+	}
+	while (!error && !execute.isFinished());
+
+	if (error)
+	{
+		printf("fault: %s\n", error);
+	}
+	return execute.mInstructionCount;
+}
+
+// Returns the time per run, and the memory of the script after the last one.
+F64 run(const char* name, const std::vector<U8>& bytecode, BOOL decoded, S32 runs, std::vector<U8>& memory)
+{
+	LLScriptExecuteLSL2::setDecodedExecution(decoded);
+	LLScriptExecuteLSL2 execute(&bytecode[0], bytecode.size());
+
+	// Once untimed, to decode the code and warm the caches.
+	U32 instructions = run_once(execute);
+
+	LLTimer timer;
+	for (S32 i = 0; i < runs; ++i)
+	{
+		run_once(execute);
+	}
+	F64 elapsed = timer.getElapsedTimeF64() / runs;
+
+	printf("%-10s %-8s %9.1f us/run  %8u instructions  %7.1f M instructions/s\n",
+		   name, decoded ? "decoded" : "legacy", elapsed * 1.0e6, instructions, instructions / elapsed * 1.0e-6);
+
+	memory.assign(execute.mBuffer, execute.mBuffer + TOP_OF_MEMORY);
+	return elapsed;
+}
+
+void bench(const std::string& name, const std::string& src_filename, S32 runs)
+{
+	std::vector<U8> bytecode;
+	if (!compile(name, src_filename, bytecode))
+	{
+		return;
+	}
+
+	std::vector<U8> legacy_memory, decoded_memory;
+	F64 legacy = run(name.c_str(), bytecode, FALSE, runs, legacy_memory);
+	F64 decoded = run(name.c_str(), bytecode, TRUE, runs, decoded_memory);
+	printf("%-10s speedup %.2fx, state %s\n", name.c_str(), legacy / decoded,
+		   legacy_memory == decoded_memory ? "identical" : "DIFFERS");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	S32 runs = argc > 1 ? atoi(argv[1]) : 20;
+	if (runs < 1)
+	{
+		runs = 1;
+	}
+
+	if (argc > 2)
+	{
+		for (S32 i = 2; i < argc; ++i)
+		{
+			// The file name without directories or extension.
+			std::string name(argv[i]);
+			size_t pos = name.find_last_of("/\\");
+			if (pos != std::string::npos)
+			{
+				name.erase(0, pos + 1);
+			}
+			pos = name.rfind('.');
+			if (pos != std::string::npos)
+			{
+				name.erase(pos);
+			}
+			bench(name, argv[i], runs);
+		}
+		return 0;
+	}
+
+	for (U32 i = 0; i < LL_ARRAY_SIZE(SCRIPTS); ++i)
+	{
+		std::string src_filename = std::string("lscript_execute_bench_") + SCRIPTS[i].mName + ".lsl";
+		LLFILE* fp = LLFile::fopen(src_filename, "w");
+		if (!fp)
+		{
+			printf("can't write %s\n", src_filename.c_str());
+			return 1;
+		}
+		fputs(SCRIPTS[i].mSource, fp);
+		fclose(fp);
+
+		bench(SCRIPTS[i].mName, src_filename, runs);
+		LLFile::remove(src_filename);
+	}
+
+	return 0;
+}
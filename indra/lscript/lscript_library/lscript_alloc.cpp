@@ -113,14 +113,16 @@ S32 lsa_heap_top(U8 *heap_start, S32 maxtop)
 //			move to next block
 //			go to start of algorithm
 
+// Adds a block of size bytes of type, filled in from data, or with the list of addresses if there are any.
+static S32 lsa_heap_add_block(U8 *buffer, U8 type, S32 size, LLScriptLibData *data, const std::vector<S32> *addresses, S32 heapsize);
+
+// Stores the number of addresses followed by the addresses, as the data of a list.
+static void lsa_insert_addresses(U8 *buffer, S32 &offset, const std::vector<S32> &addresses);
+
 S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_delete)
 {
 	if (get_register(buffer, LREG_FR))
 		return 1;
-	LLScriptAllocEntry entry, nextentry;
-	S32 hr = get_register(buffer, LREG_HR);
-	S32 hp = get_register(buffer, LREG_HP);
-	S32 current_offset, next_offset, offset = hr;
 	S32 size = 0;
 
 	switch(data->mType)
@@ -157,6 +159,29 @@ S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_de
 		break;
 	}
 
+	S32 address = lsa_heap_add_block(buffer, data->mType, size, data, NULL, heapsize);
+	if (b_delete)
+		delete data;
+	return address;
+}
+
+// Adds a list whose entries are the blocks at addresses, which must already count a reference for it.
+static S32 lsa_heap_add_list(U8 *buffer, const std::vector<S32> &addresses, S32 heapsize)
+{
+	if (get_register(buffer, LREG_FR))
+		return 1;
+	//	list data		4 bytes of number of entries followed by number of pointer
+	S32 size = 4 + 4*(S32)addresses.size();
+	return lsa_heap_add_block(buffer, LST_LIST, size, NULL, &addresses, heapsize);
+}
+
+static S32 lsa_heap_add_block(U8 *buffer, U8 type, S32 size, LLScriptLibData *data, const std::vector<S32> *addresses, S32 heapsize)
+{
+	LLScriptAllocEntry entry, nextentry;
+	S32 hr = get_register(buffer, LREG_HR);
+	S32 hp = get_register(buffer, LREG_HP);
+	S32 current_offset, next_offset, offset = hr;
+
 	current_offset = offset;
 	bytestream2alloc_entry(entry, buffer, offset);
 
@@ -169,12 +194,15 @@ S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_de
 			{
 				offset = current_offset;
 				lsa_split_block(buffer, offset, size, entry);
-				entry.mType = data->mType;
+				entry.mType = type;
 				entry.mSize = size;
 				entry.mReferenceCount = 1;
 				offset = current_offset;
 				alloc_entry2bytestream(buffer, offset, entry);
-				lsa_insert_data(buffer, offset, data, entry, heapsize);
+				if (addresses)
+					lsa_insert_addresses(buffer, offset, *addresses);
+				else
+					lsa_insert_data(buffer, offset, data, entry, heapsize);
 				hp = get_register(buffer, LREG_HP);
 				S32 new_hp = current_offset + size + 2*SIZEOF_SCRIPT_ALLOC_ENTRY;
 				if (new_hp >= hr + heapsize)
@@ -186,8 +214,6 @@ S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_de
 					set_register(buffer, LREG_HP, new_hp);
 					hp = get_register(buffer, LREG_HP);
 				}
-				if (b_delete)
-					delete data;
 	// this bit of nastiness is to get around that code paths to local variables can result in lack of initialization
 	// and function clean up of ref counts isn't based on scope (a mistake, I know)
 				if (current_offset <= hp)
@@ -197,14 +223,15 @@ S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_de
 			}
 			else if (entry.mSize >= size)
 			{
-				entry.mType = data->mType;
+				entry.mType = type;
 				entry.mReferenceCount = 1;
 				offset = current_offset;
 				alloc_entry2bytestream(buffer, offset, entry);
-				lsa_insert_data(buffer, offset, data, entry, heapsize);
+				if (addresses)
+					lsa_insert_addresses(buffer, offset, *addresses);
+				else
+					lsa_insert_data(buffer, offset, data, entry, heapsize);
 				hp = get_register(buffer, LREG_HP);
-				if (b_delete)
-					delete data;
 	// this bit of nastiness is to get around that code paths to local variables can result in lack of initialization
 	// and function clean up of ref counts isn't based on scope (a mistake, I know)
 				return current_offset - hr + 1;
@@ -248,8 +275,6 @@ S32 lsa_heap_add_data(U8 *buffer, LLScriptLibData *data, S32 heapsize, BOOL b_de
 	} while (1);
 	set_fault(buffer, LSRF_STACK_HEAP_COLLISION);
 	reset_hp_to_safe_spot(buffer);
-	if (b_delete)
-		delete data;
 	return 0;
 }
 
@@ -327,6 +352,17 @@ void lsa_insert_data(U8 *buffer, S32 &offset, LLScriptLibData *data, LLScriptAll
 	}
 }
 
+static void lsa_insert_addresses(U8 *buffer, S32 &offset, const std::vector<S32> &addresses)
+{
+	if (get_register(buffer, LREG_FR))
+		return;
+	integer2bytestream(buffer, offset, (S32)addresses.size());
+	for (std::vector<S32>::const_iterator it = addresses.begin(); it != addresses.end(); ++it)
+	{
+		integer2bytestream(buffer, offset, *it);
+	}
+}
+
 S32 lsa_create_data_block(U8 **buffer, LLScriptLibData *data, S32 base_offset)
 {
 	S32 offset = 0;
@@ -919,55 +955,89 @@ void lsa_fprint_heap(U8 *buffer, LLFILE *fp)
 	fprintf(fp, "\n");
 }
 
-S32 lsa_cat_lists(U8 *buffer, S32 offset1, S32 offset2, S32 heapsize)
+// A list entry can be shared by this many lists before it gets copied, so that its reference count
+// doesn't overflow.
+const S16 MAX_SHARED_ENTRY_REFS = 0x7fff;
+
+// Appends the addresses of the entries of the list at offset to addresses, adding a reference to
+// each for the list they will go into, and then drops a reference to the list. The entries aren't
+// copied out of the heap and back like lsa_get_data and lsa_heap_add_data would, since they are
+// never changed in place. Returns FALSE after a fault.
+static BOOL lsa_take_list_entries(U8 *buffer, S32 offset, std::vector<S32> &addresses, S32 heapsize)
 {
-	if (get_register(buffer, LREG_FR))
-		return 0;
-	LLScriptLibData *list1;
-	LLScriptLibData *list2;
-	if (offset1 != offset2)
-	{
-		list1 = lsa_get_data(buffer, offset1, TRUE);
-		list2 = lsa_get_data(buffer, offset2, TRUE);
-	}
-	else
+	S32 orig_offset = offset;
+	S32 hr = get_register(buffer, LREG_HR);
+	offset += hr - 1;
+	if (  (offset < hr)
+		||(offset >= get_register(buffer, LREG_HP)))
 	{
-		list1 = lsa_get_data(buffer, offset1, TRUE);
-		list2 = lsa_get_data(buffer, offset2, TRUE);
+		set_fault(buffer, LSRF_BOUND_CHECK_ERROR);
+		return FALSE;
 	}
+	LLScriptAllocEntry entry;
+	bytestream2alloc_entry(entry, buffer, offset);
 
-	if (  (!list1)
-		||(!list2))
+	if (entry.mType != LST_LIST)
 	{
 		set_fault(buffer, LSRF_HEAP_ERROR);
-		delete list1;
-		delete list2;
-		return 0;
+		return FALSE;
 	}
 
-	if (  (list1->mType != LST_LIST)
-		||(list2->mType != LST_LIST))
+	S32 i, length = bytestream2integer(buffer, offset);
+	addresses.reserve(addresses.size() + length);
+	for (i = 0; i < length; i++)
 	{
-		set_fault(buffer, LSRF_HEAP_ERROR);
-		delete list1;
-		delete list2;
-		return 0;
+		S32 address = bytestream2integer(buffer, offset);
+		S32 entry_offset = address + hr - 1;
+		if (  (entry_offset < hr)
+			||(entry_offset >= get_register(buffer, LREG_HP)))
+		{
+			set_fault(buffer, LSRF_BOUND_CHECK_ERROR);
+			return FALSE;
+		}
+		LLScriptAllocEntry list_entry;
+		bytestream2alloc_entry(list_entry, buffer, entry_offset);
+		if (list_entry.mReferenceCount < MAX_SHARED_ENTRY_REFS)
+		{
+			lsa_increase_ref_count(buffer, address);
+		}
+		else
+		{
+			address = lsa_heap_add_data(buffer, lsa_get_data(buffer, address, FALSE), heapsize, TRUE);
+		}
+		addresses.push_back(address);
 	}
 
-	LLScriptLibData *runner = list1;
+	lsa_decrease_ref_count(buffer, orig_offset);
+	return !get_register(buffer, LREG_FR);
+}
 
-	while (runner->mListp)
+// Adds the entries of data to the heap, appending their addresses to addresses, and deletes them.
+static void lsa_add_entries(U8 *buffer, LLScriptLibData *data, std::vector<S32> &addresses, S32 heapsize)
+{
+	if (data->checkForMultipleLists())
 	{
-		runner = runner->mListp;
+		set_fault(buffer, LSRF_NESTING_LISTS);
 	}
+	for (LLScriptLibData *entry = data->mListp; entry; entry = entry->mListp)
+	{
+		addresses.push_back(lsa_heap_add_data(buffer, entry, heapsize, FALSE));
+	}
+	delete data->mListp;
+	data->mListp = NULL;
+}
 
-	runner->mListp = list2->mListp;
-
-	list2->mListp = NULL;
-
-	delete list2;
-
-	return lsa_heap_add_data(buffer, list1, heapsize, TRUE);
+S32 lsa_cat_lists(U8 *buffer, S32 offset1, S32 offset2, S32 heapsize)
+{
+	if (get_register(buffer, LREG_FR))
+		return 0;
+	std::vector<S32> addresses;
+	if (  !lsa_take_list_entries(buffer, offset1, addresses, heapsize)
+		||!lsa_take_list_entries(buffer, offset2, addresses, heapsize))
+	{
+		return 0;
+	}
+	return lsa_heap_add_list(buffer, addresses, heapsize);
 }
 
 
@@ -1014,73 +1084,209 @@ S32 lsa_cmp_lists(U8 *buffer, S32 offset1, S32 offset2)
 }
 
 
+// These take the entries of data, leaving it empty.
+
 S32 lsa_preadd_lists(U8 *buffer, LLScriptLibData *data, S32 offset2, S32 heapsize)
 {
 	if (get_register(buffer, LREG_FR))
 		return 0;
-	LLScriptLibData *list2 = lsa_get_data(buffer, offset2, TRUE);
-
-	if (!list2)
+	std::vector<S32> addresses;
+	lsa_add_entries(buffer, data, addresses, heapsize);
+	if (!lsa_take_list_entries(buffer, offset2, addresses, heapsize))
 	{
-		set_fault(buffer, LSRF_HEAP_ERROR);
-		delete list2;
 		return 0;
 	}
+	return lsa_heap_add_list(buffer, addresses, heapsize);
+}
 
-	if (list2->mType != LST_LIST)
+
+S32 lsa_postadd_lists(U8 *buffer, S32 offset1, LLScriptLibData *data, S32 heapsize)
+{
+	if (get_register(buffer, LREG_FR))
+		return 0;
+	std::vector<S32> addresses;
+	if (!lsa_take_list_entries(buffer, offset1, addresses, heapsize))
 	{
-		set_fault(buffer, LSRF_HEAP_ERROR);
-		delete list2;
+		delete data->mListp;
+		data->mListp = NULL;
 		return 0;
 	}
+	lsa_add_entries(buffer, data, addresses, heapsize);
+	return lsa_heap_add_list(buffer, addresses, heapsize);
+}
 
-	LLScriptLibData *runner = data->mListp;
 
-	while (runner->mListp)
+// Whether operator<= is a total order on the keys, the first entry of every stride, so that sorting
+// them with a merge sort gives the order the exchange sort does, but for strides with equal keys.
+static bool lsa_sort_keys_ordered(const std::vector<LLScriptLibData*> &sort_array, S32 stride)
+{
+	const LSCRIPTType type = sort_array[0]->mType;
+	for (size_t i = 0; i < sort_array.size(); i += stride)
 	{
-		runner = runner->mListp;
+		const LLScriptLibData *key = sort_array[i];
+		if (key->mType != type)
+		{
+			return false;
+		}
+		switch(type)
+		{
+		case LST_INTEGER:
+			break;
+		case LST_FLOATINGPOINT:
+			if (llisnan(key->mFP))
+				return false;
+			break;
+		case LST_STRING:
+			if (!key->mString)
+				return false;
+			break;
+		case LST_KEY:
+			if (!key->mKey)
+				return false;
+			break;
+		case LST_VECTOR:
+			if (llisnan(key->mVec.magVecSquared()))
+				return false;
+			break;
+		default:
+			// quaternions all compare as <= each other
+			return false;
+		}
 	}
+	return true;
+}
 
+// Whether the stride keyed by right goes before the one keyed by left, which comes first in the list.
+static inline bool lsa_sort_before(const LLScriptLibData *right, const LLScriptLibData *left, bool ascending)
+{
+	return ascending ? !(*left <= *right) : !(*right <= *left);
+}
 
-	runner->mListp = list2->mListp;
-	list2->mListp = data->mListp;
+// Stable bottom up merge sort of the strides, by the index of their first entry.
+static void lsa_merge_sort(std::vector<LLScriptLibData*> &sort_array, S32 stride, bool ascending)
+{
+	S32 number = (S32)sort_array.size();
+	S32 strides = number / stride;
+	std::vector<S32> order(strides), merged(strides);
+	for (S32 i = 0; i < strides; i++)
+	{
+		order[i] = i * stride;
+	}
 
-	return lsa_heap_add_data(buffer, list2, heapsize, TRUE);
+	for (S32 width = 1; width < strides; width *= 2)
+	{
+		for (S32 low = 0; low < strides; low += 2 * width)
+		{
+			S32 mid = llmin(low + width, strides);
+			S32 high = llmin(low + 2 * width, strides);
+			S32 left = low, right = mid, out = low;
+			while (left < mid && right < high)
+			{
+				if (lsa_sort_before(sort_array[order[right]], sort_array[order[left]], ascending))
+				{
+					merged[out++] = order[right++];
+				}
+				else
+				{
+					merged[out++] = order[left++];
+				}
+			}
+			while (left < mid)
+			{
+				merged[out++] = order[left++];
+			}
+			while (right < high)
+			{
+				merged[out++] = order[right++];
+			}
+		}
+		order.swap(merged);
+	}
+
+	std::vector<LLScriptLibData*> sorted;
+	sorted.reserve(number);
+	for (S32 i = 0; i < strides; i++)
+	{
+		for (S32 s = 0; s < stride; s++)
+		{
+			sorted.push_back(sort_array[order[i] + s]);
+		}
+	}
+	sort_array.swap(sorted);
 }
 
+// The sort lsa_bubble_sort always did, for keys that aren't totally ordered, so that those keep
+// coming out the way they did.
+static void lsa_exchange_sort(std::vector<LLScriptLibData*> &sort_array, S32 stride, bool ascending)
+{
+	S32 number = (S32)sort_array.size();
+	for (S32 i = 0; i < number; i += stride)
+	{
+		for (S32 j = i; j < number; j += stride)
+		{
+			if (((*sort_array[i]) <= (*sort_array[j])) != ascending)
+			{
+				for (S32 s = 0; s < stride; s++)
+				{
+					std::swap(sort_array[i + s], sort_array[j + s]);
+				}
+			}
+		}
+	}
+}
 
-S32 lsa_postadd_lists(U8 *buffer, S32 offset1, LLScriptLibData *data, S32 heapsize)
+LLScriptLibData *lsa_bubble_sort(LLScriptLibData *src, S32 stride, S32 ascending)
 {
-	if (get_register(buffer, LREG_FR))
-		return 0;
-	LLScriptLibData *list1 = lsa_get_data(buffer, offset1, TRUE);
+	S32 number = src->getListLength();
 
-	if (!list1)
+	if (number <= 0)
 	{
-		set_fault(buffer, LSRF_HEAP_ERROR);
-		delete list1;
-		return 0;
+		return NULL;
 	}
 
-	if (list1->mType != LST_LIST)
+	if (stride <= 0)
 	{
-		set_fault(buffer, LSRF_HEAP_ERROR);
-		delete list1;
-		return 0;
+		stride = 1;
 	}
 
-	LLScriptLibData *runner = list1;
+	if (number % stride)
+	{
+		LLScriptLibData *retval = src->mListp;
+		src->mListp = NULL;
+		return retval;
+	}
 
-	while (runner->mListp)
+	std::vector<LLScriptLibData*> sort_array;
+	sort_array.reserve(number);
+	LLScriptLibData *temp = src->mListp;
+	while (temp)
 	{
-		runner = runner->mListp;
+		sort_array.push_back(temp);
+		temp = temp->mListp;
 	}
 
-	runner->mListp = data->mListp;
+	if (lsa_sort_keys_ordered(sort_array, stride))
+	{
+		lsa_merge_sort(sort_array, stride, ascending == TRUE);
+	}
+	else
+	{
+		lsa_exchange_sort(sort_array, stride, ascending == TRUE);
+	}
 
-	return lsa_heap_add_data(buffer, list1, heapsize, TRUE);
-}
+	S32 i = 1;
+	temp = sort_array[0];
+	while (i < number)
+	{
+		temp->mListp = sort_array[i++];
+		temp = temp->mListp;
+	}
+	temp->mListp = NULL;
 
+	src->mListp = NULL;
+
+	return sort_array[0];
+}
 
 LLScriptLibData* lsa_randomize(LLScriptLibData* src, S32 stride)
 {
@@ -0,0 +1,548 @@
+/**
+ * @file lscript_alloc_test.cpp
+ * @brief Tests of sorting and appending to LSL lists.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewergpl$
+ *
+ * Copyright (c) 2002-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lscript_alloc.h"
+#include "lscript_library.h"
+
+#include "../test/lltut.h"
+
+#include <limits>
+#include <map>
+#include <vector>
+
+namespace
+{
+	U32 gSeed = 1;
+
+	U32 next_random()
+	{
+		gSeed = gSeed * 1664525u + 1013904223u;
+		return gSeed >> 8;
+	}
+
+	// The exchange sort lsa_bubble_sort was, which the merge sort has to agree with.
+	LLScriptLibData *exchange_sort(LLScriptLibData *src, S32 stride, S32 ascending)
+	{
+		S32 number = src->getListLength();
+		if (number <= 0)
+		{
+			return NULL;
+		}
+		if (stride <= 0)
+		{
+			stride = 1;
+		}
+		if (number % stride)
+		{
+			LLScriptLibData *retval = src->mListp;
+			src->mListp = NULL;
+			return retval;
+		}
+
+		std::vector<LLScriptLibData*> sortarray;
+		for (LLScriptLibData *temp = src->mListp; temp; temp = temp->mListp)
+		{
+			sortarray.push_back(temp);
+		}
+		for (S32 i = 0; i < number; i += stride)
+		{
+			for (S32 j = i; j < number; j += stride)
+			{
+				if (((*sortarray[i]) <= (*sortarray[j])) != (ascending == TRUE))
+				{
+					for (S32 s = 0; s < stride; s++)
+					{
+						std::swap(sortarray[i + s], sortarray[j + s]);
+					}
+				}
+			}
+		}
+		for (S32 i = 0; i + 1 < number; i++)
+		{
+			sortarray[i]->mListp = sortarray[i + 1];
+		}
+		sortarray[number - 1]->mListp = NULL;
+		src->mListp = NULL;
+		return sortarray[0];
+	}
+
+	// An entry of type whose key is value; distinct values give distinct keys.
+	LLScriptLibData *make_entry(LSCRIPTType type, S32 value)
+	{
+		switch (type)
+		{
+		case LST_FLOATINGPOINT:
+			return new LLScriptLibData(value * 0.25f);
+		case LST_STRING:
+			{
+				std::string text = llformat("s%06d", value + 500000);
+				return new LLScriptLibData(text.c_str());
+			}
+		case LST_KEY:
+			{
+				LLUUID id;
+				id.mData[0] = (U8)((value + 0x8000) >> 8);
+				id.mData[1] = (U8)(value + 0x8000);
+				return new LLScriptLibData(id);
+			}
+		case LST_VECTOR:
+			return new LLScriptLibData(LLVector3((F32)(value + 1000), 0.f, 1.f));
+		case LST_QUATERNION:
+			return new LLScriptLibData(LLQuaternion((F32)value, 0.f, 0.f, 1.f));
+		default:
+			return new LLScriptLibData(value);
+		}
+	}
+
+	// Sorts two copies of the same list, one with lsa_bubble_sort and one with the old exchange sort,
+	// and returns the positions that the entries came from for each.
+	struct SortedPair
+	{
+		std::vector<S32> mSorted;
+		std::vector<S32> mExpected;
+		std::vector<LLScriptLibData*> mSortedEntries;
+		std::vector<LLScriptLibData*> mExpectedEntries;
+		LLScriptLibData *mSortedList;
+		LLScriptLibData *mExpectedList;
+
+		SortedPair() : mSortedList(NULL), mExpectedList(NULL) {}
+		~SortedPair()
+		{
+			delete mSortedList;
+			delete mExpectedList;
+		}
+	};
+
+	std::vector<S32> positions(LLScriptLibData *sorted, const std::map<LLScriptLibData*, S32> &position)
+	{
+		std::vector<S32> result;
+		for (; sorted; sorted = sorted->mListp)
+		{
+			result.push_back(position.find(sorted)->second);
+		}
+		return result;
+	}
+
+	void sort_both(const std::vector<LSCRIPTType> &types, const std::vector<S32> &values, S32 stride, S32 ascending, SortedPair &pair)
+	{
+		LLScriptLibData src1, src2;
+		LLScriptLibData *tip1 = &src1, *tip2 = &src2;
+		std::map<LLScriptLibData*, S32> position;
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			tip1 = tip1->mListp = make_entry(types[i], values[i]);
+			tip2 = tip2->mListp = make_entry(types[i], values[i]);
+			position[tip1] = position[tip2] = (S32)i;
+		}
+
+		LLScriptLibData *sorted = lsa_bubble_sort(&src1, stride, ascending);
+		LLScriptLibData *expected = exchange_sort(&src2, stride, ascending);
+		pair.mSorted = positions(sorted, position);
+		pair.mExpected = positions(expected, position);
+		pair.mSortedEntries.clear();
+		pair.mExpectedEntries.clear();
+		for (LLScriptLibData *entry = sorted; entry; entry = entry->mListp)
+		{
+			pair.mSortedEntries.push_back(entry);
+		}
+		for (LLScriptLibData *entry = expected; entry; entry = entry->mListp)
+		{
+			pair.mExpectedEntries.push_back(entry);
+		}
+
+		// Hang them off a head that deletes them.
+		delete pair.mSortedList;
+		delete pair.mExpectedList;
+		pair.mSortedList = new LLScriptLibData;
+		pair.mSortedList->mListp = sorted;
+		pair.mExpectedList = new LLScriptLibData;
+		pair.mExpectedList->mListp = expected;
+	}
+
+	// A script's memory with an empty heap, as the compiler lays it out.
+	const S32 HEAP_START = 1024;
+
+	struct Heap
+	{
+		std::vector<U8> mBuffer;
+
+		Heap() : mBuffer(TOP_OF_MEMORY, 0)
+		{
+			U8 *buffer = &mBuffer[0];
+			U8 *block;
+			S32 size = lsa_create_data_block(&block, NULL, 0);
+			memcpy(buffer + HEAP_START, block, size);
+			delete [] block;
+			set_register(buffer, LREG_HR, HEAP_START);
+			set_register(buffer, LREG_HP, HEAP_START + size);
+			set_register(buffer, LREG_SP, TOP_OF_MEMORY);
+			set_register(buffer, LREG_TM, TOP_OF_MEMORY);
+		}
+
+		U8 *buffer()			{ return &mBuffer[0]; }
+		S32 heapsize()			{ return get_max_heap_size(buffer()); }
+
+		S32 addList(S32 first, S32 count)
+		{
+			LLScriptLibData list;
+			list.mType = LST_LIST;
+			LLScriptLibData *tip = &list;
+			for (S32 i = 0; i < count; i++)
+			{
+				tip = tip->mListp = make_entry((LSCRIPTType)(LST_INTEGER + i % 6 % 5), first + i);
+			}
+			return lsa_heap_add_data(buffer(), &list, heapsize(), FALSE);
+		}
+
+		// The entries of the list at address, as the values they were made from.
+		std::vector<S32> values(S32 address)
+		{
+			std::vector<S32> result;
+			LLScriptLibData *list = lsa_get_data(buffer(), address, FALSE);
+			for (LLScriptLibData *entry = list->mListp; entry; entry = entry->mListp)
+			{
+				switch (entry->mType)
+				{
+				case LST_FLOATINGPOINT:
+					result.push_back(llround(entry->mFP * 4.f));
+					break;
+				case LST_STRING:
+					result.push_back(atoi(entry->mString + 1) - 500000);
+					break;
+				case LST_KEY:
+					{
+						LLUUID id(entry->mKey);
+						result.push_back(((id.mData[0] << 8) | id.mData[1]) - 0x8000);
+					}
+					break;
+				case LST_VECTOR:
+					result.push_back(llround(entry->mVec.mV[VX]) - 1000);
+					break;
+				default:
+					result.push_back(entry->mInteger);
+					break;
+				}
+			}
+			delete list;
+			return result;
+		}
+
+		// Whether every block has been freed.
+		bool empty()
+		{
+			S32 offset = get_register(buffer(), LREG_HR);
+			S32 hp = get_register(buffer(), LREG_HP);
+			while (offset < hp)
+			{
+				LLScriptAllocEntry entry;
+				S32 next = offset;
+				bytestream2alloc_entry(entry, buffer(), next);
+				if (entry.mType)
+				{
+					return false;
+				}
+				offset = next + entry.mSize;
+			}
+			return true;
+		}
+	};
+
+	std::vector<S32> range(S32 first, S32 count)
+	{
+		std::vector<S32> result;
+		for (S32 i = 0; i < count; i++)
+		{
+			result.push_back(first + i);
+		}
+		return result;
+	}
+
+	// The list operations take the entries of the list they are given, like the VM gives them.
+	S32 postadd(Heap &heap, S32 list, S32 value)
+	{
+		LLScriptLibData data;
+		data.mType = LST_LIST;
+		data.mListp = make_entry((LSCRIPTType)(LST_INTEGER + value % 5), value);
+		return lsa_postadd_lists(heap.buffer(), list, &data, heap.heapsize());
+	}
+
+	S32 preadd(Heap &heap, S32 value, S32 list)
+	{
+		LLScriptLibData data;
+		data.mType = LST_LIST;
+		data.mListp = make_entry((LSCRIPTType)(LST_INTEGER + (value + 50) % 5), value);
+		return lsa_preadd_lists(heap.buffer(), &data, list, heap.heapsize());
+	}
+}
+
+namespace tut
+{
+	struct lscript_alloc_test
+	{
+		lscript_alloc_test()
+		{
+			gSeed = 1;
+		}
+	};
+	typedef test_group<lscript_alloc_test> lscript_alloc_test_t;
+	typedef lscript_alloc_test_t::object lscript_alloc_test_object_t;
+	tut::lscript_alloc_test_t tut_lscript_alloc_test("LScriptAlloc");
+
+	// Distinct keys of every type that sorts by value come out exactly as the exchange sort puts them.
+	template<> template<>
+	void lscript_alloc_test_object_t::test<1>()
+	{
+		const LSCRIPTType types[] = { LST_INTEGER, LST_FLOATINGPOINT, LST_STRING, LST_KEY, LST_VECTOR };
+		const S32 ascendings[] = { TRUE, FALSE, 2 };
+		for (U32 t = 0; t < LL_ARRAY_SIZE(types); t++)
+		{
+			for (S32 stride = 1; stride <= 4; stride++)
+			{
+				for (U32 a = 0; a < LL_ARRAY_SIZE(ascendings); a++)
+				{
+					for (S32 length = stride; length <= 60; length += stride * 7)
+					{
+						// Keys are a permutation; the rest of each stride is random.
+						std::vector<S32> keys = range(-length / 2, length / stride);
+						for (S32 i = (S32)keys.size() - 1; i > 0; i--)
+						{
+							std::swap(keys[i], keys[next_random() % (i + 1)]);
+						}
+						std::vector<LSCRIPTType> entry_types;
+						std::vector<S32> values;
+						for (S32 i = 0; i < length; i++)
+						{
+							entry_types.push_back(i % stride ? LST_INTEGER : types[t]);
+							values.push_back(i % stride ? (S32)(next_random() % 5) : keys[i / stride]);
+						}
+
+						SortedPair pair;
+						sort_both(entry_types, values, stride, ascendings[a], pair);
+						ensure("same order as the exchange sort", pair.mSorted == pair.mExpected);
+					}
+				}
+			}
+		}
+	}
+
+	// Equal keys in a stride of one are the same value, so the order of equal keys doesn't show.
+	template<> template<>
+	void lscript_alloc_test_object_t::test<2>()
+	{
+		const LSCRIPTType types[] = { LST_INTEGER, LST_FLOATINGPOINT, LST_STRING, LST_KEY };
+		for (U32 t = 0; t < LL_ARRAY_SIZE(types); t++)
+		{
+			for (S32 ascending = FALSE; ascending <= TRUE; ascending++)
+			{
+				std::vector<LSCRIPTType> entry_types(200, types[t]);
+				std::vector<S32> values;
+				for (S32 i = 0; i < 200; i++)
+				{
+					values.push_back(next_random() % 10);
+				}
+
+				SortedPair pair;
+				sort_both(entry_types, values, 1, ascending, pair);
+				ensure_equals("length", pair.mSortedEntries.size(), pair.mExpectedEntries.size());
+				for (size_t i = 0; i < pair.mSortedEntries.size(); i++)
+				{
+					ensure("same values as the exchange sort", *pair.mSortedEntries[i] == *pair.mExpectedEntries[i]);
+				}
+			}
+		}
+	}
+
+	// Strides with equal keys are ordered like the exchange sort orders their keys, and stay in the order they were in.
+	template<> template<>
+	void lscript_alloc_test_object_t::test<3>()
+	{
+		for (S32 ascending = FALSE; ascending <= TRUE; ascending++)
+		{
+			std::vector<LSCRIPTType> entry_types;
+			std::vector<S32> values;
+			for (S32 i = 0; i < 300; i++)
+			{
+				entry_types.push_back(LST_INTEGER);
+				values.push_back(next_random() % 8);
+			}
+
+			SortedPair pair;
+			sort_both(entry_types, values, 3, ascending, pair);
+			ensure_equals("length", pair.mSorted.size(), (size_t)300);
+			for (size_t i = 0; i < pair.mSorted.size(); i += 3)
+			{
+				ensure_equals("key", pair.mSortedEntries[i]->mInteger, pair.mExpectedEntries[i]->mInteger);
+				ensure_equals("stride kept together", pair.mSorted[i + 1], pair.mSorted[i] + 1);
+				ensure_equals("stride kept together", pair.mSorted[i + 2], pair.mSorted[i] + 2);
+				if (i && pair.mSortedEntries[i]->mInteger == pair.mSortedEntries[i - 3]->mInteger)
+				{
+					ensure("equal keys keep their order", pair.mSorted[i] > pair.mSorted[i - 3]);
+				}
+			}
+		}
+	}
+
+	// Keys that operator<= doesn't order, of mixed types or quaternions, come out as they did.
+	template<> template<>
+	void lscript_alloc_test_object_t::test<4>()
+	{
+		const LSCRIPTType types[] = { LST_INTEGER, LST_FLOATINGPOINT, LST_STRING, LST_KEY, LST_VECTOR, LST_QUATERNION };
+		for (S32 stride = 1; stride <= 2; stride++)
+		{
+			for (S32 ascending = FALSE; ascending <= TRUE; ascending++)
+			{
+				for (S32 mixed = 0; mixed <= 1; mixed++)
+				{
+					std::vector<LSCRIPTType> entry_types;
+					std::vector<S32> values;
+					for (S32 i = 0; i < 40; i++)
+					{
+						entry_types.push_back(mixed ? types[next_random() % LL_ARRAY_SIZE(types)] : LST_QUATERNION);
+						values.push_back(next_random() % 20);
+					}
+
+					SortedPair pair;
+					sort_both(entry_types, values, stride, ascending, pair);
+					ensure("same order as the exchange sort", pair.mSorted == pair.mExpected);
+				}
+			}
+		}
+
+		// As do floats when one is NaN.
+		std::vector<LSCRIPTType> entry_types(10, LST_FLOATINGPOINT);
+		SortedPair pair;
+		sort_both(entry_types, range(0, 10), 1, TRUE, pair);
+		pair.mSortedEntries[3]->mFP = pair.mExpectedEntries[3]->mFP = std::numeric_limits<F32>::quiet_NaN();
+
+		LLScriptLibData src1, src2;
+		src1.mListp = pair.mSortedList->mListp;
+		src2.mListp = pair.mExpectedList->mListp;
+		pair.mSortedList->mListp = lsa_bubble_sort(&src1, 1, FALSE);
+		pair.mExpectedList->mListp = exchange_sort(&src2, 1, FALSE);
+		LLScriptLibData *a = pair.mSortedList->mListp;
+		LLScriptLibData *b = pair.mExpectedList->mListp;
+		for (; a && b; a = a->mListp, b = b->mListp)
+		{
+			ensure("NaN sorts as it did", a->mFP == b->mFP || (llisnan(a->mFP) && llisnan(b->mFP)));
+		}
+		ensure("same length", !a && !b);
+	}
+
+	// Empty lists, bad strides and lists that aren't a multiple of the stride.
+	template<> template<>
+	void lscript_alloc_test_object_t::test<5>()
+	{
+		LLScriptLibData empty;
+		ensure("empty list", lsa_bubble_sort(&empty, 1, TRUE) == NULL);
+
+		std::vector<LSCRIPTType> entry_types(7, LST_INTEGER);
+		std::vector<S32> values;
+		values.push_back(5);
+		values.push_back(3);
+		values.push_back(6);
+		values.push_back(1);
+		values.push_back(4);
+		values.push_back(0);
+		values.push_back(2);
+
+		SortedPair pair;
+		sort_both(entry_types, values, 2, TRUE, pair);
+		ensure("not a multiple of the stride", pair.mSorted == range(0, 7));
+
+		sort_both(entry_types, values, 0, TRUE, pair);
+		ensure("a stride of 0 is 1", pair.mSorted == pair.mExpected);
+		sort_both(entry_types, values, -3, FALSE, pair);
+		ensure("a negative stride is 1", pair.mSorted == pair.mExpected);
+	}
+
+	// Appending to and concatenating lists gives the entries in order, and frees everything once the lists are released.
+	template<> template<>
+	void lscript_alloc_test_object_t::test<6>()
+	{
+		Heap heap;
+		U8 *buffer = heap.buffer();
+
+		S32 list = heap.addList(0, 3);
+		for (S32 i = 3; i < 40; i++)
+		{
+			list = postadd(heap, list, i);
+		}
+		ensure_equals("no fault", get_register(buffer, LREG_FR), 0);
+		ensure("appended", heap.values(list) == range(0, 40));
+
+		for (S32 i = -1; i >= -10; i--)
+		{
+			list = preadd(heap, i, list);
+		}
+		ensure("prepended", heap.values(list) == range(-10, 50));
+
+		S32 other = heap.addList(40, 5);
+		list = lsa_cat_lists(buffer, list, other, heap.heapsize());
+		ensure("concatenated", heap.values(list) == range(-10, 55));
+
+		lsa_increase_ref_count(buffer, list);
+		list = lsa_cat_lists(buffer, list, list, heap.heapsize());
+		std::vector<S32> twice = range(-10, 55);
+		twice.insert(twice.end(), twice.begin(), twice.end());
+		ensure("concatenated with itself", heap.values(list) == twice);
+
+		ensure_equals("no fault", get_register(buffer, LREG_FR), 0);
+		lsa_decrease_ref_count(buffer, list);
+		ensure("everything freed", heap.empty());
+	}
+
+	// A list that another variable still holds doesn't change when the first is appended to.
+	template<> template<>
+	void lscript_alloc_test_object_t::test<7>()
+	{
+		Heap heap;
+		U8 *buffer = heap.buffer();
+
+		S32 first = heap.addList(0, 4);
+		lsa_increase_ref_count(buffer, first);
+		S32 second = postadd(heap, postadd(heap, first, 4), 5);
+		S32 third = preadd(heap, -1, second);
+		lsa_increase_ref_count(buffer, third);
+
+		ensure("first unchanged", heap.values(first) == range(0, 4));
+		ensure("third", heap.values(third) == range(-1, 7));
+
+		lsa_decrease_ref_count(buffer, first);
+		ensure("third still there", heap.values(third) == range(-1, 7));
+		lsa_decrease_ref_count(buffer, third);
+		lsa_decrease_ref_count(buffer, third);
+		ensure_equals("no fault", get_register(buffer, LREG_FR), 0);
+		ensure("everything freed", heap.empty());
+	}
+}
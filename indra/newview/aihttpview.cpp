@@ -45,6 +45,8 @@ namespace AICurlInterface {
   size_t getHTTPBandwidth(void);
   U32 getNumHTTPAdded(void);
   U32 getMaxHTTPAdded(void);
+  bool usingEPoll(void);
+  void getCurlThreadLoopStats(U32& wakeups, U32& ready_fds);
 } // namespace AICurlInterface
 
 //=============================================================================
@@ -182,7 +184,7 @@ LLRect AIServiceBar::getRequiredRect(void)
 
 //=============================================================================
 
-static int const number_of_header_lines = 2;
+static int const number_of_header_lines = 3;
 
 class AIGLHTTPHeaderBar : public LLView
 {
@@ -262,6 +264,13 @@ void AIGLHTTPHeaderBar::draw(void)
   start += LLFontGL::getFontMonospace()->getWidth(text);
   text = llformat("/%lu", max_bandwidth / 125);
   LLFontGL::getFontMonospace()->renderUTF8(text, 0, start, height, text_color, LLFontGL::LEFT, LLFontGL::TOP);
+
+  // Third header line.
+  height -= sLineHeight;
+  mHTTPView->updateLoopStats();
+  text = llformat("Curl thread (%s): %.1f wakeups/s, %.2f ready fds/wakeup",
+	  AICurlInterface::usingEPoll() ? "epoll" : "select", mHTTPView->mWakeUpsPerSecond, mHTTPView->mReadyFdsPerWakeUp);
+  LLFontGL::getFontMonospace()->renderUTF8(text, 0, h_offset, height, text_color, LLFontGL::LEFT, LLFontGL::TOP);
 }
 
 BOOL AIGLHTTPHeaderBar::handleMouseDown(S32 x, S32 y, MASK mask)
@@ -279,7 +288,8 @@ LLRect AIGLHTTPHeaderBar::getRequiredRect()
 //=============================================================================
 
 AIHTTPView::AIHTTPView(AIHTTPView::Params const& p) :
-	LLContainerView(p), mGLHTTPHeaderBar(NULL), mWidth(200)
+	LLContainerView(p), mGLHTTPHeaderBar(NULL), mWidth(200),
+	mLoopStatsTime_40ms(0), mLastWakeUps(0), mLastReadyFds(0), mWakeUpsPerSecond(0.f), mReadyFdsPerWakeUp(0.f)
 {
   setVisible(FALSE);
   setRectAlpha(0.5);
@@ -291,6 +301,26 @@ AIHTTPView::~AIHTTPView()
   mGLHTTPHeaderBar = NULL;
 }
 
+// Recalculate the curl thread loop statistics once per second.
+void AIHTTPView::updateLoopStats(void)
+{
+  U64 const delta_40ms = sTime_40ms - mLoopStatsTime_40ms;
+  if (delta_40ms < 25)
+	return;
+  U32 wakeups, ready_fds;
+  AICurlInterface::getCurlThreadLoopStats(wakeups, ready_fds);
+  if (mLoopStatsTime_40ms)
+  {
+	U32 const delta_wakeups = wakeups - mLastWakeUps;		// Unsigned arithmetic handles the wrap around.
+	U32 const delta_ready_fds = ready_fds - mLastReadyFds;
+	mWakeUpsPerSecond = delta_wakeups * 25.f / delta_40ms;
+	mReadyFdsPerWakeUp = delta_wakeups ? (F32)delta_ready_fds / delta_wakeups : 0.f;
+  }
+  mLoopStatsTime_40ms = sTime_40ms;
+  mLastWakeUps = wakeups;
+  mLastReadyFds = ready_fds;
+}
+
 U32 AIHTTPView::updateColumn(U32 col, U32 start)
 {
   if (col > mStartColumn.size())
@@ -55,6 +55,7 @@ class AIHTTPView : public LLContainerView
 
 	U32 updateColumn(U32 col, U32 start);
 	void setWidth(S32 width) { mWidth = width; }
+	void updateLoopStats(void);
 
   private:
 	AIGLHTTPHeaderBar* mGLHTTPHeaderBar;
@@ -63,6 +64,13 @@ class AIHTTPView : public LLContainerView
 	size_t mMaxBandwidthPerService;
 	S32 mWidth;
 
+	// Curl thread loop statistics.
+	U64 mLoopStatsTime_40ms;		// Time of the last update of the fields below.
+	U32 mLastWakeUps;
+	U32 mLastReadyFds;
+	F32 mWakeUpsPerSecond;
+	F32 mReadyFdsPerWakeUp;
+
 	static U64 sTime_40ms;
 
   public:
@@ -1473,6 +1473,7 @@ void LLDrawPoolAvatar::getRiggedGeometry(LLFace* face, LLPointer<LLVertexBuffer>
 
 		face->setSize(vol_face.mNumVertices, vol_face.mNumIndices);
 		face->setVertexBuffer(buffer);
+		face->mSkinPaletteHash = 0;	// The positions and normals written below aren't skinned.
 
 		U16 offset = 0;
 		
@@ -1549,7 +1550,7 @@ void LLDrawPoolAvatar::updateRiggedFaceVertexBuffer(LLVOAvatar* avatar, LLFace*
 
 	if (sShaderLevel <= 0 && face->mLastSkinTime < avatar->getLastSkinTime())
 	{
-		avatar->updateSoftwareSkinnedVertices(skin, weight, vol_face, buffer);
+		avatar->updateSoftwareSkinnedVertices(skin, weight, vol_face, buffer, &face->mSkinPaletteHash);
 	}
 }
 
@@ -64,7 +64,8 @@ void LLDrawPoolGround::prerender()
 
 void LLDrawPoolGround::render(S32 pass)
 {
-	if (mDrawFace.empty() || !gSavedSettings.getBOOL("RenderGround"))
+	static LLControlHandle render_ground(gSavedSettings, "RenderGround");
+	if (mDrawFace.empty() || !render_ground.getBOOL())
 	{
 		return;
 	}	
@@ -40,6 +40,7 @@
 #include "llvolume.h"
 #include "m3math.h"
 #include "llmatrix4a.h"
+#include "llvertexfill.h"
 #include "v3color.h"
 
 #include "lldrawpoolavatar.h"
@@ -127,6 +128,7 @@ void LLFace::init(LLDrawable* drawablep, LLViewerObject* objp)
 	mLastUpdateTime = gFrameTimeSeconds;
 	mLastMoveTime = 0.f;
 	mLastSkinTime = gFrameTimeSeconds;
+	mSkinPaletteHash = 0;
 	mVSize = 0.f;
 	mPixelArea = 16.f;
 	mState      = GLOBAL;
@@ -744,50 +746,6 @@ static void xform(LLVector2 &tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 of
 	tex_coord.mV[1] = t;
 }
 
-// Transform the texture coordinates for this face.
-static void xform4a(LLVector4a &tex_coord, const LLVector4a& trans, const LLVector4Logical& mask, const LLVector4a& rot0, const LLVector4a& rot1, const LLVector4a& offset, const LLVector4a& scale) 
-{
-	//tex coord is two coords, <s0, t0, s1, t1>
-	LLVector4a st;
-
-	// Texture transforms are done about the center of the face.
-	st.setAdd(tex_coord, trans);
-	
-	// Handle rotation
-	LLVector4a rot_st;
-		
-	// <s0 * cosAng, s0*-sinAng, s1*cosAng, s1*-sinAng>
-	LLVector4a s0;
-	s0.splat(st, 0);
-	LLVector4a s1;
-	s1.splat(st, 2);
-	LLVector4a ss;
-	ss.setSelectWithMask(mask, s1, s0);
-
-	LLVector4a a; 
-	a.setMul(rot0, ss);
-	
-	// <t0*sinAng, t0*cosAng, t1*sinAng, t1*cosAng>
-	LLVector4a t0;
-	t0.splat(st, 1);
-	LLVector4a t1;
-	t1.splat(st, 3);
-	LLVector4a tt;
-	tt.setSelectWithMask(mask, t1, t0);
-
-	LLVector4a b;
-	b.setMul(rot1, tt);
-		
-	st.setAdd(a,b);
-
-	// Then scale
-	st.mul(scale);
-
-	// Then offset
-	tex_coord.setAdd(st, offset);
-}
-
-
 bool less_than_max_mag(const LLVector4a& vec)
 {
 #if 1
@@ -1587,16 +1545,9 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			LLFastTimer t(FTM_FACE_GEOM_TEXTURE);
 									
 			//bump setup
-			LLVector4a binormal_dir( -sin_ang, cos_ang, 0.f );
 			LLVector4a bump_s_primary_light_ray(0.f, 0.f, 0.f);
 			LLVector4a bump_t_primary_light_ray(0.f, 0.f, 0.f);
 
-			LLQuaternion bump_quat;
-			if (mDrawablep->isActive())
-			{
-				bump_quat = LLQuaternion(mDrawablep->getRenderMatrix());
-			}
-		
 			if (bump_code)
 			{
 				mVObjp->getVolume()->genTangents(f);
@@ -1719,93 +1670,29 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 						else
 						{
 							LLFastTimer t(FTM_FACE_TEX_QUICK_XFORM);
-							F32* dst = (F32*) tex_coords0.get();
-							LLVector4a* src = (LLVector4a*) vf.mTexCoords;
-
-							LLVector4a trans;
-							trans.splat(-0.5f);
-
-							LLVector4a rot0;
-							rot0.set(cos_ang, -sin_ang, cos_ang, -sin_ang);
-
-							LLVector4a rot1;
-							rot1.set(sin_ang, cos_ang, sin_ang, cos_ang);
-
-							LLVector4a scale;
-							scale.set(ms, mt, ms, mt);
-
-							LLVector4a offset;
-							offset.set(os+0.5f, ot+0.5f, os+0.5f, ot+0.5f);
-
-							LLVector4Logical mask;
-							mask.clear();
-							mask.setElement<2>();
-							mask.setElement<3>();
-
-							U32 count = num_vertices/2 + num_vertices%2;
-
-							for (U32 i = 0; i < count; i++)
-							{	
-								LLVector4a res = *src++;
-								xform4a(res, trans, mask, rot0, rot1, offset, scale);
-								res.store4a(dst);
-								dst += 4;
-							}
+							LLVertexFill::transformTexCoords(tex_coords0.get(), vf.mTexCoords, num_vertices,
+															 LLVertexFill::TexTransform(cos_ang, sin_ang, os, ot, ms, mt));
 						}
 					}
 					else
 					{ //do tex mat, no texgen, no atlas, no bump
-						for (S32 i = 0; i < num_vertices; i++)
-						{	
-							LLVector2 tc(vf.mTexCoords[i]);
-							//LLVector4a& norm = vf.mNormals[i];
-							//LLVector4a& center = *(vf.mCenter);
-
-							LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
-							tmp = tmp * *mTextureMatrix;
-							tc.mV[0] = tmp.mV[0];
-							tc.mV[1] = tmp.mV[1];
-							*tex_coords0++ = tc;	
-						}
+						LLVertexFill::transformTexCoords(tex_coords0.get(), vf.mTexCoords, num_vertices, *mTextureMatrix);
 					}
 				}
 				else
 				{ //no bump, no atlas, tex gen planar
 					LLFastTimer t(FTM_FACE_TEX_QUICK_PLANAR);
+					// Project into local memory, the vertex buffer may be write combined.
+					std::vector<LLVector2> planar(num_vertices);
+					LLVertexFill::planarTexCoords(&planar[0], vf.mPositions, vf.mNormals, num_vertices, scalea);
 					if (do_tex_mat)
 					{
-						for (S32 i = 0; i < num_vertices; i++)
-						{	
-							LLVector2 tc(vf.mTexCoords[i]);
-							LLVector4a& norm = vf.mNormals[i];
-							LLVector4a& center = *(vf.mCenter);
-							LLVector4a vec = vf.mPositions[i];	
-							vec.mul(scalea);
-							planarProjection(tc, norm, center, vec);
-						
-							LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
-							tmp = tmp * *mTextureMatrix;
-							tc.mV[0] = tmp.mV[0];
-							tc.mV[1] = tmp.mV[1];
-				
-							*tex_coords0++ = tc;	
-						}
+						LLVertexFill::transformTexCoords(tex_coords0.get(), &planar[0], num_vertices, *mTextureMatrix);
 					}
 					else
 					{
-						for (S32 i = 0; i < num_vertices; i++)
-						{	
-							LLVector2 tc(vf.mTexCoords[i]);
-							LLVector4a& norm = vf.mNormals[i];
-							LLVector4a& center = *(vf.mCenter);
-							LLVector4a vec = vf.mPositions[i];	
-							vec.mul(scalea);
-							planarProjection(tc, norm, center, vec);
-						
-							xform(tc, cos_ang, sin_ang, os, ot, ms, mt);
-
-							*tex_coords0++ = tc;	
-						}
+						LLVertexFill::transformTexCoords(tex_coords0.get(), &planar[0], num_vertices,
+														 LLVertexFill::TexTransform(cos_ang, sin_ang, os, ot, ms, mt));
 					}
 				}
 
@@ -1818,6 +1705,14 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			{ //either bump mapped or in atlas, just do the whole expensive loop
 				LLFastTimer t(FTM_FACE_TEX_DEFAULT);
 
+				std::vector<LLVector2> planar;
+				if (texgen == LLTextureEntry::TEX_GEN_PLANAR)
+				{ //the same for all channels
+					planar.resize(num_vertices);
+					LLVertexFill::planarTexCoords(&planar[0], vf.mPositions, vf.mNormals, num_vertices, scalea);
+				}
+				const LLVector2* src = planar.empty() ? vf.mTexCoords : &planar[0];
+
 				std::vector<LLVector2> bump_tc;
 
 				if (mat && !mat->getNormalID().isNull())
@@ -1827,6 +1722,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 				LLStrider<LLVector2> dst;
 
+				// The channels below load the rotation of the normal and specular maps; the bump offsets use the diffuse one.
+				const F32 bump_cos_ang = cos_ang;
+				const F32 bump_sin_ang = sin_ang;
+
 				for (U32 ch = 0; ch < 3; ++ch)
 				{
 					switch (ch)
@@ -1876,43 +1775,28 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 					}
 					
 
-					for (S32 i = 0; i < num_vertices; i++)
-					{	
-						LLVector2 tc(vf.mTexCoords[i]);
-			
-						LLVector4a& norm = vf.mNormals[i];
-				
-						LLVector4a& center = *(vf.mCenter);
-		   
-						if (texgen != LLTextureEntry::TEX_GEN_DEFAULT)
-						{
-							LLVector4a vec = vf.mPositions[i];
-				
-							vec.mul(scalea);
-
-							if (texgen == LLTextureEntry::TEX_GEN_PLANAR)
-							{
-								planarProjection(tc, norm, center, vec);
-							}
-						}
-
+					if (do_bump && ch == 0)
+					{ //keep a copy to offset, rather than read back from the vertex buffer
+						bump_tc.resize(num_vertices);
 						if (tex_mode && mTextureMatrix)
 						{
-							LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
-							tmp = tmp * *mTextureMatrix;
-							tc.mV[0] = tmp.mV[0];
-							tc.mV[1] = tmp.mV[1];
+							LLVertexFill::transformTexCoords(&bump_tc[0], src, num_vertices, *mTextureMatrix);
 						}
 						else
 						{
-							xform(tc, cos_ang, sin_ang, os, ot, ms, mt);
-						}
-
-						*dst++ = tc;
-						if (do_bump)
-						{
-							bump_tc.push_back(tc);
+							LLVertexFill::transformTexCoords(&bump_tc[0], src, num_vertices,
+															 LLVertexFill::TexTransform(cos_ang, sin_ang, os, ot, ms, mt));
 						}
+						memcpy(dst.get(), &bump_tc[0], num_vertices * sizeof(LLVector2));
+					}
+					else if (tex_mode && mTextureMatrix)
+					{
+						LLVertexFill::transformTexCoords(dst.get(), src, num_vertices, *mTextureMatrix);
+					}
+					else
+					{
+						LLVertexFill::transformTexCoords(dst.get(), src, num_vertices,
+														 LLVertexFill::TexTransform(cos_ang, sin_ang, os, ot, ms, mt));
 					}
 				}
 
@@ -1925,38 +1809,17 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 				{
 					mVertexBuffer->getTexCoord1Strider(tex_coords1, mGeomIndex, mGeomCount, map_range);
 		
-					for (S32 i = 0; i < num_vertices; i++)
+					// The binormal is rotated by the render matrix of an active drawable after the normal matrix.
+					LLMatrix4a bump_mat = mat_normal;
+					if (mDrawablep->isActive())
 					{
-						LLVector4a tangent = vf.mTangents[i];
-
-						LLVector4a binorm;
-						binorm.setCross3(vf.mNormals[i], tangent);
-						binorm.mul(tangent.getF32ptr()[3]);
-						
-						LLMatrix4a tangent_to_object;
-						tangent_to_object.setRows(tangent, binorm, vf.mNormals[i]);
-						LLVector4a t;
-						tangent_to_object.rotate(binormal_dir, t);
-						LLVector4a binormal;
-						mat_normal.rotate(t, binormal);
-						
-						//VECTORIZE THIS
-						if (mDrawablep->isActive())
-						{
-							LLVector3 t;
-							t.set(binormal.getF32ptr());
-							t *= bump_quat;
-							binormal.load3(t.mV);
-						}
-
-						binormal.normalize3fast();
-
-						LLVector2 tc = bump_tc[i];
-						tc += LLVector2( bump_s_primary_light_ray.dot3(tangent).getF32(), bump_t_primary_light_ray.dot3(binormal).getF32() );
-					
-						*tex_coords1++ = tc;
+						LLQuaternion bump_quat(mDrawablep->getRenderMatrix());
+						bump_mat.loadu(mat_norm_in * bump_quat.getMatrix3());
 					}
 
+					LLVertexFill::bumpTexCoords(tex_coords1.get(), &bump_tc[0], vf.mNormals, vf.mTangents, num_vertices,
+												bump_mat, bump_cos_ang, bump_sin_ang, bump_s_primary_light_ray, bump_t_primary_light_ray);
+
 					if (map_range)
 					{
 						mVertexBuffer->flush();
@@ -1967,13 +1830,6 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 		if (rebuild_pos)
 		{
-			LLVector4a* src = vf.mPositions;
-			
-			//_mm_prefetch((char*)src, _MM_HINT_T0);
-
-			LLVector4a* end = src+num_vertices;
-			//LLVector4a* end_64 = end-4;
-
 			//LLFastTimer t(FTM_FACE_GEOM_POSITION);
 			llassert(num_vertices > 0);
 		
@@ -1982,83 +1838,10 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			LLMatrix4a mat_vert;
 			mat_vert.loadu(mat_vert_in);
 
-			F32* dst = (F32*) vert.get();
-			F32* end_f32 = dst+mGeomCount*4;
-
-			//_mm_prefetch((char*)dst, _MM_HINT_NTA);
-			//_mm_prefetch((char*)src, _MM_HINT_NTA);
-				
-			//_mm_prefetch((char*)dst, _MM_HINT_NTA);
-
-
-			LLVector4a res0; //,res1,res2,res3;
-
-			LLVector4a texIdx;
-
 			S32 index = mTextureIndex < 255 ? mTextureIndex : 0;
-
-			F32 val = 0.f;
-			S32* vp = (S32*) &val;
-			*vp = index;
-			
 			llassert(index <= LLGLSLShader::sIndexedTextureChannels-1);
 
-			LLVector4Logical mask;
-			mask.clear();
-			mask.setElement<3>();
-		
-			texIdx.set(0,0,0,val);
-
-			LLVector4a tmp;
-
-			{
-				//LLFastTimer t2(FTM_FACE_POSITION_STORE);
-
-				/*if (num_vertices > 4)
-				{ //more than 64 bytes
-					while (src < end_64)
-					{	
-						_mm_prefetch((char*)src + 64, _MM_HINT_T0);
-						_mm_prefetch((char*)dst + 64, _MM_HINT_T0);
-
-						mat_vert.affineTransform(*src, res0);
-						tmp.setSelectWithMask(mask, texIdx, res0);
-						tmp.store4a((F32*) dst);
-
-						mat_vert.affineTransform(*(src+1), res1);
-						tmp.setSelectWithMask(mask, texIdx, res1);
-						tmp.store4a((F32*) dst+4);
-
-						mat_vert.affineTransform(*(src+2), res2);
-						tmp.setSelectWithMask(mask, texIdx, res2);
-						tmp.store4a((F32*) dst+8);
-
-						mat_vert.affineTransform(*(src+3), res3);
-						tmp.setSelectWithMask(mask, texIdx, res3);
-						tmp.store4a((F32*) dst+12);
-
-						dst += 16;
-						src += 4;
-					}
-				}*/
-
-				while (src < end)
-				{	
-					mat_vert.affineTransform(*src++, res0);
-					tmp.setSelectWithMask(mask, texIdx, res0);
-					tmp.store4a((F32*) dst);
-					dst += 4;
-				}
-			}
-
-			{
-				//LLFastTimer t(FTM_FACE_POSITION_PAD);
-				while (dst < end_f32)
-				{
-					res0.store4a((F32*) dst);
-					dst += 4;
-				}
-			}
+			LLVertexFill::positions((F32*) vert.get(), vf.mPositions, num_vertices, mGeomCount, mat_vert, index);
 
 			if (map_range)
 			{
@@ -2071,17 +1854,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		{
 			//LLFastTimer t(FTM_FACE_GEOM_NORMAL);
 			mVertexBuffer->getNormalStrider(norm, mGeomIndex, mGeomCount, map_range);
-			F32* normals = (F32*) norm.get();
-			LLVector4a* src = vf.mNormals;
-			LLVector4a* end = src+num_vertices;
-			
-			while (src < end)
-			{	
-				LLVector4a normal;
-				mat_normal.rotate(*src++, normal);
-				normal.store4a(normals);
-				normals += 4;
-			}
+			LLVertexFill::normals((F32*) norm.get(), vf.mNormals, num_vertices, mat_normal);
 
 			if (map_range)
 			{
@@ -2093,28 +1866,8 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		{
 			LLFastTimer t(FTM_FACE_GEOM_TANGENT);
 			mVertexBuffer->getTangentStrider(tangent, mGeomIndex, mGeomCount, map_range);
-			F32* tangents = (F32*) tangent.get();
-			
 			mVObjp->getVolume()->genTangents(f);
-			
-			LLVector4Logical mask;
-			mask.clear();
-			mask.setElement<3>();
-
-			LLVector4a* src = vf.mTangents;
-			LLVector4a* end = vf.mTangents+num_vertices;
-
-			while (src < end)
-			{
-				LLVector4a tangent_out;
-				mat_normal.rotate(*src, tangent_out);
-				tangent_out.normalize3fast();
-				tangent_out.setSelectWithMask(mask, *src, tangent_out);
-				tangent_out.store4a(tangents);
-				
-				src++;
-				tangents += 4;
-			}
+			LLVertexFill::tangents((F32*) tangent.get(), vf.mTangents, num_vertices, mat_normal);
 
 			if (map_range)
 			{
@@ -2140,26 +1893,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		{
 			LLFastTimer t(FTM_FACE_GEOM_COLOR);
 			mVertexBuffer->getColorStrider(colors, mGeomIndex, mGeomCount, map_range);
-
-			LLVector4a src;
-
-			U32 vec[4];
-			vec[0] = vec[1] = vec[2] = vec[3] = color.mAll;
-		
-			src.loadua((F32*) vec);
-
-			F32* dst = (F32*) colors.get();
-			S32 num_vecs = num_vertices/4;
-			if (num_vertices%4 > 0)
-			{
-				++num_vecs;
-			}
-
-			for (S32 i = 0; i < num_vecs; i++)
-			{	
-				src.store4a(dst);
-				dst += 4;
-			}
+			LLVertexFill::fill((U32*) colors.get(), color.mAll, num_vertices);
 
 			if (map_range)
 			{
@@ -2175,31 +1909,12 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 			U8 glow = (U8) llclamp((S32) (getTextureEntry()->getGlow()*255), 0, 255);
 
-			LLVector4a src;
-
-		
 			U32 glow32 = glow |
 						 (glow << 8) |
 						 (glow << 16) |
 						 (glow << 24);
 
-			U32 vec[4];
-			std::fill_n(vec,4,glow32); // for clang
-		
-			src.loadua((F32*) vec);
-
-			F32* dst = (F32*) emissive.get();
-			S32 num_vecs = num_vertices/4;
-			if (num_vertices%4 > 0)
-			{
-				++num_vecs;
-			}
-
-			for (S32 i = 0; i < num_vecs; i++)
-			{	
-				src.store4a(dst);
-				dst += 4;
-			}
+			LLVertexFill::fill((U32*) emissive.get(), glow32, num_vertices);
 
 			if (map_range)
 			{
@@ -257,6 +257,7 @@ public:
 	F32				mDistance;
 	F32			mLastUpdateTime;
 	F32			mLastSkinTime;
+	U32			mSkinPaletteHash;	// Of the joints and mesh the vertices were skinned with in software, 0 if they need skinning.
 	F32			mLastMoveTime;
 	LLMatrix4*	mTextureMatrix;
 	LLMatrix4*	mSpecMapMatrix;
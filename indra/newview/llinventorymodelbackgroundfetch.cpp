@@ -32,6 +32,7 @@
 #include "llcallbacklist.h"
 #include "llinventorypanel.h"
 #include "llinventorymodel.h"
+#include "llsdserialize.h"
 #include "llviewercontrol.h"
 #include "llviewerinventory.h"
 #include "llviewermessage.h"
@@ -411,15 +412,16 @@ void LLInventoryModelFetchItemResponder::error( U32 status, const std::string& r
 	LLInventoryModelBackgroundFetch::instance().incrFetchCount(-1);
 }
 
-class LLInventoryModelFetchDescendentsResponder : public LLHTTPClient::ResponderWithResult
+// The response to a descendents fetch can be very large (a whole inventory), so it is
+// handled one folder at a time while it is parsed instead of being built as one LLSD first.
+class LLInventoryModelFetchDescendentsResponder : public LLHTTPClient::ResponderWithCompleted
 {
 	public:
 	LLInventoryModelFetchDescendentsResponder(const LLSD& request_sd, uuid_vec_t recursive_cats) : 
 		mRequestSD(request_sd),
 		mRecursiveCatUUIDs(recursive_cats)
 	{};
-	/*virtual*/ void result(const LLSD& content);
-	/*virtual*/ void error(U32 status, const std::string& reason);
+	/*virtual*/ void completedRaw(U32 status, std::string const& reason, LLChannelDescriptors const& channels, buffer_ptr_t const& buffer);
 	/*virtual*/ AICapabilityType capability_type(void) const { return cap_inventory; }
 	/*virtual*/ AIHTTPTimeoutPolicy const& getHTTPTimeoutPolicy(void) const { return inventoryModelFetchDescendentsResponder_timeout; }
 	/*virtual*/ char const* getName(void) const { return "LLInventoryModelFetchDescendentsResponder"; }
@@ -427,128 +429,186 @@ class LLInventoryModelFetchDescendentsResponder : public LLHTTPClient::Responder
 protected:
 	BOOL getIsRecursive(const LLUUID& cat_id) const;
 private:
+	class FolderVisitor;
+
+	void processFolder(const LLSD& folder_sd);
+	void processBadFolder(const LLSD& folder_sd);
+	void fetchDone();
+	void fetchFailed(U32 status, const std::string& reason);
+
 	LLSD mRequestSD;
 	uuid_vec_t mRecursiveCatUUIDs; // hack for storing away which cat fetches are recursive
 };
 
-// If we get back a normal response, handle it here.
-void LLInventoryModelFetchDescendentsResponder::result(const LLSD& content)
+// Descends into the top level map and its "folders" and "bad_folders" arrays,
+// and hands every folder in them to the responder as soon as it is complete.
+class LLInventoryModelFetchDescendentsResponder::FolderVisitor : public LLSDXMLVisitor
 {
-	LLInventoryModelBackgroundFetch *fetcher = LLInventoryModelBackgroundFetch::getInstance();
-	if (content.has("folders"))	
+public:
+	FolderVisitor(LLInventoryModelFetchDescendentsResponder& responder) : mResponder(responder), mDepth(0) { }
+
+	/*virtual*/ bool beginMap(const std::string& key)
 	{
+		if (mDepth != 0)
+		{
+			return false;
+		}
+		++mDepth;
+		return true;
+	}
 
-		for(LLSD::array_const_iterator folder_it = content["folders"].beginArray();
-			folder_it != content["folders"].endArray();
-			++folder_it)
-		{	
-			LLSD folder_sd = *folder_it;
-			
+	/*virtual*/ void endMap() { --mDepth; }
 
-			//LLUUID agent_id = folder_sd["agent_id"];
-
-			//if(agent_id != gAgent.getID())	//This should never happen.
-			//{
-			//	llwarns << "Got a UpdateInventoryItem for the wrong agent."
-			//			<< llendl;
-			//	break;
-			//}
-
-			LLUUID parent_id = folder_sd["folder_id"];
-			LLUUID owner_id = folder_sd["owner_id"];
-			S32    version  = (S32)folder_sd["version"].asInteger();
-			S32    descendents = (S32)folder_sd["descendents"].asInteger();
-			LLPointer<LLViewerInventoryCategory> tcategory = new LLViewerInventoryCategory(owner_id);
-
-            if (parent_id.isNull())
-            {
-			    LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
-			    for(LLSD::array_const_iterator item_it = folder_sd["items"].beginArray();
-				    item_it != folder_sd["items"].endArray();
-				    ++item_it)
-			    {	
-                    LLUUID lost_uuid = gInventory.findCategoryUUIDForType(LLFolderType::FT_LOST_AND_FOUND);
-                    if (lost_uuid.notNull())
-                    {
-				        LLSD item = *item_it;
-				        titem->unpackMessage(item);
-				
-                        LLInventoryModel::update_list_t update;
-                        LLInventoryModel::LLCategoryUpdate new_folder(lost_uuid, 1);
-                        update.push_back(new_folder);
-                        gInventory.accountForUpdate(update);
-
-                        titem->setParent(lost_uuid);
-                        titem->updateParentOnServer(FALSE);
-                        gInventory.updateItem(titem);
-                        gInventory.notifyObservers();
-                        
-                    }
-                }
-            }
-
-	        LLViewerInventoryCategory* pcat = gInventory.getCategory(parent_id);
-			if (!pcat)
-			{
-				continue;
-			}
+	/*virtual*/ bool beginArray(const std::string& key)
+	{
+		if (mDepth != 1 || (key != "folders" && key != "bad_folders"))
+		{
+			return false;
+		}
+		mArray = key;
+		++mDepth;
+		return true;
+	}
 
-			for(LLSD::array_const_iterator category_it = folder_sd["categories"].beginArray();
-				category_it != folder_sd["categories"].endArray();
-				++category_it)
-			{	
-				LLSD category = *category_it;
-				tcategory->fromLLSD(category); 
-				
-				const BOOL recursive = getIsRecursive(tcategory->getUUID());
-				
-				if (recursive)
-				{
-					fetcher->mFetchQueue.push_back(LLInventoryModelBackgroundFetch::FetchQueueInfo(tcategory->getUUID(), recursive));
-				}
-				else if ( !gInventory.isCategoryComplete(tcategory->getUUID()) )
-				{
-					gInventory.updateCategory(tcategory);
-				}
+	/*virtual*/ void endArray() { --mDepth; }
 
-			}
-			LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
-			for(LLSD::array_const_iterator item_it = folder_sd["items"].beginArray();
-				item_it != folder_sd["items"].endArray();
-				++item_it)
-			{	
+	/*virtual*/ void value(const std::string& key, const LLSD& value)
+	{
+		if (mDepth != 2)
+		{
+			return;
+		}
+		if (mArray == "folders")
+		{
+			mResponder.processFolder(value);
+		}
+		else
+		{
+			mResponder.processBadFolder(value);
+		}
+	}
+
+private:
+	LLInventoryModelFetchDescendentsResponder& mResponder;
+	S32 mDepth;
+	std::string mArray;
+};
+
+void LLInventoryModelFetchDescendentsResponder::completedRaw(U32 status, std::string const& reason, LLChannelDescriptors const& channels, buffer_ptr_t const& buffer)
+{
+	if (!isGoodStatus(status))
+	{
+		fetchFailed(status, reason);
+		return;
+	}
+
+	// If we get back a normal response, handle it here.
+	FolderVisitor visitor(*this);
+	decode_llsd_body(status, reason, channels, buffer, visitor);
+	fetchDone();
+}
+
+void LLInventoryModelFetchDescendentsResponder::processFolder(const LLSD& folder_sd)
+{
+	LLInventoryModelBackgroundFetch *fetcher = LLInventoryModelBackgroundFetch::getInstance();
+
+	//LLUUID agent_id = folder_sd["agent_id"];
+
+	//if(agent_id != gAgent.getID())	//This should never happen.
+	//{
+	//	llwarns << "Got a UpdateInventoryItem for the wrong agent."
+	//			<< llendl;
+	//	break;
+	//}
+
+	LLUUID parent_id = folder_sd["folder_id"];
+	LLUUID owner_id = folder_sd["owner_id"];
+	S32    version  = (S32)folder_sd["version"].asInteger();
+	S32    descendents = (S32)folder_sd["descendents"].asInteger();
+	LLPointer<LLViewerInventoryCategory> tcategory = new LLViewerInventoryCategory(owner_id);
+
+	if (parent_id.isNull())
+	{
+		LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
+		for(LLSD::array_const_iterator item_it = folder_sd["items"].beginArray();
+			item_it != folder_sd["items"].endArray();
+			++item_it)
+		{	
+			LLUUID lost_uuid = gInventory.findCategoryUUIDForType(LLFolderType::FT_LOST_AND_FOUND);
+			if (lost_uuid.notNull())
+			{
 				LLSD item = *item_it;
 				titem->unpackMessage(item);
 				
+				LLInventoryModel::update_list_t update;
+				LLInventoryModel::LLCategoryUpdate new_folder(lost_uuid, 1);
+				update.push_back(new_folder);
+				gInventory.accountForUpdate(update);
+
+				titem->setParent(lost_uuid);
+				titem->updateParentOnServer(FALSE);
 				gInventory.updateItem(titem);
+				gInventory.notifyObservers();
 			}
+		}
+	}
 
-			// set version and descendentcount according to message.
-			LLViewerInventoryCategory* cat = gInventory.getCategory(parent_id);
-			if(cat)
-			{
-				cat->setVersion(version);
-				cat->setDescendentCount(descendents);
-				cat->determineFolderType();
-			}
+	LLViewerInventoryCategory* pcat = gInventory.getCategory(parent_id);
+	if (!pcat)
+	{
+		return;
+	}
 
+	for(LLSD::array_const_iterator category_it = folder_sd["categories"].beginArray();
+		category_it != folder_sd["categories"].endArray();
+		++category_it)
+	{	
+		LLSD category = *category_it;
+		tcategory->fromLLSD(category); 
+		
+		const BOOL recursive = getIsRecursive(tcategory->getUUID());
+		
+		if (recursive)
+		{
+			fetcher->mFetchQueue.push_back(LLInventoryModelBackgroundFetch::FetchQueueInfo(tcategory->getUUID(), recursive));
 		}
+		else if ( !gInventory.isCategoryComplete(tcategory->getUUID()) )
+		{
+			gInventory.updateCategory(tcategory);
+		}
+
 	}
+	LLPointer<LLViewerInventoryItem> titem = new LLViewerInventoryItem;
+	for(LLSD::array_const_iterator item_it = folder_sd["items"].beginArray();
+		item_it != folder_sd["items"].endArray();
+		++item_it)
+	{	
+		LLSD item = *item_it;
+		titem->unpackMessage(item);
 		
-	if (content.has("bad_folders"))
+		gInventory.updateItem(titem);
+	}
+
+	// set version and descendentcount according to message.
+	LLViewerInventoryCategory* cat = gInventory.getCategory(parent_id);
+	if(cat)
 	{
-		for(LLSD::array_const_iterator folder_it = content["bad_folders"].beginArray();
-			folder_it != content["bad_folders"].endArray();
-			++folder_it)
-		{	
-			LLSD folder_sd = *folder_it;
-			
-			//These folders failed on the dataserver.  We probably don't want to retry them.
-			llinfos << "Folder " << folder_sd["folder_id"].asString() 
-					<< "Error: " << folder_sd["error"].asString() << llendl;
-		}
+		cat->setVersion(version);
+		cat->setDescendentCount(descendents);
+		cat->determineFolderType();
 	}
+}
 
+void LLInventoryModelFetchDescendentsResponder::processBadFolder(const LLSD& folder_sd)
+{
+	//These folders failed on the dataserver.  We probably don't want to retry them.
+	llinfos << "Folder " << folder_sd["folder_id"].asString() 
+			<< "Error: " << folder_sd["error"].asString() << llendl;
+}
+
+void LLInventoryModelFetchDescendentsResponder::fetchDone()
+{
+	LLInventoryModelBackgroundFetch *fetcher = LLInventoryModelBackgroundFetch::getInstance();
 	fetcher->incrFetchCount(-1);
 	
 	if (fetcher->isBulkFetchProcessingComplete())
@@ -561,7 +621,7 @@ void LLInventoryModelFetchDescendentsResponder::result(const LLSD& content)
 }
 
 //If we get back an error (not found, etc...), handle it here
-void LLInventoryModelFetchDescendentsResponder::error(U32 status, const std::string& reason)
+void LLInventoryModelFetchDescendentsResponder::fetchFailed(U32 status, const std::string& reason)
 {
 	LLInventoryModelBackgroundFetch *fetcher = LLInventoryModelBackgroundFetch::getInstance();
 
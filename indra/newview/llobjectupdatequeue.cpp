@@ -0,0 +1,390 @@
+/**
+ * @file llobjectupdatequeue.cpp
+ * @brief Decodes object updates on worker threads, ahead of applying them.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ *
+ * Copyright (c) 2001-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llobjectupdatequeue.h"
+
+#include "indra_constants.h"
+#include "llpartdata.h"
+#include "llprimitive.h"
+#include "llvolumemessage.h"
+#include "message.h"
+
+//-----------------------------------------------------------------------------
+// LLObjectUpdateRecord
+//-----------------------------------------------------------------------------
+LLObjectUpdateRecord::LLObjectUpdateRecord()
+:	mUpdateType(OUT_UNKNOWN),
+	mRegionHandle(0),
+	mTimeDilation(0),
+	mPacketID(0),
+	mUpdateFlags(0),
+	mSequence(0),
+	mValid(false),
+	mLocalID(0),
+	mPCode(0),
+	mHeaderSize(0),
+	mHasVolumeParams(false),
+	mVolumeParamsStart(0),
+	mVolumeParamsEnd(0)
+{
+}
+
+void LLObjectUpdateRecord::decode()
+{
+	if (mData.empty())
+	{
+		return;
+	}
+
+	LLDataPackerBinaryBuffer dp(&mData[0], (S32)mData.size());
+	mValid = dp.unpackUUID(mFullID, "ID") &&
+			 dp.unpackU32(mLocalID, "LocalID") &&
+			 dp.unpackU8(mPCode, "PCode");
+	mHeaderSize = dp.getCurrentSize();
+
+	// LLVOVolume::processUpdateMessage() unpacks the volume parameters right after the part of LLViewerObject.
+	if (mValid && mPCode == LL_PCODE_VOLUME && skipObjectData(dp))
+	{
+		mVolumeParamsStart = dp.getCurrentSize();
+		if (LLVolumeMessage::unpackVolumeParams(&mVolumeParams, dp))
+		{
+			mVolumeParamsEnd = dp.getCurrentSize();
+			mHasVolumeParams = true;
+		}
+	}
+}
+
+// Keep this in sync with the OUT_FULL_COMPRESSED case of LLViewerObject::processUpdateMessage().
+// static
+bool LLObjectUpdateRecord::skipObjectData(LLDataPackerBinaryBuffer& dp)
+{
+	U8 u8;
+	U32 u32;
+	F32 f32;
+	LLVector3 vec;
+	LLUUID id;
+	std::string str;
+	U8 buffer[MAX_OBJECT_PARAMS_SIZE];
+	S32 size;
+
+	if (!dp.unpackU8(u8, "State") ||
+		!dp.unpackU32(u32, "CRC") ||
+		!dp.unpackU8(u8, "Material") ||
+		!dp.unpackU8(u8, "ClickAction") ||
+		!dp.unpackVector3(vec, "Scale") ||
+		!dp.unpackVector3(vec, "Pos") ||
+		!dp.unpackVector3(vec, "Rot"))
+	{
+		return false;
+	}
+	U32 value;
+	if (!dp.unpackU32(value, "SpecialCode") ||
+		!dp.unpackUUID(id, "Owner"))
+	{
+		return false;
+	}
+	if ((value & 0x80) && !dp.unpackVector3(vec, "Omega"))
+	{
+		return false;
+	}
+	if ((value & 0x20) && !dp.unpackU32(u32, "ParentID"))
+	{
+		return false;
+	}
+	if (value & 0x2)
+	{
+		if (!dp.unpackU8(u8, "TreeData"))
+		{
+			return false;
+		}
+	}
+	else if (value & 0x1)
+	{
+		std::vector<U8> part_data(dp.getBufferSize());
+		if (!dp.unpackU32(u32, "ScratchPadSize") ||
+			part_data.empty() || !dp.unpackBinaryData(&part_data[0], size, "PartData"))
+		{
+			return false;
+		}
+	}
+	if (value & 0x4)
+	{
+		if (!dp.unpackString(str, "Text") ||
+			!dp.unpackBinaryDataFixed(buffer, 4, "Color"))
+		{
+			return false;
+		}
+	}
+	if ((value & 0x200) && !dp.unpackString(str, "MediaURL"))
+	{
+		return false;
+	}
+	if (value & 0x8)
+	{
+		LLPartSysData part_sys_data;
+		if (!part_sys_data.unpackLegacy(dp))
+		{
+			return false;
+		}
+	}
+	U8 num_parameters;
+	if (!dp.unpackU8(num_parameters, "num_params"))
+	{
+		return false;
+	}
+	for (U8 param = 0; param < num_parameters; ++param)
+	{
+		U16 param_type;
+		if (!dp.unpackU16(param_type, "param_type") ||
+			!dp.unpackBinaryData(buffer, size, "param_data"))
+		{
+			return false;
+		}
+	}
+	if (value & 0x10)
+	{
+		if (!dp.unpackUUID(id, "SoundUUID") ||
+			!dp.unpackF32(f32, "SoundGain") ||
+			!dp.unpackU8(u8, "SoundFlags") ||
+			!dp.unpackF32(f32, "SoundRadius"))
+		{
+			return false;
+		}
+	}
+	if ((value & 0x100) && !dp.unpackString(str, "NV"))
+	{
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// LLObjectUpdateDataPacker
+//-----------------------------------------------------------------------------
+LLObjectUpdateDataPacker::LLObjectUpdateDataPacker(LLObjectUpdateRecord& record)
+:	LLDataPackerBinaryBuffer(record.mData.empty() ? NULL : &record.mData[0], (S32)record.mData.size()),
+	mRecord(record)
+{
+	skipTo(record.mHeaderSize);
+}
+
+// static
+const LLObjectUpdateRecord* LLObjectUpdateDataPacker::getRecord(LLDataPacker* dp)
+{
+	LLObjectUpdateDataPacker* queued_dp = dynamic_cast<LLObjectUpdateDataPacker*>(dp);
+	return queued_dp ? &queued_dp->getRecord() : NULL;
+}
+
+//-----------------------------------------------------------------------------
+// LLObjectUpdateQueue
+//-----------------------------------------------------------------------------
+LLObjectUpdateQueue::LLObjectUpdateQueue(U32 num_threads)
+:	mUnclaimed(0),
+	mNextSequence(0),
+	mNextToDecode(0)
+{
+	if (num_threads > MAX_THREADS)
+	{
+		num_threads = MAX_THREADS;
+	}
+	mThreads.start(this, "objdecode", num_threads);
+	llinfos << "Decoding object updates with " << num_threads << " threads." << llendl;
+}
+
+LLObjectUpdateQueue::~LLObjectUpdateQueue()
+{
+	mThreads.stop();
+	for (std::deque<LLObjectUpdateRecord*>::iterator iter = mRecords.begin(); iter != mRecords.end(); ++iter)
+	{
+		delete *iter;
+	}
+}
+
+bool LLObjectUpdateQueue::empty()
+{
+	LLMutexLock lock(&mCondition);
+	return mRecords.empty();
+}
+
+U32 LLObjectUpdateQueue::getNumQueued()
+{
+	LLMutexLock lock(&mCondition);
+	return (U32)mRecords.size();
+}
+
+void LLObjectUpdateQueue::push(std::vector<LLObjectUpdateRecord*> const& records)
+{
+	if (records.empty())
+	{
+		return;
+	}
+	for (std::vector<LLObjectUpdateRecord*>::const_iterator iter = records.begin(); iter != records.end(); ++iter)
+	{
+		countQueued(**iter, 1);
+	}
+	{
+		LLMutexLock lock(&mCondition);
+		for (std::vector<LLObjectUpdateRecord*>::const_iterator iter = records.begin(); iter != records.end(); ++iter)
+		{
+			(*iter)->mSequence = mNextSequence++;
+			mRecords.push_back(*iter);
+			mStates.push_back(QUEUED);
+		}
+		mUnclaimed += (U32)records.size();
+	}
+	mThreads.wake();
+}
+
+LLObjectUpdateRecord* LLObjectUpdateQueue::pop()
+{
+	mCondition.lock();
+	if (mRecords.empty())
+	{
+		mCondition.unlock();
+		return NULL;
+	}
+	LLObjectUpdateRecord* record = mRecords.front();
+	if (mStates.front() == QUEUED)
+	{
+		// Nobody got to it yet; don't wait for the workers.
+		mStates.front() = DECODING;
+		++mNextToDecode;
+		mUnclaimed -= 1;
+		mCondition.unlock();
+		record->decode();
+		mCondition.lock();
+		mStates.front() = DECODED;
+	}
+	while (mStates.front() != DECODED)
+	{
+		mCondition.wait();
+	}
+	mRecords.pop_front();
+	mStates.pop_front();
+	--mNextToDecode;
+	if (mRecords.empty())
+	{
+		mKills.clear();
+	}
+	mCondition.unlock();
+	countQueued(*record, -1);
+	return record;
+}
+
+void LLObjectUpdateQueue::kill(const LLHost& sender, U32 local_id)
+{
+	if (!empty())
+	{
+		mKills[std::make_pair(sender, local_id)] = mNextSequence;
+	}
+}
+
+bool LLObjectUpdateQueue::isKilled(const LLObjectUpdateRecord& record) const
+{
+	if (mKills.empty())
+	{
+		return false;
+	}
+	kill_map_t::const_iterator iter = mKills.find(std::make_pair(record.mSender, record.mLocalID));
+	if (iter != mKills.end() && record.mSequence < iter->second)
+	{
+		return true;
+	}
+	iter = mKills.find(std::make_pair(record.mSender, (U32)0));
+	return iter != mKills.end() && record.mSequence < iter->second;
+}
+
+bool LLObjectUpdateQueue::isQueued(const LLHost& sender, U32 local_id) const
+{
+	return mQueuedLocalIDs.find(std::make_pair(sender, local_id)) != mQueuedLocalIDs.end();
+}
+
+bool LLObjectUpdateQueue::isQueued(const LLUUID& id) const
+{
+	return mQueuedIDs.find(id) != mQueuedIDs.end();
+}
+
+// Only called by the main thread, which is the only one to use the counts. The ids are read
+// from the data rather than taken from decode(), which may be running on a worker.
+void LLObjectUpdateQueue::countQueued(const LLObjectUpdateRecord& record, S32 delta)
+{
+	if (record.mData.size() < UUID_BYTES + sizeof(U32))
+	{
+		return;
+	}
+	LLUUID id;
+	U32 local_id;
+	memcpy(id.mData, &record.mData[0], UUID_BYTES);
+	htonmemcpy(&local_id, &record.mData[UUID_BYTES], MVT_U32, 4);
+
+	U32& local_id_count = mQueuedLocalIDs[std::make_pair(record.mSender, local_id)];
+	local_id_count += delta;
+	if (!local_id_count)
+	{
+		mQueuedLocalIDs.erase(std::make_pair(record.mSender, local_id));
+	}
+	U32& id_count = mQueuedIDs[id];
+	id_count += delta;
+	if (!id_count)
+	{
+		mQueuedIDs.erase(id);
+	}
+}
+
+// virtual
+void LLObjectUpdateQueue::work(U32 index)
+{
+	mCondition.lock();
+	while (mNextToDecode < mRecords.size())
+	{
+		LLObjectUpdateRecord* record = mRecords[mNextToDecode];
+		mStates[mNextToDecode++] = DECODING;
+		mUnclaimed -= 1;
+		mCondition.unlock();
+
+		record->decode();
+
+		mCondition.lock();
+		// pop() may have removed decoded records in front of this one meanwhile.
+		mStates[record->mSequence - mRecords.front()->mSequence] = DECODED;
+		mCondition.signal();
+	}
+	mCondition.unlock();
+}
+
+// virtual
+bool LLObjectUpdateQueue::hasWork()
+{
+	return mUnclaimed != 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * @file llobjectupdatequeue.h
+ * @brief Decodes object updates on worker threads, ahead of applying them.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewergpl$
+ *
+ * Copyright (c) 2001-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOBJECTUPDATEQUEUE_H
+#define LL_LLOBJECTUPDATEQUEUE_H
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "llatomic.h"
+#include "lldatapacker.h"
+#include "llhost.h"
+#include "llthreadpool.h"
+#include "lluuid.h"
+#include "llvolume.h"
+#include "llviewerobject.h"
+
+//
+// One block of an ObjectUpdateCompressed or ObjectUpdateCached message, copied out of the
+// message so that it can be decoded on a worker thread and applied in a later frame.
+// Both carry the object in the compressed format that the region object cache uses.
+//
+class LLObjectUpdateRecord
+{
+public:
+	LLObjectUpdateRecord();
+
+	// Decodes the header of the object and, for prims, its volume parameters.
+	// Only touches this record, so it can run on any thread.
+	void decode();
+
+public:
+	// What processUpdateMessage() would have read from the message.
+	EObjectUpdateType	mUpdateType;
+	U64					mRegionHandle;
+	U16					mTimeDilation;
+	LLHost				mSender;
+	U32					mPacketID;
+	U32					mUpdateFlags;
+	std::vector<U8>		mData;
+
+	U32					mSequence;				// Order in which the records were queued.
+
+	// Set by decode().
+	bool				mValid;					// False if the header could not be read.
+	LLUUID				mFullID;
+	U32					mLocalID;
+	LLPCode				mPCode;
+	S32					mHeaderSize;			// Where processUpdateMessage() starts reading.
+	bool				mHasVolumeParams;
+	LLVolumeParams		mVolumeParams;
+	S32					mVolumeParamsStart;		// Offsets in mData of the volume parameters.
+	S32					mVolumeParamsEnd;
+
+private:
+	// Reads past the part of the object that LLViewerObject::processUpdateMessage() unpacks.
+	static bool skipObjectData(LLDataPackerBinaryBuffer& dp);
+};
+
+//
+// The data packer that processUpdateMessage() gets for a queued update. Objects use it to find
+// the state of the message that the update came from, and what was decoded ahead of time.
+//
+class LLObjectUpdateDataPacker : public LLDataPackerBinaryBuffer
+{
+public:
+	LLObjectUpdateDataPacker(LLObjectUpdateRecord& record);
+
+	const LLObjectUpdateRecord& getRecord() const	{ return mRecord; }
+	// Continues reading at offset, for parts of the data that were decoded ahead of time.
+	void skipTo(S32 offset)							{ mCurBufferp = mBufferp + llclamp(offset, 0, mBufferSize); }
+
+	// Returns the record if dp belongs to a queued update, or NULL if the update is read from the current message.
+	static const LLObjectUpdateRecord* getRecord(LLDataPacker* dp);
+
+private:
+	LLObjectUpdateRecord& mRecord;
+};
+
+//
+// Records are decoded by a number of worker threads and handed back to the main thread in
+// the order in which they were queued. The main thread decodes the next record itself if
+// no worker got to it yet.
+//
+class LLObjectUpdateQueue : private LLThreadPool::Client
+{
+public:
+	// Maximum number of worker threads.
+	static U32 const MAX_THREADS = 8;
+
+	LLObjectUpdateQueue(U32 num_threads);
+	~LLObjectUpdateQueue();
+
+	U32 getNumThreads() const { return mThreads.getNumThreads(); }
+	bool empty();
+	U32 getNumQueued();
+
+	// Takes ownership of the records and starts decoding them.
+	void push(std::vector<LLObjectUpdateRecord*> const& records);
+	// Returns the oldest record after it is decoded (waiting for the worker that decodes it, if any),
+	// or NULL if the queue is empty. The caller deletes the record.
+	LLObjectUpdateRecord* pop();
+
+	// Drops the queued updates of an object (or all objects of a region, if local_id is 0) when they are popped.
+	void kill(const LLHost& sender, U32 local_id);
+	bool isKilled(const LLObjectUpdateRecord& record) const;
+
+	// Whether updates of an object are still queued; updates that are not queued must not overtake them.
+	bool isQueued(const LLHost& sender, U32 local_id) const;
+	bool isQueued(const LLUUID& id) const;
+
+private:
+	enum EState
+	{
+		QUEUED,
+		DECODING,
+		DECODED
+	};
+
+	// Decodes records until none are left to claim.
+	/*virtual*/ void work(U32 index);
+	/*virtual*/ bool hasWork();
+
+	// Keeps count of the queued records of every object.
+	void countQueued(const LLObjectUpdateRecord& record, S32 delta);
+
+private:
+	LLThreadPool mThreads;
+	LLAtomicU32 mUnclaimed;							// The number of records that nobody claimed yet.
+
+	// Only used by the main thread.
+	typedef std::map<std::pair<LLHost, U32>, U32> kill_map_t;
+	kill_map_t mKills;								// Records queued before the sequence number are dropped.
+	U32 mNextSequence;
+	typedef std::map<std::pair<LLHost, U32>, U32> local_id_count_map_t;
+	local_id_count_map_t mQueuedLocalIDs;			// The number of queued records of every object.
+	typedef std::map<LLUUID, U32> id_count_map_t;
+	id_count_map_t mQueuedIDs;
+
+	LLCondition mCondition;							// Protects everything below; signalled when a record is decoded.
+	std::deque<LLObjectUpdateRecord*> mRecords;
+	std::deque<EState> mStates;						// One for each record.
+	size_t mNextToDecode;							// Index of the first record that nobody claimed yet.
+};
+
+#endif // LL_LLOBJECTUPDATEQUEUE_H
@@ -54,6 +54,7 @@
 #include "llmeshrepository.h"
 #include "llrender.h"
 #include "lloctree.h"
+#include "llfrustumcull.h"
 #include "llphysicsshapebuilderutil.h"
 #include "llvoavatar.h"
 #include "llvolumemgr.h"
@@ -488,12 +489,7 @@ BOOL LLSpatialGroup::updateInGroup(LLDrawable *drawablep, BOOL immediate)
 {
 	drawablep->updateSpatialExtents();
 
-	OctreeNode* parent = mOctreeNode->getOctParent();
-	
-	if (mOctreeNode->isInside(drawablep->getPositionGroup()) && 
-		(mOctreeNode->contains(drawablep) ||
-		 (drawablep->getBinRadius() > mOctreeNode->getSize()[0] &&
-				parent && parent->getElementCount() >= gOctreeMaxCapacity)))
+	if (mOctreeNode->fits(drawablep))
 	{
 		unbound();
 		setState(OBJECT_DIRTY);
@@ -1751,6 +1747,16 @@ void LLSpatialPartition::move(LLDrawable *drawablep, LLSpatialGroup *curp, BOOL
 		return;
 	}
 
+	if (curp && !immediate && !isBridge())
+	{ //restructure the octree once per frame, see applyMoves()
+		curp->unbound();
+		QueuedMove move;
+		move.mDrawable = drawablep;
+		move.mWasVisible = was_visible;
+		mMoveQueue.push_back(move);
+		return;
+	}
+
 	//keep drawable from being garbage collected
 	LLPointer<LLDrawable> ptr = drawablep;
 	if (curp && !remove(drawablep, curp))
@@ -1761,6 +1767,42 @@ void LLSpatialPartition::move(LLDrawable *drawablep, LLSpatialGroup *curp, BOOL
 	put(drawablep, was_visible);
 }
 
+void LLSpatialPartition::applyMoves()
+{
+	if (mMoveQueue.empty())
+	{
+		return;
+	}
+
+	LLSpatialGroup::OctreeNode::move_list_t moves;
+	moves.reserve(mMoveQueue.size());
+
+	for (std::vector<QueuedMove>::iterator iter = mMoveQueue.begin(); iter != mMoveQueue.end(); ++iter)
+	{
+		LLDrawable* drawablep = iter->mDrawable;
+		LLSpatialGroup* group = drawablep->getSpatialGroup();
+		if (!drawablep->isDead() && group && group->mSpatialPartition == this && group->mOctreeNode)
+		{ //still where move() found it
+			moves.push_back(std::make_pair(group->mOctreeNode, iter->mDrawable));
+		}
+	}
+
+	assert_octree_valid(mOctree);
+	mOctree->applyMoves(moves);
+	assert_octree_valid(mOctree);
+
+	for (std::vector<QueuedMove>::iterator iter = mMoveQueue.begin(); iter != mMoveQueue.end(); ++iter)
+	{
+		LLSpatialGroup* group = iter->mDrawable->getSpatialGroup();
+		if (group && iter->mWasVisible && group->isOcclusionState(LLSpatialGroup::QUERY_PENDING))
+		{
+			group->setOcclusionState(LLSpatialGroup::DISCARD_QUERY, LLSpatialGroup::STATE_MODE_ALL_CAMERAS);
+		}
+	}
+
+	mMoveQueue.clear();
+}
+
 class LLSpatialShift : public LLSpatialGroup::OctreeTraveler
 {
 public:
@@ -1783,7 +1825,24 @@ class LLOctreeCull : public LLSpatialGroup::OctreeTraveler
 {
 public:
 	LLOctreeCull(LLCamera* camera)
-		: mCamera(camera), mRes(0) { }
+		: mCamera(camera), mRes(0), mCullerReady(false), mChildRes(-1), mChildPlanesInside(0) { }
+
+	// How frustumCheck and frustumCheckObjects test a group. The children of a partly visible
+	// group are tested the same way all at once with mCuller, instead of through frustumCheck.
+	// Subclasses that override frustumCheck with anything else return CHECK_CUSTOM, so that
+	// every group goes through their frustumCheck.
+	enum ECheckMode
+	{
+		CHECK_NO_FAR_CLIP_SPHERE,	// Without the far plane, then limited to the sphere through the far corners.
+		CHECK_NO_FAR_CLIP,
+		CHECK_FAR_CLIP,
+		CHECK_CUSTOM
+	};
+
+	virtual ECheckMode getCheckMode() const
+	{
+		return CHECK_NO_FAR_CLIP_SPHERE;
+	}
 
 	virtual bool earlyFail(LLSpatialGroup* group)
 	{
@@ -1804,6 +1863,11 @@ public:
 	{
 		LLSpatialGroup* group = (LLSpatialGroup*) n->getListener(0);
 
+		// The result of the frustum check, if the parent already did it.
+		S32 res = mChildRes;
+		U8 planes_inside = mChildPlanesInside;
+		mChildRes = -1;
+
 		if (earlyFail(group))
 		{
 			return;
@@ -1816,35 +1880,102 @@ public:
 		}
 		else
 		{
-			mRes = frustumCheck(group);
+			if (res < 0)
+			{
+				res = frustumCheck(group);
+				planes_inside = 0;
+			}
+			mRes = res;
 				
 			if (mRes)
 			{ //at least partially in, run on down
-				LLSpatialGroup::OctreeTraveler::traverse(n);
+				traverseChildren(n, planes_inside);
 			}
 
 			mRes = 0;
 		}
 	}
-	
-	virtual S32 frustumCheck(const LLSpatialGroup* group)
+
+	// Like LLOctreeTraveler::traverse, but when the group is partly visible its
+	// children are frustum checked all at once before descending into them.
+	void traverseChildren(const LLSpatialGroup::OctreeNode* n, U8 planes_inside)
 	{
-		S32 res = mCamera->AABBInFrustumNoFarClip(group->mBounds[0], group->mBounds[1]);
-		if (res != 0)
+		n->accept(this);
+
+		const U32 count = n->getChildCount();
+		const ECheckMode mode = getCheckMode();
+		if (mRes != 1 || count == 0 || mode == CHECK_CUSTOM)
+		{
+			for (U32 i = 0; i < count; i++)
+			{
+				traverse(n->getChild(i));
+			}
+			return;
+		}
+
+		llassert(count <= 8);
+		const LLSpatialGroup::OctreeNode* children[8];
+		const LLVector4a* centers[8];
+		const LLVector4a* radii[8];
+		S32 results[8];
+		U8 planes[8];
+		for (U32 i = 0; i < count; i++)
+		{
+			children[i] = n->getChild(i);
+			const LLSpatialGroup* child = (const LLSpatialGroup*) children[i]->getListener(0);
+			centers[i] = &child->mBounds[0];
+			radii[i] = &child->mBounds[1];
+			planes[i] = planes_inside;
+		}
+
+		if (!mCullerReady)
+		{ //not in the constructor, which can't ask the subclass for its mode
+			mCuller.setup(*mCamera, mode == CHECK_FAR_CLIP);
+			mCullerReady = true;
+		}
+		mCuller.cull(centers, radii, count, results, planes);
+
+		for (U32 i = 0; i < count; i++)
 		{
-			res = llmin(res, AABBSphereIntersect(group->mExtents[0], group->mExtents[1], mCamera->getOrigin(), mCamera->mFrustumCornerDist));
+			if (mode == CHECK_NO_FAR_CLIP_SPHERE && results[i] != 0)
+			{
+				const LLSpatialGroup* child = (const LLSpatialGroup*) children[i]->getListener(0);
+				results[i] = llmin(results[i], AABBSphereIntersect(child->mExtents[0], child->mExtents[1], mCamera->getOrigin(), mCamera->mFrustumCornerDist));
+			}
+			mChildRes = results[i];
+			mChildPlanesInside = planes[i];
+			traverse(children[i]);
 		}
-		return res;
+	}
+	
+	virtual S32 frustumCheck(const LLSpatialGroup* group)
+	{
+		return checkBounds(group->mBounds, group->mExtents);
 	}
 
 	virtual S32 frustumCheckObjects(const LLSpatialGroup* group)
 	{
-		S32 res = mCamera->AABBInFrustumNoFarClip(group->mObjectBounds[0], group->mObjectBounds[1]);
-		if (res != 0)
+		return checkBounds(group->mObjectBounds, group->mObjectExtents);
+	}
+
+	S32 checkBounds(const LLVector4a* bounds, const LLVector4a* extents)
+	{
+		switch (getCheckMode())
 		{
-			res = llmin(res, AABBSphereIntersect(group->mObjectExtents[0], group->mObjectExtents[1], mCamera->getOrigin(), mCamera->mFrustumCornerDist));
+			case CHECK_FAR_CLIP:
+				return mCamera->AABBInFrustum(bounds[0], bounds[1]);
+			case CHECK_NO_FAR_CLIP:
+				return mCamera->AABBInFrustumNoFarClip(bounds[0], bounds[1]);
+			default:
+			{
+				S32 res = mCamera->AABBInFrustumNoFarClip(bounds[0], bounds[1]);
+				if (res != 0)
+				{
+					res = llmin(res, AABBSphereIntersect(extents[0], extents[1], mCamera->getOrigin(), mCamera->mFrustumCornerDist));
+				}
+				return res;
+			}
 		}
-		return res;
 	}
 
 	virtual bool checkObjects(const LLSpatialGroup::OctreeNode* branch, const LLSpatialGroup* group)
@@ -1894,6 +2025,10 @@ public:
 
 	LLCamera *mCamera;
 	S32 mRes;
+	LLFrustumCuller mCuller;
+	bool mCullerReady;
+	S32 mChildRes;				// The frustum check result for the child about to be traversed, or -1.
+	U8 mChildPlanesInside;		// The planes that child is known to be inside of.
 };
 
 class LLOctreeCullNoFarClip : public LLOctreeCull
@@ -1902,15 +2037,9 @@ public:
 	LLOctreeCullNoFarClip(LLCamera* camera) 
 		: LLOctreeCull(camera) { }
 
-	virtual S32 frustumCheck(const LLSpatialGroup* group)
-	{
-		return mCamera->AABBInFrustumNoFarClip(group->mBounds[0], group->mBounds[1]);
-	}
-
-	virtual S32 frustumCheckObjects(const LLSpatialGroup* group)
+	virtual ECheckMode getCheckMode() const
 	{
-		S32 res = mCamera->AABBInFrustumNoFarClip(group->mObjectBounds[0], group->mObjectBounds[1]);
-		return res;
+		return CHECK_NO_FAR_CLIP;
 	}
 };
 
@@ -1920,14 +2049,9 @@ public:
 	LLOctreeCullShadow(LLCamera* camera)
 		: LLOctreeCull(camera) { }
 
-	virtual S32 frustumCheck(const LLSpatialGroup* group)
-	{
-		return mCamera->AABBInFrustum(group->mBounds[0], group->mBounds[1]);
-	}
-
-	virtual S32 frustumCheckObjects(const LLSpatialGroup* group)
+	virtual ECheckMode getCheckMode() const
 	{
-		return mCamera->AABBInFrustum(group->mObjectBounds[0], group->mObjectBounds[1]);
+		return CHECK_FAR_CLIP;
 	}
 };
 
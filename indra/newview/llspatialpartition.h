@@ -485,6 +485,8 @@ public:
 	
 	// If the drawable moves, move it here.
 	virtual void move(LLDrawable *drawablep, LLSpatialGroup *curp, BOOL immediate = FALSE);
+	// Moves the drawables that move() queued because they left their group, in one go.
+	void applyMoves();
 	virtual void shift(const LLVector4a &offset);
 
 	virtual F32 calcDistance(LLSpatialGroup* group, LLCamera& camera);
@@ -526,6 +528,14 @@ public:
 	BOOL mDepthMask; //if TRUE, objects in this partition will be written to depth during alpha rendering
 	U32 mDrawableType;
 	U32 mPartitionType;
+
+protected:
+	struct QueuedMove
+	{
+		LLPointer<LLDrawable> mDrawable;
+		BOOL mWasVisible;
+	};
+	std::vector<QueuedMove> mMoveQueue; //drawables that left their group since the last applyMoves()
 };
 
 // class for creating bridges between spatial partitions
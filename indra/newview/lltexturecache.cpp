@@ -40,7 +40,9 @@
 
 // Cache organization:
 // cache/texture.entries
-//  Unordered array of Entry structs
+//  EntriesInfo, followed by an unordered array of EntryRecord structs (Entry plus the
+//  links of the LRU list and the hash index) and the heads of the hash buckets.
+//  The file is mapped into memory and updated in place.
 // cache/texture.cache
 //  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
 // cache/textures/[0-F]/UUID.texture
@@ -49,9 +51,6 @@
 //note: there is no good to define 1024 for TEXTURE_CACHE_ENTRY_SIZE while FIRST_PACKET_SIZE is 600 on sim side.
 const S32 TEXTURE_CACHE_ENTRY_SIZE = FIRST_PACKET_SIZE;//1024;
 const F32 TEXTURE_CACHE_PURGE_AMOUNT = .20f; // % amount to reduce the cache by when it exceeds its limit
-const F32 TEXTURE_CACHE_LRU_SIZE = .10f; // % amount for LRU list (low overhead to regenerate)
-
-static std::queue<LLUUID> sgDelayedPurgeQueue;
 
 class LLTextureCacheWorker : public LLWorkerClass
 {
@@ -739,17 +738,22 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 
 LLTextureCache::LLTextureCache(bool threaded)
 	: LLWorkerThread("TextureCache", threaded),
-	  mHeaderAPRFile(NULL),
 	  mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
+	  mHeaderEntriesInfo(NULL),
+	  mHeaderEntries(NULL),
+	  mHeaderBuckets(NULL),
+	  mBucketShift(32),
 	  mTexturesSizeTotal(0),
-	  mDoPurge(FALSE)
+	  mDoPurge(FALSE),
+	  mPurgeTargetSize(0)
 {
 }
 
 LLTextureCache::~LLTextureCache()
 {
 	clearDeleteList();
-	writeUpdatedEntries();
+	LLMutexLock lock(&mHeaderMutex);
+	closeHeaderEntries();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -798,7 +802,8 @@ S32 LLTextureCache::update(F32 max_time_ms)
 	if(!res && timer.getElapsedTimeF32() > MAX_TIME_INTERVAL)
 	{
 		timer.reset();
-		writeUpdatedEntries();
+		LLMutexLock lock(&mHeaderMutex);
+		flushHeaderEntries();
 	}
 
 	return res;
@@ -827,9 +832,7 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
 	LLMutexLock lock(&mHeaderMutex);
-	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
-	
-	return (iter != mHeaderIDMap.end()) ;
+	return mHeaderEntriesFile.isOpen() && findEntry(id) >= 0;
 }
 
 //debug
@@ -875,7 +878,7 @@ BOOL LLTextureCache::isInLocal(const LLUUID& id)
 
 //static
 const S32 MAX_REASONABLE_FILE_SIZE = 512*1024*1024; // 512 MB
-F32 LLTextureCache::sHeaderCacheVersion = 1.8f;
+F32 LLTextureCache::sHeaderCacheVersion = 2.0f;
 U32 LLTextureCache::sCacheMaxEntries = MAX_REASONABLE_FILE_SIZE / TEXTURE_CACHE_ENTRY_SIZE;
 S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 const char* entries_filename = "texture.entries";
@@ -900,7 +903,7 @@ void LLTextureCache::purgeCache(ELLPath location)
 	if (!mReadOnly)
 	{
 		setDirNames(location);
-		llassert_always(mHeaderAPRFile == NULL);
+		llassert_always(!mHeaderEntriesFile.isOpen());
 
 		//remove the legacy cache if exists
 		std::string texture_dir = mTexturesDirName;
@@ -945,6 +948,7 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 	else
 		sCacheMaxTexturesSize = max_size;
 	max_size -= sCacheMaxTexturesSize;
+	mPurgeTargetSize = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
 	
 	LL_INFOS("TextureCache") << "Headers: " << sCacheMaxEntries
 			<< " Textures size: " << sCacheMaxTexturesSize / (1024 * 1024) << " MB" << LL_ENDL;
@@ -975,7 +979,7 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 		}
 	}
 	readHeaderCache();
-	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
+	purgeTextures(true); // make some room in the texture cache if we need it
 
 	llassert_always(getPending() == 0); //should not start accessing the texture cache before initialized.
 
@@ -985,526 +989,478 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
-LLAPRFile* LLTextureCache::openHeaderEntriesFile(bool readonly, S32 offset)
+static U32 num_header_buckets(U32 max_entries)
 {
-	llassert_always(mHeaderAPRFile == NULL);
-	apr_int32_t flags = readonly ? APR_READ|APR_BINARY : APR_READ|APR_WRITE|APR_BINARY;
-	// All code calling openHeaderEntriesFile, immediately calls closeHeaderEntriesFile,
-	// so this file is very short-lived.
-	mHeaderAPRFile = new LLAPRFile(mHeaderEntriesFileName, flags);
-	if(offset > 0)
+	// At least 256, so that the first byte of a UUID selects a range of buckets (see purgeTextures()).
+	U32 num_buckets = 256;
+	while (num_buckets < max_entries)
 	{
-	mHeaderAPRFile->seek(APR_SET, offset);
+		num_buckets <<= 1;
 	}
-	return mHeaderAPRFile;
+	return num_buckets;
 }
 
-void LLTextureCache::closeHeaderEntriesFile()
+//static
+size_t LLTextureCache::getHeaderEntriesFileSize(U32 max_entries, U32 num_buckets)
 {
-	if(!mHeaderAPRFile)
-	{
-		return;
-	}
-
-	delete mHeaderAPRFile;
-	mHeaderAPRFile = NULL;
+	return sizeof(EntriesInfo) + max_entries * sizeof(EntryRecord) + num_buckets * sizeof(S32);
 }
 
-void LLTextureCache::readEntriesHeader()
+// Maps texture.entries with room for max_entries entries.
+bool LLTextureCache::openHeaderEntries(U32 max_entries)
 {
-	// mHeaderEntriesInfo initializes to default values so safe not to read it
-		llassert_always(mHeaderAPRFile == NULL);
-	if (LLAPRFile::isExist(mHeaderEntriesFileName))
+	closeHeaderEntries();
+
+	U32 num_buckets = num_header_buckets(max_entries);
+	size_t size = getHeaderEntriesFileSize(max_entries, num_buckets);
+	if (!mHeaderEntriesFile.open(mHeaderEntriesFileName, size, mReadOnly))
 	{
-		LLAPRFile::readEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo));
+		return false;
 	}
-	else //create an empty entries header.
+
+	U8* data = mHeaderEntriesFile.getData();
+	mHeaderEntriesInfo = (EntriesInfo*)data;
+	mHeaderEntries = (EntryRecord*)(data + sizeof(EntriesInfo));
+	mHeaderBuckets = (S32*)(data + sizeof(EntriesInfo) + max_entries * sizeof(EntryRecord));
+	mBucketShift = 32;
+	for (U32 n = num_buckets; n > 1; n >>= 1)
 	{
-		mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
-		mHeaderEntriesInfo.mEntries = 0;
-		writeEntriesHeader();
+		--mBucketShift;
 	}
+	return true;
 }
 
-void LLTextureCache::writeEntriesHeader()
+void LLTextureCache::closeHeaderEntries()
 {
-	llassert_always(mHeaderAPRFile == NULL);
+	if (!mHeaderEntriesFile.isOpen())
+	{
+		return;
+	}
 	if (!mReadOnly)
 	{
-		LLAPRFile::writeEx(mHeaderEntriesFileName, (U8*)&mHeaderEntriesInfo, 0, sizeof(EntriesInfo));
+		// Make sure that everything else is on disk before marking the index as valid.
+		mHeaderEntriesInfo->mTexturesSizeTotal = mTexturesSizeTotal;
+		mHeaderEntriesFile.flush(true);
+		mHeaderEntriesInfo->mClean = 1;
+		mHeaderEntriesFile.flush(true);
 	}
+	mHeaderEntriesFile.close();
+	mHeaderEntriesInfo = NULL;
+	mHeaderEntries = NULL;
+	mHeaderBuckets = NULL;
 }
 
-//mHeaderMutex is locked before calling this.
-S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
+// Empties the mapped header.
+void LLTextureCache::initHeaderEntries()
 {
-	S32 idx = -1;
-	
-	id_map_t::iterator iter1 = mHeaderIDMap.find(id);
-	if (iter1 != mHeaderIDMap.end())
-	{
-		idx = iter1->second;
-	}
+	EntriesInfo& info = *mHeaderEntriesInfo;
+	info.mVersion = sHeaderCacheVersion;
+	info.mEntries = 0;
+	info.mMaxEntries = sCacheMaxEntries;
+	info.mNumBuckets = num_header_buckets(sCacheMaxEntries);
+	info.mLRUHead = info.mLRUTail = -1;
+	info.mFreeHead = -1;
+	info.mClean = 0;
+	info.mTexturesSizeTotal = 0;
+	std::fill(mHeaderBuckets, mHeaderBuckets + info.mNumBuckets, -1);
+	mTexturesSizeTotal = 0;
+}
 
-	if (idx < 0)
-	{
-		if (create && !mReadOnly)
-		{
-			if (mHeaderEntriesInfo.mEntries < sCacheMaxEntries)
-			{
-				// Add an entry to the end of the list
-				idx = mHeaderEntriesInfo.mEntries++;
+// Rebuilds the LRU list, the hash index and the free list from the entries themselves.
+void LLTextureCache::rebuildHeaderIndex()
+{
+	EntriesInfo& info = *mHeaderEntriesInfo;
+	info.mEntries = llmin(info.mEntries, info.mMaxEntries);
+	info.mLRUHead = info.mLRUTail = -1;
+	info.mFreeHead = -1;
+	std::fill(mHeaderBuckets, mHeaderBuckets + info.mNumBuckets, -1);
+	mTexturesSizeTotal = 0;
 
-			}
-			else if (!mFreeList.empty())
-			{
-				idx = *(mFreeList.begin());
-				mFreeList.erase(mFreeList.begin());
-			}
-			else
-			{
-				// Look for a still valid entry in the LRU
-				for (std::set<LLUUID>::iterator iter2 = mLRU.begin(); iter2 != mLRU.end();)
-				{
-					std::set<LLUUID>::iterator curiter2 = iter2++;
-					LLUUID oldid = *curiter2;
-					// Erase entry from LRU regardless
-					mLRU.erase(curiter2);
-					// Look up entry and use it if it is valid
-					id_map_t::iterator iter3 = mHeaderIDMap.find(oldid);
-					if (iter3 != mHeaderIDMap.end() && iter3->second >= 0)
-					{
-						idx = iter3->second;
-						removeCachedTexture(oldid);//remove the existing cached texture to release the entry index.
-						break;
-					}
-				}
-				// if (idx < 0) at this point, we will rebuild the LRU 
-				//  and retry if called from setHeaderCacheEntry(),
-				//  otherwise this shouldn't happen and will trigger an error
-			}
-			if (idx >= 0)
-			{
-				entry.mID = id;
-				entry.mImageSize = -1; //mark it is a brand-new entry.					
-				entry.mBodySize = 0;
-			}
-		}
-	}
-	else
+	typedef std::vector<std::pair<U32, S32> > time_idx_list_t;
+	time_idx_list_t lru;
+	lru.reserve(info.mEntries);
+	for (S32 idx = (S32)info.mEntries - 1; idx >= 0; --idx)
 	{
-		// Remove this entry from the LRU if it exists
-		mLRU.erase(id);
-		// Read the entry
-		idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx);
-		if(iter != mUpdatedEntryMap.end())
+		EntryRecord& record = getEntryRecord(idx);
+		Entry& entry = record.mEntry;
+		record.mPrev = NOT_LINKED;
+		record.mNext = -1;
+		record.mHashNext = NOT_LINKED;
+		if (entry.mImageSize > entry.mBodySize && entry.mBodySize >= 0 && findEntry(entry.mID) < 0)
 		{
-			entry = iter->second;
+			linkHash(idx);
+			lru.push_back(std::make_pair(entry.mTime, idx));
+			mTexturesSizeTotal += entry.mBodySize;
 		}
 		else
 		{
-			readEntryFromHeaderImmediately(idx, entry);
+			freeEntry(idx);
 		}
-		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
-		{
-			llwarns << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << llendl;
+	}
+	std::sort(lru.begin(), lru.end());
+	for (time_idx_list_t::iterator iter = lru.begin(); iter != lru.end(); ++iter)
+	{
+		linkLRU(iter->second);
+	}
+	llinfos << "Rebuilt the texture cache index: " << lru.size() << " of " << info.mEntries << " entries in use." << llendl;
+}
 
-			//erase this entry and the cached texture from the cache.
-			std::string tex_filename = getTextureFileName(id);
-			removeEntry(idx, entry, tex_filename);
-			mUpdatedEntryMap.erase(idx);
-			idx = -1;
+// Starts writing the changes of the mapped header to disk.
+void LLTextureCache::flushHeaderEntries()
+{
+	if (mHeaderEntriesFile.isOpen() && !mReadOnly)
+	{
+		mHeaderEntriesInfo->mTexturesSizeTotal = mTexturesSizeTotal;
+		mHeaderEntriesFile.flush();
+	}
+}
+
+U32 LLTextureCache::getBucket(const LLUUID& id) const
+{
+	// UUIDs are random, so their first bytes are good enough as hash.
+	U32 hash = ((U32)id.mData[0] << 24) | ((U32)id.mData[1] << 16) | ((U32)id.mData[2] << 8) | (U32)id.mData[3];
+	return hash >> mBucketShift;
+}
+
+S32 LLTextureCache::findEntry(const LLUUID& id) const
+{
+	for (S32 idx = mHeaderBuckets[getBucket(id)]; idx >= 0; idx = mHeaderEntries[idx].mHashNext)
+	{
+		if (mHeaderEntries[idx].mEntry.mID == id)
+		{
+			return idx;
 		}
 	}
-	return idx;
+	return -1;
 }
 
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
-{	
-	LLAPRFile* aprfile;
-	S32 bytes_written;
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	if(write_header)
-	{
-		aprfile = openHeaderEntriesFile(false, 0);		
-		bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo));
-		if(bytes_written != sizeof(EntriesInfo))
+void LLTextureCache::linkHash(S32 idx)
+{
+	EntryRecord& record = getEntryRecord(idx);
+	S32& bucket = mHeaderBuckets[getBucket(record.mEntry.mID)];
+	record.mHashNext = bucket;
+	bucket = idx;
+}
+
+void LLTextureCache::unlinkHash(S32 idx)
+{
+	EntryRecord& record = getEntryRecord(idx);
+	if (record.mHashNext == NOT_LINKED)
+	{
+		return;
+	}
+	S32* link = &mHeaderBuckets[getBucket(record.mEntry.mID)];
+	while (*link != idx)
+	{
+		if (*link < 0)
 		{
-			clearCorruptedCache(); //clear the cache.
-			idx = -1; //mark the idx invalid.
+			llwarns << "Entry " << idx << " missing from its hash bucket." << llendl;
+			record.mHashNext = NOT_LINKED;
 			return;
 		}
+		link = &getEntryRecord(*link).mHashNext;
+	}
+	*link = record.mHashNext;
+	record.mHashNext = NOT_LINKED;
+}
 
-		mHeaderAPRFile->seek(APR_SET, offset);
+// Appends idx to the LRU list, as the most recently used entry.
+void LLTextureCache::linkLRU(S32 idx)
+{
+	EntriesInfo& info = *mHeaderEntriesInfo;
+	EntryRecord& record = getEntryRecord(idx);
+	record.mPrev = info.mLRUTail;
+	record.mNext = -1;
+	if (info.mLRUTail >= 0)
+	{
+		getEntryRecord(info.mLRUTail).mNext = idx;
 	}
 	else
 	{
-		aprfile = openHeaderEntriesFile(false, offset);
+		info.mLRUHead = idx;
 	}
-	bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-	if(bytes_written != sizeof(Entry))
-	{
-		clearCorruptedCache(); //clear the cache.
-		idx = -1; //mark the idx invalid.
+	info.mLRUTail = idx;
+}
 
+void LLTextureCache::unlinkLRU(S32 idx)
+{
+	EntriesInfo& info = *mHeaderEntriesInfo;
+	EntryRecord& record = getEntryRecord(idx);
+	if (record.mPrev == NOT_LINKED)
+	{
 		return;
 	}
-
-	closeHeaderEntriesFile();
-	mUpdatedEntryMap.erase(idx);
+	if (record.mPrev >= 0)
+	{
+		getEntryRecord(record.mPrev).mNext = record.mNext;
+	}
+	else
+	{
+		info.mLRUHead = record.mNext;
+	}
+	if (record.mNext >= 0)
+	{
+		getEntryRecord(record.mNext).mPrev = record.mPrev;
+	}
+	else
+	{
+		info.mLRUTail = record.mPrev;
+	}
+	record.mPrev = NOT_LINKED;
+	record.mNext = -1;
 }
 
-//mHeaderMutex is locked before calling this.
-void LLTextureCache::readEntryFromHeaderImmediately(S32& idx, Entry& entry)
+// Returns a slot for a new entry for id, reusing the least recently used entry if
+// the cache is full. The entry isn't added to the hash index until updateEntry().
+S32 LLTextureCache::allocateEntry(const LLUUID& id)
 {
-		S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-		LLAPRFile* aprfile = openHeaderEntriesFile(true, offset);
-		S32 bytes_read = aprfile->read((void*)&entry, (S32)sizeof(Entry));
-		closeHeaderEntriesFile();
+	EntriesInfo& info = *mHeaderEntriesInfo;
+	if (info.mFreeHead < 0 && info.mEntries >= info.mMaxEntries && !removeLeastRecentlyUsed())
+	{
+		return -1;
+	}
 
-	if(bytes_read != sizeof(Entry))
+	S32 idx;
+	if (info.mFreeHead >= 0)
 	{
-		clearCorruptedCache(); //clear the cache.
-		idx = -1;//mark the idx invalid.
+		idx = info.mFreeHead;
+		info.mFreeHead = getEntryRecord(idx).mNext;
 	}
+	else
+	{
+		idx = info.mEntries++;
+	}
+
+	EntryRecord& record = getEntryRecord(idx);
+	record.mEntry.init(id, time(NULL));
+	record.mEntry.mImageSize = -1; //mark it is a brand-new entry.
+	record.mPrev = NOT_LINKED;
+	record.mHashNext = NOT_LINKED;
+	linkLRU(idx);
+	return idx;
 }
 
-//mHeaderMutex is locked before calling this.
-//update an existing entry time stamp, delay writing.
-void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
+// Puts idx on the free list.
+void LLTextureCache::freeEntry(S32 idx)
 {
-	static const U32 MAX_ENTRIES_WITHOUT_TIME_STAMP = (U32)(LLTextureCache::sCacheMaxEntries * 0.75f);
+	EntriesInfo& info = *mHeaderEntriesInfo;
+	unlinkLRU(idx);
+	unlinkHash(idx);
+	EntryRecord& record = getEntryRecord(idx);
+	record.mEntry.mImageSize = -1;
+	record.mEntry.mBodySize = 0;
+	record.mNext = info.mFreeHead;
+	info.mFreeHead = idx;
+}
 
-	if(mHeaderEntriesInfo.mEntries < MAX_ENTRIES_WITHOUT_TIME_STAMP)
+// Removes the least recently used entry and its texture. Returns false if the cache is empty.
+bool LLTextureCache::removeLeastRecentlyUsed()
+{
+	S32 idx = mHeaderEntriesInfo->mLRUHead;
+	if (idx < 0)
 	{
-		return; //there are enough empty entry index space, no need to stamp time.
+		return false;
 	}
+	Entry& entry = getEntryRecord(idx).mEntry;
+	std::string filename = getTextureFileName(entry.mID);
+	removeEntry(idx, entry, filename);
+	return true;
+}
 
-	if (idx >= 0)
+//mHeaderMutex is locked before calling this.
+S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create)
+{
+	S32 idx = findEntry(id);
+	if (idx < 0)
 	{
-		if (!mReadOnly)
+		if (create && !mReadOnly)
+		{
+			idx = allocateEntry(id);
+			if (idx >= 0)
+			{
+				entry = getEntryRecord(idx).mEntry;
+			}
+		}
+	}
+	else
+	{
+		entry = getEntryRecord(idx).mEntry;
+		if(entry.mImageSize <= entry.mBodySize)//it happens on 64-bit systems, do not know why
 		{
-			entry.mTime = time(NULL);
-			mUpdatedEntryMap[idx] = entry;
+			llwarns << "corrupted entry: " << id << " entry image size: " << entry.mImageSize << " entry body size: " << entry.mBodySize << llendl;
+
+			//erase this entry and the cached texture from the cache.
+			std::string tex_filename = getTextureFileName(id);
+			removeEntry(idx, entry, tex_filename);
+			idx = -1;
 		}
 	}
+	return idx;
 }
 
-//update an existing entry, write to header file immediately.
+//update an existing entry, or add a brand-new one to the index.
 bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_data_size)
 {
 	S32 new_body_size = llmax(0, new_data_size - TEXTURE_CACHE_ENTRY_SIZE);
 	
 	if(new_image_size == entry.mImageSize && new_body_size == entry.mBodySize)
-			{
-		return true; //nothing changed.
-			}
-	else 
 	{
-		bool purge = false;
-			
-		lockHeaders();
-
-		bool update_header = false;
-		if(entry.mImageSize < 0) //is a brand-new entry
-			{
-			mHeaderIDMap[entry.mID] = idx;
-			mTexturesSizeMap[entry.mID] = new_body_size;
-			mTexturesSizeTotal += new_body_size;
-			
-			// Update Header
-			update_header = true;
-			}
-		else if (entry.mBodySize != new_body_size)
-		{
-			//already in mHeaderIDMap.
-			mTexturesSizeMap[entry.mID] = new_body_size;
-			mTexturesSizeTotal -= entry.mBodySize;
-			mTexturesSizeTotal += new_body_size;
-		}
-		entry.mTime = time(NULL);
-		entry.mImageSize = new_image_size; 
-		entry.mBodySize = new_body_size;
-		
-		writeEntryToHeaderImmediately(idx, entry, update_header);
-	
-		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
-		{
-			purge = true;
-		}
-		
-		unlockHeaders();
-
-		if (purge)
-		{
-			mDoPurge = TRUE;
-		}
+		return true; //nothing changed.
 	}
 
-	return false;
-}
-
-U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
-{
-	U32 num_entries = mHeaderEntriesInfo.mEntries;
+	bool purge = false;
 
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
-	mFreeList.clear();
-	mTexturesSizeTotal = 0;
+	lockHeaders();
 
-	LLAPRFile* aprfile = NULL; 
-	if(mUpdatedEntryMap.empty())
+	EntryRecord& record = getEntryRecord(idx);
+	if (record.mEntry.mID != entry.mID || record.mPrev == NOT_LINKED)
 	{
-		aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
+		// The slot was reused for another texture since entry was read.
+		unlockHeaders();
+		idx = -1;
+		return false;
 	}
-	else //update the header file first.
+	if (record.mHashNext == NOT_LINKED) //is a brand-new entry
 	{
-		aprfile = openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile();
-		if(!aprfile)
+		if (findEntry(entry.mID) >= 0)
 		{
-			return 0;
+			// Another write of the same texture beat us to it.
+			freeEntry(idx);
+			unlockHeaders();
+			idx = -1;
+			return false;
 		}
-		aprfile->seek(APR_SET, (S32)sizeof(EntriesInfo));
+		linkHash(idx);
+		mTexturesSizeTotal += new_body_size;
 	}
-	for (U32 idx=0; idx<num_entries; idx++)
+	else
 	{
-		Entry entry;
-		S32 bytes_read = aprfile->read((void*)(&entry), (S32)sizeof(Entry));
-		if (bytes_read < sizeof(Entry))
-		{
-			llwarns << "Corrupted header entries, failed at " << idx << " / " << num_entries << llendl;
-			closeHeaderEntriesFile();
-			purgeAllTextures(false);
-			return 0;
-		}
-		entries.push_back(entry);
-// 		llinfos << "ENTRY: " << entry.mTime << " TEX: " << entry.mID << " IDX: " << idx << " Size: " << entry.mImageSize << llendl;
-		if(entry.mImageSize > entry.mBodySize)
-		{
-			mHeaderIDMap[entry.mID] = idx;
-				mTexturesSizeMap[entry.mID] = entry.mBodySize;
-				mTexturesSizeTotal += entry.mBodySize;
-			}
-		else
-		{
-			mFreeList.insert(idx);
-		}
+		mTexturesSizeTotal += new_body_size - record.mEntry.mBodySize;
 	}
-	closeHeaderEntriesFile();
-	return num_entries;
-}
+	entry.mTime = time(NULL);
+	entry.mImageSize = new_image_size; 
+	entry.mBodySize = new_body_size;
+	record.mEntry = entry;
 
-void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
-{
-	S32 num_entries = entries.size();
-	llassert_always(num_entries == mHeaderEntriesInfo.mEntries);
-	
-	if (!mReadOnly)
+	if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 	{
-		LLAPRFile* aprfile = openHeaderEntriesFile(false, (S32)sizeof(EntriesInfo));
-		for (S32 idx=0; idx<num_entries; idx++)
-		{
-			S32 bytes_written = aprfile->write((void*)(&entries[idx]), (S32)sizeof(Entry));
-			if(bytes_written != sizeof(Entry))
-			{
-				clearCorruptedCache(); //clear the cache.
-				return;
-			}
-		}
-		closeHeaderEntriesFile();
+		purge = true;
 	}
-}
 
-void LLTextureCache::writeUpdatedEntries()
-{
-	lockHeaders();
-	if (!mReadOnly && !mUpdatedEntryMap.empty())
-	{
-		openHeaderEntriesFile(false, 0);
-		updatedHeaderEntriesFile();
-		closeHeaderEntriesFile();
-	}
 	unlockHeaders();
-}
 
-//mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
-void LLTextureCache::updatedHeaderEntriesFile()
-{
-	if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
+	if (purge)
 	{
-		//entriesInfo
-		mHeaderAPRFile->seek(APR_SET, 0);
-		S32 bytes_written = mHeaderAPRFile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo));
-		if(bytes_written != sizeof(EntriesInfo))
-		{
-			clearCorruptedCache(); //clear the cache.
-			return;
-		}
-		
-		//write each updated entry
-		S32 entry_size = (S32)sizeof(Entry);
-		S32 prev_idx = -1;
-		S32 delta_idx;
-		for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
-		{
-			delta_idx = iter->first - prev_idx - 1;
-			prev_idx = iter->first;
-			if(delta_idx)
-			{
-				mHeaderAPRFile->seek(APR_CUR, delta_idx * entry_size);
-			}
-			
-			bytes_written = mHeaderAPRFile->write((void*)(&iter->second), entry_size);
-			if(bytes_written != entry_size)
-			{
-				clearCorruptedCache(); //clear the cache.
-				return;
-			}
-		}
-		mUpdatedEntryMap.clear();
+		mDoPurge = TRUE;
 	}
+
+	return false;
 }
+
 //----------------------------------------------------------------------------
 
-// Called from either the main thread or the worker thread
+// Called from the main thread, by initCache().
 void LLTextureCache::readHeaderCache()
 {
-	mHeaderMutex.lock();
+	LLMutexLock lock(&mHeaderMutex);
 
-	mLRU.clear(); // always clear the LRU
+	if (!openHeaderEntries(sCacheMaxEntries))
+	{
+		llwarns << "Unable to map " << mHeaderEntriesFileName << ", the texture cache is read-only." << llendl;
+		mReadOnly = TRUE;
+		if (!openHeaderEntries(sCacheMaxEntries))
+		{
+			llerrs << "Out of memory reading " << mHeaderEntriesFileName << llendl;
+		}
+	}
+	bool is_new = mHeaderEntriesFile.getInitialFileSize() < sizeof(EntriesInfo);
+	U32 num_buckets = num_header_buckets(sCacheMaxEntries);
 
-	readEntriesHeader();
-	
-	if (mHeaderEntriesInfo.mVersion != sHeaderCacheVersion)
+	if (is_new || mHeaderEntriesInfo->mVersion != sHeaderCacheVersion || mHeaderEntriesInfo->mEntries > mHeaderEntriesInfo->mMaxEntries)
 	{
-		if (!mReadOnly)
+		if (!is_new && !mReadOnly)
 		{
 			purgeAllTextures(false);
 		}
+		initHeaderEntries();
 	}
-	else
+	else if (mHeaderEntriesInfo->mMaxEntries != sCacheMaxEntries || mHeaderEntriesInfo->mNumBuckets != num_buckets)
 	{
-		std::vector<Entry> entries;
-		U32 num_entries = openAndReadEntries(entries);
-		if (num_entries)
+		// The size of the cache changed. Slots keep their place, but the hash index
+		// moves and the slots beyond the new maximum have to go.
+		U32 old_max_entries = mHeaderEntriesInfo->mMaxEntries;
+		size_t old_size = getHeaderEntriesFileSize(old_max_entries, mHeaderEntriesInfo->mNumBuckets);
+		size_t new_size = getHeaderEntriesFileSize(sCacheMaxEntries, num_buckets);
+		if (old_size > new_size)
 		{
-			U32 empty_entries = 0;
-			typedef std::pair<U32, S32> lru_data_t;
-			std::set<lru_data_t> lru;
-			std::set<U32> purge_list;
-			for (U32 i=0; i<num_entries; i++)
-			{
-				Entry& entry = entries[i];
-				if (entry.mImageSize <= 0)
-				{
-					// This will be in the Free List, don't put it in the LRU
-					++empty_entries;
-				}
-				else
-				{
-					lru.insert(std::make_pair(entry.mTime, i));
-					if (entry.mBodySize > 0)
-					{
-						if (entry.mBodySize > entry.mImageSize)
-						{
-							// Shouldn't happen, failsafe only
-							llwarns << "Bad entry: " << i << ": " << entry.mID << ": BodySize: " << entry.mBodySize << llendl;
-							purge_list.insert(i);
-						}
-					}
-				}
-			}
-			if (num_entries - empty_entries > sCacheMaxEntries)
+			// Map all old entries.
+			if (mHeaderEntriesFile.open(mHeaderEntriesFileName, old_size, mReadOnly))
 			{
-				// Special case: cache size was reduced, need to remove entries
-				// Note: After we prune entries, we will call this again and create the LRU
-				U32 entries_to_purge = (num_entries - empty_entries) - sCacheMaxEntries;
-				llinfos << "Texture Cache Entries: " << num_entries << " Max: " << sCacheMaxEntries << " Empty: " << empty_entries << " Purging: " << entries_to_purge << llendl;
-				// We can exit the following loop with the given condition, since if we'd reach the end of the lru set we'd have:
-				// purge_list.size() = lru.size() = num_entries - empty_entries = entries_to_purge + sCacheMaxEntries >= entries_to_purge
-				// So, it's certain that iter will never reach lru.end() first.
-				std::set<lru_data_t>::iterator iter = lru.begin();
-				while (purge_list.size() < entries_to_purge)
-				{
-					purge_list.insert(iter->second);
-					++iter;
-				}
+				mHeaderEntriesInfo = (EntriesInfo*)mHeaderEntriesFile.getData();
+				mHeaderEntries = (EntryRecord*)(mHeaderEntriesFile.getData() + sizeof(EntriesInfo));
 			}
 			else
 			{
-				S32 lru_entries = (S32)((F32)sCacheMaxEntries * TEXTURE_CACHE_LRU_SIZE);
-				for (std::set<lru_data_t>::iterator iter = lru.begin(); iter != lru.end(); ++iter)
+				// Without the old entries the textures beyond the new maximum can't be found, so all of them go.
+				llwarns << "Unable to map the " << old_max_entries << " entries of " << mHeaderEntriesFileName << ", clearing the texture cache." << llendl;
+				mHeaderEntriesInfo = NULL;
+				mHeaderEntries = NULL;
+				mHeaderBuckets = NULL;
+				purgeAllTextures(false);
+				if (!openHeaderEntries(sCacheMaxEntries))
 				{
-					mLRU.insert(entries[iter->second].mID);
-// 					llinfos << "LRU: " << iter->first << " : " << iter->second << llendl;
-					if (--lru_entries <= 0)
-						break;
+					llerrs << "Out of memory reading " << mHeaderEntriesFileName << llendl;
 				}
+				initHeaderEntries();
 			}
-			
-			if (purge_list.size() > 0)
+		}
+		EntriesInfo& info = *mHeaderEntriesInfo;
+		llinfos << "Texture Cache Entries: " << info.mEntries << " Max: " << sCacheMaxEntries << " (was " << old_max_entries << ")" << llendl;
+		if (!mReadOnly)
+		{
+			for (U32 idx = sCacheMaxEntries; idx < info.mEntries; ++idx)
 			{
-				for (std::set<U32>::iterator iter = purge_list.begin(); iter != purge_list.end(); ++iter)
-				{
-					std::string tex_filename = getTextureFileName(entries[*iter].mID);
-					removeEntry((S32)*iter, entries[*iter], tex_filename);
-				}
-				// If we removed any entries, we need to rebuild the entries list,
-				// write the header, and call this again
-				std::vector<Entry> new_entries;
-				for (U32 i=0; i<num_entries; i++)
+				Entry& entry = getEntryRecord(idx).mEntry;
+				if (entry.mImageSize > 0)
 				{
-					const Entry& entry = entries[i];
-					if (entry.mImageSize > 0)
-					{
-						new_entries.push_back(entry);
-					}
+					LLAPRFile::remove(getTextureFileName(entry.mID));
 				}
-				llassert_always(new_entries.size() <= sCacheMaxEntries);
-				mHeaderEntriesInfo.mEntries = new_entries.size();
-				writeEntriesHeader();
-				writeEntriesAndClose(new_entries);
-				mHeaderMutex.unlock(); // unlock the mutex before calling again
-				readHeaderCache(); // repeat with new entries file
-				mHeaderMutex.lock();
 			}
-			else
+		}
+		if (old_size > new_size && !openHeaderEntries(sCacheMaxEntries))
+		{
+			llwarns << "Unable to map " << mHeaderEntriesFileName << ", the texture cache is read-only." << llendl;
+			mReadOnly = TRUE;
+			if (!openHeaderEntries(sCacheMaxEntries))
 			{
-				//entries are not changed, nothing here.
+				llerrs << "Out of memory reading " << mHeaderEntriesFileName << llendl;
 			}
 		}
+		mHeaderEntriesInfo->mEntries = llmin(mHeaderEntriesInfo->mEntries, sCacheMaxEntries);
+		mHeaderEntriesInfo->mMaxEntries = sCacheMaxEntries;
+		mHeaderEntriesInfo->mNumBuckets = num_buckets;
+		rebuildHeaderIndex();
 	}
-	mHeaderMutex.unlock();
-}
-
-//////////////////////////////////////////////////////////////////////////////
-
-//the header mutex is locked before calling this.
-void LLTextureCache::clearCorruptedCache()
-{
-	llwarns << "the texture cache is corrupted, need to be cleared." << llendl;
-
-	closeHeaderEntriesFile();//close possible file handler
-	purgeAllTextures(false); //clear the cache.
-	
-	if (!mReadOnly) //regenerate the directory tree if not exists.
+	else if (!mHeaderEntriesInfo->mClean)
 	{
-		LLFile::mkdir(mTexturesDirName);
-		
-		const char* subdirs = "0123456789abcdef";
-		for (S32 i=0; i<16; i++)
-		{
-			std::string dirname = mTexturesDirName + gDirUtilp->getDirDelimiter() + subdirs[i];
-			LLFile::mkdir(dirname);
-		}
+		// The viewer didn't exit normally.
+		rebuildHeaderIndex();
+	}
+	else
+	{
+		mTexturesSizeTotal = mHeaderEntriesInfo->mTexturesSizeTotal;
 	}
 
-	return;
+	if (!mReadOnly)
+	{
+		// Any change from now on invalidates the index until closeHeaderEntries().
+		mHeaderEntriesInfo->mClean = 0;
+		mHeaderEntriesFile.flush(true);
+	}
 }
 
+//////////////////////////////////////////////////////////////////////////////
+
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
 	if (!mReadOnly)
@@ -1528,32 +1484,33 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 			LLFile::rmdir(mTexturesDirName);
 		}
 	}
-	mHeaderIDMap.clear();
-	mTexturesSizeMap.clear();
 	mTexturesSizeTotal = 0;
-	mFreeList.clear();
-	mTexturesSizeTotal = 0;
-	mUpdatedEntryMap.clear();
 
-	// Info with 0 entries
-	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
-	mHeaderEntriesInfo.mEntries = 0;
-	writeEntriesHeader();
+	if (mHeaderEntriesFile.isOpen())
+	{
+		initHeaderEntries();
+	}
+	else if (!mReadOnly && LLAPRFile::isExist(mHeaderEntriesFileName))
+	{
+		// readHeaderCache() creates a new one.
+		LLAPRFile::remove(mHeaderEntriesFileName);
+	}
 
 	llinfos << "The entire texture cache is cleared." << llendl;
 }
 
+// Called before every write: removes the least recently used textures until the
+// cache is below its maximum size, and then one more per call until it is
+// TEXTURE_CACHE_PURGE_AMOUNT below it.
 void LLTextureCache::performDelayedPurge()
 {
 	LLMutexLock lock(&mHeaderMutex);
-	while(!sgDelayedPurgeQueue.empty())
+	while (mTexturesSizeTotal >= sCacheMaxTexturesSize && removeLeastRecentlyUsed())
 	{
-		removeFromCache(sgDelayedPurgeQueue.front());
-		sgDelayedPurgeQueue.pop();
-		if (mTexturesSizeTotal < sCacheMaxTexturesSize)
-		{
-			break;
-		}
+	}
+	if (mTexturesSizeTotal <= mPurgeTargetSize || !removeLeastRecentlyUsed())
+	{
+		mDoPurge = FALSE;
 	}
 }
 
@@ -1574,111 +1531,61 @@ void LLTextureCache::purgeTextures(bool validate)
 
 	llinfos << "TEXTURE CACHE: Purging." << llendl;
 
-	std::queue<LLUUID> empty;
-	std::swap(sgDelayedPurgeQueue, empty);
-
-	// Read the entries list
-	std::vector<Entry> entries;
-	U32 num_entries = openAndReadEntries(entries);
-	if (!num_entries)
-	{
-		return; // nothing to purge
-	}
-	
-	// Use mTexturesSizeMap to collect UUIDs of textures with bodies
-	typedef std::vector<std::pair<U32,S32> > time_idx_set_t;
-	time_idx_set_t time_idx_set;
-	for (size_map_t::iterator iter1 = mTexturesSizeMap.begin();
-		 iter1 != mTexturesSizeMap.end(); ++iter1)
-	{
-		if (iter1->second > 0)
-		{
-			id_map_t::iterator iter2 = mHeaderIDMap.find(iter1->first);
-			if (iter2 != mHeaderIDMap.end())
-			{
-				S32 idx = iter2->second;
-				time_idx_set.push_back(std::make_pair(entries[idx].mTime, idx));
-// 				llinfos << "TIME: " << entries[idx].mTime << " TEX: " << entries[idx].mID << " IDX: " << idx << " Size: " << entries[idx].mImageSize << llendl;
-			}
-			else
-			{
-				llerrs << "mTexturesSizeMap / mHeaderIDMap corrupted." << llendl ;
-			}
-		}
-	}
+	S32 purge_count = 0;
 
-	std::sort(time_idx_set.begin(), time_idx_set.end());
-	
 	// Validate 1/256th of the files on startup
-	U32 validate_idx = 0;
 	if (validate)
 	{
-		validate_idx = gSavedSettings.getU32("CacheValidateCounter");
+		U32 validate_idx = gSavedSettings.getU32("CacheValidateCounter");
 		U32 next_idx = (validate_idx + 1) % 256;
 		gSavedSettings.setU32("CacheValidateCounter", next_idx);
 		LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Validating: " << validate_idx << LL_ENDL;
-	}
 
-	S64 cache_size = mTexturesSizeTotal;
-	S64 purged_cache_size = (sCacheMaxTexturesSize * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100;
-	S32 purge_count = 0;
-	for (time_idx_set_t::iterator iter = time_idx_set.begin();
-		 iter != time_idx_set.end(); ++iter)
-	{
-		S32 idx = iter->second;
-		bool purge_entry = false;
-		std::string filename = getTextureFileName(entries[idx].mID);
-		if (cache_size >= purged_cache_size)
-		{
-			purge_entry = true;
-		}
-		else if (validate)
+		// The hash of an entry starts with the first byte of its UUID, so all entries to validate are in this range of buckets.
+		U32 bucket_bits = 32 - mBucketShift;
+		U32 end_bucket = (validate_idx + 1) << (bucket_bits - 8);
+		for (U32 bucket = validate_idx << (bucket_bits - 8); bucket < end_bucket; ++bucket)
 		{
-			// make sure file exists and is the correct size
-			U32 uuididx = entries[idx].mID.mData[0];
-			if (uuididx == validate_idx)
+			S32 idx = mHeaderBuckets[bucket];
+			while (idx >= 0)
 			{
- 				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entries[idx].mBodySize << LL_ENDL;
-				S32 bodysize = LLAPRFile::size(filename);
-				if (bodysize != entries[idx].mBodySize)
+				EntryRecord& record = getEntryRecord(idx);
+				S32 next_idx = record.mHashNext;
+				Entry& entry = record.mEntry;
+				if (entry.mBodySize > 0)
 				{
-					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entries[idx].mBodySize
-							<< filename << LL_ENDL;
-					purge_entry = true;
+					// make sure file exists and is the correct size
+					std::string filename = getTextureFileName(entry.mID);
+	 				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entry.mBodySize << LL_ENDL;
+					S32 bodysize = LLAPRFile::size(filename);
+					if (bodysize != entry.mBodySize)
+					{
+						LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entry.mBodySize
+								<< filename << LL_ENDL;
+						removeEntry(idx, entry, filename);
+						purge_count++;
+					}
 				}
-			}
-		}
-		else
-		{
-			break;
-		}
-		
-		if (purge_entry)
-		{
-			purge_count++;
-	 		LL_DEBUGS("TextureCache") << "PURGING: " << filename << LL_ENDL;
-			cache_size -= entries[idx].mBodySize;
-			if(validate)
-			{
-				removeEntry(idx, entries[idx], filename);
-			}
-			else
-			{
-				sgDelayedPurgeQueue.push(entries[idx].mID);
+				idx = next_idx;
 			}
 		}
 	}
 
-	LL_DEBUGS("TextureCache") << "TEXTURE CACHE: Writing Entries: " << num_entries << LL_ENDL;
+	// Remove the least recently used textures.
+	while (mTexturesSizeTotal >= mPurgeTargetSize && removeLeastRecentlyUsed())
+	{
+		purge_count++;
+	}
+	mDoPurge = FALSE;
 
-	writeEntriesAndClose(entries);
+	flushHeaderEntries();
 	
 	// *FIX:Mani - watchdog back on.
 	LLAppViewer::instance()->resumeMainloopTimeout();
 	
 	LL_INFOS("TextureCache") << "TEXTURE CACHE:"
 			<< " PURGED: " << purge_count
-			<< " ENTRIES: " << num_entries
+			<< " ENTRIES: " << mHeaderEntriesInfo->mEntries
 			<< " CACHE SIZE: " << mTexturesSizeTotal / (1024 * 1024) << " MB"
 			<< llendl;
 }
@@ -1716,9 +1623,13 @@ S32 LLTextureCache::getHeaderCacheEntry(const LLUUID& id, Entry& entry)
 {
 	LLMutexLock lock(&mHeaderMutex);
 	S32 idx = openAndReadEntry(id, entry, false);
-	if (idx >= 0)
+	if (idx >= 0 && !mReadOnly)
 	{
-		updateEntryTimeStamp(idx, entry); // updates time
+		// Move it to the end of the LRU list.
+		unlinkLRU(idx);
+		linkLRU(idx);
+		entry.mTime = time(NULL);
+		getEntryRecord(idx).mEntry.mTime = entry.mTime;
 	}
 	return idx;
 }
@@ -1734,17 +1645,6 @@ S32 LLTextureCache::setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imag
 	{
 		updateEntry(idx, entry, imagesize, datasize);				
 	}
-
-	if(idx < 0) // retry
-	{
-		readHeaderCache(); // We couldn't write an entry, so refresh the LRU
-	
-		mHeaderMutex.lock();
-		llassert_always(!mLRU.empty() || mHeaderEntriesInfo.mEntries < sCacheMaxEntries);
-		mHeaderMutex.unlock();
-
-		idx = setHeaderCacheEntry(id, entry, imagesize, datasize); // assert above ensures no inf. recursion
-	}
 	return idx;
 }
 
@@ -1819,15 +1719,13 @@ LLTextureCache::handle_t LLTextureCache::writeToCache(const LLUUID& id, U32 prio
 		delete responder;
 		return LLWorkerThread::nullHandle();
 	}
-	if (sgDelayedPurgeQueue.empty() && mDoPurge)
+	if (mDoPurge)
 	{
-		// NOTE: This may cause an occasional hiccup,
+		// NOTE: This removes a texture file or more,
 		//  but it really needs to be done on the control thread
-		//  (i.e. here)		
-		purgeTextures(false);
-		mDoPurge = FALSE;
+		//  (i.e. here)
+		performDelayedPurge();
 	}
-	performDelayedPurge();
 	LLMutexLock lock(&mWorkersMutex);
 	LLTextureCacheWorker* worker = new LLTextureCacheRemoteWorker(this, priority, id,
 																  data, datasize, 0,
@@ -1873,18 +1771,6 @@ void LLTextureCache::addCompleted(Responder* responder, bool success)
 
 //////////////////////////////////////////////////////////////////////////////
 
-//called after mHeaderMutex is locked.
-void LLTextureCache::removeCachedTexture(const LLUUID& id)
-{
-	if (mTexturesSizeMap.find(id) != mTexturesSizeMap.end())
-	{
-		mTexturesSizeTotal -= mTexturesSizeMap[id];
-		mTexturesSizeMap.erase(id);
-	}
-	mHeaderIDMap.erase(id);
-	LLAPRFile::remove(getTextureFileName(id));		
-}
-
 //called after mHeaderMutex is locked.
 void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 {
@@ -1907,9 +1793,7 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 
 		entry.mImageSize = -1;
 		entry.mBodySize = 0;
-		mHeaderIDMap.erase(entry.mID);
-		mTexturesSizeMap.erase(entry.mID);		
-		mFreeList.insert(idx);	
+		freeEntry(idx);
 	}
 
 	if (file_maybe_exists)
@@ -1930,11 +1814,7 @@ bool LLTextureCache::removeFromCache(const LLUUID& id)
 		S32 idx = openAndReadEntry(id, entry, false);
 		std::string tex_filename = getTextureFileName(id);
 		removeEntry(idx, entry, tex_filename);
-		if (idx >= 0)
-		{			
-			writeEntryToHeaderImmediately(idx, entry);					
-			ret = true;
-		}
+		ret = idx >= 0;
 
 		unlockHeaders();
 	}
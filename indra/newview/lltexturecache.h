@@ -28,6 +28,7 @@
 #define LL_LLTEXTURECACHE_H
 
 #include "lldir.h"
+#include "llmappedfile.h"
 #include "llstl.h"
 #include "llstring.h"
 #include "lluuid.h"
@@ -47,9 +48,15 @@ private:
 	// Entries
 	struct EntriesInfo
 	{
-		EntriesInfo() : mVersion(0.f), mEntries(0) {}
 		F32 mVersion;
-		U32 mEntries;
+		U32 mEntries;				// Number of entry slots that were ever used.
+		U32 mMaxEntries;			// Number of entry slots in the file.
+		U32 mNumBuckets;			// Size of the hash index; a power of two.
+		S32 mLRUHead;				// Least recently used entry, or -1.
+		S32 mLRUTail;				// Most recently used entry, or -1.
+		S32 mFreeHead;				// First unused slot below mEntries, or -1.
+		U32 mClean;					// Zero while the file is in use, so that the index is rebuilt after a crash.
+		S64 mTexturesSizeTotal;		// Sum of all mBodySize.
 	};
 	struct Entry
 	{
@@ -68,6 +75,16 @@ private:
 		S32 mBodySize; // size of body file in body cache
 		U32 mTime; // seconds since 1/1/1970
 	};
+	// How an Entry is stored in texture.entries. Entries that are in use are
+	// linked in the LRU list and, once they have been written, in the hash index.
+	struct EntryRecord
+	{
+		Entry mEntry;
+		S32 mPrev;					// Previous entry in the LRU list, or -1, or NOT_LINKED for a free slot.
+		S32 mNext;					// Next entry in the LRU list or in the free list, or -1.
+		S32 mHashNext;				// Next entry in the same hash bucket, or -1, or NOT_LINKED.
+	};
+	enum { NOT_LINKED = -2 };
 
 	
 public:
@@ -131,7 +148,7 @@ public:
 	S32 getNumWrites() { return mWriters.size(); }
 	S64 getUsage() { return mTexturesSizeTotal; }
 	S64 getMaxUsage() { return sCacheMaxTexturesSize; }
-	U32 getEntries() { return mHeaderEntriesInfo.mEntries; }
+	U32 getEntries() { return mHeaderEntriesInfo ? mHeaderEntriesInfo->mEntries : 0; }
 	U32 getMaxEntries() { return sCacheMaxEntries; };
 	BOOL isInCache(const LLUUID& id) ;
 	BOOL isInLocal(const LLUUID& id) ;
@@ -145,27 +162,30 @@ protected:
 private:
 	void setDirNames(ELLPath location);
 	void readHeaderCache();
-	void clearCorruptedCache();
 	void performDelayedPurge();
 	void purgeAllTextures(bool purge_directories);
 	void purgeTextures(bool validate);
-	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
-	void closeHeaderEntriesFile();
-	void readEntriesHeader();
-	void writeEntriesHeader();
+	bool openHeaderEntries(U32 max_entries);
+	void closeHeaderEntries();
+	static size_t getHeaderEntriesFileSize(U32 max_entries, U32 num_buckets);
+	void initHeaderEntries();
+	void rebuildHeaderIndex();
+	void flushHeaderEntries();
+	EntryRecord& getEntryRecord(S32 idx) { return mHeaderEntries[idx]; }
+	U32 getBucket(const LLUUID& id) const;
+	S32 findEntry(const LLUUID& id) const;
+	void linkHash(S32 idx);
+	void unlinkHash(S32 idx);
+	void linkLRU(S32 idx);
+	void unlinkLRU(S32 idx);
+	S32 allocateEntry(const LLUUID& id);
+	void freeEntry(S32 idx);
+	bool removeLeastRecentlyUsed();
 	S32 openAndReadEntry(const LLUUID& id, Entry& entry, bool create);
 	bool updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_body_size);
-	void updateEntryTimeStamp(S32 idx, Entry& entry) ;
-	U32 openAndReadEntries(std::vector<Entry>& entries);
-	void writeEntriesAndClose(const std::vector<Entry>& entries);
-	void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
-	void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
 	void removeEntry(S32 idx, Entry& entry, std::string& filename);
-	void removeCachedTexture(const LLUUID& id) ;
 	S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
 	S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
-	void writeUpdatedEntries() ;
-	void updatedHeaderEntriesFile() ;
 	void lockHeaders() { mHeaderMutex.lock(); }
 	void unlockHeaders() { mHeaderMutex.unlock(); }
 	
@@ -174,7 +194,6 @@ private:
 	LLMutex mWorkersMutex;
 	LLMutex mHeaderMutex;
 	LLMutex mListMutex;
-	LLAPRFile* mHeaderAPRFile;
 	
 	typedef std::map<handle_t, LLTextureCacheWorker*> handle_map_t;
 	handle_map_t mReaders;
@@ -191,21 +210,19 @@ private:
 	// HEADERS (Include first mip)
 	std::string mHeaderEntriesFileName;
 	std::string mHeaderDataFileName;
-	EntriesInfo mHeaderEntriesInfo;
-	std::set<S32> mFreeList; // deleted entries
-	std::set<LLUUID> mLRU;
-	typedef std::map<LLUUID,S32> id_map_t;
-	id_map_t mHeaderIDMap;
+	// texture.entries, mapped into memory: an EntriesInfo, mMaxEntries EntryRecords
+	// and then mNumBuckets S32 that are the first entry of each hash bucket, or -1.
+	LLMappedFile mHeaderEntriesFile;
+	EntriesInfo* mHeaderEntriesInfo;
+	EntryRecord* mHeaderEntries;
+	S32* mHeaderBuckets;
+	U32 mBucketShift;
 
 	// BODIES (TEXTURES minus headers)
 	std::string mTexturesDirName;
-	typedef std::map<LLUUID,S32> size_map_t;
-	size_map_t mTexturesSizeMap;
 	S64 mTexturesSizeTotal;
 	LLAtomic32<BOOL> mDoPurge;
-
-	typedef std::map<S32, Entry> idx_entry_map_t;
-	idx_entry_map_t mUpdatedEntryMap;
+	S64 mPurgeTargetSize;			// Where performDelayedPurge() stops.
 
 	// Statics
 	static F32 sHeaderCacheVersion;
@@ -3196,10 +3196,10 @@ S32 LLTextureFetch::getFetchState(const LLUUID& id, F32& data_progress_p, F32& r
 void LLTextureFetch::dump()
 {
 	llinfos << "LLTextureFetch REQUESTS:" << llendl;
-	for (request_queue_t::iterator iter = mRequestQueue.begin();
-		 iter != mRequestQueue.end(); ++iter)
+	lockData();
+	for (size_t i = 0; i < mRequestQueue.size(); ++i)
 	{
-		LLQueuedThread::QueuedRequest* qreq = *iter;
+		LLQueuedThread::QueuedRequest* qreq = mRequestQueue[i];
 		LLWorkerThread::WorkRequest* wreq = (LLWorkerThread::WorkRequest*)qreq;
 		LLTextureFetchWorker* worker = (LLTextureFetchWorker*)wreq->getWorkerClass();
 		llinfos << " ID: " << worker->mID
@@ -3207,6 +3207,7 @@ void LLTextureFetch::dump()
 				<< " STATE: " << worker->sStateDescs[worker->mState]
 				<< llendl;
 	}
+	unlockData();
 
 	llinfos << "LLTextureFetch ACTIVE_HTTP:" << llendl;
 	for (queue_t::const_iterator iter(mHTTPTextureQueue.begin());
@@ -387,8 +387,10 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot, boo
 
 	LLImageGL::updateStats(gFrameTimeSeconds);
 	
-	LLVOAvatar::sRenderName = gSavedSettings.getS32("RenderName");
-	LLVOAvatar::sRenderGroupTitles = !gSavedSettings.getBOOL("RenderHideGroupTitleAll");
+	static LLControlHandle render_name(gSavedSettings, "RenderName");
+	static LLControlHandle render_hide_group_title_all(gSavedSettings, "RenderHideGroupTitleAll");
+	LLVOAvatar::sRenderName = render_name.getS32();
+	LLVOAvatar::sRenderGroupTitles = !render_hide_group_title_all.getBOOL();
 	
 	gPipeline.mBackfaceCull = TRUE;
 	gFrameCount++;
@@ -557,8 +559,9 @@ void display(BOOL rebuild, F32 zoom_factor, int subfield, BOOL for_snapshot, boo
 	// Progressively increase draw distance after TP when required.
 	if (gSavedDrawDistance > 0.0f && gAgent.getTeleportState() == LLAgent::TELEPORT_NONE)
 	{
+		static LLControlHandle speed_rez_interval(gSavedSettings, "SpeedRezInterval");
 		if (gTeleportArrivalTimer.getElapsedTimeF32() >=
-			(F32)gSavedSettings.getU32("SpeedRezInterval"))
+			(F32)speed_rez_interval.getU32())
 		{
 			gTeleportArrivalTimer.reset();
 			F32 current = gSavedSettings.getF32("RenderFarClip");
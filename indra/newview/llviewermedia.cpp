@@ -807,6 +807,8 @@ void LLViewerMedia::updateMedia(void *dummy_arg)
 	
 	// Enable/disable the plugin read thread
 	LLPluginProcessParent::setUseReadThread(gSavedSettings.getBOOL("PluginUseReadThread"));
+	// Applies to plugin processes that are launched from now on.
+	LLPluginProcessParent::setUseBinaryMessages(gSavedSettings.getBOOL("PluginUseBinaryMessages"));
 	
 	// HACK: we always try to keep a spare running webkit plugin around to improve launch times.
 	createSpareBrowserMediaSource();
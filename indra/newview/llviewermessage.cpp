@@ -5198,6 +5198,9 @@ void process_kill_object(LLMessageSystem *mesgsys, void **user_data)
 	{
 		mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
 
+		// The object may only exist in an update that wasn't applied yet.
+		gObjectList.killQueuedUpdates(mesgsys->getSender(), local_id);
+
 		LLViewerObjectList::getUUIDFromLocal(id,
 											local_id,
 											gMessageSystem->getSenderIP(),
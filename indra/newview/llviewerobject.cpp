@@ -65,6 +65,7 @@
 #include "llfloatertools.h"
 #include "llfollowcam.h"
 #include "llhudtext.h"
+#include "llobjectupdatequeue.h"
 #include "llselectmgr.h"
 #include "llrendersphere.h"
 #include "lltooldraganddrop.h"
@@ -944,9 +945,21 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 		return retval;
 	}
 
+	// Updates queued by LLViewerObjectList are applied after their message is gone,
+	// so take what is needed of the message from the queued record instead.
+	const LLObjectUpdateRecord* queued = LLObjectUpdateDataPacker::getRecord(dp);
+	const LLHost sender = queued ? queued->mSender : mesgsys->getSender();
+
 	// Coordinates of objects on simulators are region-local.
 	U64 region_handle;
-	mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
+	if (queued)
+	{
+		region_handle = queued->mRegionHandle;
+	}
+	else
+	{
+		mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, region_handle);
+	}
 	
 	{
 		LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(region_handle);
@@ -975,7 +988,14 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 	}
 
 	U16 time_dilation16;
-	mesgsys->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, time_dilation16);
+	if (queued)
+	{
+		time_dilation16 = queued->mTimeDilation;
+	}
+	else
+	{
+		mesgsys->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, time_dilation16);
+	}
 	F32 time_dilation = ((F32) time_dilation16) / 65535.f;
 	mTimeDilation = time_dilation;
 	mRegionp->setTimeDilation(time_dilation);
@@ -1780,7 +1800,14 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 				// Finer shades require the object to be selected, and the selection manager
 				// stores the extended permission info.
 				U32 flags;
-				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, block_num);
+				if (queued)
+				{
+					flags = queued->mUpdateFlags;
+				}
+				else
+				{
+					mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, block_num);
+				}
 				// keep local flags and overwrite remote-controlled flags
 				mFlags = (mFlags & FLAGS_LOCAL) | flags;
 
@@ -1815,8 +1842,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 				LLUUID parent_uuid;
 				LLViewerObjectList::getUUIDFromLocal(parent_uuid,
 														parent_id,
-														mesgsys->getSenderIP(),
-														mesgsys->getSenderPort());
+														sender.getAddress(),
+														sender.getPort());
 
 				LLViewerObject *sent_parentp = gObjectList.findObject(parent_uuid);
 
@@ -1927,8 +1954,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 					//
 					
 					//parent_id
-					U32 ip = mesgsys->getSenderIP();
-					U32 port = mesgsys->getSenderPort();
+					U32 ip = sender.getAddress();
+					U32 port = sender.getPort();
 					
 					gObjectList.orphanize(this, parent_id, ip, port);
 
@@ -1969,8 +1996,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 					LLUUID parent_uuid;
 					LLViewerObjectList::getUUIDFromLocal(parent_uuid,
 														parent_id,
-														gMessageSystem->getSenderIP(),
-														gMessageSystem->getSenderPort());
+														sender.getAddress(),
+														sender.getPort());
 					sent_parentp = gObjectList.findObject(parent_uuid);
 					
 					if (isAvatar())
@@ -1991,8 +2018,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 						//
 						// Switching parents, but we don't know the new parent.
 						//
-						U32 ip = mesgsys->getSenderIP();
-						U32 port = mesgsys->getSenderPort();
+						U32 ip = sender.getAddress();
+						U32 port = sender.getPort();
 
 						// We're an orphan, flag things appropriately.
 						gObjectList.orphanize(this, parent_id, ip, port);
@@ -2078,7 +2105,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
 	if (sPingInterpolate)
 	{ 
-		LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(mesgsys->getSender());
+		LLCircuitData *cdp = gMessageSystem->mCircuitInfo.findCircuit(sender);
 		if (cdp)
 		{
 			F32 ping_delay = 0.5f * mTimeDilation * ( ((F32)cdp->getPingDelay()) * 0.001f + gFrameDTClamped);
@@ -2099,7 +2126,7 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 
 	// If we're going to skip this message, why are we 
 	// doing all the parenting, etc above?
-	U32 packet_id = mesgsys->getCurrentRecvPacketID(); 
+	U32 packet_id = queued ? queued->mPacketID : mesgsys->getCurrentRecvPacketID();
 	if (packet_id < mLatestRecvPacketID && 
 		mLatestRecvPacketID - packet_id < 65536)
 	{
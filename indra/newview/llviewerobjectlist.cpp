@@ -47,6 +47,7 @@
 #include "llviewerwindow.h"
 #include "llwindow.h"
 #include "llnetmap.h"
+#include "llobjectupdatequeue.h"
 #include "llagent.h"
 #include "llagentcamera.h"
 #include "pipeline.h"
@@ -67,6 +68,7 @@
 #include "llviewerregion.h"
 #include "llviewerstats.h"
 #include "llviewerstatsrecorder.h"
+#include "llvolumemgr.h"
 #include "llvovolume.h"
 #include "llvoavatarself.h"
 #include "lltoolmgr.h"
@@ -130,6 +132,7 @@ LLViewerObjectList::LLViewerObjectList()
 	mNumDeadObjectUpdates = 0;
 	mNumUnknownKills = 0;
 	mNumUnknownUpdates = 0;
+	mUpdateQueue = NULL;
 }
 
 LLViewerObjectList::~LLViewerObjectList()
@@ -139,6 +142,9 @@ LLViewerObjectList::~LLViewerObjectList()
 
 void LLViewerObjectList::destroy()
 {
+	delete mUpdateQueue;
+	mUpdateQueue = NULL;
+
 	killAllObjects();
 
 	resetObjectBeacons();
@@ -254,6 +260,8 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 										   BOOL just_created)
 {
 	LLMessageSystem* msg = gMessageSystem;
+	const LLObjectUpdateRecord* queued = LLObjectUpdateDataPacker::getRecord(dpp);
+	const LLHost sender = queued ? queued->mSender : msg->getSender();
 
 	// ignore returned flags
 	objectp->processUpdateMessage(msg, user_data, i, update_type, dpp);
@@ -282,7 +290,7 @@ void LLViewerObjectList::processUpdateCore(LLViewerObject* objectp,
 	// RN: this must be called after we have a drawable 
 	// (from gPipeline.addObject)
 	// so that the drawable parent is set properly
-	findOrphans(objectp, msg->getSenderIP(), msg->getSenderPort());
+	findOrphans(objectp, sender.getAddress(), sender.getPort());
 	
 	if(just_created && objectp &&
 	(gImportTracker.getState() == ImportTracker::WAND /*||
@@ -382,6 +390,18 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		return;
 	}
 
+	if (mUpdateQueue && (cached || (compressed && update_type != OUT_TERSE_IMPROVED)))
+	{
+		queueObjectUpdates(mesgsys, update_type, cached, regionp);
+		return;
+	}
+	if (mUpdateQueue && !mUpdateQueue->empty() && hasQueuedUpdates(mesgsys, update_type))
+	{
+		// Older updates of these objects are still queued. Apply them first, or they would overwrite
+		// this update, or this update would be dropped because its object was not created yet.
+		applyQueuedUpdates(true);
+	}
+
 	U8 compressed_dpbuffer[2048];
 	LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
 	LLDataPacker *cached_dpp = NULL;
@@ -632,6 +652,224 @@ void LLViewerObjectList::processCachedObjectUpdate(LLMessageSystem *mesgsys,
 	processObjectUpdate(mesgsys, user_data, update_type, true, false);
 }	
 
+void LLViewerObjectList::queueObjectUpdates(LLMessageSystem *mesgsys, EObjectUpdateType update_type, bool cached, LLViewerRegion *regionp)
+{
+	LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
+	S32 num_objects = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
+
+	// What the objects need of the message later on.
+	LLObjectUpdateRecord message_info;
+	message_info.mUpdateType = update_type;
+	mesgsys->getU64Fast(_PREHASH_RegionData, _PREHASH_RegionHandle, message_info.mRegionHandle);
+	mesgsys->getU16Fast(_PREHASH_RegionData, _PREHASH_TimeDilation, message_info.mTimeDilation);
+	message_info.mSender = mesgsys->getSender();
+	message_info.mPacketID = mesgsys->getCurrentRecvPacketID();
+
+	std::vector<LLObjectUpdateRecord*> records;
+	records.reserve(num_objects);
+	for (S32 i = 0; i < num_objects; i++)
+	{
+		LLObjectUpdateRecord* record = new LLObjectUpdateRecord(message_info);
+		mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, record->mUpdateFlags, i);
+		if (cached)
+		{
+			U32 id;
+			U32 crc;
+			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, id, i);
+			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_CRC, crc, i);
+
+			// Lookup data packer and add this id to cache miss lists if necessary.
+			U8 cache_miss_type = LLViewerRegion::CACHE_MISS_TYPE_NONE;
+			LLDataPackerBinaryBuffer* cached_dpp = static_cast<LLDataPackerBinaryBuffer*>(regionp->getDP(id, crc, cache_miss_type));
+			if (!cached_dpp)
+			{
+				// Cache Miss.
+				recorder.cacheMissEvent(id, update_type, cache_miss_type, sizeof(U32) * 2);
+				delete record;
+				continue;
+			}
+			// Copy the data; the cache entry may change before the update is applied.
+			record->mData.assign(cached_dpp->getBuffer(), cached_dpp->getBuffer() + cached_dpp->getBufferSize());
+		}
+		else
+		{
+			S32 size = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+			if (size > 0)
+			{
+				record->mData.resize(size);
+				mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, &record->mData[0], size, i);
+			}
+		}
+		records.push_back(record);
+	}
+	mUpdateQueue->push(records);
+}
+
+bool LLViewerObjectList::hasQueuedUpdates(LLMessageSystem *mesgsys, EObjectUpdateType update_type)
+{
+	const LLHost& sender = mesgsys->getSender();
+	S32 num_objects = mesgsys->getNumberOfBlocksFast(_PREHASH_ObjectData);
+	for (S32 i = 0; i < num_objects; i++)
+	{
+		U32 local_id = 0;
+		if (update_type == OUT_TERSE_IMPROVED)
+		{
+			// The terse data starts with the local id.
+			U8 data[2048];
+			S32 size = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
+			if (size < (S32)sizeof(U32) || size > (S32)sizeof(data))
+			{
+				continue;
+			}
+			mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, data, 0, i, sizeof(data));
+			htonmemcpy(&local_id, data, MVT_U32, 4);
+		}
+		else
+		{
+			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+			if (update_type == OUT_FULL)
+			{
+				// The object may have a queued update from the region it came from.
+				LLUUID fullid;
+				mesgsys->getUUIDFast(_PREHASH_ObjectData, _PREHASH_FullID, fullid, i);
+				if (mUpdateQueue->isQueued(fullid))
+				{
+					return true;
+				}
+			}
+		}
+		if (mUpdateQueue->isQueued(sender, local_id))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static LLFastTimer::DeclareTimer FTM_APPLY_OBJECT_UPDATES("Apply Object Updates");
+
+void LLViewerObjectList::applyQueuedUpdates(bool all)
+{
+	if (!mUpdateQueue || mUpdateQueue->empty())
+	{
+		return;
+	}
+
+	LLFastTimer t(FTM_APPLY_OBJECT_UPDATES);
+
+	static LLCachedControl<F32> apply_time(gSavedSettings, "ObjectUpdateApplyTime", 5.f);
+	F32 max_time = apply_time * 0.001f;
+	LLTimer timer;
+	while (LLObjectUpdateRecord* record = mUpdateQueue->pop())
+	{
+		applyQueuedUpdate(*record);
+		delete record;
+		if (!all && timer.getElapsedTimeF32() >= max_time)
+		{
+			break;
+		}
+	}
+
+	LLViewerStatsRecorder::instance().log(0.2f);
+
+	LLVOAvatar::cullAvatarsByPixelArea();
+}
+
+void LLViewerObjectList::applyQueuedUpdate(LLObjectUpdateRecord& record)
+{
+	LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(record.mRegionHandle);
+	if (!regionp || regionp->getHost() != record.mSender || mUpdateQueue->isKilled(record))
+	{
+		// The region or the object went away while the update was queued.
+		return;
+	}
+	if (!record.mValid)
+	{
+		llwarns << "Bad object update data from " << record.mSender << llendl;
+		return;
+	}
+
+	LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
+	const EObjectUpdateType update_type = record.mUpdateType;
+	const U32 local_id = record.mLocalID;
+	const LLUUID& fullid = record.mFullID;
+	S32 msg_size = update_type == OUT_FULL_CACHED ? sizeof(U32) * 2 : 0;
+
+	LLViewerObject* objectp = findObject(fullid);
+
+	// Reset object local id and region pointer if things have changed
+	if (objectp && 
+		((objectp->mLocalID != local_id) ||
+		 (objectp->getRegion() != regionp)))
+	{
+		removeFromLocalIDTable(objectp);
+		setUUIDAndLocal(fullid,
+						local_id,
+						record.mSender.getAddress(),
+						record.mSender.getPort());
+		
+		if (objectp->mLocalID != local_id)
+		{    // Update local ID in object with the one sent from the region
+			objectp->mLocalID = local_id;
+		}
+		
+		if (objectp->getRegion() != regionp)
+		{    // Object changed region, so update it
+			objectp->updateRegion(regionp); // for LLVOAvatar
+		}
+	}
+
+	BOOL justCreated = FALSE;
+	if (!objectp)
+	{
+		if(std::find(LLFloaterBlacklist::blacklist_objects.begin(),
+			LLFloaterBlacklist::blacklist_objects.end(),fullid) != LLFloaterBlacklist::blacklist_objects.end())
+		{
+			llinfos << "Blacklisted object asset " << fullid.asString() << " blocked." << llendl; 
+			return;
+		}
+
+		objectp = createObject(record.mPCode, regionp, fullid, local_id, record.mSender);
+		if (!objectp)
+		{
+			llinfos << "createObject failure for object: " << fullid << llendl;
+			recorder.objectUpdateFailure(local_id, update_type, msg_size);
+			return;
+		}
+		justCreated = TRUE;
+		mNumNewObjects++;
+		sCacheHitRate.addValue(update_type == OUT_FULL_CACHED ? 100.f : 0.f);
+	}
+
+	if (objectp->isDead())
+	{
+		llwarns << "Dead object " << objectp->mID << " in UUID map 1!" << llendl;
+	}
+
+	LLObjectUpdateDataPacker dp(record);
+	objectp->mLocalID = local_id;
+	processUpdateCore(objectp, NULL, 0, update_type, &dp, justCreated);
+
+	bool bCached = false;
+	if (update_type == OUT_FULL_COMPRESSED)
+	{
+		bCached = true;
+		LLViewerRegion::eCacheUpdateResult result = objectp->mRegionp->cacheFullUpdate(objectp, dp);
+		recorder.cacheFullUpdate(local_id, update_type, result, objectp, msg_size);
+	}
+	recorder.objectUpdateEvent(local_id, update_type, objectp, msg_size);
+	objectp->setLastUpdateType(update_type);
+	objectp->setLastUpdateCached(bCached);
+}
+
+void LLViewerObjectList::killQueuedUpdates(const LLHost& sender, U32 local_id)
+{
+	if (mUpdateQueue)
+	{
+		mUpdateQueue->kill(sender, local_id);
+	}
+}
+
 void LLViewerObjectList::dirtyAllObjectInventory()
 {
 	for (vobj_list_t::iterator iter = mObjects.begin(); iter != mObjects.end(); ++iter)
@@ -930,6 +1168,25 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 	static const LLCachedControl<bool> AnimateTextures("AnimateTextures");
 	gAnimateTextures = AnimateTextures;
 
+	// Start, stop or resize the threads that decode object updates.
+	static LLCachedControl<U32> decode_threads(gSavedSettings, "ObjectUpdateDecodeThreads", 0);
+	U32 num_threads = llmin((U32)decode_threads, (U32)LLObjectUpdateQueue::MAX_THREADS);
+	if (mUpdateQueue && num_threads != mUpdateQueue->getNumThreads())
+	{
+		applyQueuedUpdates(true);
+		delete mUpdateQueue;
+		mUpdateQueue = NULL;
+	}
+	if (!mUpdateQueue && num_threads)
+	{
+		mUpdateQueue = new LLObjectUpdateQueue(num_threads);
+	}
+	applyQueuedUpdates(false);
+
+	// Generate new LODs of prims in the background.
+	static LLCachedControl<U32> volume_threads(gSavedSettings, "VolumeGenerateThreads", 0);
+	LLPrimitive::getVolumeManager()->setGenerateThreads(volume_threads);
+
 	// update global timer
 	F32 last_time = gFrameTimeSeconds;
 	U64 time = totalTime();                 // this will become the new gFrameTime when the update is done
@@ -1008,6 +1265,7 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 				objectp->idleUpdate(agent, world, frame_time);
 			}
 		}
+		LLVOAvatar::updateDeferredAnimations();
 	}
 	else
 	{
@@ -1020,6 +1278,9 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 
 		}
 
+		// Finish the avatars that left their pose to the animation threads.
+		LLVOAvatar::updateDeferredAnimations();
+
 		//update flexible objects
 		LLVolumeImplFlexible::updateClass();
 
@@ -1335,6 +1596,8 @@ void LLViewerObjectList::killObjects(LLViewerRegion *regionp)
 	LLTimer kill_timer;
 	LLViewerObject *objectp;
 
+	killQueuedUpdates(regionp->getHost(), 0);
+
 	S32 count = 0;
 	for (vobj_list_t::iterator iter = mObjects.begin(); iter != mObjects.end(); ++iter)
 	{
@@ -48,6 +48,8 @@
 class LLCamera;
 class LLNetMap;
 class LLDebugBeacon;
+class LLObjectUpdateQueue;
+class LLObjectUpdateRecord;
 
 const U32 CLOSE_BIN_SIZE = 10;
 const U32 NUM_BINS = 128;
@@ -93,6 +95,15 @@ public:
 	void processObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type, bool cached=false, bool compressed=false);
 	void processCompressedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
 	void processCachedObjectUpdate(LLMessageSystem *mesgsys, void **user_data, EObjectUpdateType update_type);
+	// Full updates of ObjectUpdateCompressed and ObjectUpdateCached are decoded on other threads and applied by update().
+	void queueObjectUpdates(LLMessageSystem *mesgsys, EObjectUpdateType update_type, bool cached, LLViewerRegion *regionp);
+	// Whether any object of an update that is not queued still has queued updates.
+	bool hasQueuedUpdates(LLMessageSystem *mesgsys, EObjectUpdateType update_type);
+	// Applies queued updates for at most ObjectUpdateApplyTime milliseconds, or all of them.
+	void applyQueuedUpdates(bool all);
+	void applyQueuedUpdate(LLObjectUpdateRecord& record);
+	// Drops the queued updates of an object that was killed (or of all objects of a region, if local_id is 0).
+	void killQueuedUpdates(const LLHost& sender, U32 local_id);
 	void updateApparentAngles(LLAgent &agent);
 	void update(LLAgent &agent, LLWorld &world);
 
@@ -230,6 +241,8 @@ public:
 
 	std::vector<LLDebugBeacon> mDebugBeacons;
 
+	LLObjectUpdateQueue* mUpdateQueue;			// NULL unless ObjectUpdateDecodeThreads is set.
+
 	S32 mCurLazyUpdateIndex;
 
 	static U32 sSimulatorMachineIndex;
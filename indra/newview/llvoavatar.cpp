@@ -47,6 +47,7 @@
 #include "llanimationstates.h"
 #include "llavatarnamecache.h"
 #include "llavatarpropertiesprocessor.h"
+#include "llcharacterupdatepool.h"
 #include "llphysicsmotion.h"
 #include "llviewercontrol.h"
 #include "lldrawpoolavatar.h"
@@ -76,6 +77,7 @@
 #include "llregionhandle.h"
 #include "llresmgr.h"
 #include "llselectmgr.h"
+#include "llskinningpool.h"
 #include "llsprite.h"
 #include "lltargetingmotion.h"
 #include "lltoolmorph.h"
@@ -981,6 +983,9 @@ U32 LLVOAvatar::sMaxVisible = 50;
 F32 LLVOAvatar::sRenderDistance = 256.f;
 S32	LLVOAvatar::sNumVisibleAvatars = 0;
 S32	LLVOAvatar::sNumLODChangesThisFrame = 0;
+LLCharacterUpdatePool* LLVOAvatar::sAnimationPool = NULL;
+LLSkinningPool* LLVOAvatar::sSkinningPool = NULL;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sDeferredAnimations;
 
 const LLUUID LLVOAvatar::sStepSoundOnLand("e8af4a28-aa83-4310-a7c4-c047e15ea0df");
 const LLUUID LLVOAvatar::sStepSounds[LL_MCODE_END] =
@@ -1061,6 +1066,7 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	mVisibilityRank(0),
 	mNeedsSkin(FALSE),
 	mLastSkinTime(0.f),
+	mDeferAnimation(false),
 	mUpdatePeriod(1),
 	mFirstFullyVisible(TRUE),
 	mFullyLoaded(FALSE),
@@ -1522,6 +1528,11 @@ void LLVOAvatar::initClass()
 
 void LLVOAvatar::cleanupClass()
 {
+	sDeferredAnimations.clear();
+	delete sAnimationPool;
+	sAnimationPool = NULL;
+	delete sSkinningPool;
+	sSkinningPool = NULL;
 }
 
 // virtual
@@ -2525,13 +2536,91 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 	// animate the character
 	// store off last frame's root position to be consistent with camera position
 	LLVector3 root_pos_last = mRoot->getWorldPosition();
+	// Our own avatar is needed right away, for the camera.
+	mDeferAnimation = sAnimationPool && !isSelf() && !gNoRender;
 	bool detailed_update = updateCharacter(agent);
+	mDeferAnimation = false;
 
 	if (gNoRender)
 	{
 		return;
 	}
 
+	if (mMotionController.hasDeferredPose())
+	{
+		// Continued by updateDeferredAnimations().
+		mDeferredRootPosLast = root_pos_last;
+		sDeferredAnimations.push_back(this);
+		return;
+	}
+
+	idleUpdatePostAnimation(detailed_update, root_pos_last);
+}
+
+static LLFastTimer::DeclareTimer FTM_DEFERRED_ANIMATION("Deferred Animation");
+
+// static
+void LLVOAvatar::updateDeferredAnimations()
+{
+	if (!sDeferredAnimations.empty())
+	{
+		LLFastTimer t(FTM_DEFERRED_ANIMATION);
+
+		static std::vector<LLCharacter*> characters;
+		characters.clear();
+		for (std::vector<LLPointer<LLVOAvatar> >::iterator iter = sDeferredAnimations.begin();
+			 iter != sDeferredAnimations.end(); ++iter)
+		{
+			if (!(*iter)->isDead())
+			{
+				characters.push_back(*iter);
+			}
+		}
+		sAnimationPool->applyDeferredPoses(characters);
+
+		// The rest needs the main thread.
+		for (std::vector<LLPointer<LLVOAvatar> >::iterator iter = sDeferredAnimations.begin();
+			 iter != sDeferredAnimations.end(); ++iter)
+		{
+			LLVOAvatar* avatarp = *iter;
+			if (!avatarp->isDead())
+			{
+				bool detailed_update = avatarp->finishCharacterUpdate();
+				avatarp->idleUpdatePostAnimation(detailed_update, avatarp->mDeferredRootPosLast);
+			}
+		}
+		sDeferredAnimations.clear();
+	}
+
+	// Start, stop or resize the pool for the next frame.
+	static LLCachedControl<U32> animation_threads(gSavedSettings, "AvatarAnimationThreads", 0);
+	U32 pool_size = animation_threads;
+	if (pool_size < 2)
+	{
+		pool_size = 0;		// Don't bother with a pool of one.
+	}
+	if (pool_size != (sAnimationPool ? sAnimationPool->getPoolSize() : 0))
+	{
+		delete sAnimationPool;
+		sAnimationPool = pool_size ? new LLCharacterUpdatePool(pool_size) : NULL;
+	}
+
+	// Same for the threads that skin rigged meshes in software.
+	static LLCachedControl<U32> skinning_threads(gSavedSettings, "AvatarSkinningThreads", 0);
+	pool_size = llmin((U32)skinning_threads, LLSkinningPool::MAX_POOL_SIZE);
+	if (pool_size < 2)
+	{
+		pool_size = 0;
+	}
+	if (pool_size != (sSkinningPool ? sSkinningPool->getPoolSize() : 0))
+	{
+		delete sSkinningPool;
+		sSkinningPool = pool_size ? new LLSkinningPool(pool_size) : NULL;
+	}
+}
+
+void LLVOAvatar::idleUpdatePostAnimation(bool detailed_update, const LLVector3& root_pos_last)
+{
 	static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
 	bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
 						 LLVoiceClient::getInstance()->getVoiceEnabled(mID);
@@ -2558,7 +2647,8 @@ void LLVOAvatar::idleUpdateVoiceVisualizer(bool voice_enabled)
 	// Don't render the user's own voice visualizer when in mouselook, or when opening the mic is disabled.
 	if(isSelf())
 	{
-		if(gAgentCamera.cameraMouselook() || gSavedSettings.getBOOL("VoiceDisableMic"))
+		static LLControlHandle voice_disable_mic(gSavedSettings, "VoiceDisableMic");
+		if(gAgentCamera.cameraMouselook() || voice_disable_mic.getBOOL())
 		{
 			render_visualizer = false;
 		}
@@ -4232,7 +4322,28 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	if (mSpecialRenderMode == 1) // Animation Preview
 		updateMotions(LLCharacter::FORCE_UPDATE);
 	else
+	{
+		mMotionController.deferPoseUpdate(mDeferAnimation);
 		updateMotions(LLCharacter::NORMAL_UPDATE);
+		mMotionController.deferPoseUpdate(false);
+	}
+
+	if (mMotionController.hasDeferredPose())
+	{
+		// Everything that follows needs the new pose; see updateDeferredAnimations().
+		return TRUE;
+	}
+
+	return finishCharacterUpdate();
+}
+
+//-----------------------------------------------------------------------------
+// finishCharacterUpdate()
+// The part of updateCharacter() that uses the pose of the current frame.
+//-----------------------------------------------------------------------------
+BOOL LLVOAvatar::finishCharacterUpdate()
+{
+	LLVector3 normal;
 
 	// update head position
 	updateHeadOffset();
@@ -8820,24 +8931,8 @@ void LLVOAvatar::updateLODRiggedAttachments( void )
 	rebuildRiggedAttachments();
 }
 
-void LLVOAvatar::updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer *buffer)
+void LLVOAvatar::updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer *buffer, U32* palette_hash)
 {
-	//perform software vertex skinning for this face
-	LLStrider<LLVector3> position;
-	LLStrider<LLVector3> normal;
-
-	bool has_normal = buffer->hasDataType(LLVertexBuffer::TYPE_NORMAL);
-	buffer->getVertexStrider(position);
-
-	if (has_normal)
-	{
-		buffer->getNormalStrider(normal);
-	}
-
-	LLVector4a* pos = (LLVector4a*) position.get();
-
-	LLVector4a* norm = has_normal ? (LLVector4a*) normal.get() : NULL;
-	
 	//build matrix palette
 	LLMatrix4a mp[JOINT_COUNT];
 	LLMatrix4* mat = (LLMatrix4*) mp;
@@ -8858,61 +8953,66 @@ void LLVOAvatar::updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const
 			mat[j] = skin->mInvBindMatrix[j];
 			mat[j] *= joint->getWorldMatrix();
 		}
+		else
+		{
+			mat[j].setIdentity();
+		}
 	}
 
 	LLMatrix4a bind_shape_matrix;
 	bind_shape_matrix.loadu(skin->mBindShapeMatrix);
+	LLSkinningPool::applyBindShape(mp, count, bind_shape_matrix);
 
-	for (U32 j = 0; j < (U32)buffer->getNumVerts(); ++j)
+	if (palette_hash)
 	{
-		LLMatrix4a final_mat;
-		final_mat.clear();
-
-		S32 idx[4];
-
-		LLVector4 wght;
-
-		F32 scale = 0.f;
-		for (U32 k = 0; k < 4; k++)
+		// Nothing to do if neither the joints nor the mesh moved since the last time.
+		const void* mesh[] = { &vol_face, vol_face.mPositions, weight, buffer };
+		U32 hash = LLSkinningPool::hashPalette(mp, count);
+		const U32* words = (const U32*) mesh;
+		for (U32 i = 0; i < sizeof(mesh) / sizeof(U32); ++i)
 		{
-			F32 w = weight[j][k];
-
-			idx[k] = (S32) floorf(w);
-			wght[k] = w - floorf(w);
-			scale += wght[k];
+			hash = (hash ^ words[i]) * 16777619u;
+		}
+		hash |= 1;		// 0 means never skinned.
+		if (hash == *palette_hash)
+		{
+			return;
 		}
+		*palette_hash = hash;
+	}
 
-		if(scale > 0.f)
-			wght *= 1.f/scale;
-		else
-			wght = LLVector4(F32_MAX,F32_MAX,F32_MAX,F32_MAX);
+	//perform software vertex skinning for this face
+	LLStrider<LLVector3> position;
+	LLStrider<LLVector3> normal;
 
-		for (U32 k = 0; k < 4; k++)
-		{
-			F32 w = wght[k];
-			LLMatrix4a src;
-			src.setMul(mp[idx[k]], w);
+	bool has_normal = buffer->hasDataType(LLVertexBuffer::TYPE_NORMAL);
+	buffer->getVertexStrider(position);
 
-			final_mat.add(src);
-		}
-		
-		LLVector4a& v = vol_face.mPositions[j];
-		LLVector4a t;
-		LLVector4a dst;
-		bind_shape_matrix.affineTransform(v, t);
-		final_mat.affineTransform(t, dst);
-		pos[j] = dst;
+	if (has_normal)
+	{
+		buffer->getNormalStrider(normal);
+	}
 
-		if (norm)
-		{
-			LLVector4a& n = vol_face.mNormals[j];
-			bind_shape_matrix.rotate(n, t);
-			final_mat.rotate(t, dst);
-			dst.normalize3fast();
-			norm[j] = dst;
-		}
+	LLSkinningPool::Job job;
+	job.mPalette = mp;
+	job.mPaletteSize = count;
+	job.mWeights = weight;
+	job.mPositions = vol_face.mPositions;
+	job.mNormals = vol_face.mNormals;
+	job.mPositionsOut = (LLVector4a*) position.get();
+	job.mNormalsOut = has_normal ? (LLVector4a*) normal.get() : NULL;
+	job.mNumVertices = buffer->getNumVerts();
+
+	if (sSkinningPool)
+	{
+		sSkinningPool->skin(job);
+	}
+	else
+	{
+		LLSkinningPool::skinVertices(job, 0, job.mNumVertices);
 	}
 }
+
 U32 LLVOAvatar::getPartitionType() const
 { 
 	// Avatars merely exist as drawables in the bridge partition
@@ -80,6 +80,8 @@ class LLTexGlobalColor;
 class LLViewerJoint;
 struct LLAppearanceMessageContents;
 class LLMeshSkinInfo;
+class LLCharacterUpdatePool;
+class LLSkinningPool;
 
 class SHClientTagMgr : public LLSingleton<SHClientTagMgr>, public boost::signals2::trackable
 {
@@ -182,7 +184,9 @@ public:
 	/*virtual*/ BOOL   	 	 	updateLOD();
 	BOOL  	 	 	 	 	updateJointLODs();
 	void						updateLODRiggedAttachments( void );
-	void						updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer *buffer);
+	// If palette_hash isn't NULL, the vertices are only skinned if *palette_hash differs from the hash of the
+	// joint matrices and the mesh; it is set to that hash afterwards.
+	void						updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer *buffer, U32* palette_hash = NULL);
 	/*virtual*/ BOOL   	 	 	isActive() const; // Whether this object needs to do an idleUpdate.
 	S32 						totalTextureMemForUUIDS(std::set<LLUUID>& ids);
 	bool 						allTexturesCompletelyDownloaded(std::set<LLUUID>& ids) const;
@@ -285,6 +289,16 @@ private:
 	//--------------------------------------------------------------------
 public:
 	virtual BOOL 	updateCharacter(LLAgent &agent);
+	// With AvatarAnimationThreads > 1, idleUpdate() of other avatars stops right after their motions
+	// were evaluated. This applies all their poses on the animation threads and then finishes their idle updates.
+	static void		updateDeferredAnimations();
+private:
+	BOOL			finishCharacterUpdate();
+	void			idleUpdatePostAnimation(bool detailed_update, const LLVector3& root_pos_last);
+	static LLCharacterUpdatePool* sAnimationPool;
+	static LLSkinningPool* sSkinningPool;
+	static std::vector<LLPointer<LLVOAvatar> > sDeferredAnimations;
+public:
 	void 			idleUpdateVoiceVisualizer(bool voice_enabled);
 	void 			idleUpdateMisc(bool detailed_update);
 	virtual void	idleUpdateAppearanceAnimation();
@@ -444,6 +458,8 @@ private:
 
 	BOOL 		mNeedsSkin; // avatar has been animated and verts have not been updated
 	F32			mLastSkinTime; //value of gFrameTimeSeconds at last skin update
+	bool		mDeferAnimation; // set while updateCharacter() may leave applying the pose to updateDeferredAnimations()
+	LLVector3	mDeferredRootPosLast; // root_pos_last of an idleUpdate() that was deferred
 
 	S32	 		mUpdatePeriod;
 	S32  		mNumInitFaces; //number of faces generated when creating the avatar drawable, does not inculde splitted faces due to long vertex buffer.
@@ -38,15 +38,8 @@
 #include "llregionhandle.h"
 #include "llviewercontrol.h"
 
-BOOL check_read(LLAPRFile* apr_file, void* src, S32 n_bytes) 
-{
-	return apr_file->read(src, n_bytes) == n_bytes ;
-}
+#include <algorithm>
 
-BOOL check_write(LLAPRFile* apr_file, void* src, S32 n_bytes) 
-{
-	return apr_file->write(src, n_bytes) == n_bytes ;
-}
 //---------------------------------------------------------------------------
 // LLVOCacheEntry
 //---------------------------------------------------------------------------
@@ -64,6 +57,19 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mDP = dp; //memcpy
 }
 
+LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, S32 hit_count, S32 dupe_count, S32 crc_change_count, U8* data, S32 size)
+	:
+	mLocalID(local_id),
+	mCRC(crc),
+	mHitCount(hit_count),
+	mDupeCount(dupe_count),
+	mCRCChangeCount(crc_change_count),
+	mBuffer(NULL)
+{
+	// The data is unpacked straight from the store when the object is rezzed.
+	mDP.assignBuffer(data, size);
+}
+
 LLVOCacheEntry::LLVOCacheEntry()
 	:
 	mLocalID(0),
@@ -76,77 +82,36 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
-	: mBuffer(NULL)
+LLVOCacheEntry::~LLVOCacheEntry()
 {
-	S32 size = -1;
-	BOOL success;
+	freeBuffer();
+}
 
-	mDP.assignBuffer(mBuffer, 0);
-	success = check_read(apr_file, &mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_read(apr_file, &mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mHitCount, sizeof(S32));
-	}
-	if(success)
+void LLVOCacheEntry::freeBuffer()
+{
+	if (mBuffer)
 	{
-		success = check_read(apr_file, &mDupeCount, sizeof(S32));
+		mDP.freeBuffer();
+		mBuffer = NULL;
 	}
-	if(success)
+	else
 	{
-		success = check_read(apr_file, &mCRCChangeCount, sizeof(S32));
+		// Don't delete data in the store.
+		mDP.assignBuffer(NULL, 0);
 	}
-	if(success)
-	{
-		success = check_read(apr_file, &size, sizeof(S32));
+}
 
-	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
-	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-			llwarns << "Bogus cache entry, size " << size << ", aborting!" << llendl;
-			success = FALSE;
-		}
-	}
-	if(success && size > 0)
+void LLVOCacheEntry::detachFromStore()
+{
+	if (!mBuffer && mDP.getBufferSize() > 0)
 	{
+		S32 size = mDP.getBufferSize();
 		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
-
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = NULL ;
-		}
+		memcpy(mBuffer, mDP.getBuffer(), size);
+		mDP.assignBuffer(mBuffer, size);
 	}
-
-	if(!success)
-	{
-		mLocalID = 0;
-		mCRC = 0;
-		mHitCount = 0;
-		mDupeCount = 0;
-		mCRCChangeCount = 0;
-		mBuffer = NULL;
-	}
-}
-
-LLVOCacheEntry::~LLVOCacheEntry()
-{
-	mDP.freeBuffer();
 }
 
-
 // New CRC means the object has changed.
 void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 {
@@ -157,7 +122,7 @@ void LLVOCacheEntry::assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp)
 		mHitCount = 0;
 		mCRCChangeCount++;
 
-		mDP.freeBuffer();
+		freeBuffer();
 		mBuffer = new U8[dp.getBufferSize()];
 		mDP.assignBuffer(mBuffer, dp.getBufferSize());
 		mDP = dp;
@@ -193,51 +158,21 @@ void LLVOCacheEntry::dump() const
 		<< llendl;
 }
 
-BOOL LLVOCacheEntry::writeToFile(LLAPRFile* apr_file) const
-{
-	BOOL success;
-	success = check_write(apr_file, (void*)&mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_write(apr_file, (void*)&mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		S32 size = mDP.getBufferSize();
-		success = check_write(apr_file, (void*)&size, sizeof(S32));
-	
-		if(success)
-		{
-			success = check_write(apr_file, (void*)mBuffer, size);
-		}
-	}
-
-	return success ;
-}
-
 //-------------------------------------------------------------------
 //LLVOCache
 //-------------------------------------------------------------------
-// Format string used to construct filename for the object cache
-static const char OBJECT_CACHE_FILENAME[] = "objects_%d_%d.slc";
-
 const U32 MAX_NUM_OBJECT_ENTRIES = 128 ;
 const U32 MIN_ENTRIES_TO_PURGE = 16 ;
 const U32 INVALID_TIME = 0 ;
+const U32 OBJECT_STORE_VERSION = 1;					// Change if the layout of objects.store changes.
+const U32 MIN_DATA_CAPACITY = 4 * 1024 * 1024;
+const U32 MAX_DATA_CAPACITY = 256 * 1024 * 1024;
+const S32 MAX_OBJECT_SIZE = 10000;
 const char* object_cache_dirname = "objectcache";
-const char* header_filename = "object.cache";
+const char* header_filename = "objects.store";
+// Files of the cache before all regions were kept in objects.store.
+const char* old_header_filename = "object.cache";
+const char* old_object_cache_mask = "objects_*.slc";
 
 LLVOCache* LLVOCache::sInstance = NULL;
 
@@ -280,7 +215,8 @@ LLVOCache::~LLVOCache()
 {
 	if(mEnabled)
 	{
-		writeCacheHeader();
+		detachMappedEntries(NULL);
+		closeStore();
 		clearCacheInMemory();
 	}
 }
@@ -310,9 +246,16 @@ void LLVOCache::initCache(ELLPath location, U32 size, U32 cache_version)
 	if (!mReadOnly)
 	{
 		LLFile::mkdir(mObjectCacheDirName);
+
+		std::string old_header = gDirUtilp->getExpandedFilename(location, object_cache_dirname, old_header_filename);
+		if (LLAPRFile::isExist(old_header))
+		{
+			llinfos << "Removing the object cache files of an older viewer." << llendl;
+			LLAPRFile::remove(old_header);
+			gDirUtilp->deleteFilesInDir(mObjectCacheDirName, old_object_cache_mask);
+		}
 	}
 	mCacheSize = llclamp(size, MIN_ENTRIES_TO_PURGE, MAX_NUM_OBJECT_ENTRIES);
-	mMetaInfo.mVersion = cache_version;
 	readCacheHeader();	
 
 	if(mMetaInfo.mVersion != cache_version) 
@@ -339,6 +282,9 @@ void LLVOCache::removeCache(ELLPath location)
 
 	llinfos << "about to remove the object cache due to settings." << llendl ;
 
+	detachMappedEntries(NULL);
+	closeStore();
+
 	std::string mask = "*";
 	std::string cache_dir = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
 	llinfos << "Removing cache at " << cache_dir << llendl;
@@ -360,11 +306,11 @@ void LLVOCache::removeCache()
 
 	llinfos << "about to remove the object cache due to some error." << llendl ;
 
-	std::string mask = "*";
-	llinfos << "Removing cache at " << mObjectCacheDirName << llendl;
-	gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask); 
-
+	// The store stays mapped; just forget all blocks.
+	detachMappedEntries(NULL);
 	clearCacheInMemory() ;
+	mMetaInfo.mDataUsed = 0;
+	mMetaInfo.mDataGarbage = 0;
 	writeCacheHeader();
 }
 
@@ -418,17 +364,6 @@ void LLVOCache::clearCacheInMemory()
 
 }
 
-void LLVOCache::getObjectCacheFilename(U64 handle, std::string& filename) 
-{
-	U32 region_x, region_y;
-
-	grid_from_region_handle(handle, &region_x, &region_y);
-	filename = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, object_cache_dirname,
-			   llformat(OBJECT_CACHE_FILENAME, region_x, region_y));
-
-	return ;
-}
-
 void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 {
 	if(mReadOnly)
@@ -437,13 +372,188 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 		return ;
 	}
 
-	std::string filename;
-	getObjectCacheFilename(entry->mHandle, filename);
-	LLAPRFile::remove(filename);
+	// The block of the region becomes garbage.
+	mMetaInfo.mDataGarbage += entry->mSize;
+	entry->mSize = 0;
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
+	writeCacheHeader();
+}
+
+//----------------------------------------------------------------------------
+// objects.store
+
+bool LLVOCache::openStore(U32 data_capacity)
+{
+	size_t size = sizeof(HeaderMetaInfo) + MAX_NUM_OBJECT_ENTRIES * sizeof(HeaderEntryInfo) + data_capacity;
+	if (!mStore.open(mHeaderFileName, size, mReadOnly))
+	{
+		return false;
+	}
+	mMetaInfo.mDataCapacity = data_capacity;
+	return true;
+}
+
+void LLVOCache::closeStore()
+{
+	if (mStore.isOpen())
+	{
+		writeCacheHeader();
+		mStore.flush(true);
+		mStore.close();
+	}
+}
+
+U8* LLVOCache::getDataArea() const
+{
+	return mStore.getData() + sizeof(HeaderMetaInfo) + MAX_NUM_OBJECT_ENTRIES * sizeof(HeaderEntryInfo);
+}
+
+LLVOCache::HeaderEntryInfo* LLVOCache::getStoredEntry(S32 index) const
+{
+	return (HeaderEntryInfo*)(mStore.getData() + sizeof(HeaderMetaInfo)) + index;
+}
+
+S32 LLVOCache::findFreeIndex() const
+{
+	for (S32 i = 0; i < (S32)MAX_NUM_OBJECT_ENTRIES; ++i)
+	{
+		if (getStoredEntry(i)->mTime == INVALID_TIME)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool LLVOCache::isValidBlock(const HeaderEntryInfo* entry) const
+{
+	if (!entry->mSize)
+	{
+		return true;
+	}
+	if ((entry->mOffset & 3) || entry->mOffset > mMetaInfo.mDataUsed || entry->mSize > mMetaInfo.mDataUsed - entry->mOffset ||
+		entry->mNumObjects > entry->mSize / sizeof(ObjectInfo))
+	{
+		return false;
+	}
+	const ObjectInfo* objects = (const ObjectInfo*)(getDataArea() + entry->mOffset);
+	U32 data_start = entry->mNumObjects * sizeof(ObjectInfo);
+	for (U32 i = 0; i < entry->mNumObjects; ++i)
+	{
+		const ObjectInfo& object = objects[i];
+		if (!object.mLocalID || object.mSize < 1 || object.mSize > MAX_OBJECT_SIZE ||
+			object.mOffset < data_start || object.mOffset > entry->mSize - object.mSize)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void LLVOCache::detachMappedEntries(const LLVOCacheEntry::vocache_entry_map_t* extra_map)
+{
+	if (extra_map)
+	{
+		for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = extra_map->begin(); iter != extra_map->end(); ++iter)
+		{
+			iter->second->detachFromStore();
+		}
+	}
+	for (mapped_entries_map_t::iterator map_iter = mMappedEntries.begin(); map_iter != mMappedEntries.end(); ++map_iter)
+	{
+		const LLVOCacheEntry::vocache_entry_map_t* entry_map = map_iter->second;
+		for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = entry_map->begin(); iter != entry_map->end(); ++iter)
+		{
+			iter->second->detachFromStore();
+		}
+	}
+	mMappedEntries.clear();
+}
+
+// Moves all blocks to the start of the data area, in the order in which they are stored.
+void LLVOCache::compactData()
+{
+	std::vector<std::pair<U32, HeaderEntryInfo*> > blocks;
+	for (header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin(); iter != mHeaderEntryQueue.end(); ++iter)
+	{
+		if ((*iter)->mSize)
+		{
+			blocks.push_back(std::make_pair((*iter)->mOffset, *iter));
+		}
+	}
+	std::sort(blocks.begin(), blocks.end());
+
+	U8* data = getDataArea();
+	U32 used = 0;
+	for (size_t i = 0; i < blocks.size(); ++i)
+	{
+		HeaderEntryInfo* entry = blocks[i].second;
+		if (entry->mOffset != used)
+		{
+			memmove(data + used, data + entry->mOffset, entry->mSize);
+			entry->mOffset = used;
+			updateEntry(entry);
+		}
+		used += entry->mSize;
+	}
+	llinfos << "Compacted the object cache from " << mMetaInfo.mDataUsed << " to " << used << " bytes." << llendl;
+	mMetaInfo.mDataUsed = used;
+	mMetaInfo.mDataGarbage = 0;
+	writeCacheHeader();
+}
+
+bool LLVOCache::reserveData(U32 size, const HeaderEntryInfo* keep)
+{
+	if (size > mMetaInfo.mDataCapacity - mMetaInfo.mDataUsed)
+	{
+		// Blocks are going to move.
+		detachMappedEntries(NULL);
+
+		// Make room by dropping the least recently used regions, if the store can't grow enough.
+		while (mMetaInfo.mDataUsed - mMetaInfo.mDataGarbage + size > MAX_DATA_CAPACITY && mHeaderEntryQueue.size() > 1)
+		{
+			HeaderEntryInfo* entry = *mHeaderEntryQueue.begin();
+			if (entry == keep)
+			{
+				entry = *(++mHeaderEntryQueue.begin());
+			}
+			removeEntry(entry);
+		}
+		if (mMetaInfo.mDataUsed - mMetaInfo.mDataGarbage + size > MAX_DATA_CAPACITY)
+		{
+			return false;
+		}
+
+		// Grow the store unless compacting leaves a quarter of it free, so that it isn't compacted on every write.
+		U32 live = mMetaInfo.mDataUsed - mMetaInfo.mDataGarbage + size;
+		U32 capacity = llmax(mMetaInfo.mDataCapacity, MIN_DATA_CAPACITY);
+		while (capacity < MAX_DATA_CAPACITY && live > capacity / 4 * 3)
+		{
+			capacity = llmin(capacity * 2, MAX_DATA_CAPACITY);
+		}
+		if (mMetaInfo.mDataGarbage)
+		{
+			compactData();
+		}
+		if (capacity != mMetaInfo.mDataCapacity)
+		{
+			writeCacheHeader();
+			if (!openStore(capacity))
+			{
+				llwarns << "Unable to grow the object cache to " << capacity << " bytes, disabling it." << llendl;
+				clearCacheInMemory();
+				mReadOnly = TRUE;
+				return false;
+			}
+			llinfos << "Grew the object cache to " << capacity << " bytes." << llendl;
+		}
+	}
+	return true;
 }
 
+//----------------------------------------------------------------------------
+
 void LLVOCache::readCacheHeader()
 {
 	if(!mEnabled)
@@ -455,68 +565,72 @@ void LLVOCache::readCacheHeader()
 	//clear stale info.
 	clearCacheInMemory();	
 
+	if (!openStore(MIN_DATA_CAPACITY))
+	{
+		llwarns << "Unable to open " << mHeaderFileName << ", disabling the object cache." << llendl;
+		mEnabled = FALSE;
+		return;
+	}
+
 	bool success = true ;
-	if (LLAPRFile::isExist(mHeaderFileName))
+	if (mStore.getInitialFileSize() >= sizeof(HeaderMetaInfo))
 	{
-		LLAPRFile apr_file(mHeaderFileName, APR_READ|APR_BINARY);		
-		
 		//read the meta element
-		success = check_read(&apr_file, &mMetaInfo, sizeof(HeaderMetaInfo)) ;
+		mMetaInfo = *(HeaderMetaInfo*)mStore.getData();
+		U32 capacity = mMetaInfo.mDataCapacity;
+		success = mMetaInfo.mStoreVersion == OBJECT_STORE_VERSION &&
+				  capacity >= MIN_DATA_CAPACITY && capacity <= MAX_DATA_CAPACITY &&
+				  mMetaInfo.mDataUsed <= capacity && mMetaInfo.mDataGarbage <= mMetaInfo.mDataUsed;
+		if (success && capacity != MIN_DATA_CAPACITY)
+		{
+			// Map the whole data area.
+			success = openStore(capacity);
+		}
 		
 		if(success)
 		{
-			HeaderEntryInfo* entry = NULL ;
 			mNumEntries = 0 ;
-			U32 num_read = 0 ;
-			while(num_read++ < MAX_NUM_OBJECT_ENTRIES)
+			for (S32 i = 0; i < (S32)MAX_NUM_OBJECT_ENTRIES; ++i)
 			{
-				if(!entry)
-				{
-					entry = new HeaderEntryInfo() ;
-				}
-				success = check_read(&apr_file, entry, sizeof(HeaderEntryInfo));
-								
-				if(!success) //failed
+				HeaderEntryInfo* stored = getStoredEntry(i);
+				if (stored->mTime == INVALID_TIME)
 				{
-					llwarns << "Error reading cache header entry. (entry_index=" << mNumEntries << ")" << llendl;
-					delete entry ;
-					entry = NULL ;
-					break ;
+					continue ; //an empty entry
 				}
-				else if(entry->mTime == INVALID_TIME)
+				if (!isValidBlock(stored))
 				{
-					continue ; //an empty entry
+					llwarns << "Error reading cache header entry. (entry_index=" << i << ")" << llendl;
+					mMetaInfo.mDataGarbage += llmin(stored->mSize, mMetaInfo.mDataUsed - mMetaInfo.mDataGarbage);
+					stored->mTime = INVALID_TIME;
+					stored->mSize = 0;
+					continue;
 				}
 
-				entry->mIndex = mNumEntries++ ;
+				HeaderEntryInfo* entry = new HeaderEntryInfo(*stored) ;
+				entry->mIndex = i;
+				mNumEntries++ ;
 				mHeaderEntryQueue.insert(entry) ;
 				mHandleEntryMap[entry->mHandle] = entry ;
-				entry = NULL ;
-			}
-			if(entry)
-			{
-				delete entry ;
 			}
 		}
-
-		//---------
-		//debug code
-		//----------
-		//std::string name ;
-		//for(header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin() ; success && iter != mHeaderEntryQueue.end(); ++iter)
-		//{
-		//	getObjectCacheFilename((*iter)->mHandle, name) ;
-		//	llinfos << name << llendl ;
-		//}
-		//-----------
 	}
 	else
 	{
+		mMetaInfo.mStoreVersion = OBJECT_STORE_VERSION;
+		mMetaInfo.mDataUsed = 0;
+		mMetaInfo.mDataGarbage = 0;
 		writeCacheHeader() ;
 	}
 
 	if(!success)
 	{
+		if (!mStore.isOpen() && !openStore(MIN_DATA_CAPACITY))
+		{
+			mEnabled = FALSE;
+			return;
+		}
+		mMetaInfo.mStoreVersion = OBJECT_STORE_VERSION;
+		mMetaInfo.mDataCapacity = mStore.getSize() - (sizeof(HeaderMetaInfo) + MAX_NUM_OBJECT_ENTRIES * sizeof(HeaderEntryInfo));
 		removeCache() ; //failed to read header, clear the cache
 	}
 	else if(mNumEntries >= mCacheSize)
@@ -535,56 +649,35 @@ void LLVOCache::writeCacheHeader()
 		return;
 	}
 
-	if(mReadOnly)
+	if(mReadOnly || !mStore.isOpen())
 	{
-		llwarns << "Not writing cache header: Cache is currently in read-only mode." << llendl;
 		return;
 	}
 
-	bool success = true ;
-	{
-		LLAPRFile apr_file(mHeaderFileName, APR_CREATE|APR_WRITE|APR_BINARY);
-
-		//write the meta element
-		success = check_write(&apr_file, &mMetaInfo, sizeof(HeaderMetaInfo)) ;
+	//write the meta element
+	*(HeaderMetaInfo*)mStore.getData() = mMetaInfo;
 
-
-		mNumEntries = 0 ;	
-		for(header_entry_queue_t::iterator iter = mHeaderEntryQueue.begin() ; success && iter != mHeaderEntryQueue.end(); ++iter)
-		{
-			(*iter)->mIndex = mNumEntries++ ;
-			success = check_write(&apr_file, (void*)*iter, sizeof(HeaderEntryInfo));
-		}
-	
-		mNumEntries = mHeaderEntryQueue.size() ;
-		if(success && mNumEntries < MAX_NUM_OBJECT_ENTRIES)
+	if (mHeaderEntryQueue.empty())
+	{
+		// Clear all entries.
+		HeaderEntryInfo entry;
+		entry.mTime = INVALID_TIME;
+		for (S32 i = 0; i < (S32)MAX_NUM_OBJECT_ENTRIES; ++i)
 		{
-			HeaderEntryInfo* entry = new HeaderEntryInfo() ;
-			entry->mTime = INVALID_TIME ;
-			for(S32 i = mNumEntries ; success && i < MAX_NUM_OBJECT_ENTRIES ; i++)
-			{
-				//fill the cache with the default entry.
-				success = check_write(&apr_file, entry, sizeof(HeaderEntryInfo)) ;			
-
-			}
-			delete entry ;
+			entry.mIndex = i;
+			updateEntry(&entry);
 		}
 	}
-
-	if(!success)
-	{
-		clearCacheInMemory() ;
-		mReadOnly = TRUE ; //disable the cache.
-	}
-	return ;
 }
 
 BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 {
-	LLAPRFile apr_file(mHeaderFileName, APR_WRITE|APR_BINARY);
-	apr_file.seek(APR_SET, entry->mIndex * sizeof(HeaderEntryInfo) + sizeof(HeaderMetaInfo)) ;
-
-	return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
+	if (mReadOnly || !mStore.isOpen() || entry->mIndex < 0 || entry->mIndex >= (S32)MAX_NUM_OBJECT_ENTRIES)
+	{
+		return FALSE;
+	}
+	*getStoredEntry(entry->mIndex) = *entry;
+	return TRUE;
 }
 
 void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
@@ -603,53 +696,28 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 		return ;
 	}
 
-	bool success = true ;
+	HeaderEntryInfo* entry = iter->second;
+	if (entry->mCacheID != id)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY);
-	
-		LLUUID cache_id ;
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
-	
-		if(success)
-		{		
-			if(cache_id != id)
-			{
-				llinfos << "Cache ID doesn't match for this region, discarding"<< llendl;
-				success = false ;
-			}
+		llinfos << "Cache ID doesn't match for this region, discarding"<< llendl;
+		removeEntry(entry);
+		return;
+	}
 
-			if(success)
-			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				if(success)
-				{
-					for (S32 i = 0; i < num_entries; i++)
-					{
-						LLVOCacheEntry* entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
-						{
-							llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
-							delete entry ;
-							success = false ;
-							break ;
-						}
-						cache_entry_map[entry->getLocalID()] = entry;
-					}
-				}
-			}
-		}		
+	// The objects are unpacked from the store only when they are needed.
+	U8* block = getDataArea() + entry->mOffset;
+	const ObjectInfo* objects = (const ObjectInfo*)block;
+	for (U32 i = 0; i < entry->mNumObjects; ++i)
+	{
+		const ObjectInfo& object = objects[i];
+		LLVOCacheEntry*& cache_entry = cache_entry_map[object.mLocalID];
+		delete cache_entry;
+		cache_entry = new LLVOCacheEntry(object.mLocalID, object.mCRC, object.mHitCount, object.mDupeCount, object.mCRCChangeCount,
+										 block + object.mOffset, object.mSize);
 	}
-	
-	if(!success)
+	if (entry->mNumObjects)
 	{
-		if(cache_entry_map.empty())
-		{
-			removeEntry(iter->second) ;
-		}
+		mMappedEntries[handle] = &cache_entry_map;
 	}
 
 	return ;
@@ -680,6 +748,8 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 
 	if(mReadOnly)
 	{
+		// The region is done with its entries.
+		mMappedEntries.erase(handle);
 		llwarns << "Not writing cache for handle " << handle << "): Cache is currently in read-only mode." << llendl;
 		return ;
 	}	
@@ -696,7 +766,8 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		entry = new HeaderEntryInfo();
 		entry->mHandle = handle ;
 		entry->mTime = time(NULL) ;
-		entry->mIndex = mNumEntries++;
+		entry->mIndex = findFreeIndex();
+		mNumEntries++;
 		mHeaderEntryQueue.insert(entry) ;
 		mHandleEntryMap[handle] = entry ;
 	}
@@ -712,47 +783,67 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		mHeaderEntryQueue.insert(entry) ;
 	}
 
-	//update cache header
-	if(!updateEntry(entry))
-	{
-		llwarns << "Failed to update cache header index " << entry->mIndex << ". handle = " << handle << llendl;
-		return ; //update failed.
-	}
-
-	if(!dirty_cache)
+	if(!dirty_cache && entry->mSize && entry->mCacheID == id)
 	{
+		mMappedEntries.erase(handle);
+		updateEntry(entry);
 		llwarns << "Skipping write to cache for handle " << handle << ": cache not dirty" << llendl;
 		return ; //nothing changed, no need to update.
 	}
 
-	//write to cache file
-	bool success = true ;
+	// Append a new block for the region.
+	U32 num_objects = 0;
+	U32 size = 0;
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES) ;
-
-	
-		if(success)
+		S32 object_size = iter->second->getSize();
+		if (object_size > 0 && object_size <= MAX_OBJECT_SIZE)
 		{
-			S32 num_entries = cache_entry_map.size() ;
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-	
-			for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
-			{
-				success = iter->second->writeToFile(&apr_file) ;
-			}
+			++num_objects;
+			size += sizeof(ObjectInfo) + ((object_size + 3) & ~3);	// Keep the ObjectInfo of the next block aligned.
 		}
 	}
-
-	if(!success)
+	if (!reserveData(size, entry))
 	{
+		llwarns << "Failed to make room for " << size << " bytes in the object cache. handle = " << handle << llendl;
+		mMappedEntries.erase(handle);
 		removeEntry(entry) ;
+		return ;
+	}
 
+	U8* block = getDataArea() + mMetaInfo.mDataUsed;
+	ObjectInfo* objects = (ObjectInfo*)block;
+	U32 offset = num_objects * sizeof(ObjectInfo);
+	for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); iter != cache_entry_map.end(); ++iter)
+	{
+		const LLVOCacheEntry* cache_entry = iter->second;
+		S32 object_size = cache_entry->getSize();
+		if (object_size > 0 && object_size <= MAX_OBJECT_SIZE)
+		{
+			ObjectInfo& object = *objects++;
+			object.mLocalID = cache_entry->getLocalID();
+			object.mCRC = cache_entry->getCRC();
+			object.mHitCount = cache_entry->getHitCount();
+			object.mDupeCount = cache_entry->getDupeCount();
+			object.mCRCChangeCount = cache_entry->getCRCChangeCount();
+			object.mOffset = offset;
+			object.mSize = object_size;
+			memcpy(block + offset, cache_entry->getData(), object_size);
+			offset += (object_size + 3) & ~3;
+		}
 	}
+	// The old block of the region is no longer needed; the entries of the region may still point into it, but are deleted after this.
+	mMappedEntries.erase(handle);
+
+	mMetaInfo.mDataGarbage += entry->mSize;
+	entry->mCacheID = id;
+	entry->mOffset = mMetaInfo.mDataUsed;
+	entry->mSize = size;
+	entry->mNumObjects = num_objects;
+	mMetaInfo.mDataUsed += size;
+	updateEntry(entry);
+	writeCacheHeader();
+	mStore.flush();
 
 	return ;
 }
-
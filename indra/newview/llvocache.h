@@ -37,6 +37,7 @@
 #include "lldatapacker.h"
 #include "lldlinked.h"
 #include "lldir.h"
+#include "llmappedfile.h"
 
 
 //---------------------------------------------------------------------------
@@ -47,25 +48,33 @@ class LLVOCacheEntry
 {
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	// An entry read from the object store: data points into the store and isn't copied.
+	LLVOCacheEntry(U32 local_id, U32 crc, S32 hit_count, S32 dupe_count, S32 crc_change_count, U8* data, S32 size);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
 	U32 getLocalID() const			{ return mLocalID; }
 	U32 getCRC() const				{ return mCRC; }
 	S32 getHitCount() const			{ return mHitCount; }
+	S32 getDupeCount() const		{ return mDupeCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
+	const U8* getData() const		{ return mDP.getBuffer(); }
+	S32 getSize() const				{ return mDP.getBufferSize(); }
 
 	void dump() const;
-	BOOL writeToFile(LLAPRFile* apr_file) const;
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
 	LLDataPackerBinaryBuffer *getDP(U32 crc);
 	void recordHit();
 	void recordDupe() { mDupeCount++; }
+	// Copies data that points into the object store, before the store moves it.
+	void detachFromStore();
 
 public:
 	typedef std::map<U32, LLVOCacheEntry*>	vocache_entry_map_t;
 
+protected:
+	void freeBuffer();
+
 protected:
 	U32							mLocalID;
 	U32							mCRC;
@@ -73,28 +82,54 @@ protected:
 	S32							mDupeCount;
 	S32							mCRCChangeCount;
 	LLDataPackerBinaryBuffer	mDP;
-	U8							*mBuffer;
+	U8							*mBuffer;	// NULL if mDP points into the object store.
 };
 
 //
 //Note: LLVOCache is not thread-safe
 //
+// All regions are kept in one file, objectcache/objects.store, which is mapped into memory:
+//  HeaderMetaInfo
+//  MAX_NUM_OBJECT_ENTRIES HeaderEntryInfo, one per cached region (mTime is INVALID_TIME for unused ones)
+//  the data area, with one block per region: an ObjectInfo per object, sorted by local id, followed by the object data.
+// Blocks are only appended; the block that a region replaces becomes garbage until the data area is compacted.
+// The entries that readFromCache() returns point into their block, until writeToCache() is called for their region.
+//
 class LLVOCache
 {
 private:
 	struct HeaderEntryInfo
 	{
-		HeaderEntryInfo() : mIndex(0), mHandle(0), mTime(0) {}
+		HeaderEntryInfo() : mIndex(0), mHandle(0), mTime(0), mOffset(0), mSize(0), mNumObjects(0) {}
 		S32 mIndex;
 		U64 mHandle ;
 		U32 mTime ;
+		LLUUID mCacheID;	// The region's cache id; the cache is discarded when it changes.
+		U32 mOffset;		// Offset of the block of the region in the data area.
+		U32 mSize;			// Size of the block, or 0 if there is none.
+		U32 mNumObjects;
 	};
 
 	struct HeaderMetaInfo
 	{
-		HeaderMetaInfo() : mVersion(0){}
+		HeaderMetaInfo() : mVersion(0), mStoreVersion(0), mDataCapacity(0), mDataUsed(0), mDataGarbage(0) {}
 
 		U32 mVersion;
+		U32 mStoreVersion;
+		U32 mDataCapacity;	// Size of the data area.
+		U32 mDataUsed;		// New blocks are appended here.
+		U32 mDataGarbage;	// Bytes below mDataUsed that no region uses.
+	};
+
+	struct ObjectInfo
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		S32 mHitCount;
+		S32 mDupeCount;
+		S32 mCRCChangeCount;
+		U32 mOffset;		// Offset of the data in the block.
+		S32 mSize;
 	};
 
 	struct header_entry_less
@@ -111,6 +146,7 @@ private:
 	};
 	typedef std::set<HeaderEntryInfo*, header_entry_less> header_entry_queue_t;
 	typedef std::map<U64, HeaderEntryInfo*> handle_entry_map_t;
+	typedef std::map<U64, const LLVOCacheEntry::vocache_entry_map_t*> mapped_entries_map_t;
 private:
 	LLVOCache() ;
 
@@ -128,8 +164,6 @@ public:
 
 private:
 	void setDirNames(ELLPath location);	
-	// determine the cache filename for the region from the region handle	
-	void getObjectCacheFilename(U64 handle, std::string& filename);
 	void removeFromCache(HeaderEntryInfo* entry);
 	void readCacheHeader();
 	void writeCacheHeader();
@@ -138,6 +172,18 @@ private:
 	void removeEntry(HeaderEntryInfo* entry) ;
 	void purgeEntries(U32 size);
 	BOOL updateEntry(const HeaderEntryInfo* entry);
+
+	bool openStore(U32 data_capacity);
+	void closeStore();
+	U8* getDataArea() const;
+	HeaderEntryInfo* getStoredEntry(S32 index) const;
+	S32 findFreeIndex() const;
+	bool isValidBlock(const HeaderEntryInfo* entry) const;
+	// Makes sure that a block of size bytes can be appended. This may move all blocks.
+	bool reserveData(U32 size, const HeaderEntryInfo* keep);
+	void compactData();
+	// Makes the entries returned by readFromCache() copy their data, before blocks are moved.
+	void detachMappedEntries(const LLVOCacheEntry::vocache_entry_map_t* extra_map);
 	
 private:
 	BOOL                 mEnabled;
@@ -150,6 +196,8 @@ private:
 	std::string          mObjectCacheDirName;
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
+	LLMappedFile         mStore;
+	mapped_entries_map_t mMappedEntries;	// Entry maps of regions that point into mStore.
 
 	static LLVOCache* sInstance ;
 public:
@@ -44,6 +44,7 @@
 #include "llfloatertools.h"
 #include "llmaterialid.h"
 #include "llmaterialtable.h"
+#include "llobjectupdatequeue.h"
 #include "llprimitive.h"
 #include "llvolume.h"
 #include "llvolumeoctree.h"
@@ -398,7 +399,20 @@ U32 LLVOVolume::processUpdateMessage(LLMessageSystem *mesgsys,
 		if (update_type != OUT_TERSE_IMPROVED)
 		{
 			LLVolumeParams volume_params;
-			BOOL res = LLVolumeMessage::unpackVolumeParams(&volume_params, *dp);
+			BOOL res;
+			LLObjectUpdateDataPacker* queued_dp = dynamic_cast<LLObjectUpdateDataPacker*>(dp);
+			if (queued_dp && queued_dp->getRecord().mHasVolumeParams &&
+				queued_dp->getCurrentSize() == queued_dp->getRecord().mVolumeParamsStart)
+			{
+				// Already decoded by the thread that decoded the update.
+				volume_params = queued_dp->getRecord().mVolumeParams;
+				queued_dp->skipTo(queued_dp->getRecord().mVolumeParamsEnd);
+				res = TRUE;
+			}
+			else
+			{
+				res = LLVolumeMessage::unpackVolumeParams(&volume_params, *dp);
+			}
 			if (!res)
 			{
 				llwarns << "Bogus volume parameters in object " << getID() << llendl;
@@ -1282,6 +1296,27 @@ BOOL LLVOVolume::calcLOD()
 	}
 }
 
+BOOL LLVOVolume::isLODVolumeReady()
+{
+	LLVolume* volume = getVolume();
+	if (mLODRequest.notNull() && mLODRequest->getDetail() != LLVolumeLODGroup::getVolumeScaleFromDetail(mLOD))
+	{
+		// The LOD changed again before the request was done.
+		mLODRequest = NULL;
+	}
+	// Sculpties and meshes get their faces from elsewhere, and unique volumes aren't shared.
+	if (mLODRequest.isNull() && volume && !volume->isUnique() && !isSculpted())
+	{
+		mLODRequest = LLPrimitive::getVolumeManager()->requestVolume(volume->getParams(), mLOD);
+	}
+	if (mLODRequest.notNull() && !mLODRequest->isDone())
+	{
+		return FALSE;
+	}
+	mLODRequest = NULL;
+	return TRUE;
+}
+
 BOOL LLVOVolume::updateLOD()
 {
 	if (mDrawable.isNull())
@@ -1665,6 +1700,13 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 			genBBoxes(FALSE);
 		}
 	}
+	else if (mLODChanged && !mSculptChanged && !isLODVolumeReady())
+	{
+		// Keep the current LOD until the new one is generated; returning FALSE keeps us in the build queue.
+		LLFastTimer t(FTM_GEN_TRIANGLES);
+		genBBoxes(FALSE);
+		return FALSE;
+	}
 	else if ((mLODChanged) || (mSculptChanged))
 	{
 		dirtySpatialGroup(drawable->isState(LLDrawable::IN_REBUILD_Q1));
@@ -38,6 +38,7 @@
 #include "llviewermedia.h"
 #include "llframetimer.h"
 #include "llapr.h"
+#include "llvolumegenerator.h"
 #include "m3math.h"		// LLMatrix3
 #include "m4math.h"		// LLMatrix4
 #include <map>
@@ -337,6 +338,8 @@ public:
 protected:
 	S32	computeLODDetail(F32	distance, F32 radius);
 	BOOL calcLOD();
+	// Returns FALSE while the volume for mLOD is generated in the background.
+	BOOL isLODVolumeReady();
 	LLFace* addFace(S32 face_index);
 	void updateTEData();
 
@@ -363,6 +366,7 @@ private:
 	LLFrameTimer mTextureUpdateTimer;
 	S32			mLOD;
 	BOOL		mLODChanged;
+	LLPointer<LLVolumeRequest> mLODRequest;
 	BOOL		mSculptChanged;
 	F32			mSpotLightPriority;
 	LLMatrix4	mRelativeXform;
@@ -1949,6 +1949,7 @@ void LLPipeline::updateMovedList(LLDrawable::drawable_vector_t& moved_list)
 	}
 }
 
+static LLFastTimer::DeclareTimer FTM_OCTREE_MOVES("Move Octree Elements");
 static LLFastTimer::DeclareTimer FTM_OCTREE_BALANCE("Balance Octree");
 static LLFastTimer::DeclareTimer FTM_UPDATE_MOVE("Update Move");
 
@@ -1986,6 +1987,25 @@ void LLPipeline::updateMove()
 		updateMovedList(mMovedList);
 	}
 
+	//move the drawables that left their spatial group
+	{
+		LLFastTimer ot(FTM_OCTREE_MOVES);
+
+		for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
+			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+		{
+			LLViewerRegion* region = *iter;
+			for (U32 i = 0; i < LLViewerRegion::NUM_PARTITIONS; i++)
+			{
+				LLSpatialPartition* part = region->getSpatialPartition(i);
+				if (part)
+				{
+					part->applyMoves();
+				}
+			}
+		}
+	}
+
 	//balance octrees
 	{
  		LLFastTimer ot(FTM_OCTREE_BALANCE);
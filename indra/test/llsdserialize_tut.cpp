@@ -42,6 +42,7 @@
 #include "llsdserialize.h"
 #include "lltut.h"
 #include "llformat.h"
+#include "lltimer.h"
 
 // These tests take too long to run on Windows. JC
 // Yeah, who cares if windows works or not, right? Phoenix
@@ -505,6 +506,91 @@ namespace tut
 	};
 
 
+	/**
+	 * @class TestLLSDXMLParsing
+	 * @brief Concrete instance of a parse tester.
+	 */
+	/**
+	 * @class LLSDRebuildVisitor
+	 * @brief Visitor that builds the parsed document again from the events it gets.
+	 *
+	 * It descends into the maps and arrays up to max_depth levels deep and
+	 * logs the events in mEvents.
+	 */
+	class LLSDRebuildVisitor : public LLSDXMLVisitor
+	{
+	public:
+		LLSDRebuildVisitor(U32 max_depth) : mMaxDepth(max_depth) { }
+
+		/*virtual*/ bool beginMap(const std::string& key)
+		{
+			return begin(key, LLSD::emptyMap(), "{");
+		}
+
+		/*virtual*/ void endMap()
+		{
+			end("}");
+		}
+
+		/*virtual*/ bool beginArray(const std::string& key)
+		{
+			return begin(key, LLSD::emptyArray(), "[");
+		}
+
+		/*virtual*/ void endArray()
+		{
+			end("]");
+		}
+
+		/*virtual*/ void value(const std::string& key, const LLSD& value)
+		{
+			mEvents += key.empty() ? "v " : key + " ";
+			add(key, value);
+		}
+
+		LLSD mResult;
+		std::string mEvents;
+
+	private:
+		bool begin(const std::string& key, const LLSD& container, const std::string& event)
+		{
+			if (mStack.size() >= mMaxDepth)
+			{
+				return false;
+			}
+			mEvents += key + event + " ";
+			mStack.push_back(std::make_pair(key, container));
+			return true;
+		}
+
+		void end(const std::string& event)
+		{
+			mEvents += event + " ";
+			std::pair<std::string, LLSD> top = mStack.back();
+			mStack.pop_back();
+			add(top.first, top.second);
+		}
+
+		void add(const std::string& key, const LLSD& value)
+		{
+			if (mStack.empty())
+			{
+				mResult = value;
+			}
+			else if (mStack.back().second.isMap())
+			{
+				mStack.back().second[key] = value;
+			}
+			else
+			{
+				mStack.back().second.append(value);
+			}
+		}
+
+		U32 mMaxDepth;
+		std::vector<std::pair<std::string, LLSD> > mStack;
+	};
+
 	/**
 	 * @class TestLLSDXMLParsing
 	 * @brief Concrete instance of a parse tester.
@@ -513,6 +599,37 @@ namespace tut
 	{
 	public:
 		TestLLSDXMLParsing() {}
+
+		// Also check that a visitor gets the same document, however deep it descends into it.
+		void ensureParse(
+			const std::string& msg,
+			const std::string& in,
+			const LLSD& expected_value,
+			S32 expected_count)
+		{
+			TestLLSDParsing<LLSDXMLParser>::ensureParse(msg, in, expected_value, expected_count);
+
+			for (U32 max_depth = 0; max_depth < 4; ++max_depth)
+			{
+				std::string visitor_msg = llformat("%s (visitor depth %u)", msg.c_str(), max_depth);
+				std::stringstream input;
+				input.str(in);
+
+				LLSDRebuildVisitor visitor(max_depth);
+				LLSD parsed_result;
+				mParser->reset();
+				mParser->setVisitor(&visitor);
+				S32 parsed_count = mParser->parse(input, parsed_result, in.size());
+				mParser->setVisitor(NULL);
+
+				ensure(visitor_msg + " leaves data undefined", parsed_result.isUndefined());
+				if (expected_count != LLSDParser::PARSE_FAILURE)
+				{
+					ensure_equals(visitor_msg.c_str(), visitor.mResult, expected_value);
+				}
+				ensure_equals(visitor_msg + " (count)", parsed_count, expected_count);
+			}
+		}
 	};
 	
 	typedef tut::test_group<TestLLSDXMLParsing> TestLLSDXMLParsingGroup;
@@ -648,6 +765,46 @@ namespace tut
 			v.size() + 1);
 	}
 
+	template<> template<> 
+	void TestLLSDXMLParsingObject::test<4>()
+	{
+		// test the order of the visitor events, and that values it does not descend into arrive whole
+		std::string const in =
+			"<llsd><map>"
+				"<key>folders</key>"
+				"<array>"
+					"<map><key>folder_id</key><integer>1</integer><key>items</key><array><string>a</string></array></map>"
+					"<map><key>folder_id</key><integer>2</integer></map>"
+				"</array>"
+				"<key>count</key><integer>2</integer>"
+			"</map></llsd>";
+
+		LLSD folder;
+		folder["folder_id"] = 1;
+		folder["items"][0] = "a";
+
+		std::stringstream input;
+		input.str(in);
+		LLSDRebuildVisitor visitor(2);
+		LLSD parsed_result;
+		mParser->reset();
+		mParser->setVisitor(&visitor);
+		S32 parsed_count = mParser->parse(input, parsed_result, in.size());
+		mParser->setVisitor(NULL);
+
+		ensure_equals("events", visitor.mEvents, std::string("{ folders[ v v ] count } "));
+		ensure_equals("first folder", visitor.mResult["folders"][0], folder);
+		ensure_equals("count", parsed_count, 9);
+
+		// The same through LLSDSerialize.
+		input.clear();
+		input.str(in);
+		LLSDRebuildVisitor serialize_visitor(1);
+		ensure_equals("fromXML count", LLSDSerialize::fromXML(serialize_visitor, input), 9);
+		ensure_equals("fromXML events", serialize_visitor.mEvents, std::string("{ folders count } "));
+		ensure_equals("fromXML folder", serialize_visitor.mResult["folders"][0], folder);
+	}
+
 	/*
 	TODO:
 		test XML parsing
@@ -917,6 +1074,21 @@ namespace tut
 	{
 	public:
 		TestLLSDBinaryParsing() {}
+
+		// Also check that parsing from a buffer gives the same result as parsing from a stream.
+		void ensureParse(
+			const std::string& msg,
+			const std::string& in,
+			const LLSD& expected_value,
+			S32 expected_count)
+		{
+			TestLLSDParsing<LLSDBinaryParser>::ensureParse(msg, in, expected_value, expected_count);
+
+			LLSD parsed_result;
+			S32 parsed_count = mParser->parseBuffer((const U8*)in.data(), in.size(), parsed_result);
+			ensure_equals((msg + " (buffer)").c_str(), parsed_result, expected_value);
+			ensure_equals(msg + " (buffer count)", parsed_count, expected_count);
+		}
 	};
 
 	typedef tut::test_group<TestLLSDBinaryParsing> TestLLSDBinaryParsingGroup;
@@ -1234,12 +1406,57 @@ namespace tut
 			1);
 	}
 
-/*
 	template<> template<> 
 	void TestLLSDBinaryParsingObject::test<11>()
 	{
+		// Micro-benchmark: stream versus buffer parsing of the same binary LLSD.
+		LLSD val = LLSD::emptyMap();
+		fillmap(val["tree"], 10, 4);
+		// Something that looks like a list of inventory items: lots of maps with the same keys.
+		LLSD items = LLSD::emptyArray();
+		for (S32 i = 0; i < 2000; ++i)
+		{
+			LLSD item;
+			item["item_id"] = LLUUID::generateNewID();
+			item["name"] = llformat("Item number %d", i);
+			item["desc"] = "it must be a blue moon again";
+			item["type"] = i % 20;
+			item["created_at"] = LLDate(1234567.0 + i);
+			item["permissions"]["owner_mask"] = 0x7fffffff;
+			item["permissions"]["is_owner_group"] = false;
+			item["sale_info"]["sale_price"] = 10.5;
+			items.append(item);
+		}
+		val["items"] = items;
+
+		std::ostringstream ostr;
+		S32 format_count = LLSDSerialize::toBinary(val, ostr);
+		std::string const data = ostr.str();
+
+		const S32 ITERATIONS = 10;
+		LLTimer timer;
+		for (S32 i = 0; i < ITERATIONS; ++i)
+		{
+			std::istringstream istr(data);
+			LLSD result;
+			mParser->reset();
+			ensure_equals("stream parse count", mParser->parse(istr, result, data.size()), format_count);
+		}
+		F64 stream_time = timer.getElapsedTimeAndResetF64();
+		LLSD result;
+		for (S32 i = 0; i < ITERATIONS; ++i)
+		{
+			result.clear();
+			S32 bytes_read = 0;
+			ensure_equals("buffer parse count", mParser->parseBuffer((const U8*)data.data(), data.size(), result, &bytes_read), format_count);
+			ensure_equals("buffer bytes read", bytes_read, (S32)data.size());
+		}
+		F64 buffer_time = timer.getElapsedTimeF64();
+		ensure_equals("buffer parse result", result, val);
+
+		llinfos << "Binary LLSD parse of " << data.size() << " bytes: stream " << stream_time * 1000.0 / ITERATIONS
+				<< " ms, buffer " << buffer_time * 1000.0 / ITERATIONS << " ms" << llendl;
 	}
-*/
 
    /**
 	 * @class TestLLSDCrossCompatible
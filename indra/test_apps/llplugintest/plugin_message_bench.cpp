@@ -0,0 +1,164 @@
+/**
+ * @file plugin_message_bench.cpp
+ * @brief Round trip throughput of the plugin message wire formats.
+ *
+ * $LicenseInfo:firstyear=2008&license=viewergpl$
+ *
+ * Copyright (c) 2008-2009, Linden Research, Inc.
+ *
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ *
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ *
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ *
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+// Usage: plugin_message_bench [messages] [batch]
+//
+// Sends a mix of the messages that media plugins exchange most often through
+// the same steps as LLPluginProcessParent and LLPluginProcessChild do:
+// generate, frame (LLPluginMessagePipe::appendMessage), unframe
+// (LLPluginMessagePipe::extractMessage) and parse. The sender frames batch
+// messages before the receiver unframes them, like a socket read would.
+// Both wire formats are timed; beforehand, every kind of message is checked
+// to arrive unchanged.
+
+#include "linden_common.h"
+
+#include "llpluginmessage.h"
+#include "llpluginmessageclasses.h"
+#include "llpluginmessagepipe.h"
+#include "lltimer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+std::vector<LLPluginMessage> makeMessages()
+{
+	std::vector<LLPluginMessage> messages;
+
+	LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_MEDIA, "updated");
+	message.setValueS32("left", 16);
+	message.setValueS32("top", 480);
+	message.setValueS32("right", 640);
+	message.setValueS32("bottom", 32);
+	messages.push_back(message);
+
+	message.setMessage(LLPLUGIN_MESSAGE_CLASS_MEDIA, "mouse_event");
+	message.setValue("event", "move");
+	message.setValueS32("button", 0);
+	message.setValueS32("x", 312);
+	message.setValueS32("y", 207);
+	message.setValue("modifiers", "");
+	messages.push_back(message);
+
+	message.setMessage(LLPLUGIN_MESSAGE_CLASS_MEDIA, "cursor_changed");
+	message.setValue("name", "arrow");
+	messages.push_back(message);
+
+	message.setMessage(LLPLUGIN_MESSAGE_CLASS_MEDIA, "size_change");
+	message.setValue("name", "LL_PLUGIN_SHARED_MEMORY_1234_5");
+	message.setValueS32("width", 1024);
+	message.setValueS32("height", 768);
+	message.setValueS32("texture_width", 1024);
+	message.setValueS32("texture_height", 1024);
+	message.setValueReal("background_r", 1.0);
+	message.setValueReal("background_g", 1.0);
+	message.setValueReal("background_b", 1.0);
+	message.setValueReal("background_a", 1.0);
+	messages.push_back(message);
+
+	message.setMessage(LLPLUGIN_MESSAGE_CLASS_INTERNAL, "heartbeat");
+	message.setValueReal("cpu_usage", 0.125);
+	messages.push_back(message);
+
+	return messages;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	S32 count = argc > 1 ? atoi(argv[1]) : 200000;
+	S32 batch = argc > 2 ? atoi(argv[2]) : 16;
+	count = llmax(count, 1);
+	batch = llmax(batch, 1);
+
+	std::vector<LLPluginMessage> messages = makeMessages();
+	S32 errors = 0;
+	for (size_t i = 0; i < messages.size(); ++i)
+	{
+		for (S32 binary = 0; binary < 2; ++binary)
+		{
+			std::string wire;
+			std::string received;
+			LLPluginMessage parsed;
+			LLPluginMessagePipe::appendMessage(wire, binary ? messages[i].generateBinary() : messages[i].generate());
+			if (!LLPluginMessagePipe::extractMessage(wire, received) || !wire.empty() ||
+				parsed.parse(received) == -1 || parsed.generate() != messages[i].generate())
+			{
+				printf("%s message %s was not received correctly\n", binary ? "binary" : "xml", messages[i].getName().c_str());
+				++errors;
+			}
+		}
+	}
+
+	printf("%d messages in batches of %d\n", count, batch);
+
+	F64 xml_us = 0.0;
+	for (S32 binary = 0; binary < 2; ++binary)
+	{
+		std::string wire;
+		std::string received;
+		LLPluginMessage parsed;
+		size_t bytes = 0;
+
+		LLTimer timer;
+		for (S32 sent = 0; sent < count; )
+		{
+			for (S32 n = 0; n < batch && sent < count; ++n, ++sent)
+			{
+				const LLPluginMessage& message = messages[sent % messages.size()];
+				std::string buffer = binary ? message.generateBinary() : message.generate();
+				bytes += buffer.size();
+				LLPluginMessagePipe::appendMessage(wire, buffer);
+			}
+			while (LLPluginMessagePipe::extractMessage(wire, received))
+			{
+				if (parsed.parse(received) == -1)
+				{
+					++errors;
+				}
+			}
+		}
+		F64 us = timer.getElapsedTimeF64() * 1000000.0 / count;
+		if (!binary)
+		{
+			xml_us = us;
+		}
+		printf("%-6s %8.3f us per message  x%5.2f  %6.1f bytes per message\n",
+			   binary ? "binary" : "xml", us, xml_us / us, (F64)bytes / count);
+	}
+	return errors ? 1 : 0;
+}